@@ -13,6 +13,7 @@
 
 class BFile;
 class BSymLink;
+struct dir_stat_entry;
 struct stat_beos;
 
 
@@ -51,6 +52,10 @@ class BDirectory : public BNode, public BEntryList {
 		virtual status_t Rewind();
 		virtual int32 CountEntries();
 
+		int32 GetNextDirentStats(dir_stat_entry *buf, size_t bufSize,
+			const char *const *attributes = NULL, int32 attributeCount = 0,
+			size_t maxAttributeSize = 0, int32 count = INT_MAX);
+
 		status_t CreateDirectory(const char *path, BDirectory *dir);
 		status_t CreateFile(const char *path, BFile *file,
 			bool failIfExists = false);
@@ -39,6 +39,7 @@ extern "C" {
 #define _kern_write					_kernbuild_write
 #define _kern_writev				_kernbuild_writev
 #define _kern_read_dir				_kernbuild_read_dir
+#define _kern_read_dir_stat			_kernbuild_read_dir_stat
 #define _kern_rewind_dir			_kernbuild_rewind_dir
 #define _kern_read_stat				_kernbuild_read_stat
 #define _kern_write_stat			_kernbuild_write_stat
@@ -50,6 +51,7 @@ extern "C" {
 
 struct stat;
 struct dirent;
+struct dir_stat_entry;
 
 extern status_t		_kern_entry_ref_to_path(dev_t device, ino_t inode,
 						const char *leaf, char *userPath, size_t pathLength);
@@ -90,6 +92,10 @@ extern ssize_t		_kern_writev(int fd, off_t pos, const struct iovec *vecs,
 						size_t count);
 extern ssize_t		_kern_read_dir(int fd, struct dirent *buffer,
 						size_t bufferSize, uint32 maxCount);
+extern ssize_t		_kern_read_dir_stat(int fd, const char *const *attributes,
+						uint32 attributeCount, size_t maxAttributeSize,
+						struct dir_stat_entry *buffer, size_t bufferSize,
+						uint32 maxCount);
 extern status_t		_kern_rewind_dir(int fd);
 extern status_t		_kern_read_stat(int fd, const char *path,
 						bool traverseLink, struct stat *stat, size_t statSize);
@@ -0,0 +1 @@
+#include <../../../private/package/RepositoryDelta.h>
@@ -18,6 +18,7 @@
 
 
 struct dirent;
+struct dir_stat_entry;
 struct stat;
 struct fs_info;
 struct select_sync;
@@ -39,7 +40,11 @@ struct file_io_vec {
 	off_t	length;
 };
 
-#define	B_CURRENT_FS_API_VERSION "/v1"
+/* The suffix of the module names of file systems. It must be changed
+   whenever the layout of the structures below changes in a way that file
+   systems built against the old ones would be used incorrectly, so that
+   these won't be loaded anymore. "/v2" added fs_vnode_ops::read_dir_stat(). */
+#define	B_CURRENT_FS_API_VERSION "/v2"
 
 // flags for publish_vnode() and fs_volume_ops::get_vnode()
 #define B_VNODE_PUBLISH_REMOVED					0x01
@@ -251,6 +256,13 @@ struct fs_vnode_ops {
 				const struct flock* lock, bool wait);
 	status_t (*release_lock)(fs_volume* volume, fs_vnode* vnode, void* cookie,
 				const struct flock* lock);
+
+	/* batched directory reading */
+	status_t (*read_dir_stat)(fs_volume* volume, fs_vnode* vnode,
+				void* cookie, const char* const* attributes,
+				uint32 attributeCount, size_t maxAttributeSize,
+				struct dir_stat_entry* buffer, size_t bufferSize,
+				uint32* _num);
 };
 
 struct file_system_module_info {
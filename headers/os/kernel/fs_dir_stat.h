@@ -0,0 +1,84 @@
+/*
+ * Copyright 2026, Haiku Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _FS_DIR_STAT_H
+#define	_FS_DIR_STAT_H
+
+
+#include <OS.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+
+#define DIR_STAT_MAX_ATTRIBUTES		16
+#define DIR_STAT_MAX_ATTRIBUTE_SIZE	4096
+
+typedef struct dir_stat_attr {
+	uint32			type;
+	uint32			offset;
+		/* of the attribute data, relative to the start of the entry */
+	off_t			size;
+		/* of the attribute, or an error code; at most the maximum attribute
+		   size passed in has been copied */
+} dir_stat_attr;
+
+typedef struct dir_stat_entry {
+	uint32			length;
+		/* of the whole entry, the next one directly follows it */
+	uint32			dirent_offset;
+	uint32			attribute_count;
+	status_t		stat_status;
+	struct stat		stat;
+#if __GNUC__ == 2
+	dir_stat_attr	attributes[0];
+#else
+	dir_stat_attr	attributes[];
+#endif
+} dir_stat_entry;
+
+
+#define DIR_STAT_ALIGN(size)	(((size) + 7) & ~(size_t)7)
+
+/*! Returns the size of an entry with the given number of attributes and name
+	length. An entry never takes up more space than one for a name of
+	B_FILE_NAME_LENGTH - 1 bytes.
+*/
+static inline size_t
+dir_stat_entry_size(uint32 attributeCount, size_t maxAttributeSize,
+	size_t nameLength)
+{
+	return DIR_STAT_ALIGN(sizeof(dir_stat_entry)
+			+ attributeCount * sizeof(dir_stat_attr))
+		+ attributeCount * DIR_STAT_ALIGN(maxAttributeSize)
+		+ DIR_STAT_ALIGN(sizeof(struct dirent) + nameLength + 1);
+}
+
+static inline struct dirent*
+dir_stat_entry_dirent(const dir_stat_entry* entry)
+{
+	return (struct dirent*)((uint8*)entry + entry->dirent_offset);
+}
+
+static inline void*
+dir_stat_entry_attribute_data(const dir_stat_entry* entry, uint32 index)
+{
+	return (uint8*)entry + entry->attributes[index].offset;
+}
+
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+extern ssize_t	fs_read_dir_stat(int fd, const char* const* attributes,
+					uint32 attributeCount, size_t maxAttributeSize,
+					dir_stat_entry* buffer, size_t bufferSize,
+					uint32 maxCount);
+
+#ifdef  __cplusplus
+}
+#endif
+
+
+#endif	/* _FS_DIR_STAT_H */
@@ -39,7 +39,12 @@ protected:
 	virtual	void				JobSucceeded(BSupportKit::BJob* job);
 
 private:
+			status_t			_ApplyRepositoryDelta(
+									const BEntry& repoCacheEntry);
 			status_t			_FetchRepositoryCache();
+			status_t			_ActivateRepositoryCache(
+									const BEntry& repoCacheEntry,
+									BSupportKit::BJob* dependency);
 
 			BEntry				fFetchedChecksumFile;
 			BRepositoryConfig	fRepoConfig;
@@ -57,10 +57,16 @@ public:
 			int32				CompressionLevel() const;
 			void				SetCompressionLevel(int32 compressionLevel);
 
+			int32				ThreadCount() const;
+			void				SetThreadCount(int32 threadCount);
+
 private:
+	// The fields must not exceed the size of the original three 32 bit
+	// fields, since the class is embedded in applications.
 			uint32				fFlags;
-			uint32				fCompression;
-			int32				fCompressionLevel;
+			uint16				fCompression;
+			int16				fCompressionLevel;
+			int32				fThreadCount;
 };
 
 
@@ -14,4 +14,9 @@ struct udphdr {
 	uint16_t uh_sum;
 };
 
+/* options that can be set using setsockopt() and level IPPROTO_UDP */
+
+#define UDP_SEGMENT		103
+	/* split sends into datagrams of this size */
+
 #endif /* _NETINET_UDP_H */
@@ -128,6 +128,13 @@ struct msghdr {
 #define MSG_NOSIGNAL	0x0800	/* don't raise SIGPIPE if socket is closed */
 #define MSG_CMSG_CLOEXEC	0x1000	/* set FD_CLOEXEC flag on FDs created via SCM_RIGHTS */
 #define MSG_CMSG_CLOFORK	0x2000	/* set FD_CLOFORK flag on FDs created via SCM_RIGHTS */
+#define MSG_WAITFORONE	0x4000	/* recvmmsg(): don't wait after the first message */
+
+/* used by recvmmsg() and sendmmsg() */
+struct mmsghdr {
+	struct msghdr	msg_hdr;		/* the message */
+	unsigned int	msg_len;		/* number of bytes transferred */
+};
 
 struct cmsghdr {
 	socklen_t	cmsg_len;
@@ -164,6 +171,9 @@ struct ucred {
 };
 
 
+struct timespec;
+
+
 #if __cplusplus
 extern "C" {
 #endif
@@ -185,8 +195,12 @@ ssize_t recv(int socket, void *buffer, size_t length, int flags);
 ssize_t recvfrom(int socket, void *buffer, size_t bufferLength, int flags,
 			struct sockaddr *address, socklen_t *_addressLength);
 ssize_t recvmsg(int socket, struct msghdr *message, int flags);
+int		recvmmsg(int socket, struct mmsghdr *messages, unsigned int count,
+			int flags, struct timespec *timeout);
 ssize_t send(int socket, const void *buffer, size_t length, int flags);
 ssize_t	sendmsg(int socket, const struct msghdr *message, int flags);
+int		sendmmsg(int socket, struct mmsghdr *messages, unsigned int count,
+			int flags);
 ssize_t sendto(int socket, const void *message, size_t length, int flags,
 			const struct sockaddr *address, socklen_t addressLength);
 int     setsockopt(int socket, int level, int option, const void *value,
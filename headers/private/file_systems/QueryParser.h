@@ -26,6 +26,8 @@
 #	include "fssh_auto_deleter.h"
 #else
 #	include <dirent.h>
+#	include <stdarg.h>
+#	include <stdio.h>
 #	include <stdlib.h>
 #	include <string.h>
 
@@ -72,6 +74,7 @@ namespace QueryParser {
 
 template<typename QueryPolicy> class Equation;
 template<typename QueryPolicy> class Expression;
+template<typename QueryPolicy> class Operator;
 template<typename QueryPolicy> class Term;
 template<typename QueryPolicy> class Query;
 
@@ -94,6 +97,113 @@ enum ops {
 };
 
 
+// The query planner considers loading an entry to check it against the rest
+// of the query this much more expensive than reading an index entry.
+static const int64 kEntryCost = 16;
+
+// Intersecting the entries of several indices is only considered for up to
+// that many equations of an "and" operator, and for up to that many entries
+// per index.
+static const int32 kMaxConjunctionTerms = 16;
+static const int32 kMaxIntersectionTerms = 4;
+static const int64 kMaxIntersectionEntries = 262144;
+
+
+static inline const char*
+operatorSymbol(int32 op)
+{
+	switch (op) {
+		case OP_EQUAL: return "==";
+		case OP_UNEQUAL: return "!=";
+		case OP_GREATER_THAN: return ">";
+		case OP_GREATER_THAN_OR_EQUAL: return ">=";
+		case OP_LESS_THAN: return "<";
+		case OP_LESS_THAN_OR_EQUAL: return "<=";
+		case OP_AND: return "&&";
+		case OP_OR: return "||";
+	}
+	return "???";
+}
+
+
+static inline int
+compareNodeIDs(const void* _a, const void* _b)
+{
+	ino_t a = *(const ino_t*)_a;
+	ino_t b = *(const ino_t*)_b;
+	return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+
+/*!	Removes all IDs from the sorted \a ids array that are not part of the
+	sorted \a other array, and returns the number of IDs that are left.
+*/
+static inline uint32
+intersectNodeIDs(ino_t* ids, uint32 count, const ino_t* other,
+	uint32 otherCount)
+{
+	uint32 left = 0;
+	for (uint32 i = 0, j = 0; i < count && j < otherCount;) {
+		if (ids[i] < other[j])
+			i++;
+		else if (ids[i] > other[j])
+			j++;
+		else {
+			ids[left++] = ids[i++];
+			j++;
+		}
+	}
+	return left;
+}
+
+
+/*!	Collects the text of Query::Explain() in a fixed size buffer that always
+	stays null terminated.
+*/
+class ExplainBuffer {
+public:
+	ExplainBuffer(char* buffer, size_t size)
+		:
+		fBuffer(buffer),
+		fSize(size),
+		fLength(0),
+		fTruncated(size == 0)
+	{
+		if (size > 0)
+			buffer[0] = '\0';
+	}
+
+	void Printf(const char* format, ...)
+	{
+		if (fTruncated)
+			return;
+
+		va_list args;
+		va_start(args, format);
+		int length = vsnprintf(fBuffer + fLength, fSize - fLength, format,
+			args);
+		va_end(args);
+
+		if (length < 0 || (size_t)length >= fSize - fLength) {
+			fLength = fSize - 1;
+			fTruncated = true;
+		} else
+			fLength += length;
+	}
+
+	bool IsTruncated() const
+	{
+		return fTruncated;
+	}
+
+private:
+	char*	fBuffer;
+	size_t	fSize;
+	size_t	fLength;
+	bool	fTruncated;
+};
+
+
 template<typename QueryPolicy>
 union value {
 	int64	Int64;
@@ -128,6 +238,7 @@ public:
 
 			status_t		Rewind();
 	inline	status_t		GetNextEntry(struct dirent* dirent, size_t size);
+			status_t		Explain(char* buffer, size_t bufferSize);
 
 			void			LiveUpdate(Entry* entry, Node* node,
 								const char* attribute, int32 type,
@@ -145,6 +256,8 @@ public:
 								{ return fFlags; }
 
 private:
+			Term<QueryPolicy>* _PlanConjunction(Operator<QueryPolicy>* op);
+			int64			_TotalEntries();
 			status_t		_GetNextEntry(struct dirent* dirent, size_t size);
 			void			_EvaluateLiveUpdate(Entry* entry, Node* node,
 								const char* attribute, int32 type,
@@ -161,6 +274,13 @@ private:
 			IndexIterator*	fIterator;
 			Index			fIndex;
 			Stack<Equation<QueryPolicy>*> fStack;
+			Stack<Equation<QueryPolicy>*> fPlan;
+
+			ino_t*			fCandidates;
+			uint32			fCandidateCount;
+			uint32			fNextCandidate;
+			bool			fIntersecting;
+			int64			fTotalEntries;
 
 			uint32			fFlags;
 			port_id			fPort;
@@ -203,6 +323,8 @@ public:
 
 	virtual	bool		NeedsEntry() = 0;
 
+	virtual	void		Describe(ExplainBuffer& buffer) const = 0;
+
 #ifdef DEBUG_QUERY
 	virtual	void		PrintToStream() = 0;
 #endif
@@ -255,12 +377,38 @@ public:
 			status_t	GetNextMatching(Context* context,
 							IndexIterator* iterator, struct dirent* dirent,
 							size_t bufferSize);
+			status_t	GetNextCandidate(Context* context,
+							const ino_t* candidates, uint32 count,
+							uint32& next, struct dirent* dirent,
+							size_t bufferSize);
+
+			status_t	Intersect(Context* context, Index& index,
+							ino_t** _ids, uint32* _count);
+			status_t	CollectNodeIDs(Context* context, Index& index,
+							ino_t** _ids, uint32* _count);
+			status_t	MatchConjunction(Entry* entry, bool matchThis);
 
 	virtual	void		CalculateScore(Index &index);
 	virtual	int32		Score() const { return fScore; }
 
+			int64		EstimatedReads() const { return fEstimatedReads; }
+			int64		EstimatedMatches() const
+							{ return fEstimatedMatches; }
+			bool		CanIntersect() const;
+			Equation<QueryPolicy>* NextIntersection() const
+							{ return fNextIntersection; }
+			void		SetNextIntersection(Equation<QueryPolicy>* next)
+							{ fNextIntersection = next; }
+			void		SetEstimatedCandidates(int64 candidates)
+							{ fEstimatedCandidates = candidates; }
+
+			void		ResetStatistics();
+			void		Explain(ExplainBuffer& buffer, int32 step) const;
+
 	virtual	bool		NeedsEntry();
 
+	virtual	void		Describe(ExplainBuffer& buffer) const;
+
 #ifdef DEBUG_QUERY
 	virtual	void		PrintToStream();
 #endif
@@ -274,6 +422,12 @@ private:
 			bool		CompareTo(const uint8* value, size_t size);
 			uint8*		Value() const { return (uint8*)&fValue; }
 
+			status_t	_EstimateMatches(Index& index);
+			status_t	_NextIndexEntry(IndexIterator* iterator);
+			void		_FillDirent(Context* context, Entry* entry,
+							struct dirent* dirent, size_t bufferSize);
+			void		_ExplainIndex(ExplainBuffer& buffer) const;
+
 			char*		fAttribute;
 			char*		fString;
 			union value<QueryPolicy> fValue;
@@ -283,6 +437,17 @@ private:
 
 			int32		fScore;
 			bool		fHasIndex;
+
+			// query planning and statistics
+			int64		fEstimatedReads;
+			int64		fEstimatedMatches;
+			int64		fEstimatedCandidates;
+			Equation<QueryPolicy>* fNextIntersection;
+			int64		fEntriesRead;
+			int64		fEntriesMatched;
+			int64		fEntriesChecked;
+			int64		fEntriesReturned;
+			int64		fCandidates;
 };
 
 
@@ -318,6 +483,8 @@ public:
 
 	virtual	bool		NeedsEntry();
 
+	virtual	void		Describe(ExplainBuffer& buffer) const;
+
 #ifdef DEBUG_QUERY
 	virtual	void		PrintToStream();
 #endif
@@ -373,7 +540,17 @@ Equation<QueryPolicy>::Equation(const char** expr)
 	fType(0),
 	fSize(0),
 	fIsPattern(false),
-	fScore(INT32_MAX)
+	fScore(INT32_MAX),
+	fHasIndex(false),
+	fEstimatedReads(-1),
+	fEstimatedMatches(-1),
+	fEstimatedCandidates(-1),
+	fNextIntersection(NULL),
+	fEntriesRead(0),
+	fEntriesMatched(0),
+	fEntriesChecked(0),
+	fEntriesReturned(0),
+	fCandidates(-1)
 {
 	const char* string = *expr;
 	const char* start = string;
@@ -764,6 +941,9 @@ Equation<QueryPolicy>::CalculateScore(Index &index)
 	// As always, these values could be tuned and refined.
 	// And the code could also need some real world testing :-)
 
+	fEstimatedReads = -1;
+	fEstimatedMatches = -1;
+
 	// do we have to operate on a "foreign" index?
 	if (QueryPolicy::IndexSetTo(index, fAttribute) != B_OK) {
 		fScore = INT32_MAX;
@@ -776,6 +956,14 @@ Equation<QueryPolicy>::CalculateScore(Index &index)
 		return;
 	}
 
+	// If the index can tell how many entries we would have to look at, use
+	// that to score the equation
+	if (_EstimateMatches(index) == B_OK) {
+		int64 cost = fEstimatedReads + kEntryCost * fEstimatedMatches;
+		fScore = cost < INT32_MAX ? (int32)cost : INT32_MAX - 1;
+		return;
+	}
+
 	fScore = QueryPolicy::IndexGetSize(index);
 
 	if (Term<QueryPolicy>::fOp == OP_UNEQUAL) {
@@ -860,11 +1048,15 @@ Equation<QueryPolicy>::PrepareQuery(Context* /*context*/, Index& index,
 		// is either OP_EQUAL or OP_UNEQUAL
 		if (fIsPattern) {
 			// let's see if we can use the beginning of the key for positioning
-			// the iterator and adjust the key size; if not, just leave the
-			// iterator at the start and return success
+			// the iterator and adjust the key size; if not, the index might
+			// still be able to narrow down the entries that could match the
+			// pattern, otherwise just leave the iterator at the start and
+			// return success
 			keySize = getFirstPatternSymbol(fString);
-			if (keySize <= 0)
+			if (keySize <= 0) {
+				QueryPolicy::IndexIteratorFindPattern(*iterator, fString);
 				return B_OK;
+			}
 		}
 
 		if (keySize == 0) {
@@ -904,33 +1096,11 @@ Equation<QueryPolicy>::GetNextMatching(Context* context,
 	IndexIterator* iterator, struct dirent* dirent, size_t bufferSize)
 {
 	while (true) {
-		NodeHolder nodeHolder;
-		union value<QueryPolicy> indexValue;
-		size_t keyLength;
-		size_t duplicate = 0;
-
-		status_t status = QueryPolicy::IndexIteratorFetchNextEntry(iterator,
-			&indexValue, &keyLength, (size_t)sizeof(indexValue), &duplicate);
+		status_t status = _NextIndexEntry(iterator);
 		if (status != B_OK)
 			return status;
 
-		// only compare against the index entry when this is the correct
-		// index for the equation
-		if (fHasIndex && duplicate < 2 && !CompareTo((uint8*)&indexValue, keyLength)) {
-			// They aren't equal? Let the operation decide what to do. Since
-			// we always start at the beginning of the index (or the correct
-			// position), only some needs to be stopped if the entry doesn't
-			// fit.
-			if (Term<QueryPolicy>::fOp == OP_LESS_THAN
-				|| Term<QueryPolicy>::fOp == OP_LESS_THAN_OR_EQUAL
-				|| (Term<QueryPolicy>::fOp == OP_EQUAL && !fIsPattern))
-				return B_ENTRY_NOT_FOUND;
-
-			if (duplicate > 0)
-				QueryPolicy::IndexIteratorSkipDuplicates(iterator);
-			continue;
-		}
-
+		NodeHolder nodeHolder;
 		Entry* entry = NULL;
 		status = QueryPolicy::IndexIteratorGetEntry(context, iterator,
 			nodeHolder, &entry);
@@ -939,6 +1109,8 @@ Equation<QueryPolicy>::GetNextMatching(Context* context,
 			continue;
 		}
 
+		fEntriesChecked++;
+
 		// TODO: check user permissions here - but which one?!
 		// we could filter out all those where we don't have
 		// read access... (we should check for every parent
@@ -948,61 +1120,390 @@ Equation<QueryPolicy>::GetNextMatching(Context* context,
 		// query will do something similar (and we don't have
 		// to do it for root, either).
 
-		// go up in the tree until a &&-operator is found, and check if the
-		// node matches with the rest of the expression - we don't have to
-		// check ||-operators for that
-		Term<QueryPolicy>* term = this;
-		status = MATCH_OK;
+		if (MatchConjunction(entry, !fHasIndex) == MATCH_OK) {
+			_FillDirent(context, entry, dirent, bufferSize);
+			fEntriesReturned++;
+			return B_OK;
+		}
+	}
+}
+
+
+/*!	Like GetNextMatching(), but goes through the IDs of the nodes that
+	Intersect() found instead of the index, starting at \a next.
+*/
+template<typename QueryPolicy>
+status_t
+Equation<QueryPolicy>::GetNextCandidate(Context* context,
+	const ino_t* candidates, uint32 count, uint32& next, struct dirent* dirent,
+	size_t bufferSize)
+{
+	while (next < count) {
+		NodeHolder nodeHolder;
+		Entry* entry = NULL;
+		status_t status = QueryPolicy::ContextGetEntry(context,
+			candidates[next++], nodeHolder, &entry);
+		if (status != B_OK)
+			continue;
+
+		fEntriesChecked++;
 
-		if (!fHasIndex)
-			status = Match(entry, QueryPolicy::EntryGetNode(entry));
+		// The indices only told us that the entry might match
+		if (MatchConjunction(entry, true) == MATCH_OK) {
+			_FillDirent(context, entry, dirent, bufferSize);
+			fEntriesReturned++;
+			return B_OK;
+		}
+	}
 
-		while (term != NULL && status == MATCH_OK) {
-			Operator<QueryPolicy>* parent
-				= (Operator<QueryPolicy>*)term->Parent();
-			if (parent == NULL)
-				break;
+	return B_ENTRY_NOT_FOUND;
+}
 
-			if (parent->Op() == OP_AND) {
-				// choose the other child of the parent
-				Term<QueryPolicy>* other = parent->Right();
-				if (other == term)
-					other = parent->Left();
 
-				if (other == NULL) {
-					QUERY_FATAL("&&-operator has only one child... "
-						"(parent = %p)\n", parent);
+/*!	Returns the sorted IDs of all nodes that may match this equation, and all
+	equations that were chained to it with SetNextIntersection().
+	If there are too many entries in the index of this equation, this fails,
+	and the query should iterate over the index instead. The other indices
+	only reduce the number of candidates further if they can.
+*/
+template<typename QueryPolicy>
+status_t
+Equation<QueryPolicy>::Intersect(Context* context, Index& index,
+	ino_t** _ids, uint32* _count)
+{
+	ino_t* ids;
+	uint32 count;
+	status_t status = CollectNodeIDs(context, index, &ids, &count);
+	if (status != B_OK)
+		return status;
+
+	for (Equation<QueryPolicy>* equation = fNextIntersection;
+			equation != NULL && count > 0;
+			equation = equation->fNextIntersection) {
+		ino_t* otherIDs;
+		uint32 otherCount;
+		if (equation->CollectNodeIDs(context, index, &otherIDs, &otherCount)
+				!= B_OK) {
+			// all candidates are checked against the whole query anyway
+			continue;
+		}
+
+		count = intersectNodeIDs(ids, count, otherIDs, otherCount);
+		free(otherIDs);
+	}
+
+	fCandidates = count;
+	*_ids = ids;
+	*_count = count;
+	return B_OK;
+}
+
+
+/*!	Returns the sorted IDs of all nodes of which the index tells that they
+	match this equation.
+*/
+template<typename QueryPolicy>
+status_t
+Equation<QueryPolicy>::CollectNodeIDs(Context* context, Index& index,
+	ino_t** _ids, uint32* _count)
+{
+	IndexIterator* iterator = NULL;
+	status_t status = PrepareQuery(context, index, &iterator, false);
+	if (!fHasIndex) {
+		QueryPolicy::IndexIteratorDelete(iterator);
+		return B_BAD_VALUE;
+	}
+
+	uint32 count = 0;
+	uint32 size = 256;
+	ino_t* ids = (ino_t*)malloc(size * sizeof(ino_t));
+	if (ids == NULL)
+		status = B_NO_MEMORY;
+
+	if (status == B_OK) {
+		while ((status = _NextIndexEntry(iterator)) == B_OK) {
+			if (count == size) {
+				if (size >= kMaxIntersectionEntries) {
+					status = B_BUFFER_OVERFLOW;
 					break;
 				}
-				status = other->Match(entry, QueryPolicy::EntryGetNode(entry));
-				if (status < 0) {
-					QUERY_REPORT_ERROR(status);
-					status = NO_MATCH;
+
+				size *= 2;
+				ino_t* newIDs = (ino_t*)realloc(ids, size * sizeof(ino_t));
+				if (newIDs == NULL) {
+					status = B_NO_MEMORY;
+					break;
 				}
+				ids = newIDs;
 			}
-			term = (Term<QueryPolicy>*)parent;
+
+			ids[count++] = QueryPolicy::IndexIteratorGetNodeID(iterator);
 		}
+	}
+
+	QueryPolicy::IndexIteratorDelete(iterator);
+
+	// B_ENTRY_NOT_FOUND also means that there is no matching key at all
+	if (status != B_ENTRY_NOT_FOUND) {
+		free(ids);
+		return status;
+	}
+
+	qsort(ids, count, sizeof(ino_t), &compareNodeIDs);
+
+	uint32 unique = 0;
+	for (uint32 i = 0; i < count; i++) {
+		if (unique == 0 || ids[i] != ids[unique - 1])
+			ids[unique++] = ids[i];
+	}
+	count = unique;
+
+	*_ids = ids;
+	*_count = count;
+	return B_OK;
+}
+
+
+/*!	Checks if the entry matches this equation (if \a matchThis is \c true),
+	and all terms that it is combined with by an "and" operator.
+	There is no need to check the terms combined by an "or" operator, as we
+	already know that the entry matches this equation.
+*/
+template<typename QueryPolicy>
+status_t
+Equation<QueryPolicy>::MatchConjunction(Entry* entry, bool matchThis)
+{
+	// go up in the tree until a &&-operator is found, and check if the
+	// node matches with the rest of the expression - we don't have to
+	// check ||-operators for that
+	Term<QueryPolicy>* term = this;
+	status_t status = MATCH_OK;
+
+	if (matchThis)
+		status = Match(entry, QueryPolicy::EntryGetNode(entry));
+
+	while (term != NULL && status == MATCH_OK) {
+		Operator<QueryPolicy>* parent
+			= (Operator<QueryPolicy>*)term->Parent();
+		if (parent == NULL)
+			break;
 
-		if (status == MATCH_OK) {
-			ssize_t nameLength = QueryPolicy::EntryGetName(entry,
-				dirent->d_name,
-				(const char*)dirent + bufferSize - dirent->d_name);
-			if (nameLength < 0) {
-				// Invalid or unknown name.
-				nameLength = 0;
+		if (parent->Op() == OP_AND) {
+			// choose the other child of the parent
+			Term<QueryPolicy>* other = parent->Right();
+			if (other == term)
+				other = parent->Left();
+
+			if (other == NULL) {
+				QUERY_FATAL("&&-operator has only one child... "
+					"(parent = %p)\n", parent);
+				break;
+			}
+			status = other->Match(entry, QueryPolicy::EntryGetNode(entry));
+			if (status < 0) {
+				QUERY_REPORT_ERROR(status);
+				status = NO_MATCH;
 			}
+		}
+		term = (Term<QueryPolicy>*)parent;
+	}
 
-			dirent->d_dev = QueryPolicy::ContextGetVolumeID(context);
-			dirent->d_ino = QueryPolicy::EntryGetNodeID(entry);
-			dirent->d_pdev = dirent->d_dev;
-			dirent->d_pino = QueryPolicy::EntryGetParentID(entry);
-			dirent->d_reclen = offsetof(struct dirent, d_name) + nameLength;
+	return status;
+}
+
+
+/*!	An equation can only be part of an intersection if it can be resolved
+	completely by its index, and if that doesn't contain too many matches.
+*/
+template<typename QueryPolicy>
+bool
+Equation<QueryPolicy>::CanIntersect() const
+{
+	return fEstimatedMatches >= 0
+		&& fEstimatedMatches <= kMaxIntersectionEntries
+		&& Term<QueryPolicy>::fOp != OP_UNEQUAL;
+}
+
+
+template<typename QueryPolicy>
+void
+Equation<QueryPolicy>::ResetStatistics()
+{
+	fEntriesRead = 0;
+	fEntriesMatched = 0;
+	fEntriesChecked = 0;
+	fEntriesReturned = 0;
+	fCandidates = -1;
+}
+
+
+/*!	Describes how this equation is used as \a step of the query plan, and
+	what it has done so far.
+*/
+template<typename QueryPolicy>
+void
+Equation<QueryPolicy>::Explain(ExplainBuffer& buffer, int32 step) const
+{
+	buffer.Printf("%" B_PRId32 ". ", step);
+
+	if (fNextIntersection != NULL) {
+		buffer.Printf("intersect indices, ~%" B_PRId64 " candidates",
+			fEstimatedCandidates);
+		if (fCandidates >= 0)
+			buffer.Printf(" (found %" B_PRId64 ")", fCandidates);
+		buffer.Printf("\n");
+
+		for (const Equation<QueryPolicy>* equation = this; equation != NULL;
+				equation = equation->fNextIntersection) {
+			buffer.Printf("     ");
+			equation->_ExplainIndex(buffer);
 		}
+	} else
+		_ExplainIndex(buffer);
+
+	buffer.Printf("   checked %" B_PRId64 " entries, returned %" B_PRId64
+		"\n", fEntriesChecked, fEntriesReturned);
+
+	const Term<QueryPolicy>* term = this;
+	while (const Operator<QueryPolicy>* parent
+			= (const Operator<QueryPolicy>*)term->Parent()) {
+		if (parent->Op() == OP_AND) {
+			const Term<QueryPolicy>* other = parent->Right();
+			if (other == term)
+				other = parent->Left();
+
+			buffer.Printf("   filter: ");
+			other->Describe(buffer);
+			buffer.Printf("\n");
+		}
+		term = parent;
+	}
+}
 
-		if (status == MATCH_OK)
-			return B_OK;
+
+/*!	Returns an estimate of how many index entries have to be read to find all
+	matches for this equation, and how many of these actually match.
+*/
+template<typename QueryPolicy>
+status_t
+Equation<QueryPolicy>::_EstimateMatches(Index& index)
+{
+	int32 op = Term<QueryPolicy>::fOp;
+	const void* value = Value();
+	size_t size = fSize;
+	bool prefix = false;
+	bool exact = true;
+
+	if (op == OP_UNEQUAL) {
+		// we'll need to scan the whole index
+		value = NULL;
+	} else if (fIsPattern) {
+		int32 prefixLength = getFirstPatternSymbol(fString);
+		if (prefixLength > 0) {
+			size = prefixLength;
+			prefix = true;
+		} else
+			value = NULL;
+
+		// all keys with the prefix only match a trailing "*"
+		exact = prefixLength >= 0 && fString[prefixLength] == '*'
+			&& fString[prefixLength + 1] == '\0';
+	} else if (fType == B_STRING_TYPE && size == 0) {
+		// the empty string includes the trailing null byte
+		size = 1;
 	}
-	QUERY_RETURN_ERROR(B_ERROR);
+
+	int64 count;
+	status_t status = QueryPolicy::IndexEstimateCount(index, op, value, size,
+		prefix, &count);
+	if (status != B_OK)
+		return status;
+
+	fEstimatedReads = count;
+	// Guess how many keys will match the pattern
+	fEstimatedMatches = exact ? count : count / 4;
+	return B_OK;
+}
+
+
+/*!	Moves the iterator to the next entry that matches the equation, as far as
+	the index can tell.
+*/
+template<typename QueryPolicy>
+status_t
+Equation<QueryPolicy>::_NextIndexEntry(IndexIterator* iterator)
+{
+	while (true) {
+		union value<QueryPolicy> indexValue;
+		size_t keyLength;
+		size_t duplicate = 0;
+
+		status_t status = QueryPolicy::IndexIteratorFetchNextEntry(iterator,
+			&indexValue, &keyLength, (size_t)sizeof(indexValue), &duplicate);
+		if (status != B_OK)
+			return status;
+
+		fEntriesRead++;
+
+		// only compare against the index entry when this is the correct
+		// index for the equation
+		if (fHasIndex && duplicate < 2 && !CompareTo((uint8*)&indexValue, keyLength)) {
+			// They aren't equal? Let the operation decide what to do. Since
+			// we always start at the beginning of the index (or the correct
+			// position), only some needs to be stopped if the entry doesn't
+			// fit.
+			if (Term<QueryPolicy>::fOp == OP_LESS_THAN
+				|| Term<QueryPolicy>::fOp == OP_LESS_THAN_OR_EQUAL
+				|| (Term<QueryPolicy>::fOp == OP_EQUAL && !fIsPattern))
+				return B_ENTRY_NOT_FOUND;
+
+			if (duplicate > 0)
+				QueryPolicy::IndexIteratorSkipDuplicates(iterator);
+			continue;
+		}
+
+		fEntriesMatched++;
+		return B_OK;
+	}
+}
+
+
+template<typename QueryPolicy>
+void
+Equation<QueryPolicy>::_FillDirent(Context* context, Entry* entry,
+	struct dirent* dirent, size_t bufferSize)
+{
+	ssize_t nameLength = QueryPolicy::EntryGetName(entry, dirent->d_name,
+		(const char*)dirent + bufferSize - dirent->d_name);
+	if (nameLength < 0) {
+		// Invalid or unknown name.
+		nameLength = 0;
+	}
+
+	dirent->d_dev = QueryPolicy::ContextGetVolumeID(context);
+	dirent->d_ino = QueryPolicy::EntryGetNodeID(entry);
+	dirent->d_pdev = dirent->d_dev;
+	dirent->d_pino = QueryPolicy::EntryGetParentID(entry);
+	dirent->d_reclen = offsetof(struct dirent, d_name) + nameLength;
+}
+
+
+template<typename QueryPolicy>
+void
+Equation<QueryPolicy>::_ExplainIndex(ExplainBuffer& buffer) const
+{
+	Describe(buffer);
+
+	if (fEstimatedReads >= 0) {
+		buffer.Printf(": index, ~%" B_PRId64 " reads, ~%" B_PRId64 " matches",
+			fEstimatedReads, fEstimatedMatches);
+	} else if (fScore == INT32_MAX)
+		buffer.Printf(": no index");
+	else
+		buffer.Printf(": index");
+
+	buffer.Printf(" (read %" B_PRId64 ", matched %" B_PRId64 ")\n",
+		fEntriesRead, fEntriesMatched);
 }
 
 
@@ -1014,6 +1515,16 @@ Equation<QueryPolicy>::NeedsEntry()
 }
 
 
+template<typename QueryPolicy>
+void
+Equation<QueryPolicy>::Describe(ExplainBuffer& buffer) const
+{
+	const char* quote = fType == B_STRING_TYPE || fType == 0 ? "\"" : "";
+	buffer.Printf("%s %s %s%s%s", fAttribute,
+		operatorSymbol(Term<QueryPolicy>::fOp), quote, fString, quote);
+}
+
+
 //	#pragma mark -
 
 
@@ -1136,6 +1647,18 @@ Operator<QueryPolicy>::NeedsEntry()
 }
 
 
+template<typename QueryPolicy>
+void
+Operator<QueryPolicy>::Describe(ExplainBuffer& buffer) const
+{
+	buffer.Printf("(");
+	fLeft->Describe(buffer);
+	buffer.Printf(" %s ", operatorSymbol(Term<QueryPolicy>::fOp));
+	fRight->Describe(buffer);
+	buffer.Printf(")");
+}
+
+
 //	#pragma mark -
 
 #ifdef DEBUG_QUERY
@@ -1167,16 +1690,8 @@ template<typename QueryPolicy>
 void
 Equation<QueryPolicy>::PrintToStream()
 {
-	const char* symbol = "???";
-	switch (Term<QueryPolicy>::fOp) {
-		case OP_EQUAL: symbol = "=="; break;
-		case OP_UNEQUAL: symbol = "!="; break;
-		case OP_GREATER_THAN: symbol = ">"; break;
-		case OP_GREATER_THAN_OR_EQUAL: symbol = ">="; break;
-		case OP_LESS_THAN: symbol = "<"; break;
-		case OP_LESS_THAN_OR_EQUAL: symbol = "<="; break;
-	}
-	QUERY_D(__out("[\"%s\" %s \"%s\"]", fAttribute, symbol, fString));
+	QUERY_D(__out("[\"%s\" %s \"%s\"]", fAttribute,
+		operatorSymbol(Term<QueryPolicy>::fOp), fString));
 }
 
 #endif	// DEBUG_QUERY
@@ -1427,6 +1942,11 @@ Query<QueryPolicy>::Query(Context* context, Expression<QueryPolicy>* expression,
 	fCurrent(NULL),
 	fIterator(NULL),
 	fIndex(context),
+	fCandidates(NULL),
+	fCandidateCount(0),
+	fNextCandidate(0),
+	fIntersecting(false),
+	fTotalEntries(0),
 	fFlags(flags),
 	fPort(port),
 	fToken(token),
@@ -1451,6 +1971,7 @@ Query<QueryPolicy>::Query(Context* context, Expression<QueryPolicy>* expression,
 template<typename QueryPolicy>
 Query<QueryPolicy>::~Query()
 {
+	free(fCandidates);
 	delete fExpression;
 }
 
@@ -1494,11 +2015,16 @@ Query<QueryPolicy>::Rewind()
 	// free previous stuff
 
 	fStack.MakeEmpty();
+	fPlan.MakeEmpty();
 
 	QueryPolicy::IndexIteratorDelete(fIterator);
 	fIterator = NULL;
 	fCurrent = NULL;
 
+	free(fCandidates);
+	fCandidates = NULL;
+	fIntersecting = false;
+
 	// put the whole expression on the stack
 
 	Stack<Term<QueryPolicy>*> stack;
@@ -1513,22 +2039,48 @@ Query<QueryPolicy>::Rewind()
 				stack.Push(op->Left());
 				stack.Push(op->Right());
 			} else {
-				// For OP_AND, we can use the scoring system to decide which
-				// path to add
-				if (op->Right()->Score() < op->Left()->Score())
-					stack.Push(op->Right());
-				else
-					stack.Push(op->Left());
+				// For OP_AND, the planner uses the scoring system to decide
+				// which path to add
+				stack.Push(_PlanConjunction(op));
 			}
 		} else if (term->Op() == OP_EQUATION
-				|| fStack.Push((Equation<QueryPolicy>*)term) != B_OK)
+				|| fStack.Push((Equation<QueryPolicy>*)term) != B_OK
+				|| fPlan.Push((Equation<QueryPolicy>*)term) != B_OK) {
 			QUERY_FATAL("Unknown term on stack or stack error\n");
+		} else
+			((Equation<QueryPolicy>*)term)->ResetStatistics();
 	}
 
 	return B_OK;
 }
 
 
+/*!	Describes how the query is evaluated, and what each step has done so far,
+	in a human readable form.
+*/
+template<typename QueryPolicy>
+status_t
+Query<QueryPolicy>::Explain(char* buffer, size_t bufferSize)
+{
+	ExplainBuffer explain(buffer, bufferSize);
+
+	explain.Printf("query: ");
+	fExpression->Root()->Describe(explain);
+	explain.Printf("\n");
+	if (fTotalEntries > 0) {
+		explain.Printf("estimated entries: %" B_PRId64 "\n",
+			fTotalEntries);
+	}
+
+	Equation<QueryPolicy>** steps = fPlan.Array();
+	int32 step = 1;
+	for (int32 i = fPlan.CountItems(); i-- > 0; step++)
+		steps[i]->Explain(explain, step);
+
+	return explain.IsTruncated() ? B_BUFFER_OVERFLOW : B_OK;
+}
+
+
 template<typename QueryPolicy>
 status_t
 Query<QueryPolicy>::GetNextEntry(struct dirent* dirent, size_t size)
@@ -1671,6 +2223,130 @@ Query<QueryPolicy>::_EvaluateLiveUpdate(Entry* entry, Node* node, const char* at
 }
 
 
+/*!	Chooses the term of an "and" operator and the "and" operators directly
+	below it that is used to find the entries; all other terms only filter
+	them. If that's an equation, it also decides which other equations
+	should be intersected with it, by comparing how many index entries that
+	would need to read with how many fewer entries would need to be checked.
+*/
+template<typename QueryPolicy>
+Term<QueryPolicy>*
+Query<QueryPolicy>::_PlanConjunction(Operator<QueryPolicy>* op)
+{
+	Term<QueryPolicy>* terms[kMaxConjunctionTerms];
+	int32 count = 0;
+
+	Stack<Term<QueryPolicy>*> stack;
+	stack.Push(op);
+
+	Term<QueryPolicy>* term;
+	while (stack.Pop(&term)) {
+		if (term->Op() == OP_AND) {
+			Operator<QueryPolicy>* andOp = (Operator<QueryPolicy>*)term;
+			stack.Push(andOp->Right());
+			stack.Push(andOp->Left());
+		} else if (count < kMaxConjunctionTerms) {
+			// the others will still be used to filter the entries
+			terms[count++] = term;
+		}
+	}
+
+	Term<QueryPolicy>* best = terms[0];
+	for (int32 i = 0; i < count; i++) {
+		if (terms[i]->Op() > OP_EQUATION) {
+			Equation<QueryPolicy>* equation = (Equation<QueryPolicy>*)terms[i];
+			equation->SetNextIntersection(NULL);
+			equation->SetEstimatedCandidates(-1);
+			equation->ResetStatistics();
+		}
+		if (terms[i]->Score() < best->Score())
+			best = terms[i];
+	}
+
+	if (best->Op() <= OP_EQUATION)
+		return best;
+
+	Equation<QueryPolicy>* driver = (Equation<QueryPolicy>*)best;
+	if (!driver->CanIntersect())
+		return best;
+
+	// Sort the other equations by the number of entries they would add
+	Equation<QueryPolicy>* others[kMaxConjunctionTerms];
+	int32 otherCount = 0;
+	for (int32 i = 0; i < count; i++) {
+		if (terms[i] == best || terms[i]->Op() <= OP_EQUATION)
+			continue;
+
+		Equation<QueryPolicy>* equation = (Equation<QueryPolicy>*)terms[i];
+		if (!equation->CanIntersect())
+			continue;
+
+		int32 index = otherCount++;
+		while (index > 0 && others[index - 1]->EstimatedMatches()
+				> equation->EstimatedMatches()) {
+			others[index] = others[index - 1];
+			index--;
+		}
+		others[index] = equation;
+	}
+
+	int64 total = otherCount > 0 ? _TotalEntries() : 0;
+	if (total <= 0)
+		return best;
+
+	// Assume that the equations are independent from each other
+	int64 candidates = driver->EstimatedMatches();
+	int64 cost = driver->EstimatedReads() + kEntryCost * candidates;
+	Equation<QueryPolicy>* last = driver;
+	int32 used = 1;
+
+	for (int32 i = 0; i < otherCount && used < kMaxIntersectionTerms; i++) {
+		Equation<QueryPolicy>* equation = others[i];
+		int64 matches = min_c(equation->EstimatedMatches(), total);
+		int64 remaining = candidates * matches / total;
+		int64 newCost = cost + equation->EstimatedReads()
+			- kEntryCost * (candidates - remaining);
+		if (newCost >= cost)
+			continue;
+
+		last->SetNextIntersection(equation);
+		last = equation;
+		used++;
+
+		candidates = remaining;
+		cost = newCost;
+	}
+
+	if (used > 1)
+		driver->SetEstimatedCandidates(candidates);
+
+	return best;
+}
+
+
+/*!	Returns the estimated number of entries on the volume, that is, the
+	number of entries in the "name" index, or -1 if that is not known.
+*/
+template<typename QueryPolicy>
+int64
+Query<QueryPolicy>::_TotalEntries()
+{
+	if (fTotalEntries == 0) {
+		fTotalEntries = -1;
+
+		int64 count;
+		if (QueryPolicy::IndexSetTo(fIndex, "name") == B_OK
+			&& QueryPolicy::IndexEstimateCount(fIndex, OP_NONE, NULL, 0, false,
+				&count) == B_OK) {
+			fTotalEntries = count;
+		}
+		QueryPolicy::IndexUnset(fIndex);
+	}
+
+	return fTotalEntries;
+}
+
+
 template<typename QueryPolicy>
 status_t
 Query<QueryPolicy>::_GetNextEntry(struct dirent* dirent, size_t size)
@@ -1678,24 +2354,45 @@ Query<QueryPolicy>::_GetNextEntry(struct dirent* dirent, size_t size)
 	// If we don't have an equation to use yet/anymore, get a new one
 	// from the stack
 	while (true) {
-		if (fIterator == NULL) {
+		if (fIterator == NULL && !fIntersecting) {
 			if (!fStack.Pop(&fCurrent)
 				|| fCurrent == NULL)
 				return B_ENTRY_NOT_FOUND;
 
-			status_t status = fCurrent->PrepareQuery(fContext, fIndex,
-				&fIterator, fFlags & B_QUERY_NON_INDEXED);
-			if (status == B_ENTRY_NOT_FOUND) {
-				// try next equation
-				continue;
-			}
+			if (fCurrent->NextIntersection() != NULL
+				&& fCurrent->Intersect(fContext, fIndex, &fCandidates,
+					&fCandidateCount) == B_OK) {
+				fNextCandidate = 0;
+				fIntersecting = true;
+			} else {
+				// Use the index of the equation instead
+				status_t status = fCurrent->PrepareQuery(fContext, fIndex,
+					&fIterator, fFlags & B_QUERY_NON_INDEXED);
+				if (status == B_ENTRY_NOT_FOUND) {
+					// try next equation
+					continue;
+				}
 
-			if (status != B_OK)
-				return status;
+				if (status != B_OK)
+					return status;
+			}
 		}
 		if (fCurrent == NULL)
 			QUERY_RETURN_ERROR(B_ERROR);
 
+		if (fIntersecting) {
+			status_t status = fCurrent->GetNextCandidate(fContext, fCandidates,
+				fCandidateCount, fNextCandidate, dirent, size);
+			if (status == B_OK)
+				return B_OK;
+
+			free(fCandidates);
+			fCandidates = NULL;
+			fIntersecting = false;
+			fCurrent = NULL;
+			continue;
+		}
+
 		status_t status = fCurrent->GetNextMatching(fContext, fIterator, dirent,
 			size);
 		if (status != B_OK) {
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2026, Haiku Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _KERNEL_DIR_STAT_H
+#define _KERNEL_DIR_STAT_H
+
+
+#include <string.h>
+
+#include <fs_dir_stat.h>
+
+
+/*!	Lays out a dir_stat_entry for the given \a dirent at \a entry, which must
+	have room for dir_stat_entry_size() bytes. The stat and all attributes
+	are marked as not yet read.
+	The whole entry is cleared first, since it is copied to userland as is,
+	including padding and the parts of the stat and the attribute slots that
+	are never filled in.
+*/
+static inline void
+init_dir_stat_entry(dir_stat_entry* entry, uint32 attributeCount,
+	size_t maxAttributeSize, const struct dirent* dirent)
+{
+	size_t nameLength = strlen(dirent->d_name);
+	size_t offset = DIR_STAT_ALIGN(sizeof(dir_stat_entry)
+		+ attributeCount * sizeof(dir_stat_attr));
+	size_t length = dir_stat_entry_size(attributeCount, maxAttributeSize,
+		nameLength);
+
+	memset(entry, 0, length);
+
+	entry->length = length;
+	entry->attribute_count = attributeCount;
+	entry->stat_status = B_NO_INIT;
+
+	for (uint32 i = 0; i < attributeCount; i++) {
+		entry->attributes[i].type = 0;
+		entry->attributes[i].offset = offset;
+		entry->attributes[i].size = B_NO_INIT;
+		offset += DIR_STAT_ALIGN(maxAttributeSize);
+	}
+
+	entry->dirent_offset = offset;
+
+	struct dirent* target = dir_stat_entry_dirent(entry);
+	memcpy(target, dirent, sizeof(struct dirent));
+	memcpy(target->d_name, dirent->d_name, nameLength + 1);
+	target->d_reclen = entry->length - offset;
+}
+
+
+#endif	// _KERNEL_DIR_STAT_H
@@ -25,6 +25,8 @@ status_t _user_get_system_info(system_info *userInfo);
 status_t _user_get_cpu_info(uint32 firstCPU, uint32 cpuCount, cpu_info* info);
 status_t _user_get_cpu_topology_info(cpu_topology_node_info* topologyInfos,
 				uint32* topologyInfoCount);
+status_t _user_get_writeback_info(struct writeback_device_info* infos,
+				uint32* _count);
 
 status_t _user_get_system_info_etc(int32 id, void *buffer,
 			size_t bufferSize);
@@ -133,6 +133,8 @@ status_t	vfs_disconnect_vnode(dev_t mountID, ino_t vnodeID);
 status_t	vfs_resolve_parent(struct vnode* parent, dev_t* device,
 				ino_t* node);
 void		vfs_free_unused_vnodes(int32 level);
+void		vfs_entry_created(dev_t device, ino_t directory, const char *name);
+void		vfs_entry_removed(dev_t device, ino_t directory, const char *name);
 
 status_t	vfs_read_stat(int fd, const char *path, bool traverseLeafLink,
 				struct stat *stat, bool kernel);
@@ -184,6 +186,10 @@ int			_user_open_dir_entry_ref(dev_t device, ino_t inode,
 				const char *name);
 int			_user_open_dir(int fd, const char *path);
 int			_user_open_parent_dir(int fd, char *name, size_t nameLength);
+ssize_t		_user_read_dir_stat(int fd, const char *const *attributes,
+				uint32 attributeCount, size_t maxAttributeSize,
+				struct dir_stat_entry *buffer, size_t bufferSize,
+				uint32 maxCount);
 status_t	_user_fcntl(int fd, int op, size_t argument);
 status_t	_user_fsync(int fd, bool dataOnly);
 status_t	_user_flock(int fd, int op);
@@ -271,10 +277,14 @@ ssize_t		_user_recv(int socket, void *data, size_t length, int flags);
 ssize_t		_user_recvfrom(int socket, void *data, size_t length, int flags,
 				struct sockaddr *address, socklen_t *_addressLength);
 ssize_t		_user_recvmsg(int socket, struct msghdr *message, int flags);
+ssize_t		_user_recvmmsg(int socket, struct mmsghdr *messages,
+				unsigned int count, int flags, bigtime_t timeout);
 ssize_t		_user_send(int socket, const void *data, size_t length, int flags);
 ssize_t		_user_sendto(int socket, const void *data, size_t length, int flags,
 				const struct sockaddr *address, socklen_t addressLength);
 ssize_t		_user_sendmsg(int socket, const struct msghdr *message, int flags);
+ssize_t		_user_sendmmsg(int socket, struct mmsghdr *messages,
+				unsigned int count, int flags);
 status_t	_user_getsockopt(int socket, int level, int option, void *value,
 				socklen_t *_length);
 status_t	_user_setsockopt(int socket, int level, int option,
@@ -14,6 +14,8 @@
 
 
 struct kernel_args;
+struct vm_writeback_device;
+struct writeback_device_info;
 
 extern int32 gMappedPagesCount;
 
@@ -62,6 +64,13 @@ void vm_page_schedule_write_page(struct vm_page *page);
 void vm_page_schedule_write_page_range(struct VMCache *cache,
 	uint32 firstPage, uint32 endPage);
 
+struct vm_writeback_device* vm_page_get_writeback_device(dev_t device);
+void vm_page_put_writeback_device(struct vm_writeback_device* device);
+void vm_page_account_modified_pages(struct VMCache* cache, int32 count);
+void vm_page_throttle_writer(dev_t device);
+uint32 vm_page_get_writeback_info(struct writeback_device_info* infos,
+	uint32 maxCount);
+
 void vm_page_unreserve_pages(vm_page_reservation* reservation);
 void vm_page_reserve_pages(vm_page_reservation* reservation, uint32 count,
 	int priority);
@@ -95,6 +95,20 @@ Checksum::PseudoHeader(net_address_module_info* addressModule,
 }
 
 
+/*!	Maps the \a flowHash of a connection or datagram flow onto one of the
+	\a count members of a SO_REUSEPORT group.
+	The address modules' pair hashes are mostly XORs of addresses and ports,
+	so the hash is scrambled before it is scaled down to the member range.
+*/
+static inline uint32
+reuse_port_select(uint32 flowHash, uint32 count)
+{
+	flowHash *= 0x9e3779b1;
+	flowHash ^= flowHash >> 16;
+	return (uint32)(((uint64)flowHash * count) >> 32);
+}
+
+
 /*!	Helper class that prints an address (and optionally a port) into a buffer
 	that is automatically freed at end of scope.
 */
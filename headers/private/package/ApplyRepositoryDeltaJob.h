@@ -0,0 +1,64 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _PACKAGE__PRIVATE__APPLY_REPOSITORY_DELTA_JOB_H_
+#define _PACKAGE__PRIVATE__APPLY_REPOSITORY_DELTA_JOB_H_
+
+
+#include <Entry.h>
+#include <String.h>
+
+#include <package/Job.h>
+
+
+namespace BPackageKit {
+
+namespace BPrivate {
+
+
+/*!	Tries to bring a repository cache up to date by fetching and applying the
+	delta published for it instead of the complete repository file.
+	A missing, unusable or mismatching delta is not an error, the job succeeds
+	anyway and DeltaApplied() tells whether the target file is valid. This
+	allows the request to fall back to fetching the complete repository file.
+*/
+class ApplyRepositoryDeltaJob : public BJob {
+	typedef	BJob				inherited;
+
+public:
+								ApplyRepositoryDeltaJob(
+									const BContext& context,
+									const BString& title,
+									const BString& baseURL,
+									const BEntry& baseRepoCacheEntry,
+									const BEntry& checksumEntry,
+									const BEntry& targetEntry);
+	virtual						~ApplyRepositoryDeltaJob();
+
+			const BEntry&		TargetEntry() const
+									{ return fTargetEntry; }
+			bool				DeltaApplied() const
+									{ return fDeltaApplied; }
+
+protected:
+	virtual	status_t			Execute();
+
+private:
+			status_t			_ApplyDelta(const BEntry& deltaEntry);
+
+private:
+			BString				fBaseURL;
+			BEntry				fBaseRepoCacheEntry;
+			BEntry				fChecksumEntry;
+			BEntry				fTargetEntry;
+			bool				fDeltaApplied;
+};
+
+
+}	// namespace BPrivate
+
+}	// namespace BPackageKit
+
+
+#endif // _PACKAGE__PRIVATE__APPLY_REPOSITORY_DELTA_JOB_H_
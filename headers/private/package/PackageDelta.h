@@ -0,0 +1,80 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _PACKAGE__PRIVATE__PACKAGE_DELTA_H_
+#define _PACKAGE__PRIVATE__PACKAGE_DELTA_H_
+
+
+#include <Entry.h>
+#include <String.h>
+
+
+namespace BPackageKit {
+
+namespace BPrivate {
+
+
+/*!	A binary delta between two package files.
+	The delta is a sequence of operations that either copy a range of the base
+	package file or insert literal data. It is computed on the raw file
+	contents, so applying it reconstructs the target package file byte by byte,
+	including its compressed heap. Base and target are identified by the
+	SHA-256 checksums of the files, both of which are verified by Apply().
+*/
+class PackageDelta {
+public:
+								PackageDelta();
+								~PackageDelta();
+
+			status_t			Create(const BEntry& basePackage,
+									const BEntry& targetPackage,
+									const BEntry& deltaEntry);
+			status_t			SetTo(const BEntry& deltaEntry);
+
+			status_t			Apply(const BEntry& basePackage,
+									const BEntry& targetPackage) const;
+
+			const BString&		BaseChecksum() const
+									{ return fBaseChecksum; }
+			const BString&		TargetChecksum() const
+									{ return fTargetChecksum; }
+			off_t				BaseSize() const
+									{ return fBaseSize; }
+			off_t				TargetSize() const
+									{ return fTargetSize; }
+			off_t				CopiedSize() const
+									{ return fCopiedSize; }
+									// only valid after Create()
+
+	static	BString				DeltaFileName(const BString& packageFileName);
+	static	BString				DeltaURL(const BString& packagesURL,
+									const BString& packageFileName,
+									const BString& baseChecksum);
+
+private:
+			struct Header;
+			struct Writer;
+			struct Reader;
+
+private:
+			status_t			_Diff(const uint8* base, size_t baseSize,
+									const uint8* target, size_t targetSize,
+									Writer& writer);
+
+private:
+			BEntry				fDeltaEntry;
+			BString				fBaseChecksum;
+			BString				fTargetChecksum;
+			off_t				fBaseSize;
+			off_t				fTargetSize;
+			off_t				fCopiedSize;
+};
+
+
+}	// namespace BPrivate
+
+}	// namespace BPackageKit
+
+
+#endif // _PACKAGE__PRIVATE__PACKAGE_DELTA_H_
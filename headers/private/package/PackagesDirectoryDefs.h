@@ -11,6 +11,7 @@
 
 #define PACKAGES_DIRECTORY_ADMIN_DIRECTORY	"administrative"
 #define PACKAGES_DIRECTORY_ACTIVATION_FILE	"activated-packages"
+#define PACKAGES_DIRECTORY_MOUNT_INDEX_FILE	"packagefs-mount-index"
 
 
 
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _PACKAGE__PRIVATE__REPOSITORY_DELTA_H_
+#define _PACKAGE__PRIVATE__REPOSITORY_DELTA_H_
+
+
+#include <Entry.h>
+#include <ObjectList.h>
+#include <String.h>
+#include <StringList.h>
+
+#include <package/PackageInfo.h>
+#include <package/RepositoryInfo.h>
+
+
+namespace BPackageKit {
+
+namespace BHPKG {
+	class BErrorOutput;
+}
+
+namespace BPrivate {
+
+
+/*!	The difference between two versions of a repository file.
+	A delta is keyed by the SHA-256 checksum of the repository file it applies
+	to. It carries the repository info and the ordered list of package file
+	names of the newer version, but only the package infos of packages that
+	aren't contained in the older version. Applying the delta to the older
+	version rewrites the newer repository file from the combined package infos.
+	Since the result is rebuilt rather than patched, callers must compare its
+	checksum against the published one before using it.
+*/
+class RepositoryDelta {
+public:
+								RepositoryDelta();
+								~RepositoryDelta();
+
+			status_t			Create(const BEntry& baseRepository,
+									const BEntry& targetRepository);
+			status_t			Apply(const BEntry& baseRepository,
+									const BEntry& targetRepository,
+									BHPKG::BErrorOutput* errorOutput) const;
+
+			status_t			ReadFromFile(const BEntry& entry);
+			status_t			WriteToFile(const BEntry& entry) const;
+
+			const BString&		BaseChecksum() const
+									{ return fBaseChecksum; }
+			int32				CountPackages() const
+									{ return fPackageFileNames.CountStrings(); }
+			int32				CountAddedPackages() const
+									{ return fAddedPackages.CountItems(); }
+
+	static	BString				DeltaURL(const BString& baseURL,
+									const BString& baseChecksum);
+
+private:
+			typedef BObjectList<BPackageInfo, true> PackageInfoList;
+
+private:
+	static	status_t			_ReadPackageInfos(const BEntry& repositoryEntry,
+									BRepositoryInfo* _repositoryInfo,
+									PackageInfoList& _packageInfos);
+
+private:
+			BString				fBaseChecksum;
+			BRepositoryInfo		fRepositoryInfo;
+			BStringList			fPackageFileNames;
+			PackageInfoList		fAddedPackages;
+};
+
+
+}	// namespace BPrivate
+
+}	// namespace BPackageKit
+
+
+#endif // _PACKAGE__PRIVATE__REPOSITORY_DELTA_H_
@@ -6,6 +6,8 @@
 #define _PACKAGE__HPKG__PRIVATE__PACKAGE_FILE_HEAP_WRITER_H_
 
 
+#include <pthread.h>
+
 #include <Array.h>
 #include <package/hpkg/PackageFileHeapAccessorBase.h>
 
@@ -42,6 +44,9 @@ public:
 										decompressionAlgorithm);
 								~PackageFileHeapWriter();
 
+			void				SetThreadCount(int32 count);
+									// must be called before Init()
+
 			void				Init();
 			void				Reinit(PackageFileHeapReader* heapReader);
 
@@ -64,17 +69,33 @@ private:
 			struct Chunk;
 			struct ChunkSegment;
 			struct ChunkBuffer;
+			struct CompressionJob;
+			struct SynchronousWriting;
 
 			friend struct ChunkBuffer;
+			friend struct SynchronousWriting;
 
 private:
 			void				_Uninit();
 
+			void				_StartWorkers();
+			void				_StopWorkers();
+	static	void*				_WorkerEntry(void* data);
+			void				_Worker();
+
 			status_t			_FlushPendingData();
+			status_t			_QueueCompressionJob();
+			status_t			_WriteNextCompressionJob();
+			status_t			_FlushCompressionJobs();
+			status_t			_CompressChunk(const void* data, size_t size,
+									void* buffer, size_t& _compressedSize)
+									const;
 			status_t			_WriteChunk(const void* data, size_t size,
 									bool mayCompress);
-			status_t			_WriteDataCompressed(const void* data,
-									size_t size);
+			status_t			_WriteCompressedChunk(const void* data,
+									size_t size, const void* compressedData,
+									size_t compressedSize,
+									status_t compressionStatus);
 			status_t			_WriteDataUncompressed(const void* data,
 									size_t size);
 
@@ -88,6 +109,21 @@ private:
 			size_t				fPendingDataSize;
 			Array<uint64>		fOffsets;
 			CompressionAlgorithmOwner* fCompressionAlgorithm;
+
+			// parallel compression
+			int32				fThreadCount;
+			int32				fSynchronousWriting;
+			pthread_t*			fWorkers;
+			int32				fWorkerCount;
+			CompressionJob*		fJobs;
+			int32				fJobCount;
+			uint64				fJobsQueued;
+			uint64				fJobsStarted;
+			uint64				fJobsWritten;
+			pthread_mutex_t		fJobLock;
+			pthread_cond_t		fJobQueuedCondition;
+			pthread_cond_t		fJobDoneCondition;
+			bool				fTerminating;
 };
 
 
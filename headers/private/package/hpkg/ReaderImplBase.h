@@ -169,11 +169,16 @@ protected:
 protected:
 			PackageFileSection	fPackageAttributesSection;
 
+private:
+			struct LowLevelAttributeNode;
+
 private:
 			status_t			_Init(BPositionIO* file, bool keepFile);
 
 			status_t			_ParseAttributeTree(
 									AttributeHandlerContext* context);
+			status_t			_ParseLowLevelAttributeTree(
+									AttributeHandlerContext* context);
 
 	template<typename Type>
 	inline	status_t			_Read(Type& _value);
@@ -122,6 +122,14 @@ protected:
 	virtual	void				JobProgress(BSupportKit::BJob* job);
 	virtual	void				JobSucceeded(BSupportKit::BJob* job);
 
+private:
+			struct FetchTask;
+			struct FetchTaskRunner;
+			class SerializedJobStateListener;
+
+			typedef BObjectList<FetchTask, true> FetchTaskList;
+			typedef BObjectList<BRepositoryConfig, true> RepositoryConfigList;
+
 private:
 			void				_HandleProblems();
 			void				_AnalyzeResult();
@@ -142,11 +150,15 @@ private:
 
 			void				_AddInstalledRepository(
 									InstalledRepository* repository);
+			void				_RefreshRepositories(BPackageRoster& roster,
+									const RepositoryConfigList& configs,
+									bool refresh);
 			void				_AddRemoteRepository(BPackageRoster& roster,
-									const char* name, bool refresh);
-			status_t			_GetRepositoryCache(BPackageRoster& roster,
-									const BRepositoryConfig& config,
-									bool refresh, BRepositoryCache& _cache);
+									const BRepositoryConfig& config);
+
+			void				_RunFetchTasks(FetchTaskList& tasks);
+	static	status_t			_FetchTaskWorker(void* data);
+			status_t			_DownloadPackageDelta(FetchTask& task);
 
 			void				_AddPackageSpecifiers(
 									const char* const* searchStrings,
@@ -167,6 +179,7 @@ protected:
 			RemoteRepositoryList fOtherRepositories;
 			MiscLocalRepository* fLocalRepository;
 			TransactionList		fTransactions;
+			SerializedJobStateListener* fJobStateListener;
 
 			// must be set by the derived class
 			InstallationInterface* fInstallationInterface;
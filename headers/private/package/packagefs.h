@@ -24,7 +24,9 @@ enum PackageFSMountType {
 enum {
 	PACKAGE_FS_OPERATION_GET_VOLUME_INFO		= B_DEVICE_OP_CODES_END + 1,
 	PACKAGE_FS_OPERATION_GET_PACKAGE_INFOS,
-	PACKAGE_FS_OPERATION_CHANGE_ACTIVATION
+	PACKAGE_FS_OPERATION_CHANGE_ACTIVATION,
+	PACKAGE_FS_OPERATION_GET_CHUNK_CACHE_INFO,
+	PACKAGE_FS_OPERATION_GET_MEMORY_USAGE
 };
 
 
@@ -104,4 +106,53 @@ struct PackageFSActivationChangeRequest {
 };
 
 
+// PACKAGE_FS_OPERATION_GET_CHUNK_CACHE_INFO
+
+struct PackageFSChunkCacheInfo {
+	// The cache of decompressed heap chunks is shared by all packagefs
+	// volumes, so are these counters.
+	uint64							lookups;
+	uint64							hits;
+	uint64							prefetches;
+		// chunks decompressed ahead of time for sequential readers
+	uint64							prefetchHits;
+		// prefetched chunks that have actually been read
+	uint64							evictions;
+	uint32							chunkCount;
+	uint32							maxChunkCount;
+	uint32							chunkSize;
+};
+
+
+// PACKAGE_FS_OPERATION_GET_MEMORY_USAGE
+
+struct PackageFSPackageMemoryUsage {
+	// node_ref of the package file
+	dev_t							packageDeviceID;
+	ino_t							packageNodeID;
+
+	// the package's own node tree, as loaded from its TOC
+	uint32							nodeCount;
+	uint32							attributeCount;
+	uint64							size;
+		// in bytes, including the package object itself
+};
+
+struct PackageFSGetMemoryUsageRequest {
+	// Filled in by the FS. The nodes of the merged directory tree are shared
+	// by the packages and are thus only accounted for the volume as a whole.
+	// nodeSize includes their child and ID hash tables. Merged nodes own no
+	// attributes, they show those of their package nodes, which are accounted
+	// for by the packages. The indices are not included.
+	uint32							nodeCount;
+	uint64							nodeSize;
+
+	// packageCount is set to the actual number of packages, even if it is
+	// greater than the array, so the caller can determine whether the array
+	// was large enough.
+	uint32							packageCount;
+	PackageFSPackageMemoryUsage		packages[1];
+};
+
+
 #endif	// _PACKAGE__PRIVATE__PACKAGE_FS_H_
@@ -23,6 +23,7 @@ extern "C" {
 
 struct attr_info;
 struct dirent;
+struct dir_stat_entry;
 struct event_wait_info;
 struct fd_info;
 struct fd_set;
@@ -42,6 +43,7 @@ struct signal_frame_data;
 struct stat;
 struct system_profiler_parameters;
 struct user_timer_info;
+struct writeback_device_info;
 
 struct disk_device_job_progress_info;
 struct partitionable_space_data;
@@ -341,6 +343,10 @@ extern ssize_t		_kern_writev(int fd, off_t pos, const struct iovec *vecs,
 extern status_t		_kern_ioctl(int fd, uint32 cmd, void *data, size_t length);
 extern ssize_t		_kern_read_dir(int fd, struct dirent *buffer,
 						size_t bufferSize, uint32 maxCount);
+extern ssize_t		_kern_read_dir_stat(int fd, const char *const *attributes,
+						uint32 attributeCount, size_t maxAttributeSize,
+						struct dir_stat_entry *buffer, size_t bufferSize,
+						uint32 maxCount);
 extern status_t		_kern_rewind_dir(int fd);
 extern status_t		_kern_read_stat(int fd, const char *path, bool traverseLink,
 						struct stat *stat, size_t statSize);
@@ -374,6 +380,8 @@ extern ssize_t		_kern_recvfrom(int socket, void *data, size_t length,
 						socklen_t *_addressLength);
 extern ssize_t		_kern_recvmsg(int socket, struct msghdr *message,
 						int flags);
+extern ssize_t		_kern_recvmmsg(int socket, struct mmsghdr *messages,
+						unsigned int count, int flags, bigtime_t timeout);
 extern ssize_t		_kern_send(int socket, const void *data, size_t length,
 						int flags);
 extern ssize_t		_kern_sendto(int socket, const void *data, size_t length,
@@ -381,6 +389,8 @@ extern ssize_t		_kern_sendto(int socket, const void *data, size_t length,
 						socklen_t addressLength);
 extern ssize_t		_kern_sendmsg(int socket, const struct msghdr *message,
 						int flags);
+extern ssize_t		_kern_sendmmsg(int socket, struct mmsghdr *messages,
+						unsigned int count, int flags);
 extern status_t		_kern_getsockopt(int socket, int level, int option,
 						void *value, socklen_t *_length);
 extern status_t		_kern_setsockopt(int socket, int level, int option,
@@ -550,6 +560,8 @@ extern status_t		_kern_get_cpu_info(uint32 firstCPU, uint32 cpuCount,
 extern status_t		_kern_get_cpu_topology_info(
 						cpu_topology_node_info* topologyInfos,
 						uint32* topologyInfoCount);
+extern status_t		_kern_get_writeback_info(
+						struct writeback_device_info* infos, uint32* _count);
 
 extern status_t		_kern_analyze_scheduling(bigtime_t from, bigtime_t until,
 						void* buffer, size_t size,
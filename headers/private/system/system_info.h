@@ -43,6 +43,19 @@ enum {
 };
 
 
+typedef struct writeback_device_info {
+	dev_t		device;
+	uint32		dirty_pages;
+	uint32		dirty_limit;
+		// modified pages the device may have before writers are throttled
+	uint32		bandwidth;
+		// estimated write back speed in pages per second
+	uint64		written_pages;
+	uint64		throttled_writes;
+	bigtime_t	throttle_time;
+} writeback_device_info;
+
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -333,6 +333,9 @@ BFSPartitionHandle::Repair(bool checkOnly)
 		result.stats.double_indirect_array_blocks,
 		size_string(1.0 * result.stats.blocks_in_double_indirect
 			* result.stats.block_size).String());
+	printf("\tfile extents\t\t\t%" B_PRIu64 " (%" B_PRIu64 " files "
+		"fragmented)\n", result.file_extents,
+		result.fragmented_files);
 	// TODO: this is currently not maintained correctly
 	//printf("\tpartial block runs\t%" B_PRIu64 "\n",
 	//	result.stats.partial_block_runs);
@@ -40,7 +40,8 @@ InitializeBFSEditor::InitializeBFSEditor()
 	fView(NULL),
 	fNameControl(NULL),
 	fBlockSizeMenuField(NULL),
-	fUseIndicesCheckBox(NULL)
+	fUseIndicesCheckBox(NULL),
+	fInlineDataCheckBox(NULL)
 {
 	_CreateViewControls();
 }
@@ -111,6 +112,8 @@ InitializeBFSEditor::GetParameters(BString& parameters)
 	}
 	if (fUseIndicesCheckBox->Value() == B_CONTROL_OFF)
 		parameters << "noindex;\n";
+	if (fInlineDataCheckBox->Value() == B_CONTROL_ON)
+		parameters << "inline_data;\n";
 
 	parameters << "name \"" << fNameControl->Text() << "\";\n";
 	return B_OK;
@@ -157,6 +160,12 @@ InitializeBFSEditor::_CreateViewControls()
 		"\nAny volume that is intended for booting Haiku must have query "
 		"support enabled."));
 
+	fInlineDataCheckBox = new BCheckBox(
+		B_TRANSLATE("Store small files in their inode"), NULL);
+	fInlineDataCheckBox->SetToolTip(B_TRANSLATE("Saves space and disk "
+		"accesses for volumes with many small files, but the volume can\n"
+		"then only be used with Haiku versions that support this."));
+
 	float spacing = be_control_look->DefaultItemSpacing();
 
 	fView = BGridLayoutBuilder(spacing, spacing)
@@ -169,6 +178,9 @@ InitializeBFSEditor::_CreateViewControls()
 		.Add(fBlockSizeMenuField->CreateMenuBarLayoutItem(), 1, 1)
 
 		// row 3
-		.Add(fUseIndicesCheckBox, 0, 2, 2).View()
+		.Add(fUseIndicesCheckBox, 0, 2, 2)
+
+		// row 4
+		.Add(fInlineDataCheckBox, 0, 3, 2).View()
 	;
 }
@@ -42,6 +42,7 @@ private:
 				BTextControl*	fNameControl;
 				BMenuField*		fBlockSizeMenuField;
 				BCheckBox*		fUseIndicesCheckBox;
+				BCheckBox*		fInlineDataCheckBox;
 				BMenuItem*		f1KBlockMenuItem;
 				BMenuItem*		f2KBlockMenuItem;
 				BMenuItem*		f4KBlockMenuItem;
@@ -31,6 +31,19 @@ namespace BFS {
 #endif
 
 
+#if !_BOOT_MODE
+// Used by BPlusTree::EstimateRange()
+static const off_t kExactEstimateCount = 1024;
+static const off_t kMaxDuplicateEstimateCount = 65536;
+static const uint64 kEstimateScale = 1ULL << 40;
+
+// Used by BPlusTree::Compact(): nodes are filled up to this percentage, so
+// that a few keys can still be inserted without splitting them right away
+static const int32 kCompactNodeFill = 90;
+static const int32 kCompactPasses = 3;
+#endif
+
+
 /*!	Simple array used for the duplicate handling in the B+Tree. This is an
 	on disk structure.
 */
@@ -2342,6 +2355,149 @@ BPlusTree::Find(const uint8* key, uint16 keyLength, off_t* _value)
 }
 
 
+#if !_BOOT_MODE
+/*!	Estimates how many values are stored under the keys between \a from and
+	\a to (both included). If \a from is \c NULL, the range starts at the
+	beginning of the tree, if \a to is \c NULL, it ends at its end. If
+	\a prefix is \c true, the range contains all keys starting with \a to.
+	Small ranges are counted exactly; for larger ones, the count of the first
+	values is extrapolated using the position of the keys within the tree.
+	Many values under a single key are counted up to a certain limit only.
+*/
+status_t
+BPlusTree::EstimateRange(const uint8* from, uint16 fromLength, const uint8* to,
+	uint16 toLength, bool prefix, off_t* _count)
+{
+	if ((from != NULL && (fromLength < BPLUSTREE_MIN_KEY_LENGTH
+			|| fromLength > BPLUSTREE_MAX_KEY_LENGTH))
+		|| (to != NULL && (toLength < BPLUSTREE_MIN_KEY_LENGTH
+			|| toLength > BPLUSTREE_MAX_KEY_LENGTH
+			|| (prefix && toLength == BPLUSTREE_MAX_KEY_LENGTH))))
+		RETURN_ERROR(B_BAD_VALUE);
+
+	TreeIterator iterator(this);
+	status_t status = from != NULL ? iterator.Find(from, fromLength)
+		: iterator.Goto(BPLUSTREE_BEGIN);
+	if (status != B_OK && status != B_ENTRY_NOT_FOUND)
+		return status;
+
+	uint8 firstKey[BPLUSTREE_MAX_KEY_LENGTH + 1];
+	uint16 firstLength = 0;
+	uint8 key[BPLUSTREE_MAX_KEY_LENGTH + 1];
+	uint16 keyLength;
+	off_t value;
+	off_t count = 0;
+
+	while (true) {
+		status = iterator.GetNextEntry(key, &keyLength, sizeof(key), &value);
+		if (status == B_ENTRY_NOT_FOUND)
+			break;
+		if (status != B_OK)
+			return status;
+
+		if (to != NULL) {
+			int32 compare;
+			if (prefix) {
+				compare = memcmp(key, to, min_c(keyLength, toLength));
+				if (compare == 0 && keyLength < toLength)
+					compare = -1;
+			} else
+				compare = _CompareKeys(key, keyLength, to, toLength);
+			if (compare > 0)
+				break;
+		}
+
+		if (count == 0) {
+			memcpy(firstKey, key, keyLength);
+			firstLength = keyLength;
+		}
+		count++;
+
+		if (count < kExactEstimateCount)
+			continue;
+
+		bool sameKey = keyLength == firstLength
+			&& memcmp(key, firstKey, keyLength) == 0;
+		if (sameKey && count < kMaxDuplicateEstimateCount)
+			continue;
+		if (sameKey) {
+			// We cannot extrapolate the number of duplicates
+			break;
+		}
+
+		// Extrapolate from the range we have counted so far
+		uint64 first;
+		uint64 last;
+		uint64 end = kEstimateScale;
+		status = _EstimatePosition(firstKey, firstLength, first);
+		if (status == B_OK)
+			status = _EstimatePosition(key, keyLength, last);
+		if (status == B_OK && to != NULL) {
+			if (prefix) {
+				memcpy(key, to, toLength);
+				key[toLength] = 0xff;
+				status = _EstimatePosition(key, toLength + 1, end);
+			} else
+				status = _EstimatePosition(to, toLength, end);
+		}
+		if (status != B_OK)
+			return status;
+
+		if (last > first && end > last)
+			count = count * (end - first) / (last - first);
+		break;
+	}
+
+	*_count = count;
+	return B_OK;
+}
+
+
+/*!	Computes the relative position of \a key within the tree, from 0 to
+	\c kEstimateScale, by assuming that all nodes on the path to it are
+	equally full.
+*/
+status_t
+BPlusTree::_EstimatePosition(const uint8* key, uint16 keyLength,
+	uint64& _position)
+{
+	InodeReadLocker locker(fStream);
+
+	off_t nodeOffset = fHeader.RootNode();
+	CachedNode cached(this);
+	const bplustree_node* node;
+	uint64 position = 0;
+	uint64 width = kEstimateScale;
+
+	while ((node = cached.SetTo(nodeOffset)) != NULL) {
+		uint16 keyIndex = 0;
+		off_t nextOffset;
+		status_t status = _FindKey(node, key, keyLength, &keyIndex,
+			&nextOffset);
+		if (status != B_OK && status != B_ENTRY_NOT_FOUND)
+			return status;
+
+		if (node->OverflowLink() == BPLUSTREE_NULL) {
+			if (node->NumKeys() > 0)
+				position += width * keyIndex / node->NumKeys();
+
+			_position = min_c(position, kEstimateScale);
+			return B_OK;
+		} else if (nextOffset == nodeOffset)
+			RETURN_ERROR(B_ERROR);
+
+		// the overflow link is the last child of an index node
+		uint32 children = node->NumKeys() + 1;
+		position += width * keyIndex / children;
+		width /= children;
+
+		nodeOffset = nextOffset;
+	}
+	RETURN_ERROR(B_ERROR);
+}
+#endif // !_BOOT_MODE
+
+
 #if !_BOOT_MODE
 status_t
 BPlusTree::_ValidateChildren(TreeCheck& check, uint32 level, off_t offset,
@@ -2566,6 +2722,1015 @@ BPlusTree::_ValidateChild(TreeCheck& check, CachedNode& cached, uint32 level,
 
 	return _ValidateChildren(check, level + 1, offset, key, keyLength, node);
 }
+
+
+//	#pragma mark - compaction
+
+
+/*!	A key and its value while the children of a node are repacked. For index
+	nodes, the key is the largest key below the child node the value points
+	to; the overflow link of the last child has no key.
+*/
+struct compact_entry {
+	uint32	keyOffset;
+	uint16	keyLength;
+	off_t	value;
+};
+
+
+static inline int32
+node_usage(uint32 keyCount, uint32 keyLength)
+{
+	return key_align(sizeof(bplustree_node) + keyLength)
+		+ keyCount * (sizeof(uint16) + sizeof(off_t));
+}
+
+
+/*!	Merges underfull nodes, and gives the nodes that are no longer needed
+	back to the file system.
+	The children of every index node are repacked, from the leaves upwards;
+	each group of children gets its own small transaction, so that the tree
+	remains usable while this is going on. Afterwards, the nodes at the end
+	of the tree are moved into free nodes before them, and the stream is
+	truncated. Duplicate fragments are never moved, and may therefore keep
+	the tree from shrinking completely.
+	Since the whole operation is not a single transaction, a crash or an
+	error in the middle leaves the tree only partly compacted: every
+	transaction leaves it valid, and it can simply be compacted again.
+*/
+status_t
+BPlusTree::Compact()
+{
+	if (fStream->GetVolume()->IsReadOnly())
+		return B_READ_ONLY_DEVICE;
+
+	uint32 levels;
+	off_t usedNodes, freeNodes;
+	status_t status = CountNodes(levels, usedNodes, freeNodes);
+	if (status != B_OK)
+		return status;
+
+	// Only the children of the same parent are merged, so the nodes at the
+	// borders can often be merged after their parents have been merged, too
+	for (int32 pass = 0; pass < kCompactPasses; pass++) {
+		for (int32 level = (int32)levels - 2; level >= 0; level--) {
+			status = _CompactLevel(level, levels);
+			if (status != B_OK)
+				return status;
+		}
+
+		status = _CollapseRoot();
+		if (status != B_OK)
+			return status;
+
+		off_t previousNodes = usedNodes;
+		status = CountNodes(levels, usedNodes, freeNodes);
+		if (status != B_OK)
+			return status;
+		if (usedNodes >= previousNodes * 99 / 100)
+			break;
+	}
+
+	return _Trim();
+}
+
+
+/*!	Returns the number of levels of the tree, and how many of its nodes are
+	in use, and free. The header is not counted.
+*/
+status_t
+BPlusTree::CountNodes(uint32& _levels, off_t& _usedNodes, off_t& _freeNodes)
+{
+	InodeReadLocker locker(fStream);
+
+	off_t nodeCount = fHeader.MaximumSize() / fNodeSize;
+	off_t freeCount = 0;
+
+	CachedNode cached(this);
+	off_t offset = fHeader.FreeNode();
+	while (offset > 0) {
+		if (++freeCount >= nodeCount)
+			RETURN_ERROR(B_BAD_DATA);
+
+		const bplustree_node* node;
+		status_t status = cached.SetTo(offset, &node, false);
+		if (status != B_OK)
+			return status;
+
+		offset = node->LeftLink();
+	}
+
+	_levels = fHeader.MaxNumberOfLevels();
+	_usedNodes = nodeCount - 1 - freeCount;
+	_freeNodes = freeCount;
+	return B_OK;
+}
+
+
+/*!	Repacks the children of all nodes on the given \a level, one parent per
+	transaction. Between those, the position is remembered by the largest
+	key below the last parent, so that changes to the tree in the meantime
+	don't matter.
+*/
+status_t
+BPlusTree::_CompactLevel(uint32 level, uint32 levels)
+{
+	uint8 lastKey[BPLUSTREE_MAX_KEY_LENGTH];
+	uint16 lastKeyLength = 0;
+	bool first = true;
+
+	while (true) {
+		Transaction transaction(fStream->GetVolume(), fStream->BlockNumber());
+		fStream->WriteLockInTransaction(transaction);
+
+		if (fHeader.MaxNumberOfLevels() != levels) {
+			// the tree has grown, or shrunk in the meantime
+			return transaction.Done();
+		}
+
+		CachedNode cached(this);
+		const bplustree_node* node;
+		off_t parentOffset = fHeader.RootNode();
+
+		if (first) {
+			// start with the leftmost node on this level
+			for (uint32 i = 0; i < level; i++) {
+				if ((node = cached.SetTo(parentOffset)) == NULL)
+					RETURN_ERROR(B_IO_ERROR);
+
+				parentOffset = node->NumKeys() > 0
+					? BFS_ENDIAN_TO_HOST_INT64(node->Values()[0])
+					: node->OverflowLink();
+			}
+			first = false;
+		} else {
+			Stack<node_and_key> stack;
+			status_t status = _SeekDown(stack, lastKey, lastKeyLength);
+			if (status != B_OK)
+				return status;
+			if (stack.CountItems() != (int32)levels)
+				return transaction.Done();
+
+			if ((node = cached.SetTo(stack.Array()[level].nodeOffset)) == NULL)
+				RETURN_ERROR(B_IO_ERROR);
+
+			parentOffset = node->RightLink();
+			if (parentOffset == BPLUSTREE_NULL)
+				return transaction.Done();
+		}
+		cached.Unset();
+
+		status_t status = _CompactChildren(transaction, parentOffset);
+		if (status == B_OK)
+			status = _LastKey(parentOffset, lastKey, &lastKeyLength);
+		if (status == B_ENTRY_NOT_FOUND)
+			return transaction.Done();
+		if (status != B_OK)
+			return status;
+
+		status = transaction.Done();
+		if (status != B_OK)
+			return status;
+	}
+}
+
+
+/*!	Packs the keys of all children of the node at \a parentOffset into as
+	few nodes as possible, and frees the others. The nodes with the lowest
+	offsets are kept, so that the end of the tree can be trimmed more
+	easily later on.
+	Leaves the children alone if that wouldn't save any nodes.
+*/
+status_t
+BPlusTree::_CompactChildren(Transaction& transaction, off_t parentOffset)
+{
+	CachedNode cachedParent(this);
+	const bplustree_node* parent = cachedParent.SetTo(parentOffset);
+	if (parent == NULL)
+		RETURN_ERROR(B_IO_ERROR);
+	if (parent->IsLeaf())
+		return B_OK;
+
+	uint32 childCount = parent->NumKeys() + 1;
+	if (childCount < 2)
+		return B_OK;
+
+	off_t* children = (off_t*)malloc(3 * childCount * sizeof(off_t));
+	uint32* firstEntry = (uint32*)malloc(2 * (childCount + 1)
+		* sizeof(uint32));
+	MemoryDeleter childrenDeleter(children);
+	MemoryDeleter firstEntryDeleter(firstEntry);
+	if (children == NULL || firstEntry == NULL)
+		return B_NO_MEMORY;
+
+	off_t* targets = children + childCount;
+	off_t* separators = targets + childCount;
+	uint32* nodeStart = firstEntry + childCount + 1;
+
+	for (uint32 i = 0; i < childCount - 1; i++)
+		children[i] = BFS_ENDIAN_TO_HOST_INT64(parent->Values()[i]);
+	children[childCount - 1] = parent->OverflowLink();
+
+	// Count the entries of all children
+
+	CachedNode cached(this);
+	const bplustree_node* node;
+	bool leaves = true;
+	uint32 entryCount = 0;
+
+	for (uint32 i = 0; i < childCount; i++) {
+		if ((node = cached.SetTo(children[i])) == NULL)
+			RETURN_ERROR(B_IO_ERROR);
+		if (i == 0)
+			leaves = node->IsLeaf();
+		else if (node->IsLeaf() != leaves)
+			RETURN_ERROR(B_BAD_DATA);
+
+		entryCount += node->NumKeys() + (leaves ? 0 : 1);
+	}
+	if (entryCount == 0)
+		return B_OK;
+
+	// Copy them, including the keys the parent has for index nodes
+
+	compact_entry* entries = (compact_entry*)malloc(
+		entryCount * sizeof(compact_entry));
+	uint8* keys = (uint8*)malloc((childCount + 1) * fNodeSize);
+	MemoryDeleter entriesDeleter(entries);
+	MemoryDeleter keysDeleter(keys);
+	if (entries == NULL || keys == NULL)
+		return B_NO_MEMORY;
+
+	off_t leftLink = BPLUSTREE_NULL;
+	off_t rightLink = BPLUSTREE_NULL;
+	uint32 count = 0;
+	uint32 keyOffset = 0;
+
+	for (uint32 i = 0; i < childCount; i++) {
+		if ((node = cached.SetTo(children[i])) == NULL)
+			RETURN_ERROR(B_IO_ERROR);
+
+		if (i == 0)
+			leftLink = node->LeftLink();
+		if (i == childCount - 1)
+			rightLink = node->RightLink();
+
+		firstEntry[i] = count;
+
+		for (uint32 j = 0; j <= node->NumKeys(); j++) {
+			uint16 keyLength = 0;
+			const uint8* key = NULL;
+			off_t value;
+
+			if (j < node->NumKeys()) {
+				key = node->KeyAt(j, &keyLength);
+				value = BFS_ENDIAN_TO_HOST_INT64(node->Values()[j]);
+			} else if (!leaves) {
+				if (i < childCount - 1)
+					key = parent->KeyAt(i, &keyLength);
+				value = node->OverflowLink();
+			} else
+				break;
+
+			if (keyLength > BPLUSTREE_MAX_KEY_LENGTH || count >= entryCount)
+				RETURN_ERROR(B_BAD_DATA);
+
+			memcpy(keys + keyOffset, key, keyLength);
+			entries[count].keyOffset = keyOffset;
+			entries[count].keyLength = keyLength;
+			entries[count].value = value;
+			keyOffset += keyLength;
+			count++;
+		}
+	}
+	firstEntry[childCount] = count;
+	cached.Unset();
+
+	// Find out how many nodes are needed; the last entry of an index node
+	// becomes its overflow link
+
+	int32 fillLimit = fNodeSize * kCompactNodeFill / 100;
+	uint32 nodeCount = 0;
+	uint32 start = 0;
+
+	while (start < count) {
+		if (nodeCount == childCount)
+			return B_OK;
+
+		uint32 end = start + 1;
+		uint32 keyLength = 0;
+		if (!leaves && end < count) {
+			keyLength = entries[start].keyLength;
+			end++;
+		}
+
+		while (end < count) {
+			// for index nodes, the last entry is the overflow link
+			uint32 keyCount = end + 1 - start - (leaves ? 0 : 1);
+			uint32 nextLength = keyLength + entries[start + keyCount - 1]
+				.keyLength;
+			if (node_usage(keyCount, nextLength) > fillLimit)
+				break;
+
+			keyLength = nextLength;
+			end++;
+		}
+
+		nodeStart[nodeCount++] = start;
+		start = end;
+	}
+	nodeStart[nodeCount] = count;
+
+	if (!leaves && nodeCount > 1
+		&& nodeStart[nodeCount] - nodeStart[nodeCount - 1] == 1) {
+		// an index node needs at least one key besides its overflow link
+		if (nodeStart[nodeCount - 1] - nodeStart[nodeCount - 2] < 3)
+			return B_OK;
+		nodeStart[nodeCount - 1]--;
+	}
+	if (nodeCount >= childCount)
+		return B_OK;
+
+	// The parent gets the largest key of each node but the last one
+
+	uint32 parentKeyLength = 0;
+	for (uint32 i = 0; i < nodeCount - 1; i++) {
+		separators[i] = nodeStart[i + 1] - 1;
+		parentKeyLength += entries[separators[i]].keyLength;
+	}
+	if (node_usage(nodeCount - 1, parentKeyLength) >= (int32)fNodeSize)
+		return B_OK;
+
+	// Keep the children with the lowest offsets
+
+	memcpy(targets, children, childCount * sizeof(off_t));
+	for (uint32 i = 1; i < childCount; i++) {
+		off_t offset = targets[i];
+		uint32 j = i;
+		for (; j > 0 && targets[j - 1] > offset; j--)
+			targets[j] = targets[j - 1];
+		targets[j] = offset;
+	}
+
+	for (uint32 i = 0; i < nodeCount; i++) {
+		bplustree_node* writableNode = cached.SetToWritable(transaction,
+			targets[i], false);
+		if (writableNode == NULL)
+			return B_IO_ERROR;
+
+		writableNode->Initialize();
+		writableNode->left_link = HOST_ENDIAN_TO_BFS_INT64(
+			i == 0 ? leftLink : targets[i - 1]);
+		writableNode->right_link = HOST_ENDIAN_TO_BFS_INT64(
+			i == nodeCount - 1 ? rightLink : targets[i + 1]);
+
+		uint32 end = nodeStart[i + 1];
+		if (!leaves) {
+			end--;
+			writableNode->overflow_link = HOST_ENDIAN_TO_BFS_INT64(
+				entries[end].value);
+		}
+
+		for (uint32 j = nodeStart[i]; j < end; j++) {
+			_InsertKey(writableNode, j - nodeStart[i],
+				keys + entries[j].keyOffset, entries[j].keyLength,
+				entries[j].value);
+		}
+	}
+
+	// Update the neighbours of the group
+
+	if (leftLink != BPLUSTREE_NULL) {
+		bplustree_node* other = cached.SetToWritable(transaction, leftLink);
+		if (other == NULL)
+			return B_IO_ERROR;
+
+		other->right_link = HOST_ENDIAN_TO_BFS_INT64(targets[0]);
+	}
+	if (rightLink != BPLUSTREE_NULL) {
+		bplustree_node* other = cached.SetToWritable(transaction, rightLink);
+		if (other == NULL)
+			return B_IO_ERROR;
+
+		other->left_link = HOST_ENDIAN_TO_BFS_INT64(targets[nodeCount - 1]);
+	}
+
+	for (uint32 i = nodeCount; i < childCount; i++) {
+		if (cached.SetToWritable(transaction, targets[i], false) == NULL)
+			return B_IO_ERROR;
+
+		status_t status = cached.Free(transaction, targets[i]);
+		if (status != B_OK)
+			return status;
+	}
+
+	// Finally, rebuild the parent
+
+	bplustree_node* writableParent = cachedParent.MakeWritable(transaction);
+	if (writableParent == NULL)
+		return B_IO_ERROR;
+
+	off_t parentLeftLink = writableParent->LeftLink();
+	off_t parentRightLink = writableParent->RightLink();
+	writableParent->Initialize();
+	writableParent->left_link = HOST_ENDIAN_TO_BFS_INT64(parentLeftLink);
+	writableParent->right_link = HOST_ENDIAN_TO_BFS_INT64(parentRightLink);
+	writableParent->overflow_link = HOST_ENDIAN_TO_BFS_INT64(
+		targets[nodeCount - 1]);
+
+	for (uint32 i = 0; i < nodeCount - 1; i++) {
+		const compact_entry& entry = entries[separators[i]];
+		_InsertKey(writableParent, i, keys + entry.keyOffset, entry.keyLength,
+			targets[i]);
+	}
+
+	if (leaves) {
+		_RemapIterators(children, firstEntry, childCount, targets, nodeStart,
+			nodeCount);
+	}
+
+	return B_OK;
+}
+
+
+/*!	Copies the largest key below the node at \a offset into \a key.
+	Returns \c B_ENTRY_NOT_FOUND if the tree is empty.
+*/
+status_t
+BPlusTree::_LastKey(off_t offset, uint8* key, uint16* _keyLength)
+{
+	CachedNode cached(this);
+	const bplustree_node* node;
+
+	for (uint32 level = 0; level < fHeader.MaxNumberOfLevels(); level++) {
+		if ((node = cached.SetTo(offset)) == NULL)
+			RETURN_ERROR(B_IO_ERROR);
+
+		if (!node->IsLeaf()) {
+			offset = node->OverflowLink();
+			continue;
+		}
+
+		if (node->NumKeys() == 0)
+			return B_ENTRY_NOT_FOUND;
+
+		uint16 keyLength;
+		uint8* lastKey = node->KeyAt(node->NumKeys() - 1, &keyLength);
+		if (keyLength > BPLUSTREE_MAX_KEY_LENGTH)
+			RETURN_ERROR(B_BAD_DATA);
+
+		memcpy(key, lastKey, keyLength);
+		*_keyLength = keyLength;
+		return B_OK;
+	}
+
+	RETURN_ERROR(B_BAD_DATA);
+}
+
+
+/*!	Removes root nodes that only have a single child left. */
+status_t
+BPlusTree::_CollapseRoot()
+{
+	Transaction transaction(fStream->GetVolume(), fStream->BlockNumber());
+	fStream->WriteLockInTransaction(transaction);
+
+	while (true) {
+		off_t rootOffset = fHeader.RootNode();
+
+		CachedNode cached(this);
+		const bplustree_node* root = cached.SetTo(rootOffset);
+		if (root == NULL)
+			RETURN_ERROR(B_IO_ERROR);
+		if (root->IsLeaf() || root->NumKeys() > 0)
+			break;
+
+		off_t child = root->OverflowLink();
+
+		CachedNode cachedHeader(this);
+		bplustree_header* header = cachedHeader.SetToWritableHeader(
+			transaction);
+		if (header == NULL)
+			return B_IO_ERROR;
+
+		header->root_node_pointer = HOST_ENDIAN_TO_BFS_INT64(child);
+		header->max_number_of_levels = HOST_ENDIAN_TO_BFS_INT32(
+			header->MaxNumberOfLevels() - 1);
+		cachedHeader.Unset();
+
+		if (cached.MakeWritable(transaction) == NULL)
+			return B_IO_ERROR;
+
+		status_t status = cached.Free(transaction, rootOffset);
+		if (status != B_OK)
+			return status;
+	}
+
+	return transaction.Done();
+}
+
+
+/*!	Moves the nodes at the end of the tree into the free nodes before them,
+	and truncates the stream once there are only free nodes left behind the
+	used ones. The number of nodes moved in one transaction depends on the
+	size of the log.
+*/
+status_t
+BPlusTree::_Trim()
+{
+	Volume* volume = fStream->GetVolume();
+	uint32 maxMoves = max_c(volume->Log().Length() / 16, 8);
+
+	while (true) {
+		Transaction transaction(volume, fStream->BlockNumber());
+		fStream->WriteLockInTransaction(transaction);
+
+		off_t nodeCount = fHeader.MaximumSize() / fNodeSize;
+		off_t* freeNodes = (off_t*)malloc(nodeCount * sizeof(off_t));
+		off_t* slots = (off_t*)malloc(maxMoves * sizeof(off_t));
+		MemoryDeleter freeNodesDeleter(freeNodes);
+		MemoryDeleter slotsDeleter(slots);
+		BitmapArray isFree(nodeCount);
+		BitmapArray remove(nodeCount);
+		if (freeNodes == NULL || slots == NULL || isFree.InitCheck() != B_OK
+			|| remove.InitCheck() != B_OK)
+			return B_NO_MEMORY;
+
+		uint32 freeCount;
+		status_t status = _CollectFreeNodes(freeNodes, freeCount, isFree);
+		if (status != B_OK)
+			return status;
+
+		off_t lastFragment;
+		status = _LastFragmentNode(lastFragment);
+		if (status != B_OK)
+			return status;
+
+		// All used nodes would fit before this one
+		off_t targetCount = max_c(nodeCount - freeCount,
+			lastFragment / fNodeSize + 1);
+		if (targetCount >= nodeCount)
+			return transaction.Done();
+
+		// Reserve the first free nodes as new places for the nodes behind
+		// the target, and remove them from the free list
+
+		uint32 slotCount = 0;
+		for (off_t i = 1; i < targetCount && slotCount < maxMoves; i++) {
+			if (isFree.IsSet(i)) {
+				slots[slotCount++] = i * fNodeSize;
+				remove.Set(i, true);
+			}
+		}
+
+		status = _UnlinkFreeNodes(transaction, freeNodes, freeCount, remove);
+		if (status != B_OK)
+			return status;
+
+		uint32 moved = 0;
+		bool complete = false;
+		status = _MoveNodesBehind(transaction, targetCount * fNodeSize, slots,
+			slotCount, moved, complete);
+		if (status != B_OK)
+			return status;
+
+		CachedNode cached(this);
+		for (uint32 i = moved; i < slotCount; i++) {
+			if (cached.SetToWritable(transaction, slots[i], false) == NULL)
+				return B_IO_ERROR;
+
+			status = cached.Free(transaction, slots[i]);
+			if (status != B_OK)
+				return status;
+		}
+		cached.Unset();
+
+		if (!complete) {
+			status = transaction.Done();
+			if (status != B_OK)
+				return status;
+			continue;
+		}
+
+		// Only free nodes are left behind the target now, remove them from
+		// the free list, and cut them off
+
+		BitmapArray stillFree(nodeCount);
+		BitmapArray behind(nodeCount);
+		if (stillFree.InitCheck() != B_OK || behind.InitCheck() != B_OK)
+			return B_NO_MEMORY;
+
+		status = _CollectFreeNodes(freeNodes, freeCount, stillFree);
+		if (status != B_OK)
+			return status;
+
+		for (uint32 i = 0; i < freeCount; i++) {
+			if (freeNodes[i] >= targetCount * fNodeSize)
+				behind.Set(freeNodes[i] / fNodeSize, true);
+		}
+
+		status = _UnlinkFreeNodes(transaction, freeNodes, freeCount, behind);
+		if (status != B_OK)
+			return status;
+
+		bplustree_header* header = cached.SetToWritableHeader(transaction);
+		if (header == NULL)
+			return B_IO_ERROR;
+
+		header->maximum_size = HOST_ENDIAN_TO_BFS_INT64(
+			targetCount * fNodeSize);
+		cached.Unset();
+
+		status = fStream->SetFileSize(transaction, targetCount * fNodeSize);
+		if (status != B_OK)
+			return status;
+
+		return transaction.Done();
+	}
+}
+
+
+/*!	Fills \a nodes with the offsets of all free nodes in the order of the
+	free list, and marks them in \a isFree. \a nodes must have room for all
+	nodes of the tree.
+*/
+status_t
+BPlusTree::_CollectFreeNodes(off_t* nodes, uint32& _count,
+	BitmapArray& isFree)
+{
+	off_t nodeCount = fHeader.MaximumSize() / fNodeSize;
+	uint32 count = 0;
+
+	CachedNode cached(this);
+	off_t offset = fHeader.FreeNode();
+	while (offset > 0) {
+		if (count + 1 >= nodeCount || isFree.IsSet(offset / fNodeSize))
+			RETURN_ERROR(B_BAD_DATA);
+
+		const bplustree_node* node;
+		status_t status = cached.SetTo(offset, &node, false);
+		if (status != B_OK)
+			return status;
+
+		isFree.Set(offset / fNodeSize, true);
+		nodes[count++] = offset;
+		offset = node->LeftLink();
+	}
+
+	_count = count;
+	return B_OK;
+}
+
+
+/*!	Removes the nodes marked in \a remove from the free list, which is given
+	in \a nodes in its current order.
+*/
+status_t
+BPlusTree::_UnlinkFreeNodes(Transaction& transaction, const off_t* nodes,
+	uint32 count, const BitmapArray& remove)
+{
+	CachedNode cached(this);
+	off_t nextKept = BPLUSTREE_NULL;
+
+	for (int32 i = (int32)count - 1; i >= -1; i--) {
+		if (i >= 0 && remove.IsSet(nodes[i] / fNodeSize))
+			continue;
+
+		off_t next = i + 1 < (int32)count ? nodes[i + 1] : BPLUSTREE_NULL;
+		if (next != nextKept) {
+			if (i < 0) {
+				bplustree_header* header
+					= cached.SetToWritableHeader(transaction);
+				if (header == NULL)
+					return B_IO_ERROR;
+
+				header->free_node_pointer = HOST_ENDIAN_TO_BFS_INT64(nextKept);
+			} else {
+				bplustree_node* node = cached.SetToWritable(transaction,
+					nodes[i], false);
+				if (node == NULL)
+					return B_IO_ERROR;
+
+				node->left_link = HOST_ENDIAN_TO_BFS_INT64(nextKept);
+			}
+		}
+
+		if (i >= 0)
+			nextKept = nodes[i];
+	}
+
+	return B_OK;
+}
+
+
+/*!	Finds the duplicate fragment node with the highest offset, as these are
+	not moved. Sets \a _offset to 0 if there are none.
+*/
+status_t
+BPlusTree::_LastFragmentNode(off_t& _offset)
+{
+	CachedNode cached(this);
+	const bplustree_node* node;
+	off_t offset = fHeader.RootNode();
+	off_t lastFragment = 0;
+
+	// go down to the leftmost leaf
+	for (uint32 level = 1; level < fHeader.MaxNumberOfLevels(); level++) {
+		if ((node = cached.SetTo(offset)) == NULL)
+			RETURN_ERROR(B_IO_ERROR);
+
+		offset = node->NumKeys() > 0
+			? BFS_ENDIAN_TO_HOST_INT64(node->Values()[0])
+			: node->OverflowLink();
+	}
+
+	while (offset != BPLUSTREE_NULL) {
+		if ((node = cached.SetTo(offset)) == NULL)
+			RETURN_ERROR(B_IO_ERROR);
+		if (!node->IsLeaf())
+			RETURN_ERROR(B_BAD_DATA);
+
+		for (uint32 i = 0; i < node->NumKeys(); i++) {
+			off_t value = BFS_ENDIAN_TO_HOST_INT64(node->Values()[i]);
+			if (bplustree_node::LinkType(value) == BPLUSTREE_DUPLICATE_FRAGMENT
+				&& bplustree_node::FragmentOffset(value) > lastFragment)
+				lastFragment = bplustree_node::FragmentOffset(value);
+		}
+
+		offset = node->RightLink();
+	}
+
+	_offset = lastFragment;
+	return B_OK;
+}
+
+
+/*!	Walks the tree level by level, and moves every node behind \a limit into
+	one of the \a slots. \a _complete is set to \c true if all nodes could
+	be moved, otherwise, \a _moved slots have been used.
+*/
+status_t
+BPlusTree::_MoveNodesBehind(Transaction& transaction, off_t limit,
+	const off_t* slots, uint32 slotCount, uint32& _moved, bool& _complete)
+{
+	off_t nodeCount = fHeader.MaximumSize() / fNodeSize;
+	off_t* level = (off_t*)malloc(2 * nodeCount * sizeof(off_t));
+	MemoryDeleter levelDeleter(level);
+	if (level == NULL)
+		return B_NO_MEMORY;
+
+	off_t* nextLevel = level + nodeCount;
+	uint32 moved = 0;
+	_complete = false;
+
+	off_t rootOffset = fHeader.RootNode();
+	if (rootOffset >= limit) {
+		if (slotCount == 0) {
+			_moved = 0;
+			return B_OK;
+		}
+
+		status_t status = _MoveNode(transaction, rootOffset, slots[moved]);
+		if (status != B_OK)
+			return status;
+
+		CachedNode cachedHeader(this);
+		bplustree_header* header = cachedHeader.SetToWritableHeader(
+			transaction);
+		if (header == NULL)
+			return B_IO_ERROR;
+
+		rootOffset = slots[moved++];
+		header->root_node_pointer = HOST_ENDIAN_TO_BFS_INT64(rootOffset);
+	}
+
+	level[0] = rootOffset;
+	off_t levelCount = 1;
+
+	CachedNode cached(this);
+	CachedNode cachedDuplicate(this);
+
+	while (levelCount > 0) {
+		off_t nextCount = 0;
+
+		for (off_t i = 0; i < levelCount; i++) {
+			const bplustree_node* node = cached.SetTo(level[i]);
+			if (node == NULL)
+				RETURN_ERROR(B_IO_ERROR);
+
+			bool isLeaf = node->IsLeaf();
+			uint32 keyCount = node->NumKeys();
+
+			for (uint32 j = 0; j <= keyCount; j++) {
+				off_t child = j < keyCount
+					? BFS_ENDIAN_TO_HOST_INT64(node->Values()[j])
+					: node->OverflowLink();
+
+				if (isLeaf) {
+					if (j == keyCount
+						|| bplustree_node::LinkType(child)
+							!= BPLUSTREE_DUPLICATE_NODE)
+						continue;
+
+					// move the duplicate nodes of this key
+					off_t duplicate = bplustree_node::FragmentOffset(child);
+					bool first = true;
+					while (duplicate != BPLUSTREE_NULL) {
+						if (duplicate >= limit) {
+							if (moved == slotCount) {
+								_moved = moved;
+								return B_OK;
+							}
+
+							status_t status = _MoveNode(transaction, duplicate,
+								slots[moved]);
+							if (status != B_OK)
+								return status;
+
+							duplicate = slots[moved++];
+							if (first) {
+								bplustree_node* writableNode
+									= cached.MakeWritable(transaction);
+								if (writableNode == NULL)
+									return B_IO_ERROR;
+
+								writableNode->Values()[j]
+									= HOST_ENDIAN_TO_BFS_INT64(
+										bplustree_node::MakeLink(
+											BPLUSTREE_DUPLICATE_NODE,
+											duplicate));
+							}
+						}
+
+						const bplustree_node* duplicateNode
+							= cachedDuplicate.SetTo(duplicate, false);
+						if (duplicateNode == NULL)
+							RETURN_ERROR(B_IO_ERROR);
+
+						duplicate = duplicateNode->RightLink();
+						first = false;
+					}
+					continue;
+				}
+
+				if (child >= limit) {
+					if (moved == slotCount) {
+						_moved = moved;
+						return B_OK;
+					}
+
+					status_t status = _MoveNode(transaction, child,
+						slots[moved]);
+					if (status != B_OK)
+						return status;
+
+					child = slots[moved++];
+
+					bplustree_node* writableNode
+						= cached.MakeWritable(transaction);
+					if (writableNode == NULL)
+						return B_IO_ERROR;
+
+					if (j < keyCount) {
+						writableNode->Values()[j]
+							= HOST_ENDIAN_TO_BFS_INT64(child);
+					} else
+						writableNode->overflow_link
+							= HOST_ENDIAN_TO_BFS_INT64(child);
+				}
+
+				if (nextCount >= nodeCount)
+					RETURN_ERROR(B_BAD_DATA);
+				nextLevel[nextCount++] = child;
+			}
+		}
+
+		off_t* swap = level;
+		level = nextLevel;
+		nextLevel = swap;
+		levelCount = nextCount;
+	}
+
+	_moved = moved;
+	_complete = true;
+	return B_OK;
+}
+
+
+/*!	Copies the node at \a from to the unused node at \a to, updates the links
+	of its neighbours and the iterators, and frees the old node. The caller
+	has to update the reference to the node.
+*/
+status_t
+BPlusTree::_MoveNode(Transaction& transaction, off_t from, off_t to)
+{
+	uint8* buffer = (uint8*)malloc(fNodeSize);
+	MemoryDeleter bufferDeleter(buffer);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+
+	CachedNode cached(this);
+	const bplustree_node* node = cached.SetTo(from, false);
+	if (node == NULL)
+		RETURN_ERROR(B_IO_ERROR);
+
+	memcpy(buffer, node, fNodeSize);
+
+	bplustree_node* target = cached.SetToWritable(transaction, to, false);
+	if (target == NULL)
+		return B_IO_ERROR;
+
+	memcpy(target, buffer, fNodeSize);
+	off_t leftLink = target->LeftLink();
+	off_t rightLink = target->RightLink();
+
+	CachedNode cachedOther(this);
+	if (leftLink != BPLUSTREE_NULL) {
+		bplustree_node* other = cachedOther.SetToWritable(transaction,
+			leftLink, false);
+		if (other == NULL)
+			return B_IO_ERROR;
+
+		other->right_link = HOST_ENDIAN_TO_BFS_INT64(to);
+	}
+	if (rightLink != BPLUSTREE_NULL) {
+		bplustree_node* other = cachedOther.SetToWritable(transaction,
+			rightLink, false);
+		if (other == NULL)
+			return B_IO_ERROR;
+
+		other->left_link = HOST_ENDIAN_TO_BFS_INT64(to);
+	}
+
+	if (cached.SetToWritable(transaction, from, false) == NULL)
+		return B_IO_ERROR;
+
+	status_t status = cached.Free(transaction, from);
+	if (status != B_OK)
+		return status;
+
+	_MoveIterators(from, to);
+	return B_OK;
+}
+
+
+/*!	Lets the iterators that point into the \a childCount leaves in \a children
+	point to the same key in the \a nodeCount leaves in \a targets.
+	\a firstEntry and \a nodeStart contain the position of the first key of
+	each leaf within the keys of all of them.
+*/
+void
+BPlusTree::_RemapIterators(const off_t* children, const uint32* firstEntry,
+	uint32 childCount, const off_t* targets, const uint32* nodeStart,
+	uint32 nodeCount)
+{
+	MutexLocker _(fIteratorLock);
+
+	SinglyLinkedList<TreeIterator>::ConstIterator iterator
+		= fIterators.GetIterator();
+	while (iterator.HasNext()) {
+		TreeIterator* treeIterator = iterator.Next();
+
+		for (uint32 i = 0; i < childCount; i++) {
+			if (treeIterator->fCurrentNodeOffset != children[i])
+				continue;
+
+			int32 position = firstEntry[i] + treeIterator->fCurrentKey;
+			uint32 node = 0;
+			while (node + 1 < nodeCount
+				&& position >= (int32)nodeStart[node + 1])
+				node++;
+
+			treeIterator->fCurrentNodeOffset = targets[node];
+			treeIterator->fCurrentKey = position - nodeStart[node];
+			break;
+		}
+	}
+}
+
+
+void
+BPlusTree::_MoveIterators(off_t from, off_t to)
+{
+	MutexLocker _(fIteratorLock);
+
+	SinglyLinkedList<TreeIterator>::ConstIterator iterator
+		= fIterators.GetIterator();
+	while (iterator.HasNext()) {
+		TreeIterator* treeIterator = iterator.Next();
+
+		if (treeIterator->fCurrentNodeOffset == from)
+			treeIterator->fCurrentNodeOffset = to;
+
+		off_t duplicate = treeIterator->fDuplicateNode;
+		if (duplicate != BPLUSTREE_NULL
+			&& bplustree_node::FragmentOffset(duplicate) == from) {
+			treeIterator->fDuplicateNode = bplustree_node::MakeLink(
+				bplustree_node::LinkType(duplicate), to,
+				bplustree_node::FragmentIndex(duplicate));
+		}
+	}
+}
 #endif // !_BOOT_MODE
 
 
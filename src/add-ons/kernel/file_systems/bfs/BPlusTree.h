@@ -158,6 +158,7 @@ enum bplustree_traversing {
 //	#pragma mark - in-memory structures
 
 
+class BitmapArray;
 class BPlusTree;
 struct TreeCheck;
 class TreeIterator;
@@ -268,6 +269,9 @@ public:
 #if !_BOOT_MODE
 			status_t			Validate(bool repair, bool& _errorsFound);
 			status_t			MakeEmpty();
+			status_t			Compact();
+			status_t			CountNodes(uint32& _levels, off_t& _usedNodes,
+									off_t& _freeNodes);
 
 			status_t			Remove(Transaction& transaction,
 									const uint8* key, uint16 keyLength,
@@ -300,6 +304,12 @@ public:
 
 			status_t			Find(const uint8* key, uint16 keyLength,
 									off_t* value);
+#if !_BOOT_MODE
+			status_t			EstimateRange(const uint8* from,
+									uint16 fromLength, const uint8* to,
+									uint16 toLength, bool prefix,
+									off_t* _count);
+#endif
 
 #if !_BOOT_MODE
 	static	int32				TypeCodeToKeyType(type_code code);
@@ -321,6 +331,8 @@ private:
 									const uint8* key, uint16 keyLength,
 									uint16* index = NULL, off_t* next = NULL);
 #if !_BOOT_MODE
+			status_t			_EstimatePosition(const uint8* key,
+									uint16 keyLength, uint64& _position);
 			status_t			_SeekDown(Stack<node_and_key>& stack,
 									const uint8* key, uint16 keyLength);
 
@@ -362,6 +374,32 @@ private:
 									off_t offset, off_t lastOffset,
 									off_t nextOffset, const uint8* key,
 									uint16 keyLength);
+
+			status_t			_CompactLevel(uint32 level, uint32 levels);
+			status_t			_CompactChildren(Transaction& transaction,
+									off_t parentOffset);
+			status_t			_LastKey(off_t offset, uint8* key,
+									uint16* _keyLength);
+			status_t			_CollapseRoot();
+			status_t			_Trim();
+			status_t			_CollectFreeNodes(off_t* nodes,
+									uint32& _count, BitmapArray& isFree);
+			status_t			_UnlinkFreeNodes(Transaction& transaction,
+									const off_t* nodes, uint32 count,
+									const BitmapArray& remove);
+			status_t			_LastFragmentNode(off_t& _offset);
+			status_t			_MoveNodesBehind(Transaction& transaction,
+									off_t limit, const off_t* slots,
+									uint32 slotCount, uint32& _moved,
+									bool& _complete);
+			status_t			_MoveNode(Transaction& transaction,
+									off_t from, off_t to);
+			void				_RemapIterators(const off_t* children,
+									const uint32* firstEntry,
+									uint32 childCount, const off_t* targets,
+									const uint32* nodeStart,
+									uint32 nodeCount);
+			void				_MoveIterators(off_t from, off_t to);
 #endif // !_BOOT_MODE
 
 private:
@@ -11,8 +11,11 @@
 
 #include "Debug.h"
 #include "Inode.h"
+#include "Journal.h"
 #include "Volume.h"
 
+#include <util/SplayTree.h>
+
 
 // Things the BlockAllocator should do:
 
@@ -30,9 +33,14 @@
 // group can span several blocks in the block bitmap, the AllocationBlock
 // class is there to make handling those easier.
 
-// The current implementation is only slightly optimized and could probably
-// be improved a lot. Furthermore, the allocation policies used here should
-// have some real world tests.
+// To avoid scanning the bitmap for every allocation, each allocation group
+// keeps an index of its free ranges in memory, ordered by position, and by
+// size. It is built when the bitmap is read in, and is maintained on every
+// allocation and free. Since a heavily fragmented group could need a lot of
+// memory for this, the number of ranges per group is limited; groups that
+// exceed it are scanned the old way.
+
+// The allocation policies used here should have some real world tests.
 
 #if BFS_TRACING && !defined(FS_SHELL)
 namespace BFSBlockTracing {
@@ -192,7 +200,102 @@ private:
 };
 
 
-class AllocationGroup {
+struct free_range {
+	SplayTreeLink<free_range>	startLink;
+	SplayTreeLink<free_range>	sizeLink;
+	int32						start;
+	int32						length;
+};
+
+
+struct FreeRangeStartDefinition {
+	typedef int32 KeyType;
+	typedef free_range NodeType;
+
+	static KeyType GetKey(const NodeType* node)
+	{
+		return node->start;
+	}
+
+	static SplayTreeLink<NodeType>* GetLink(NodeType* node)
+	{
+		return &node->startLink;
+	}
+
+	static int Compare(KeyType key, const NodeType* node)
+	{
+		return key == node->start ? 0 : (key < node->start ? -1 : 1);
+	}
+};
+
+
+struct FreeRangeSizeDefinition {
+	typedef uint64 KeyType;
+	typedef free_range NodeType;
+
+	static KeyType MakeKey(int32 length, int32 start)
+	{
+		return ((uint64)length << 32) | (uint32)start;
+	}
+
+	static KeyType GetKey(const NodeType* node)
+	{
+		return MakeKey(node->length, node->start);
+	}
+
+	static SplayTreeLink<NodeType>* GetLink(NodeType* node)
+	{
+		return &node->sizeLink;
+	}
+
+	static int Compare(KeyType key, const NodeType* node)
+	{
+		KeyType nodeKey = GetKey(node);
+		return key == nodeKey ? 0 : (key < nodeKey ? -1 : 1);
+	}
+};
+
+
+typedef SplayTree<FreeRangeStartDefinition> FreeRangeStartTree;
+typedef SplayTree<FreeRangeSizeDefinition> FreeRangeSizeTree;
+
+
+/*!	An in-memory index of the free ranges of an allocation group. It is only
+	a cache of the block bitmap: if it cannot be maintained, because it got
+	too large, or doesn't match the bitmap anymore, it is dropped, and can be
+	rebuilt from the bitmap later on.
+*/
+class FreeRangeIndex {
+public:
+	FreeRangeIndex();
+	~FreeRangeIndex();
+
+	bool IsValid() const { return fValid; }
+	void SetMaxRanges(int32 maxRanges) { fMaxRanges = maxRanges; }
+
+	void MakeEmpty();
+	void Invalidate();
+
+	status_t Add(int32 start, int32 length);
+	status_t Allocate(int32 start, int32 length);
+	status_t Free(int32 start, int32 length);
+
+	bool Find(int32 near, int32 length, int32& start, int32& foundLength);
+	free_range* Lookup(int32 start) { return fStartTree.Lookup(start); }
+
+private:
+	void _Clear();
+	void _Remove(free_range* range);
+
+	FreeRangeStartTree	fStartTree;
+	FreeRangeSizeTree	fSizeTree;
+	int32				fCount;
+	int32				fMaxRanges;
+	bool				fValid;
+};
+
+
+class AllocationGroup : public TransactionListener {
 public:
 	AllocationGroup();
 
@@ -206,9 +309,17 @@ public:
 	uint32 NumBitmapBlocks() const { return fNumBitmapBlocks; }
 	int32 Start() const { return fStart; }
 
+	bool ShouldBuildIndex() const;
+	void DropIndex(status_t reason);
+
+	virtual void TransactionDone(bool success);
+	virtual void RemovedFromTransaction();
+
 private:
 	friend class BlockAllocator;
 
+	void _AddToTransaction(Transaction& transaction);
+
 	uint32	fNumBits;
 	uint32	fNumBitmapBlocks;
 	int32	fStart;
@@ -218,9 +329,25 @@ private:
 	int32	fLargestStart;
 	int32	fLargestLength;
 	bool	fLargestValid;
+
+	FreeRangeIndex fFreeRanges;
+	int32	fIndexRetryFreeBits;
+
+	recursive_lock* fAllocatorLock;
+	bool	fInTransaction;
 };
 
 
+// The free range index of a group is limited to this many ranges, or a
+// share of kMaxIndexedRanges for all groups, whichever is larger
+static const int32 kMinIndexedRangesPerGroup = 64;
+static const int32 kMaxIndexedRanges = 65536;
+
+// How many free ranges following the wanted position are looked at, before
+// the best fitting range anywhere in the group is chosen instead
+static const int32 kMaxNearRanges = 8;
+
+
 AllocationBlock::AllocationBlock(Volume* volume)
 	: CachedBlock(volume)
 {
@@ -362,6 +489,233 @@ AllocationBlock::Free(uint16 start, uint16 numBlocks)
 //	#pragma mark -
 
 
+FreeRangeIndex::FreeRangeIndex()
+	:
+	fCount(0),
+	fMaxRanges(kMinIndexedRangesPerGroup),
+	fValid(false)
+{
+}
+
+
+FreeRangeIndex::~FreeRangeIndex()
+{
+	_Clear();
+}
+
+
+/*!	Empties the index, and marks it valid, so that it can be filled using
+	Add().
+*/
+void
+FreeRangeIndex::MakeEmpty()
+{
+	_Clear();
+	fValid = true;
+}
+
+
+void
+FreeRangeIndex::Invalidate()
+{
+	_Clear();
+	fValid = false;
+}
+
+
+/*!	Adds a free range that must not touch any of the ranges in the index.
+	Returns \c B_NO_MEMORY, and invalidates the index if that would exceed
+	the maximum number of ranges.
+*/
+status_t
+FreeRangeIndex::Add(int32 start, int32 length)
+{
+	if (!fValid)
+		return B_NO_INIT;
+
+	free_range* range = NULL;
+	if (fCount < fMaxRanges)
+		range = new(std::nothrow) free_range;
+	if (range == NULL) {
+		Invalidate();
+		return B_NO_MEMORY;
+	}
+
+	range->start = start;
+	range->length = length;
+	fStartTree.Insert(range);
+	fSizeTree.Insert(range);
+	fCount++;
+	return B_OK;
+}
+
+
+/*!	Removes the specified blocks from the free range that contains them.
+	If they are not free according to the index, it is invalidated, and
+	\c B_BAD_DATA is returned.
+*/
+status_t
+FreeRangeIndex::Allocate(int32 start, int32 length)
+{
+	if (!fValid)
+		return B_NO_INIT;
+
+	free_range* range = fStartTree.FindClosest(start, false, true);
+	if (range == NULL || range->start + range->length < start + length) {
+		Invalidate();
+		return B_BAD_DATA;
+	}
+
+	int32 end = start + length;
+	int32 rangeEnd = range->start + range->length;
+
+	if (range->start == start) {
+		if (end == rangeEnd) {
+			_Remove(range);
+			delete range;
+			return B_OK;
+		}
+
+		// cut from the start
+		fStartTree.Remove(range);
+		fSizeTree.Remove(range);
+		range->start = end;
+		range->length = rangeEnd - end;
+		fStartTree.Insert(range);
+		fSizeTree.Insert(range);
+		return B_OK;
+	}
+
+	// cut from the end, and keep what remains after the allocation
+	fSizeTree.Remove(range);
+	range->length = start - range->start;
+	fSizeTree.Insert(range);
+
+	if (end < rangeEnd)
+		return Add(end, rangeEnd - end);
+
+	return B_OK;
+}
+
+
+/*!	Adds the specified blocks to the index, and joins them with the ranges
+	directly before and after them.
+*/
+status_t
+FreeRangeIndex::Free(int32 start, int32 length)
+{
+	if (!fValid)
+		return B_NO_INIT;
+
+	int32 end = start + length;
+	free_range* previous = fStartTree.FindClosest(start, false, false);
+	free_range* next = fStartTree.FindClosest(start, true, true);
+
+	if ((previous != NULL && previous->start + previous->length > start)
+		|| (next != NULL && next->start < end)) {
+		// the blocks are already free according to the index
+		Invalidate();
+		return B_BAD_DATA;
+	}
+
+	if (previous != NULL && previous->start + previous->length == start) {
+		fSizeTree.Remove(previous);
+		previous->length += length;
+
+		if (next != NULL && next->start == end) {
+			previous->length += next->length;
+			_Remove(next);
+			delete next;
+		}
+
+		fSizeTree.Insert(previous);
+		return B_OK;
+	}
+
+	if (next != NULL && next->start == end) {
+		fStartTree.Remove(next);
+		fSizeTree.Remove(next);
+		next->start = start;
+		next->length += length;
+		fStartTree.Insert(next);
+		fSizeTree.Insert(next);
+		return B_OK;
+	}
+
+	return Add(start, length);
+}
+
+
+/*!	Looks for a free range of at least \a length blocks. If \a near is not
+	zero, one of the ranges at or shortly after that position is preferred,
+	to keep data that belongs together close to each other. Otherwise, or if
+	there is none, the smallest range that fits is chosen. If no range is
+	large enough, the largest one is returned.
+	The range found may be larger than \a length.
+*/
+bool
+FreeRangeIndex::Find(int32 near, int32 length, int32& start,
+	int32& foundLength)
+{
+	if (!fValid)
+		return false;
+
+	if (near > 0) {
+		free_range* range = fStartTree.FindClosest(near, false, true);
+		if (range == NULL || range->start + range->length <= near)
+			range = fStartTree.FindClosest(near, true, false);
+
+		for (int32 i = 0; range != NULL && i < kMaxNearRanges; i++) {
+			int32 rangeStart = max_c(range->start, near);
+			int32 rangeLength = range->start + range->length - rangeStart;
+			if (rangeLength >= length) {
+				start = rangeStart;
+				foundLength = rangeLength;
+				return true;
+			}
+
+			range = fStartTree.FindClosest(range->start, true, false);
+		}
+	}
+
+	free_range* range = fSizeTree.FindClosest(
+		FreeRangeSizeDefinition::MakeKey(length, 0), true, true);
+	if (range == NULL)
+		range = fSizeTree.FindMax();
+	if (range == NULL)
+		return false;
+
+	start = range->start;
+	foundLength = range->length;
+	return true;
+}
+
+
+void
+FreeRangeIndex::_Clear()
+{
+	while (free_range* range = fStartTree.FindMin()) {
+		fStartTree.Remove(range);
+		delete range;
+	}
+
+	fSizeTree = FreeRangeSizeTree();
+	fCount = 0;
+}
+
+
+void
+FreeRangeIndex::_Remove(free_range* range)
+{
+	fStartTree.Remove(range);
+	fSizeTree.Remove(range);
+	fCount--;
+}
+
+
+//	#pragma mark -
+
+
 /*!	The allocation groups are created and initialized in
 	BlockAllocator::Initialize() and BlockAllocator::InitializeAndClearBitmap()
 	respectively.
@@ -370,7 +724,10 @@ AllocationGroup::AllocationGroup()
 	:
 	fFirstFree(-1),
 	fFreeBits(0),
-	fLargestValid(false)
+	fLargestValid(false),
+	fIndexRetryFreeBits(0),
+	fAllocatorLock(NULL),
+	fInTransaction(false)
 {
 }
 
@@ -391,6 +748,39 @@ AllocationGroup::AddFreeRange(int32 start, int32 blocks)
 	}
 
 	fFreeBits += blocks;
+
+	status_t status = fFreeRanges.Add(start, blocks);
+	if (status != B_OK && status != B_NO_INIT)
+		DropIndex(status);
+}
+
+
+/*!	Returns whether or not it makes sense to try to build the free range
+	index of this group from the block bitmap.
+*/
+bool
+AllocationGroup::ShouldBuildIndex() const
+{
+	return !fFreeRanges.IsValid() && fFreeBits >= fIndexRetryFreeBits;
+}
+
+
+/*!	Drops the free range index. If it was too large, it will only be built
+	again once more blocks have become free, as it will likely have gotten
+	less fragmented then. The same applies if it did not match the block
+	bitmap, so that a group that keeps diverging does not get its index
+	rebuilt on every allocation.
+*/
+void
+AllocationGroup::DropIndex(status_t reason)
+{
+	fFreeRanges.Invalidate();
+
+	if (reason == B_NO_MEMORY || reason == B_BAD_DATA) {
+		fIndexRetryFreeBits = min_c(fFreeBits + (int32)fNumBits / 8,
+			(int32)fNumBits);
+	} else
+		fIndexRetryFreeBits = 0;
 }
 
 
@@ -433,6 +823,12 @@ AllocationGroup::Allocate(Transaction& transaction, uint16 start, int32 length)
 		}
 	}
 
+	_AddToTransaction(transaction);
+
+	status_t status = fFreeRanges.Allocate(start, length);
+	if (status != B_OK && status != B_NO_INIT)
+		DropIndex(status);
+
 	Volume* volume = transaction.GetVolume();
 
 	// calculate block in the block bitmap and position within
@@ -445,6 +841,7 @@ AllocationGroup::Allocate(Transaction& transaction, uint16 start, int32 length)
 	while (length > 0) {
 		if (cached.SetToWritable(transaction, *this, block) < B_OK) {
 			fLargestValid = false;
+			DropIndex(B_IO_ERROR);
 			RETURN_ERROR(B_IO_ERROR);
 		}
 
@@ -494,6 +891,12 @@ AllocationGroup::Free(Transaction& transaction, uint16 start, int32 length)
 		fLargestValid = false;
 	}
 
+	_AddToTransaction(transaction);
+
+	status_t status = fFreeRanges.Free(start, length);
+	if (status != B_OK && status != B_NO_INIT)
+		DropIndex(status);
+
 	Volume* volume = transaction.GetVolume();
 
 	// calculate block in the block bitmap and position within
@@ -504,8 +907,10 @@ AllocationGroup::Free(Transaction& transaction, uint16 start, int32 length)
 	AllocationBlock cached(volume);
 
 	while (length > 0) {
-		if (cached.SetToWritable(transaction, *this, block) < B_OK)
+		if (cached.SetToWritable(transaction, *this, block) < B_OK) {
+			DropIndex(B_IO_ERROR);
 			RETURN_ERROR(B_IO_ERROR);
+		}
 
 		T(Block("free-1", block, cached.Block(), volume->BlockSize()));
 		uint16 freeLength = length;
@@ -523,6 +928,40 @@ AllocationGroup::Free(Transaction& transaction, uint16 start, int32 length)
 }
 
 
+/*!	If the transaction is aborted, the block cache reverts the bitmap blocks,
+	but not the free range index. Since we don't know which of its changes
+	were part of the transaction, we just drop the index then, and let it be
+	rebuilt from the reverted bitmap the next time it is needed.
+*/
+void
+AllocationGroup::TransactionDone(bool success)
+{
+	if (success)
+		return;
+
+	RecursiveLocker locker(fAllocatorLock);
+	fLargestValid = false;
+	DropIndex(B_OK);
+}
+
+
+void
+AllocationGroup::RemovedFromTransaction()
+{
+	fInTransaction = false;
+}
+
+
+void
+AllocationGroup::_AddToTransaction(Transaction& transaction)
+{
+	if (!fInTransaction) {
+		transaction.AddListener(this);
+		fInTransaction = true;
+	}
+}
+
+
 //	#pragma mark -
 
 
@@ -534,6 +973,7 @@ BlockAllocator::BlockAllocator(Volume* volume)
 	fAllowedEndBlock(0)
 {
 	recursive_lock_init(&fLock, "bfs allocator");
+	memset(fLocalityHints, 0, sizeof(fLocalityHints));
 }
 
 
@@ -555,6 +995,13 @@ BlockAllocator::Initialize(bool full)
 	if (fGroups == NULL)
 		return B_NO_MEMORY;
 
+	int32 maxRanges = max_c(kMaxIndexedRanges / fNumGroups,
+		kMinIndexedRangesPerGroup);
+	for (int32 i = 0; i < fNumGroups; i++) {
+		fGroups[i].fFreeRanges.SetMaxRanges(maxRanges);
+		fGroups[i].fAllocatorLock = &fLock;
+	}
+
 	if (!full)
 		return B_OK;
 
@@ -613,6 +1060,8 @@ BlockAllocator::InitializeAndClearBitmap(Transaction& transaction)
 		fGroups[i].fFirstFree = fGroups[i].fLargestStart = 0;
 		fGroups[i].fFreeBits = fGroups[i].fLargestLength = fGroups[i].fNumBits;
 		fGroups[i].fLargestValid = true;
+		fGroups[i].fFreeRanges.MakeEmpty();
+		fGroups[i].fFreeRanges.Add(0, fGroups[i].fNumBits);
 
 		offset += fBlocksPerGroup;
 	}
@@ -695,6 +1144,7 @@ BlockAllocator::_Initialize(BlockAllocator* allocator)
 			groups[i].fNumBitmapBlocks = blocks;
 		}
 		groups[i].fStart = offset;
+		groups[i].fFreeRanges.MakeEmpty();
 
 		// finds all free ranges in this allocation group
 		int32 start = -1, range = 0;
@@ -849,6 +1299,9 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 			lastGroupEnd = bitsPerFullBlock;
 	}
 
+	// The free range indices don't know about the allowed range
+	bool useIndex = fAllowedBeginBlock == 0 && fAllowedEndBlock == 0;
+
 	// Find the block_run that can fulfill the request best
 	int32 bestGroup = -1;
 	int32 bestStart = -1;
@@ -875,6 +1328,32 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 		if (start >= end || group.IsFull())
 			continue;
 
+		if (useIndex && (group.fFreeRanges.IsValid()
+				|| (group.ShouldBuildIndex() && _BuildIndex(group) == B_OK))) {
+			int32 rangeStart;
+			int32 rangeLength;
+			if (!group.fFreeRanges.Find(start, maximum, rangeStart,
+					rangeLength) || rangeLength <= bestLength) {
+				// The group has no free range that would be better than
+				// what we have already
+				continue;
+			} else if (CheckBlockRun(block_run::Run(groupIndex, rangeStart,
+					min_c(rangeLength, (int32)maximum)), NULL, false) == B_OK) {
+				bestGroup = groupIndex;
+				bestStart = rangeStart;
+				bestLength = rangeLength;
+
+				if (bestLength >= maximum)
+					break;
+				continue;
+			} else {
+				// The index doesn't match the bitmap (anymore), scan it
+				// instead
+				group.DropIndex(B_BAD_DATA);
+				group.fLargestValid = false;
+			}
+		}
+
 		// The wanted maximum is smaller than the largest free block in the
 		// group or already smaller than the minimum
 
@@ -1064,14 +1543,17 @@ BlockAllocator::AllocateForInode(Transaction& transaction,
 	// if necessary) - we will start with those described in Dominic Giampaolo's
 	// "Practical File System Design", and see how good they work
 
-	// Files are going in the same allocation group as its parent,
-	// sub-directories will be inserted 8 allocation groups after
+	// Files are going in the same allocation group as its parent, close
+	// after it, sub-directories will be inserted 8 allocation groups after
 	// the one of the parent
 	uint16 group = parent->AllocationGroup();
-	if ((type & (S_DIRECTORY | S_INDEX_DIR | S_ATTR_DIR)) == S_DIRECTORY)
+	uint16 start = parent->Start();
+	if ((type & (S_DIRECTORY | S_INDEX_DIR | S_ATTR_DIR)) == S_DIRECTORY) {
 		group += 8;
+		start = 0;
+	}
 
-	return AllocateBlocks(transaction, group, 0, 1, 1, run);
+	return AllocateBlocks(transaction, group, start, 1, 1, run);
 }
 
 
@@ -1105,32 +1587,40 @@ BlockAllocator::Allocate(Transaction& transaction, Inode* inode,
 	uint16 start = 0;
 
 	// Are there already allocated blocks? (then just try to allocate near the
-	// last one)
+	// last one, so that the stream can be continued with the same run)
 	if (inode->Size() > 0) {
 		const data_stream& data = inode->Node().data;
-		// TODO: we currently don't care for when the data stream
-		// is already grown into the indirect ranges
-		if (data.max_double_indirect_range == 0
-			&& data.max_indirect_range == 0) {
-			// Since size > 0, there must be a valid block run in this stream
-			int32 last = 0;
-			for (; last < NUM_DIRECT_BLOCKS - 1; last++)
-				if (data.direct[last + 1].IsZero())
-					break;
-
-			group = data.direct[last].AllocationGroup();
-			start = data.direct[last].Start() + data.direct[last].Length();
+		off_t end = data.MaxDoubleIndirectRange();
+		if (end == 0)
+			end = data.MaxIndirectRange();
+		if (end == 0)
+			end = data.MaxDirectRange();
+
+		// Since size > 0, there must be a valid block run in this stream
+		block_run last;
+		off_t offset;
+		if (end > 0 && inode->FindBlockRun(end - 1, last, offset) == B_OK) {
+			group = last.AllocationGroup();
+			start = last.Start() + last.Length();
 		}
 	} else if (inode->IsContainer() || inode->IsSymLink()) {
 		// directory and symbolic link data will go in the same allocation
 		// group as the inode is in but after the inode data
 		start = inode->BlockRun().Start();
 	} else {
-		// file data will start in the next allocation group
+		// file data will start in the next allocation group, or right after
+		// the data that was last allocated for a file in the same directory
 		group = inode->BlockRun().AllocationGroup() + 1;
+		if (inode->IsFile())
+			_GetLocalityHint(inode->Parent(), group, start);
 	}
 
-	return AllocateBlocks(transaction, group, start, numBlocks, minimum, run);
+	status_t status = AllocateBlocks(transaction, group, start, numBlocks,
+		minimum, run);
+	if (status == B_OK && inode->IsFile())
+		_SetLocalityHint(inode->Parent(), run);
+
+	return status;
 }
 
 
@@ -1235,6 +1725,92 @@ BlockAllocator::Free(Transaction& transaction, block_run run)
 }
 
 
+/*!	Reads the block bitmap of the \a group to build its free range index.
+*/
+status_t
+BlockAllocator::_BuildIndex(AllocationGroup& group)
+{
+	ASSERT_LOCKED_RECURSIVE(&fLock);
+
+	AllocationBlock cached(fVolume);
+	FreeRangeIndex& index = group.fFreeRanges;
+	index.MakeEmpty();
+
+	int32 rangeStart = -1;
+	int32 bit = 0;
+
+	for (uint32 block = 0; block < group.NumBitmapBlocks(); block++) {
+		if (cached.SetTo(group, block) != B_OK) {
+			group.DropIndex(B_IO_ERROR);
+			RETURN_ERROR(B_IO_ERROR);
+		}
+
+		for (uint32 i = 0; i < cached.NumBlockBits(); i++, bit++) {
+			if (!cached.IsUsed(i)) {
+				if (rangeStart < 0)
+					rangeStart = bit;
+				continue;
+			}
+			if (rangeStart < 0)
+				continue;
+
+			status_t status = index.Add(rangeStart, bit - rangeStart);
+			if (status != B_OK) {
+				group.DropIndex(status);
+				return status;
+			}
+			rangeStart = -1;
+		}
+	}
+
+	if (rangeStart >= 0) {
+		status_t status = index.Add(rangeStart, bit - rangeStart);
+		if (status != B_OK) {
+			group.DropIndex(status);
+			return status;
+		}
+	}
+
+	CHECK_ALLOCATION_GROUP(&group - fGroups);
+	return B_OK;
+}
+
+
+/*!	Retrieves the position after the data that was last allocated for a file
+	in the \a directory, if there is any. Otherwise, \a group and \a start
+	are left untouched.
+*/
+void
+BlockAllocator::_GetLocalityHint(const block_run& directory, uint16& group,
+	uint16& start)
+{
+	off_t block = fVolume->ToBlock(directory);
+
+	RecursiveLocker locker(fLock);
+
+	const locality_hint& hint = fLocalityHints[block % kLocalityHints];
+	if (hint.directory == block) {
+		group = hint.group;
+		start = hint.start;
+	}
+}
+
+
+void
+BlockAllocator::_SetLocalityHint(const block_run& directory,
+	const block_run& run)
+{
+	off_t block = fVolume->ToBlock(directory);
+
+	RecursiveLocker locker(fLock);
+
+	locality_hint& hint = fLocalityHints[block % kLocalityHints];
+	hint.directory = block;
+	hint.group = run.AllocationGroup();
+	hint.start = run.Start() + run.Length();
+}
+
+
 #ifdef DEBUG_FRAGMENTER
 void
 BlockAllocator::Fragment()
@@ -1274,6 +1850,7 @@ BlockAllocator::_CheckGroup(int32 groupIndex) const
 	ASSERT_LOCKED_RECURSIVE(&fLock);
 
 	AllocationGroup& group = fGroups[groupIndex];
+	_CheckIndex(groupIndex);
 
 	int32 currentStart = 0, currentLength = 0;
 	int32 firstFree = -1;
@@ -1281,7 +1858,7 @@ BlockAllocator::_CheckGroup(int32 groupIndex) const
 	int32 largestLength = 0;
 	int32 currentBit = 0;
 
-	for (uint32 block = 0; block < group.NumBlocks(); block++) {
+	for (uint32 block = 0; block < group.NumBitmapBlocks(); block++) {
 		if (cached.SetTo(group, block) < B_OK) {
 			panic("setting group block %d failed\n", (int)block);
 			return;
@@ -1337,6 +1914,51 @@ BlockAllocator::_CheckGroup(int32 groupIndex) const
 			(int)group.fLargestLength, (int)largestStart, (int)largestLength);
 	}
 }
+
+
+/*!	Compares the free range index of the group with its block bitmap.
+*/
+void
+BlockAllocator::_CheckIndex(int32 groupIndex) const
+{
+	AllocationBlock cached(fVolume);
+	AllocationGroup& group = fGroups[groupIndex];
+	FreeRangeIndex& index = group.fFreeRanges;
+	if (!index.IsValid())
+		return;
+
+	int32 rangeStart = -1;
+	int32 bit = 0;
+
+	for (uint32 block = 0; block <= group.NumBitmapBlocks(); block++) {
+		bool last = block == group.NumBitmapBlocks();
+		if (!last && cached.SetTo(group, block) < B_OK) {
+			panic("setting group block %d failed\n", (int)block);
+			return;
+		}
+
+		uint32 numBits = last ? 1 : cached.NumBlockBits();
+		for (uint32 i = 0; i < numBits; i++, bit++) {
+			if (!last && !cached.IsUsed(i)) {
+				if (rangeStart < 0)
+					rangeStart = bit;
+				continue;
+			}
+			if (rangeStart < 0)
+				continue;
+
+			free_range* range = index.Lookup(rangeStart);
+			if (range == NULL || range->length != bit - rangeStart) {
+				panic("bfs %p: group %d free range %d.%d is indexed as "
+					"%d.%d\n", fVolume, (int)groupIndex, (int)rangeStart,
+					(int)(bit - rangeStart), range != NULL ? (int)range->start
+						: -1, range != NULL ? (int)range->length : -1);
+				return;
+			}
+			rangeStart = -1;
+		}
+	}
+}
 #endif	// DEBUG_ALLOCATION_GROUPS
 
 
@@ -1359,10 +1981,8 @@ BlockAllocator::Trim(uint64 offset, uint64 size, uint64& trimmedSize)
 		return B_NO_MEMORY;
 
 	MemoryDeleter deleter(trimData);
-	RecursiveLocker locker(fLock);
 
 	// TODO: take given offset and size into account!
-	int32 lastGroup = fNumGroups - 1;
 	uint32 firstBlock = 0;
 	uint32 firstBit = 0;
 	uint64 currentBlock = 0;
@@ -1375,7 +1995,13 @@ BlockAllocator::Trim(uint64 offset, uint64 size, uint64& trimmedSize)
 	trimmedSize = 0;
 
 	AllocationBlock cached(fVolume);
-	for (int32 groupIndex = 0; groupIndex <= lastGroup; groupIndex++) {
+	for (int32 groupIndex = 0;; groupIndex++) {
+		// The allocator is only locked for one group at a time, so that
+		// allocations don't have to wait until the whole volume is trimmed
+		RecursiveLocker locker(fLock);
+		if (groupIndex >= fNumGroups)
+			break;
+
 		AllocationGroup& group = fGroups[groupIndex];
 
 		for (uint32 block = firstBlock; block < group.NumBitmapBlocks(); block++) {
@@ -1413,10 +2039,21 @@ BlockAllocator::Trim(uint64 offset, uint64 size, uint64& trimmedSize)
 
 		firstBlock = 0;
 		firstBit = 0;
+
+		// The free ranges must be trimmed before the lock is released, as
+		// they could be allocated again right after
+		if (freeLength > 0 || trimData->range_count > 0) {
+			status_t status = _TrimNext(*trimData, kTrimRanges,
+				firstFree << blockShift, freeLength << blockShift, true,
+				trimmedSize);
+			if (status != B_OK)
+				return status;
+
+			freeLength = 0;
+		}
 	}
 
-	return _TrimNext(*trimData, kTrimRanges, firstFree << blockShift,
-		freeLength << blockShift, true, trimmedSize);
+	return B_OK;
 }
 
 
@@ -73,9 +73,23 @@ public:
 #endif
 
 private:
+	static	const int32		kLocalityHints = 32;
+
+			struct locality_hint {
+				off_t		directory;
+				int32		group;
+				uint16		start;
+			};
+
 #ifdef DEBUG_ALLOCATION_GROUPS
 			void			_CheckGroup(int32 group) const;
+			void			_CheckIndex(int32 group) const;
 #endif
+			status_t		_BuildIndex(AllocationGroup& group);
+			void			_GetLocalityHint(const block_run& directory,
+								uint16& group, uint16& start);
+			void			_SetLocalityHint(const block_run& directory,
+								const block_run& run);
 			bool			_AddTrim(fs_trim_data& trimData, uint32 maxRanges,
 								uint64 offset, uint64 size);
 			status_t		_TrimNext(fs_trim_data& trimData, uint32 maxRanges,
@@ -94,6 +108,8 @@ private:
 
 			off_t			fAllowedBeginBlock;
 			off_t			fAllowedEndBlock;
+
+			locality_hint	fLocalityHints[kLocalityHints];
 };
 
 #ifdef BFS_DEBUGGER_COMMANDS
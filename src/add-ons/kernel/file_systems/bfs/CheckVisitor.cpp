@@ -32,7 +32,9 @@ struct check_index {
 CheckVisitor::CheckVisitor(Volume* volume)
 	:
 	FileSystemVisitor(volume),
-	fCheckBitmap(NULL)
+	fCheckBitmap(NULL),
+	fExtents(0),
+	fNextExtentBlock(-1)
 {
 }
 
@@ -190,6 +192,9 @@ CheckVisitor::StopChecking()
 	if (Control().status != B_ENTRY_NOT_FOUND)
 		FATAL(("CheckVisitor didn't run through\n"));
 
+	if (Control().status == B_ENTRY_NOT_FOUND && !GetVolume()->IsReadOnly())
+		_CompactIndices();
+
 	_FreeIndices();
 
 	recursive_lock_unlock(&GetVolume()->Allocator().Lock());
@@ -297,6 +302,12 @@ CheckVisitor::VisitInode(Inode* inode, const char* treeName)
 			if (status != B_OK)
 				return status;
 
+			if (inode->IsFile()) {
+				Control().file_extents += fExtents;
+				if (fExtents > 1)
+					Control().fragmented_files++;
+			}
+
 			// Check the B+tree as well
 			if (inode->IsContainer()) {
 				bool repairErrors = (Control().flags & BFS_FIX_BPLUSTREES) != 0;
@@ -481,6 +492,20 @@ CheckVisitor::_CheckInodeBlocks(Inode* inode, const char* name)
 
 	data_stream* data = &inode->Node().data;
 
+	if (inode->HasInlineData()) {
+		// the data is stored in the small_data section, there is no stream
+		if (!GetVolume()->HasInlineData() || !inode->IsFile()
+			|| data->MaxDirectRange() != 0 || data->MaxIndirectRange() != 0
+			|| data->MaxDoubleIndirectRange() != 0
+			|| data->Size() > GetVolume()->MaxInlineDataSize())
+			return B_BAD_DATA;
+
+		return B_OK;
+	}
+
+	fExtents = 0;
+	fNextExtentBlock = -1;
+
 	// check the direct range
 
 	if (data->max_direct_range) {
@@ -492,6 +517,8 @@ CheckVisitor::_CheckInodeBlocks(Inode* inode, const char* name)
 			if (status < B_OK)
 				return status;
 
+			_CountExtent(data->direct[i]);
+
 			Control().stats.direct_block_runs++;
 			Control().stats.blocks_in_direct
 				+= data->direct[i].Length();
@@ -525,6 +552,8 @@ CheckVisitor::_CheckInodeBlocks(Inode* inode, const char* name)
 				if (status < B_OK)
 					return status;
 
+				_CountExtent(runs[index]);
+
 				Control().stats.indirect_block_runs++;
 				Control().stats.blocks_in_indirect
 					+= runs[index].Length();
@@ -588,6 +617,8 @@ CheckVisitor::_CheckInodeBlocks(Inode* inode, const char* name)
 					if (status != B_OK)
 						return status;
 
+					_CountExtent(runs[index % runsPerBlock]);
+
 					Control().stats.double_indirect_block_runs++;
 					Control().stats.blocks_in_double_indirect
 						+= runs[index % runsPerBlock].Length();
@@ -602,6 +633,20 @@ CheckVisitor::_CheckInodeBlocks(Inode* inode, const char* name)
 }
 
 
+/*!	Counts the contiguous extents of the data stream currently being checked;
+	a run that directly follows the previous one on disk continues its extent.
+*/
+void
+CheckVisitor::_CountExtent(block_run run)
+{
+	off_t block = GetVolume()->ToBlock(run);
+	if (block != fNextExtentBlock)
+		fExtents++;
+
+	fNextExtentBlock = block + run.Length();
+}
+
+
 status_t
 CheckVisitor::_CheckAllocated(block_run run, const char* type)
 {
@@ -708,6 +753,27 @@ CheckVisitor::_PrepareIndices()
 }
 
 
+/*!	The rebuilt indices have been filled in the order of the inodes, which
+	leaves many of their nodes half empty. Packs them, so that they start
+	out as small as possible.
+*/
+void
+CheckVisitor::_CompactIndices()
+{
+	for (int32 i = 0; i < Indices().CountItems(); i++) {
+		check_index* index = Indices().Array()[i];
+		if (index->inode == NULL)
+			continue;
+
+		status_t status = index->inode->Tree()->Compact();
+		if (status != B_OK) {
+			FATAL(("check: Could not compact index \"%s\": %s\n",
+				index->name, strerror(status)));
+		}
+	}
+}
+
+
 void
 CheckVisitor::_FreeIndices()
 {
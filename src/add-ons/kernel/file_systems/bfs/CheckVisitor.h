@@ -58,10 +58,12 @@ private:
 									const char* name);
 			status_t			_CheckAllocated(block_run run,
 									const char* type);
+			void				_CountExtent(block_run run);
 
 			size_t				_BitmapSize() const;
 
 			status_t			_PrepareIndices();
+			void				_CompactIndices();
 			void				_FreeIndices();
 			status_t			_AddInodeToIndex(Inode* inode);
 
@@ -70,6 +72,9 @@ private:
 			IndexStack			indices;
 
 			uint32*				fCheckBitmap;
+
+			uint32				fExtents;
+			off_t				fNextExtentBlock;
 };
 
 
@@ -12,6 +12,7 @@
 #include <file_systems/QueryParserUtils.h>
 
 #include "Debug.h"
+#include "IndexCache.h"
 #include "Volume.h"
 #include "Inode.h"
 #include "BPlusTree.h"
@@ -204,6 +205,10 @@ Index::Create(Transaction& transaction, const char* name, uint32 type)
 			RETURN_ERROR(status);
 	}
 
+	// a previous index of that name might still be cached
+	if (fVolume->IndexCache() != NULL)
+		fVolume->IndexCache()->InvalidateIndex(name);
+
 	// Inode::Create() will keep the inode locked for us
 	return Inode::Create(transaction, fVolume->IndicesNode(), name,
 		S_INDEX_DIR | S_DIRECTORY | mode, 0, type, NULL, NULL, &fNode);
@@ -279,6 +284,12 @@ Index::Update(Transaction& transaction, const char* name, int32 type,
 			inode->ID());
 	}
 
+	if (status == B_OK && type == B_STRING_TYPE
+		&& fVolume->IndexCache() != NULL) {
+		fVolume->IndexCache()->Update(transaction, name, oldKey, oldLength,
+			newKey, newLength, inode->ID());
+	}
+
 	RETURN_ERROR(status);
 }
 
@@ -23,6 +23,7 @@ public:
 			void			Unset();
 
 			Inode*			Node() const { return fNode; };
+			const char*		Name() const { return fName; }
 			uint32			Type();
 			size_t			KeySize();
 
@@ -0,0 +1,912 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+//!	In-memory trigram index for substring queries
+
+
+#include "IndexCache.h"
+
+#include "BPlusTree.h"
+#include "bfs_control.h"
+#include "Debug.h"
+#include "Inode.h"
+#include "Volume.h"
+
+
+static const int32 kMaxPatternTrigrams = 16;
+static const size_t kMaxCacheSize = 256 * 1024 * 1024;
+static const int32 kBuildBatchSize = 256;
+static const uint32 kMinRemovedNodes = 1024;
+static const uint64 kMinStalePostings = 65536;
+
+
+enum trigram_index_state {
+	TRIGRAM_INDEX_BUILDING,
+	TRIGRAM_INDEX_READY,
+	TRIGRAM_INDEX_TOO_LARGE
+};
+
+struct trigram_list {
+	uint32			trigram;
+	uint32			count;
+	uint32			sorted;
+	uint32			capacity;
+	uint32*			ids;
+};
+
+struct build_entry {
+	uint32		id;
+	uint16		length;
+	uint8		key[MAX_INDEX_KEY_LENGTH + 1];
+};
+
+
+/*!	Maps every trigram of the keys of one index to the IDs of the nodes
+	whose key contains it. The node IDs are stored as 32-bit block numbers.
+	Changed keys only add the new trigrams, and the postings of the old key
+	are left in place, as they only produce candidates that the query will
+	reject. Nodes that were removed from the index are remembered, though,
+	as their IDs may no longer point to an inode.
+*/
+class TrigramIndex : public DoublyLinkedListLinkImpl<TrigramIndex> {
+public:
+								TrigramIndex(const char* name);
+								~TrigramIndex();
+
+			status_t			Init();
+			void				MakeEmpty();
+
+			const char*			Name() const { return fName; }
+			size_t				Size() const;
+
+			trigram_index_state	State() const { return fState; }
+			void				SetState(trigram_index_state state)
+									{ fState = state; }
+			bool				IsDropped() const { return fDropped; }
+			void				SetDropped() { fDropped = true; }
+
+			status_t			AddKey(const uint8* key, uint16 length,
+									uint32 id, bool restore);
+			status_t			RemoveKey(const uint8* key, uint16 length,
+									uint32 id, bool removeNode);
+			bool				NeedsRebuild() const;
+
+			status_t			FindCandidates(const uint32* trigrams,
+									int32 count, ino_t** _candidates,
+									uint32* _count);
+
+private:
+			trigram_list*		_Lookup(uint32 trigram) const;
+			status_t			_Insert(trigram_list* list);
+			void				_Sort(trigram_list* list);
+			bool				_IsRemoved(uint32 id) const;
+
+private:
+			char				fName[B_ATTR_NAME_LENGTH];
+			trigram_list**		fTable;
+			uint32				fTableSize;
+			uint32				fListCount;
+			trigram_index_state	fState;
+			bool				fDropped;
+			size_t				fSize;
+			uint64				fPostings;
+			uint64				fStalePostings;
+			uint32				fKeys;
+
+			uint32*				fRemoved;
+			uint32				fRemovedCount;
+			uint32				fRemovedCapacity;
+};
+
+
+static inline uint32
+hash_trigram(uint32 trigram)
+{
+	uint32 hash = trigram * 2654435761U;
+	return hash ^ (hash >> 16);
+}
+
+
+static inline uint8
+fold_case(uint8 c)
+{
+	if (c >= 'A' && c <= 'Z')
+		return c + ('a' - 'A');
+	return c;
+}
+
+
+static int
+compare_ids(const void* _a, const void* _b)
+{
+	uint32 a = *(const uint32*)_a;
+	uint32 b = *(const uint32*)_b;
+	return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+
+/*!	Sorts the \a count entries of \a array, and removes duplicates. Returns
+	the number of remaining entries.
+*/
+static uint32
+sort_unique(uint32* array, uint32 count)
+{
+	if (count < 2)
+		return count;
+
+	qsort(array, count, sizeof(uint32), &compare_ids);
+
+	uint32 last = 0;
+	for (uint32 i = 1; i < count; i++) {
+		if (array[i] != array[last])
+			array[++last] = array[i];
+	}
+	return last + 1;
+}
+
+
+/*!	Returns the index of the first entry of the sorted \a array that is not
+	smaller than \a id.
+*/
+static uint32
+find_id(const uint32* array, uint32 count, uint32 id)
+{
+	uint32 low = 0;
+	uint32 high = count;
+	while (low < high) {
+		uint32 middle = (low + high) / 2;
+		if (array[middle] < id)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+
+static inline bool
+contains_id(const uint32* array, uint32 count, uint32 id)
+{
+	uint32 index = find_id(array, count, id);
+	return index < count && array[index] == id;
+}
+
+
+/*!	Collects the distinct trigrams of \a key in \a trigrams, which must have
+	room for \a length entries.
+*/
+static int32
+get_key_trigrams(const uint8* key, uint16 length, uint32* trigrams)
+{
+	int32 count = 0;
+	uint32 trigram = 0;
+
+	for (uint16 i = 0; i < length; i++) {
+		trigram = ((trigram << 8) | fold_case(key[i])) & 0xffffff;
+		if (i >= 2)
+			trigrams[count++] = trigram;
+	}
+
+	return sort_unique(trigrams, count);
+}
+
+
+/*!	Parses the character class at \a pattern (which points behind the '['),
+	and sets \a _c to the character it stands for, if it only consists of
+	the upper and lower case variant of a single character, like "[fF]".
+	Otherwise \a _c is set to -1. Returns the pattern behind the class.
+*/
+static const char*
+parse_pattern_class(const char* pattern, int32* _c)
+{
+	int32 c = -1;
+	bool single = pattern[0] != '^' && pattern[0] != '!';
+
+	while (pattern[0] != ']') {
+		if (pattern[0] == '\\')
+			pattern++;
+		if (pattern[0] == '\0') {
+			*_c = -1;
+			return pattern;
+		}
+
+		uint8 member = (uint8)pattern[0];
+		if (member >= 0x80 || (pattern[1] == '-' && pattern[2] != ']'))
+			single = false;
+		else if (c == -1)
+			c = fold_case(member);
+		else if (c != fold_case(member))
+			single = false;
+
+		pattern++;
+	}
+
+	*_c = single ? c : -1;
+	return pattern + 1;
+}
+
+
+/*!	Collects the trigrams every key that matches \a pattern must contain.
+	Only the literal parts of the pattern can be used, and the trigrams are
+	case folded, so that patterns for case insensitive queries can use
+	the index as well.
+*/
+static int32
+get_pattern_trigrams(const char* pattern, uint32* trigrams, int32 maxCount)
+{
+	int32 count = 0;
+	int32 runLength = 0;
+	uint32 trigram = 0;
+
+	while (pattern[0] != '\0' && count < maxCount) {
+		int32 c = -1;
+
+		switch (pattern[0]) {
+			case '*':
+			case '?':
+				pattern++;
+				break;
+
+			case '[':
+				pattern = parse_pattern_class(pattern + 1, &c);
+				break;
+
+			case '\\':
+				pattern++;
+				if (pattern[0] == '\0')
+					break;
+				// supposed to fall through
+			default:
+				c = fold_case((uint8)pattern[0]);
+				pattern++;
+				break;
+		}
+
+		if (c < 0) {
+			runLength = 0;
+			continue;
+		}
+
+		trigram = ((trigram << 8) | c) & 0xffffff;
+		if (++runLength >= 3)
+			trigrams[count++] = trigram;
+	}
+
+	return count;
+}
+
+
+//	#pragma mark -
+
+
+TrigramIndex::TrigramIndex(const char* name)
+	:
+	fTable(NULL),
+	fTableSize(0),
+	fListCount(0),
+	fState(TRIGRAM_INDEX_BUILDING),
+	fDropped(false),
+	fSize(sizeof(TrigramIndex)),
+	fPostings(0),
+	fStalePostings(0),
+	fKeys(0),
+	fRemoved(NULL),
+	fRemovedCount(0),
+	fRemovedCapacity(0)
+{
+	strlcpy(fName, name, sizeof(fName));
+}
+
+
+TrigramIndex::~TrigramIndex()
+{
+	MakeEmpty();
+	free(fTable);
+}
+
+
+status_t
+TrigramIndex::Init()
+{
+	fTableSize = 1024;
+	fTable = (trigram_list**)calloc(fTableSize, sizeof(trigram_list*));
+	if (fTable == NULL)
+		return B_NO_MEMORY;
+
+	return B_OK;
+}
+
+
+void
+TrigramIndex::MakeEmpty()
+{
+	for (uint32 i = 0; i < fTableSize; i++) {
+		if (fTable[i] != NULL) {
+			free(fTable[i]->ids);
+			delete fTable[i];
+			fTable[i] = NULL;
+		}
+	}
+	fListCount = 0;
+
+	free(fRemoved);
+	fRemoved = NULL;
+	fRemovedCount = 0;
+	fRemovedCapacity = 0;
+
+	fSize = sizeof(TrigramIndex);
+	fPostings = 0;
+	fStalePostings = 0;
+	fKeys = 0;
+}
+
+
+size_t
+TrigramIndex::Size() const
+{
+	return fSize + fTableSize * sizeof(trigram_list*);
+}
+
+
+/*!	Adds the trigrams of \a key for the node \a id. If \a restore is \c true,
+	the node is no longer considered removed, in case it was before.
+*/
+status_t
+TrigramIndex::AddKey(const uint8* key, uint16 length, uint32 id, bool restore)
+{
+	if (restore && _IsRemoved(id)) {
+		uint32 index = find_id(fRemoved, fRemovedCount, id);
+		memmove(fRemoved + index, fRemoved + index + 1,
+			(--fRemovedCount - index) * sizeof(uint32));
+	}
+
+	uint32 trigrams[MAX_INDEX_KEY_LENGTH];
+	int32 count = get_key_trigrams(key, min_c(length, MAX_INDEX_KEY_LENGTH),
+		trigrams);
+
+	for (int32 i = 0; i < count; i++) {
+		trigram_list* list = _Lookup(trigrams[i]);
+		if (list == NULL) {
+			list = new(std::nothrow) trigram_list;
+			if (list == NULL)
+				return B_NO_MEMORY;
+
+			list->trigram = trigrams[i];
+			list->count = 0;
+			list->sorted = 0;
+			list->capacity = 0;
+			list->ids = NULL;
+
+			if (_Insert(list) != B_OK) {
+				delete list;
+				return B_NO_MEMORY;
+			}
+			fSize += sizeof(trigram_list);
+		}
+
+		if (list->count == list->capacity) {
+			uint32 capacity = list->capacity < 4 ? 4 : list->capacity * 2;
+			uint32* ids = (uint32*)realloc(list->ids,
+				capacity * sizeof(uint32));
+			if (ids == NULL)
+				return B_NO_MEMORY;
+
+			fSize += (capacity - list->capacity) * sizeof(uint32);
+			list->ids = ids;
+			list->capacity = capacity;
+		}
+
+		list->ids[list->count++] = id;
+	}
+
+	fPostings += count;
+	fKeys++;
+	return B_OK;
+}
+
+
+/*!	Accounts for the postings of \a key that are now stale. If \a removeNode
+	is \c true, the node \a id is no longer part of the index at all.
+*/
+status_t
+TrigramIndex::RemoveKey(const uint8* key, uint16 length, uint32 id,
+	bool removeNode)
+{
+	uint32 trigrams[MAX_INDEX_KEY_LENGTH];
+	fStalePostings += get_key_trigrams(key,
+		min_c(length, MAX_INDEX_KEY_LENGTH), trigrams);
+
+	if (!removeNode)
+		return B_OK;
+
+	uint32 index = find_id(fRemoved, fRemovedCount, id);
+	if (index < fRemovedCount && fRemoved[index] == id)
+		return B_OK;
+
+	if (fRemovedCount == fRemovedCapacity) {
+		uint32 capacity = fRemovedCapacity < 64 ? 64 : fRemovedCapacity * 2;
+		uint32* removed = (uint32*)realloc(fRemoved,
+			capacity * sizeof(uint32));
+		if (removed == NULL)
+			return B_NO_MEMORY;
+
+		fSize += (capacity - fRemovedCapacity) * sizeof(uint32);
+		fRemoved = removed;
+		fRemovedCapacity = capacity;
+	}
+
+	memmove(fRemoved + index + 1, fRemoved + index,
+		(fRemovedCount - index) * sizeof(uint32));
+	fRemoved[index] = id;
+	fRemovedCount++;
+	return B_OK;
+}
+
+
+/*!	Returns whether or not so many keys have been changed or removed, that
+	the index should better be built again from scratch.
+*/
+bool
+TrigramIndex::NeedsRebuild() const
+{
+	return fRemovedCount > max_c(kMinRemovedNodes, fKeys / 16)
+		|| (fStalePostings > kMinStalePostings
+			&& fStalePostings > fPostings / 2);
+}
+
+
+/*!	Returns the sorted IDs of all nodes that contain all of the given
+	\a trigrams in an array that the caller has to free().
+*/
+status_t
+TrigramIndex::FindCandidates(const uint32* trigrams, int32 count,
+	ino_t** _candidates, uint32* _count)
+{
+	trigram_list* lists[kMaxPatternTrigrams];
+	trigram_list* smallest = NULL;
+
+	for (int32 i = 0; i < count; i++) {
+		lists[i] = _Lookup(trigrams[i]);
+		if (lists[i] == NULL) {
+			// no key contains this trigram
+			*_candidates = NULL;
+			*_count = 0;
+			return B_OK;
+		}
+
+		_Sort(lists[i]);
+		if (smallest == NULL || lists[i]->count < smallest->count)
+			smallest = lists[i];
+	}
+
+	ino_t* candidates = (ino_t*)malloc(max_c(smallest->count, 1)
+		* sizeof(ino_t));
+	if (candidates == NULL)
+		return B_NO_MEMORY;
+
+	uint32 found = 0;
+	for (uint32 i = 0; i < smallest->count; i++) {
+		uint32 id = smallest->ids[i];
+		if (_IsRemoved(id))
+			continue;
+
+		bool matches = true;
+		for (int32 j = 0; j < count && matches; j++) {
+			if (lists[j] != smallest)
+				matches = contains_id(lists[j]->ids, lists[j]->count, id);
+		}
+		if (matches)
+			candidates[found++] = id;
+	}
+
+	*_candidates = candidates;
+	*_count = found;
+	return B_OK;
+}
+
+
+trigram_list*
+TrigramIndex::_Lookup(uint32 trigram) const
+{
+	uint32 mask = fTableSize - 1;
+	for (uint32 i = hash_trigram(trigram) & mask; fTable[i] != NULL;
+			i = (i + 1) & mask) {
+		if (fTable[i]->trigram == trigram)
+			return fTable[i];
+	}
+
+	return NULL;
+}
+
+
+/*!	Inserts \a list into the hash table, which uses open addressing, and is
+	doubled in size when it gets three quarters full.
+*/
+status_t
+TrigramIndex::_Insert(trigram_list* list)
+{
+	if ((fListCount + 1) * 4 > fTableSize * 3) {
+		uint32 tableSize = fTableSize * 2;
+		trigram_list** table = (trigram_list**)calloc(tableSize,
+			sizeof(trigram_list*));
+		if (table == NULL)
+			return B_NO_MEMORY;
+
+		for (uint32 i = 0; i < fTableSize; i++) {
+			if (fTable[i] == NULL)
+				continue;
+
+			uint32 index = hash_trigram(fTable[i]->trigram) & (tableSize - 1);
+			while (table[index] != NULL)
+				index = (index + 1) & (tableSize - 1);
+			table[index] = fTable[i];
+		}
+
+		free(fTable);
+		fTable = table;
+		fTableSize = tableSize;
+	}
+
+	uint32 mask = fTableSize - 1;
+	uint32 index = hash_trigram(list->trigram) & mask;
+	while (fTable[index] != NULL)
+		index = (index + 1) & mask;
+
+	fTable[index] = list;
+	fListCount++;
+	return B_OK;
+}
+
+
+void
+TrigramIndex::_Sort(trigram_list* list)
+{
+	if (list->sorted == list->count)
+		return;
+
+	fPostings -= list->count;
+	list->count = sort_unique(list->ids, list->count);
+	list->sorted = list->count;
+	fPostings += list->count;
+}
+
+
+bool
+TrigramIndex::_IsRemoved(uint32 id) const
+{
+	return contains_id(fRemoved, fRemovedCount, id);
+}
+
+
+//	#pragma mark -
+
+
+IndexCache::IndexCache(Volume* volume)
+	:
+	fVolume(volume),
+	fMaxSize(0),
+	fSize(0),
+	fInTransaction(false),
+	fLookups(0),
+	fBuilds(0)
+{
+	mutex_init(&fLock, "bfs index cache");
+}
+
+
+IndexCache::~IndexCache()
+{
+	_RemoveAll();
+	mutex_destroy(&fLock);
+}
+
+
+/*!	Sets the memory the cache may use to \a maxSize bytes; a size of zero
+	disables the cache. The size is silently limited to kMaxCacheSize.
+	All trigram indices are thrown away, and will be built again when they
+	are needed.
+*/
+status_t
+IndexCache::SetMaxSize(size_t maxSize)
+{
+	if (maxSize != 0 && fVolume->NumBlocks() > UINT32_MAX)
+		return B_NOT_SUPPORTED;
+	if (maxSize > kMaxCacheSize)
+		maxSize = kMaxCacheSize;
+
+	MutexLocker locker(fLock);
+
+	fMaxSize = maxSize;
+	_RemoveAll();
+	return B_OK;
+}
+
+
+void
+IndexCache::GetInfo(index_cache_info& info)
+{
+	MutexLocker locker(fLock);
+
+	info.max_size = fMaxSize;
+	info.size = fSize;
+	info.indices = 0;
+	TrigramIndexList::Iterator iterator = fIndices.GetIterator();
+	while (iterator.Next() != NULL)
+		info.indices++;
+	info.lookups = fLookups;
+	info.builds = fBuilds;
+}
+
+
+/*!	Called by Index::Update() after the key of node \a id in the index
+	\a name has been changed in the B+tree.
+*/
+void
+IndexCache::Update(Transaction& transaction, const char* name,
+	const uint8* oldKey, uint16 oldLength, const uint8* newKey,
+	uint16 newLength, ino_t id)
+{
+	if (!IsEnabled())
+		return;
+
+	MutexLocker locker(fLock);
+
+	TrigramIndex* index = _Find(name);
+	if (index == NULL || index->State() == TRIGRAM_INDEX_TOO_LARGE)
+		return;
+
+	if (!fInTransaction) {
+		// If the transaction fails, the B+tree changes are reverted, but
+		// ours would not be
+		transaction.AddListener(this);
+		fInTransaction = true;
+	}
+
+	size_t oldSize = index->Size();
+	status_t status = B_OK;
+
+	if (oldKey != NULL)
+		status = index->RemoveKey(oldKey, oldLength, id, newKey == NULL);
+	if (newKey != NULL && status == B_OK)
+		status = index->AddKey(newKey, newLength, id, true);
+
+	fSize = fSize - oldSize + index->Size();
+
+	if (status != B_OK || index->NeedsRebuild())
+		_Remove(index);
+	else
+		_CheckSize(index);
+}
+
+
+/*!	Throws away the trigram index for \a name, if any, ie. because the index
+	has been created again.
+*/
+void
+IndexCache::InvalidateIndex(const char* name)
+{
+	MutexLocker locker(fLock);
+
+	TrigramIndex* index = _Find(name);
+	if (index != NULL)
+		_Remove(index);
+}
+
+
+/*!	Returns the IDs of all nodes in the index \a name whose key could match
+	\a pattern in a sorted array that the caller has to free(). The trigram
+	index is built first, if necessary.
+	Returns \c B_UNSUPPORTED if the cache cannot be used for this query.
+*/
+status_t
+IndexCache::FindCandidates(Inode* indexNode, const char* name,
+	const char* pattern, ino_t** _candidates, uint32* _count)
+{
+	if (!IsEnabled())
+		return B_UNSUPPORTED;
+
+	uint32 trigrams[kMaxPatternTrigrams];
+	int32 count = get_pattern_trigrams(pattern, trigrams, kMaxPatternTrigrams);
+	if (count == 0)
+		return B_UNSUPPORTED;
+
+	MutexLocker locker(fLock);
+
+	if (!IsEnabled())
+		return B_UNSUPPORTED;
+
+	TrigramIndex* index = _Find(name);
+	if (index == NULL) {
+		index = new(std::nothrow) TrigramIndex(name);
+		if (index == NULL || index->Init() != B_OK) {
+			delete index;
+			return B_NO_MEMORY;
+		}
+
+		fIndices.Add(index);
+		fSize += index->Size();
+		fBuilds++;
+
+		status_t status = _Build(index, indexNode);
+		if (status != B_OK)
+			return status;
+	}
+
+	if (index->State() != TRIGRAM_INDEX_READY) {
+		// it's too large, or another query is still building it
+		return B_UNSUPPORTED;
+	}
+
+	fLookups++;
+
+	size_t oldSize = index->Size();
+	status_t status = index->FindCandidates(trigrams, count, _candidates,
+		_count);
+	fSize = fSize - oldSize + index->Size();
+
+	return status;
+}
+
+
+void
+IndexCache::TransactionDone(bool success)
+{
+	if (!success) {
+		MutexLocker locker(fLock);
+		_RemoveAll();
+	}
+}
+
+
+void
+IndexCache::RemovedFromTransaction()
+{
+	fInTransaction = false;
+}
+
+
+TrigramIndex*
+IndexCache::_Find(const char* name)
+{
+	TrigramIndexList::Iterator iterator = fIndices.GetIterator();
+	while (TrigramIndex* index = iterator.Next()) {
+		if (!strcmp(index->Name(), name))
+			return index;
+	}
+
+	return NULL;
+}
+
+
+/*!	Fills \a index with the keys of the B+tree of \a indexNode. Must be
+	called with the cache locked. The lock is released while reading from
+	the B+tree, as Index::Update() holds the index node locked when it calls
+	us; changes made in the mean time are added by Update() directly.
+	Returns with the cache locked; if the index could not be built, it has
+	already been removed.
+*/
+status_t
+IndexCache::_Build(TrigramIndex* index, Inode* indexNode)
+{
+	build_entry* entries = (build_entry*)malloc(
+		kBuildBatchSize * sizeof(build_entry));
+	if (entries == NULL) {
+		_Delete(index);
+		return B_NO_MEMORY;
+	}
+
+	TreeIterator iterator(indexNode->Tree());
+	status_t status = B_OK;
+
+	while (status == B_OK) {
+		mutex_unlock(&fLock);
+
+		int32 count = 0;
+		for (; count < kBuildBatchSize; count++) {
+			build_entry& entry = entries[count];
+			off_t id;
+			status = iterator.GetNextEntry(entry.key, &entry.length,
+				sizeof(entry.key), &id);
+			if (status != B_OK)
+				break;
+
+			entry.id = (uint32)id;
+		}
+
+		mutex_lock(&fLock);
+
+		if (index->IsDropped() || index->State() != TRIGRAM_INDEX_BUILDING)
+			break;
+
+		size_t oldSize = index->Size();
+		for (int32 i = 0; i < count; i++) {
+			// A node that has been removed since we read its key must stay
+			// removed
+			if (index->AddKey(entries[i].key, entries[i].length,
+					entries[i].id, false) != B_OK) {
+				status = B_NO_MEMORY;
+				break;
+			}
+		}
+		fSize = fSize - oldSize + index->Size();
+
+		_CheckSize(index);
+	}
+
+	free(entries);
+
+	if (index->IsDropped()) {
+		// it has already been removed from the cache
+		delete index;
+		return B_INTERRUPTED;
+	}
+	if (index->State() != TRIGRAM_INDEX_BUILDING)
+		return B_UNSUPPORTED;
+
+	if (status == B_ENTRY_NOT_FOUND) {
+		index->SetState(TRIGRAM_INDEX_READY);
+		return B_OK;
+	}
+
+	_Delete(index);
+	return status;
+}
+
+
+/*!	Empties \a index if the cache has grown larger than allowed; the index
+	will not be used again until the size of the cache is changed.
+	Returns \c false in this case.
+*/
+bool
+IndexCache::_CheckSize(TrigramIndex* index)
+{
+	if (fSize <= fMaxSize)
+		return true;
+
+	INFORM(("bfs: trigram index \"%s\" exceeds the index cache size\n",
+		index->Name()));
+
+	fSize -= index->Size();
+	index->MakeEmpty();
+	index->SetState(TRIGRAM_INDEX_TOO_LARGE);
+	fSize += index->Size();
+	return false;
+}
+
+
+void
+IndexCache::_Remove(TrigramIndex* index)
+{
+	fIndices.Remove(index);
+	fSize -= index->Size();
+
+	if (index->State() == TRIGRAM_INDEX_BUILDING) {
+		// the thread that is building it will delete it
+		index->MakeEmpty();
+		index->SetDropped();
+	} else
+		delete index;
+}
+
+
+/*!	Removes \a index from the cache, and deletes it. Must only be used by
+	the thread that builds it.
+*/
+void
+IndexCache::_Delete(TrigramIndex* index)
+{
+	fIndices.Remove(index);
+	fSize -= index->Size();
+	delete index;
+}
+
+
+void
+IndexCache::_RemoveAll()
+{
+	while (TrigramIndex* index = fIndices.Head())
+		_Remove(index);
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef INDEX_CACHE_H
+#define INDEX_CACHE_H
+
+
+#include "system_dependencies.h"
+
+#include "Journal.h"
+
+
+struct index_cache_info;
+class TrigramIndex;
+
+typedef DoublyLinkedList<TrigramIndex> TrigramIndexList;
+
+
+/*!	Keeps an in-memory trigram index for string indices, so that queries for
+	patterns like "*foo*" that cannot use the B+tree don't have to look at
+	every key of the index.
+	A trigram index is built the first time a pattern is queried on an
+	index, and is kept up to date by Index::Update() from then on. It only
+	delivers candidates; every one of them is still compared against the
+	pattern by the query.
+*/
+class IndexCache : public TransactionListener {
+public:
+								IndexCache(Volume* volume);
+	virtual						~IndexCache();
+
+			bool				IsEnabled() const
+									{ return fMaxSize != 0; }
+			status_t			SetMaxSize(size_t maxSize);
+			void				GetInfo(index_cache_info& info);
+
+			void				Update(Transaction& transaction,
+									const char* name, const uint8* oldKey,
+									uint16 oldLength, const uint8* newKey,
+									uint16 newLength, ino_t id);
+			void				InvalidateIndex(const char* name);
+			status_t			FindCandidates(Inode* indexNode,
+									const char* name, const char* pattern,
+									ino_t** _candidates, uint32* _count);
+
+	virtual	void				TransactionDone(bool success);
+	virtual	void				RemovedFromTransaction();
+
+private:
+			TrigramIndex*		_Find(const char* name);
+			status_t			_Build(TrigramIndex* index, Inode* indexNode);
+			bool				_CheckSize(TrigramIndex* index);
+			void				_Remove(TrigramIndex* index);
+			void				_Delete(TrigramIndex* index);
+			void				_RemoveAll();
+
+private:
+			Volume*				fVolume;
+			mutex				fLock;
+			size_t				fMaxSize;
+			size_t				fSize;
+			TrigramIndexList	fIndices;
+			bool				fInTransaction;
+
+			uint32				fLookups;
+			uint32				fBuilds;
+};
+
+
+#endif	// INDEX_CACHE_H
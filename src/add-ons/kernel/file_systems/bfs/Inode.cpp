@@ -134,6 +134,10 @@ private:
 #endif
 
 
+static const char kFileDataName[] = { FILE_DATA_NAME, '\0' };
+static const int32 kMaxInlineWriteTries = 20;
+
+
 /*!	A helper class used by Inode::Create() to keep track of the belongings
 	of an inode creation in progress.
 	This class will make sure everything is cleaned up properly.
@@ -344,7 +348,8 @@ Inode::Inode(Volume* volume, ino_t id)
 	fTree(NULL),
 	fAttributes(NULL),
 	fCache(NULL),
-	fMap(NULL)
+	fMap(NULL),
+	fWriterCount(0)
 {
 	PRINT(("Inode::Inode(volume = %p, id = %" B_PRIdINO ") @ %p\n",
 		volume, id, this));
@@ -378,7 +383,8 @@ Inode::Inode(Volume* volume, Transaction& transaction, ino_t id, mode_t mode,
 	fTree(NULL),
 	fAttributes(NULL),
 	fCache(NULL),
-	fMap(NULL)
+	fMap(NULL),
+	fWriterCount(0)
 {
 	PRINT(("Inode::Inode(volume = %p, transaction = %p, id = %" B_PRIdINO
 		") @ %p\n", volume, &transaction, id, this));
@@ -404,6 +410,8 @@ Inode::Inode(Volume* volume, Transaction& transaction, ino_t id, mode_t mode,
 	Node().inode_num = run;
 	Node().mode = HOST_ENDIAN_TO_BFS_INT32(mode);
 	Node().flags = HOST_ENDIAN_TO_BFS_INT32(INODE_IN_USE);
+	if (volume->HasInlineData() && IsFile())
+		Node().flags |= HOST_ENDIAN_TO_BFS_INT32(INODE_INLINE_DATA);
 
 	Node().create_time = Node().last_modified_time = Node().status_change_time
 		= HOST_ENDIAN_TO_BFS_INT64(bfs_inode::ToInode(real_time_clock_usecs()));
@@ -568,7 +576,9 @@ Inode::_MakeSpaceForSmallData(Transaction& transaction, bfs_inode* node,
 		int32 index = 0, maxIndex = 0;
 		for (; !item->IsLast(node); item = item->Next(), index++) {
 			// should not remove those
-			if (*item->Name() == FILE_NAME_NAME || !strcmp(name, item->Name()))
+			if (*item->Name() == FILE_NAME_NAME
+				|| *item->Name() == FILE_DATA_NAME
+				|| !strcmp(name, item->Name()))
 				continue;
 
 			if (max == NULL || max->Size() < item->Size()) {
@@ -1428,8 +1438,9 @@ Inode::ContainerContentsChanged(Transaction& transaction)
 off_t
 Inode::AllocatedSize() const
 {
-	if (IsSymLink() && (Flags() & INODE_LONG_SYMLINK) == 0) {
-		// This symlink does not have a data stream
+	if ((IsSymLink() && (Flags() & INODE_LONG_SYMLINK) == 0)
+		|| HasInlineData()) {
+		// This inode does not have a data stream
 		return Node().InodeSize();
 	}
 
@@ -1594,6 +1605,7 @@ Inode::WriteAt(Transaction& transaction, off_t pos, const uint8* buffer,
 
 	size_t length = *_length;
 	bool changeSize = (uint64)pos + (uint64)length > (uint64)Size();
+	bool inlineData = HasInlineData() && length > 0;
 
 	// set/check boundaries for pos/length
 	if (pos < 0)
@@ -1602,7 +1614,7 @@ Inode::WriteAt(Transaction& transaction, off_t pos, const uint8* buffer,
 	locker.Unlock();
 
 	// the transaction doesn't have to be started already
-	if (changeSize && !transaction.IsStarted())
+	if ((changeSize || inlineData) && !transaction.IsStarted())
 		transaction.Start(fVolume, BlockNumber());
 
 	WriteLocker writeLocker(fLock);
@@ -1640,6 +1652,17 @@ Inode::WriteAt(Transaction& transaction, off_t pos, const uint8* buffer,
 		}
 	}
 
+	if (length > 0 && HasInlineData()) {
+		// Inline data is written through to the inode, so that writing back
+		// the file cache usually doesn't need a transaction
+		status_t status = _WriteInlineData(transaction, pos, buffer, length);
+		if (status != B_OK) {
+			*_length = 0;
+			WriteLockInTransaction(transaction);
+			RETURN_ERROR(status);
+		}
+	}
+
 	writeLocker.Unlock();
 
 	if (oldSize < pos)
@@ -1686,6 +1709,246 @@ Inode::FillGapWithZeros(off_t pos, off_t newSize)
 }
 
 
+/*!	Copies the inline data of the file starting at \a pos into \a vecs.
+	Everything beyond the end of the file is filled with zeros, as the file
+	cache always reads whole pages.
+	You need to hold the inode's read lock when calling this method.
+*/
+status_t
+Inode::ReadInlineData(off_t pos, const iovec* vecs, size_t count,
+	size_t* _length)
+{
+	NodeGetter node(fVolume);
+	status_t status = node.SetTo(this);
+	if (status != B_OK)
+		return status;
+
+	RecursiveLocker locker(fSmallDataLock);
+
+	if (!HasInlineData())
+		return B_NOT_SUPPORTED;
+
+	const small_data* item = FindSmallData(node.Node(), kFileDataName);
+	off_t size = item != NULL ? min_c(Size(), (off_t)item->DataSize()) : 0;
+
+	size_t bytesLeft = *_length;
+	for (size_t i = 0; i < count && bytesLeft > 0; i++) {
+		uint8* buffer = (uint8*)vecs[i].iov_base;
+		size_t length = min_c(vecs[i].iov_len, bytesLeft);
+
+		size_t bytes = 0;
+		if (pos < size) {
+			bytes = min_c((off_t)length, size - pos);
+			memcpy(buffer, item->Data() + pos, bytes);
+		}
+		memset(buffer + bytes, 0, length - bytes);
+
+		pos += length;
+		bytesLeft -= length;
+	}
+
+	*_length -= bytesLeft;
+	return B_OK;
+}
+
+
+/*!	Writes pages of the file cache back to the inline data of the file.
+	Since Inode::WriteAt() already writes through to the inode, there is
+	usually nothing left to do; only pages that were changed via a mapping
+	need a transaction.
+	The journal might be held by someone who waits for the very pages that
+	are being written, so this method does not wait for it forever, and
+	returns \c B_WOULD_BLOCK instead.
+	Returns \c B_NOT_SUPPORTED if the file doesn't have inline data (anymore).
+*/
+status_t
+Inode::WriteInlineData(off_t pos, const iovec* vecs, size_t count,
+	size_t* _length)
+{
+	{
+		NodeGetter node(fVolume);
+		status_t status = node.SetTo(this);
+		if (status != B_OK)
+			return status;
+
+		RecursiveLocker locker(fSmallDataLock);
+
+		if (!HasInlineData())
+			return B_NOT_SUPPORTED;
+		if (_InlineDataEquals(node.Node(), pos, vecs, count, *_length))
+			return B_OK;
+	}
+
+	Transaction transaction;
+	for (int32 tries = 0; transaction.Start(fVolume, BlockNumber(), false)
+			!= B_OK; tries++) {
+		if (tries == kMaxInlineWriteTries)
+			return B_WOULD_BLOCK;
+
+		snooze(1000);
+	}
+
+	{
+		NodeGetter node(fVolume);
+		status_t status = node.SetToWritable(transaction, this);
+		if (status != B_OK)
+			return status;
+
+		RecursiveLocker locker(fSmallDataLock);
+
+		if (!HasInlineData())
+			return B_NOT_SUPPORTED;
+
+		small_data* item = FindSmallData(node.WritableNode(), kFileDataName);
+		off_t size = item != NULL ? min_c(Size(), (off_t)item->DataSize()) : 0;
+
+		size_t bytesLeft = *_length;
+		for (size_t i = 0; i < count && bytesLeft > 0 && pos < size; i++) {
+			size_t length = min_c(vecs[i].iov_len, bytesLeft);
+			size_t bytes = min_c((off_t)length, size - pos);
+			memcpy(item->Data() + pos, vecs[i].iov_base, bytes);
+
+			pos += length;
+			bytesLeft -= length;
+		}
+	}
+
+	return transaction.Done();
+}
+
+
+/*!	Adds or removes space for inline data, so that it matches \a size.
+	New space is filled with zeros. Returns \c B_DEVICE_FULL if the data
+	would no longer fit into the inode.
+*/
+status_t
+Inode::_ResizeInlineData(Transaction& transaction, off_t size)
+{
+	if (size > fVolume->MaxInlineDataSize())
+		return B_DEVICE_FULL;
+
+	NodeGetter node(fVolume);
+	status_t status = node.SetToWritable(transaction, this);
+	if (status != B_OK)
+		return status;
+
+	if (size == 0) {
+		status = _RemoveSmallData(transaction, node, kFileDataName);
+		if (status == B_ENTRY_NOT_FOUND)
+			status = B_OK;
+	} else {
+		uint8 dummy = 0;
+
+		RecursiveLocker locker(fSmallDataLock);
+		if (FindSmallData(node.Node(), kFileDataName) == NULL) {
+			status = _AddSmallData(transaction, node, kFileDataName,
+				FILE_DATA_TYPE, 0, &dummy, 0);
+		}
+		if (status == B_OK) {
+			// growing the item fills the gap with zeros
+			status = _AddSmallData(transaction, node, kFileDataName,
+				FILE_DATA_TYPE, size, &dummy, 0);
+		}
+	}
+	if (status != B_OK)
+		return status;
+
+	Node().data.size = HOST_ENDIAN_TO_BFS_INT64(size);
+	return B_OK;
+}
+
+
+status_t
+Inode::_WriteInlineData(Transaction& transaction, off_t pos,
+	const uint8* buffer, size_t length)
+{
+	NodeGetter node(fVolume);
+	status_t status = node.SetToWritable(transaction, this);
+	if (status != B_OK)
+		return status;
+
+	RecursiveLocker locker(fSmallDataLock);
+
+	small_data* item = FindSmallData(node.WritableNode(), kFileDataName);
+	if (item == NULL || pos + length > item->DataSize())
+		RETURN_ERROR(B_BAD_DATA);
+
+	return user_memcpy(item->Data() + pos, buffer, length);
+}
+
+
+/*!	Returns whether or not the inline data already contains what \a vecs
+	would write. Anything beyond the end of the file is ignored.
+	You need to hold the fSmallDataLock when you call this method.
+*/
+bool
+Inode::_InlineDataEquals(const bfs_inode* node, off_t pos, const iovec* vecs,
+	size_t count, size_t length)
+{
+	const small_data* item = FindSmallData(node, kFileDataName);
+	off_t size = item != NULL ? min_c(Size(), (off_t)item->DataSize()) : 0;
+
+	for (size_t i = 0; i < count && length > 0 && pos < Size(); i++) {
+		size_t vecLength = min_c(vecs[i].iov_len, length);
+		size_t bytes = min_c((off_t)vecLength, Size() - pos);
+		if (pos + (off_t)bytes > size
+			|| memcmp(item->Data() + pos, vecs[i].iov_base, bytes) != 0)
+			return false;
+
+		pos += vecLength;
+		length -= vecLength;
+	}
+
+	return true;
+}
+
+
+/*!	Moves the inline data of the file into a newly allocated data stream
+	of the same size.
+*/
+status_t
+Inode::_MoveInlineDataToStream(Transaction& transaction)
+{
+	off_t size = Size();
+	uint32 blockSize = fVolume->BlockSize();
+
+	uint8* buffer = (uint8*)calloc(1, blockSize);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+
+	MemoryDeleter bufferDeleter(buffer);
+
+	iovec vec = { buffer, (size_t)size };
+	size_t length = size;
+	status_t status = ReadInlineData(0, &vec, 1, &length);
+	if (status == B_OK)
+		status = _ResizeInlineData(transaction, 0);
+	if (status != B_OK)
+		return status;
+
+	Node().flags &= ~HOST_ENDIAN_TO_BFS_INT32(INODE_INLINE_DATA);
+	if (size == 0)
+		return B_OK;
+
+	status = _GrowStream(transaction, size);
+	if (status != B_OK)
+		return status;
+
+	// The data always fits into the first block of the stream
+	block_run run;
+	off_t offset;
+	status = FindBlockRun(0, run, offset);
+	if (status != B_OK)
+		return status;
+
+	if (write_pos(fVolume->Device(), fVolume->ToOffset(run), buffer,
+			blockSize) != (ssize_t)blockSize)
+		return B_IO_ERROR;
+
+	return B_OK;
+}
+
+
 /*!	Allocates \a length blocks, and clears their contents. Growing
 	the indirect and double indirect range uses this method.
 	The allocated block_run is saved in "run"
@@ -2033,6 +2296,19 @@ Inode::_GrowStream(Transaction& transaction, off_t size)
 				// 64 MB for 1 GB)
 				roundTo = size >> (fVolume->BlockShift() + 4);
 			}
+
+			if (fWriterCount > 0) {
+				// While the file is open for writing, let it grow by as much
+				// as it already has (up to 4 MB), so that files written to
+				// in small pieces get few, large runs, even if several of
+				// them are written at the same time. Whatever is left is
+				// trimmed when the last writer is gone.
+				off_t growBy = min_c(size, 4 * 1024 * 1024)
+					>> fVolume->BlockShift();
+				growBy = min_c(growBy, fVolume->FreeBlocks() / 16);
+				if (growBy > roundTo)
+					roundTo = growBy;
+			}
 		} else if (IsIndex()) {
 			// Always preallocate 64 KB for index directories
 			roundTo = 65536 >> fVolume->BlockShift();
@@ -2328,8 +2604,26 @@ Inode::SetFileSize(Transaction& transaction, off_t size)
 
 	T(Resize(this, oldSize, size, false));
 
-	// should the data stream grow or shrink?
 	status_t status;
+	if (HasInlineData()) {
+		status = _ResizeInlineData(transaction, size);
+		if (status == B_OK) {
+			file_cache_set_size(FileCache(), size);
+			file_map_set_size(Map(), size);
+
+			return WriteBack(transaction);
+		}
+		if (status != B_DEVICE_FULL)
+			return status;
+
+		// The data doesn't fit into the inode anymore; files never get
+		// their inline data back once they have a data stream.
+		status = _MoveInlineDataToStream(transaction);
+		if (status != B_OK)
+			return status;
+	}
+
+	// should the data stream grow or shrink?
 	if (size > oldSize) {
 		status = _GrowStream(transaction, size);
 		if (status < B_OK) {
@@ -2969,7 +3263,8 @@ AttributeIterator::GetNext(char* name, size_t* _length, uint32* _type,
 		int32 index = 0;
 		for (; !item->IsLast(node); item = item->Next(), index++) {
 			if (item->NameSize() == FILE_NAME_NAME_LENGTH
-				&& *item->Name() == FILE_NAME_NAME)
+				&& (*item->Name() == FILE_NAME_NAME
+					|| *item->Name() == FILE_DATA_NAME))
 				continue;
 
 			if (index >= fCurrentSmallData)
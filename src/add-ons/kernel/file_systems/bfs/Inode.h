@@ -75,6 +75,9 @@ public:
 			bool				IsLongSymLink() const
 									{ return (Flags() & INODE_LONG_SYMLINK)
 										!= 0; }
+			bool				HasInlineData() const
+									{ return (Flags() & INODE_INLINE_DATA)
+										!= 0; }
 
 			bool				HasUserAccessableStream() const
 									{ return IsFile(); }
@@ -150,6 +153,12 @@ public:
 									const uint8* buffer, size_t* length);
 			status_t			FillGapWithZeros(off_t oldSize, off_t newSize);
 
+			// for files with inline data only:
+			status_t			ReadInlineData(off_t pos, const iovec* vecs,
+									size_t count, size_t* _length);
+			status_t			WriteInlineData(off_t pos, const iovec* vecs,
+									size_t count, size_t* _length);
+
 			status_t			SetFileSize(Transaction& transaction,
 									off_t size);
 			status_t			Append(Transaction& transaction, off_t bytes);
@@ -182,6 +191,13 @@ public:
 			off_t				OldSize() { return fOldSize; }
 			off_t				OldLastModified() { return fOldLastModified; }
 
+			// preallocations are kept while the file is open for writing
+			void				AddWriter()
+									{ atomic_add(&fWriterCount, 1); }
+			bool				RemoveWriter()
+									{ return atomic_add(&fWriterCount, -1)
+										== 1; }
+
 			bool				InNameIndex() const;
 			bool				InSizeIndex() const;
 			bool				InLastModifiedIndex() const;
@@ -256,6 +272,16 @@ private:
 									off_t size);
 			status_t			_ShrinkStream(Transaction& transaction,
 									off_t size);
+			status_t			_ResizeInlineData(Transaction& transaction,
+									off_t size);
+			status_t			_WriteInlineData(Transaction& transaction,
+									off_t pos, const uint8* buffer,
+									size_t length);
+			bool				_InlineDataEquals(const bfs_inode* node,
+									off_t pos, const iovec* vecs, size_t count,
+									size_t length);
+			status_t			_MoveInlineDataToStream(
+									Transaction& transaction);
 			status_t			_AddBlockRun(Transaction& transaction,
 									data_stream* data, block_run run,
 									off_t targetSize, int32* rest = NULL,
@@ -275,6 +301,7 @@ private:
 			off_t				fOldLastModified;
 				// we need those values to ensure we will remove
 				// the correct keys from the indices
+			int32				fWriterCount;
 
 			mutable recursive_lock fSmallDataLock;
 			SinglyLinkedList<AttributeIterator> fIterators;
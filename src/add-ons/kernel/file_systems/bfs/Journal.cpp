@@ -407,10 +407,12 @@ Journal::Journal(Volume* volume)
 	fUsed(0),
 	fUnwrittenTransactions(0),
 	fHasSubtransaction(false),
-	fSeparateSubTransactions(false)
+	fSeparateSubTransactions(false),
+	fCommitGeneration(0)
 {
 	recursive_lock_init(&fLock, "bfs journal");
 	mutex_init(&fEntriesLock, "bfs journal entries");
+	mutex_init(&fCommitLock, "bfs journal commit");
 
 	fLogFlusherSem = create_sem(0, "bfs log flusher");
 	fLogFlusher = spawn_kernel_thread(&Journal::_LogFlusher, "bfs log flusher",
@@ -426,6 +428,7 @@ Journal::~Journal()
 
 	recursive_lock_destroy(&fLock);
 	mutex_destroy(&fEntriesLock);
+	mutex_destroy(&fCommitLock);
 
 	sem_id logFlusher = fLogFlusherSem;
 	fLogFlusherSem = -1;
@@ -783,6 +786,7 @@ Journal::_WriteTransactionToLog()
 				NULL);
 			fUnwrittenTransactions = 0;
 		}
+		atomic_add(&fCommitGeneration, 1);
 		return B_OK;
 	}
 
@@ -919,6 +923,9 @@ Journal::_WriteTransactionToLog()
 		fUnwrittenTransactions = 0;
 	}
 
+	if (status == B_OK)
+		atomic_add(&fCommitGeneration, 1);
+
 	return status;
 }
 
@@ -988,10 +995,42 @@ Journal::FlushLogAndLockJournal()
 }
 
 
+/*!	Makes sure all transactions that have been completed before this call
+	are written to the log, but does not write back any blocks.
+
+	This implements a group commit: while one thread writes the log, others
+	that want to commit wait for it to finish. If a log write started after
+	they came in, it contains their transactions as well, and they don't have
+	to write the log again.
+	The other log writers don't go through here: FlushLogAndBlocks() and
+	FlushLogAndLockJournal() must also write back the blocks under the
+	journal lock, and the log flusher must never wait. Their log writes
+	still count as commits for callers waiting here, though.
+	Must not be called from within a transaction.
+*/
 status_t
-Journal::Lock(Transaction* owner, bool separateSubTransactions)
+Journal::Commit()
 {
-	status_t status = recursive_lock_lock(&fLock);
+	int32 generation = atomic_get(&fCommitGeneration);
+
+	MutexLocker committer(fCommitLock);
+
+	if (atomic_get(&fCommitGeneration) != generation) {
+		// Another thread has written the log in the mean time. It must have
+		// taken the journal lock after our transactions were done, so they
+		// have been part of it.
+		return B_OK;
+	}
+
+	return _FlushLog(true, false);
+}
+
+
+status_t
+Journal::Lock(Transaction* owner, bool separateSubTransactions, bool canWait)
+{
+	status_t status = canWait ? recursive_lock_lock(&fLock)
+		: recursive_lock_trylock(&fLock);
 	if (status != B_OK)
 		return status;
 
@@ -1245,6 +1284,7 @@ Journal::Dump()
 	kprintf("  transaction ID:       %" B_PRId32 "\n", fTransactionID);
 	kprintf("  has subtransaction:   %d\n", fHasSubtransaction);
 	kprintf("  separate sub-trans.:  %d\n", fSeparateSubTransactions);
+	kprintf("  commit generation:    %" B_PRId32 "\n", fCommitGeneration);
 	kprintf("entries:\n");
 	kprintf("  address        id  start length\n");
 
@@ -1295,18 +1335,21 @@ TransactionListener::~TransactionListener()
 
 
 status_t
-Transaction::Start(Volume* volume, off_t refBlock)
+Transaction::Start(Volume* volume, off_t refBlock, bool canWait)
 {
 	// has it already been started?
 	if (fJournal != NULL)
 		return B_OK;
 
 	fJournal = volume->GetJournal(refBlock);
-	if (fJournal != NULL && fJournal->Lock(this, false) == B_OK)
-		return B_OK;
+	if (fJournal == NULL)
+		return B_ERROR;
 
-	fJournal = NULL;
-	return B_ERROR;
+	status_t status = fJournal->Lock(this, false, canWait);
+	if (status != B_OK)
+		fJournal = NULL;
+
+	return status;
 }
 
 
@@ -26,7 +26,8 @@ public:
 			status_t		InitCheck();
 
 			status_t		Lock(Transaction* owner,
-								bool separateSubTransactions);
+								bool separateSubTransactions,
+								bool canWait = true);
 			status_t		Unlock(Transaction* owner, bool success);
 
 			status_t		ReplayLog();
@@ -37,6 +38,7 @@ public:
 
 			status_t		FlushLogAndBlocks();
 			status_t		FlushLogAndLockJournal();
+			status_t		Commit();
 
 			Volume*			GetVolume() const { return fVolume; }
 			int32			TransactionID() const { return fTransactionID; }
@@ -82,6 +84,9 @@ private:
 			bool			fHasSubtransaction;
 			bool			fSeparateSubTransactions;
 
+			mutex			fCommitLock;
+			int32			fCommitGeneration;
+
 			thread_id		fLogFlusher;
 			sem_id			fLogFlusherSem;
 };
@@ -140,7 +145,7 @@ public:
 			fJournal->Unlock(this, false);
 	}
 
-	status_t Start(Volume* volume, off_t refBlock);
+	status_t Start(Volume* volume, off_t refBlock, bool canWait = true);
 	bool IsStarted() const { return fJournal != NULL; }
 
 	status_t Done()
@@ -11,6 +11,7 @@
 #include "bfs.h"
 #include "Debug.h"
 #include "Index.h"
+#include "IndexCache.h"
 #include "Inode.h"
 #include "Volume.h"
 
@@ -44,12 +45,33 @@ struct Query::QueryPolicy {
 		off_t offset;
 		bool isSpecialTime;
 
-		IndexIterator(BPlusTree* tree)
+		// used when the index cache found the candidates for a pattern
+		Inode* indexNode;
+		const char* attribute;
+		bool isString;
+		ino_t* candidates;
+		uint32 candidateCount;
+		uint32 nextCandidate;
+		bool useCandidates;
+
+		IndexIterator(Index& index)
 			:
-			TreeIterator(tree),
+			TreeIterator(index.Node()->Tree()),
 			offset(0),
-			isSpecialTime(false)
+			isSpecialTime(index.isSpecialTime),
+			indexNode(index.Node()),
+			attribute(index.Name()),
+			isString(index.Type() == B_STRING_TYPE),
+			candidates(NULL),
+			candidateCount(0),
+			nextCandidate(0),
+			useCandidates(false)
+		{
+		}
+
+		~IndexIterator()
 		{
+			free(candidates);
 		}
 	};
 
@@ -143,14 +165,59 @@ struct Query::QueryPolicy {
 		return index.KeySize();
 	}
 
-	static IndexIterator* IndexCreateIterator(Index& index)
+	/*!	Estimates the number of entries in the index that match \a op with
+		\a value, or all of its entries, if \a value is \c NULL.
+	*/
+	static status_t IndexEstimateCount(Index& index, int32 op,
+		const void* value, size_t size, bool prefix, int64* _count)
 	{
-		IndexIterator* iterator = new(std::nothrow) IndexIterator(index.Node()->Tree());
-		if (iterator == NULL)
-			return NULL;
+		const uint8* from = NULL;
+		const uint8* to = NULL;
+		int64 shiftedFrom;
+		int64 shiftedTo;
+
+		if (value != NULL && index.isSpecialTime) {
+			// the lower bits of the keys are used to make them unique
+			shiftedFrom = *(int64*)value << INODE_TIME_SHIFT;
+			shiftedTo = shiftedFrom | ((1LL << INODE_TIME_SHIFT) - 1);
+		}
+
+		if (value != NULL) {
+			switch (op) {
+				case QueryParser::OP_EQUAL:
+					from = to = (const uint8*)value;
+					break;
+				case QueryParser::OP_GREATER_THAN:
+				case QueryParser::OP_GREATER_THAN_OR_EQUAL:
+					from = (const uint8*)value;
+					break;
+				case QueryParser::OP_LESS_THAN:
+				case QueryParser::OP_LESS_THAN_OR_EQUAL:
+					to = (const uint8*)value;
+					break;
+			}
+
+			if (index.isSpecialTime) {
+				if (from != NULL)
+					from = (const uint8*)&shiftedFrom;
+				if (to != NULL)
+					to = (const uint8*)&shiftedTo;
+			}
+		}
+
+		off_t count;
+		status_t status = index.Node()->Tree()->EstimateRange(from, size, to,
+			size, prefix, &count);
+		if (status != B_OK)
+			return status;
 
-		iterator->isSpecialTime = index.isSpecialTime;
-		return iterator;
+		*_count = count;
+		return B_OK;
+	}
+
+	static IndexIterator* IndexCreateIterator(Index& index)
+	{
+		return new(std::nothrow) IndexIterator(index);
 	}
 
 	// IndexIterator interface
@@ -173,9 +240,31 @@ struct Query::QueryPolicy {
 		return iterator->Find((const uint8*)value, size);
 	}
 
+	static status_t IndexIteratorFindPattern(IndexIterator* iterator,
+		const char* pattern)
+	{
+		Volume* volume = iterator->indexNode->GetVolume();
+		if (volume->IndexCache() == NULL || !iterator->isString)
+			return B_UNSUPPORTED;
+
+		status_t status = volume->IndexCache()->FindCandidates(
+			iterator->indexNode, iterator->attribute, pattern,
+			&iterator->candidates, &iterator->candidateCount);
+		if (status == B_OK)
+			iterator->useCandidates = true;
+
+		return status;
+	}
+
 	static status_t IndexIteratorFetchNextEntry(IndexIterator* iterator,
 		void* indexValue, size_t* _keyLength, size_t bufferSize, size_t* _duplicate)
 	{
+		if (iterator->useCandidates) {
+			*_duplicate = 0;
+			return IndexIteratorFetchNextCandidate(iterator, indexValue,
+				_keyLength, bufferSize);
+		}
+
 		uint16 keyLength;
 		uint16 duplicate;
 		status_t status = iterator->GetNextEntry((uint8*)indexValue, &keyLength,
@@ -193,22 +282,67 @@ struct Query::QueryPolicy {
 		return B_OK;
 	}
 
+	/*!	Reads the key of the next candidate from its inode, as the index
+		cache does not store the keys themselves.
+	*/
+	static status_t IndexIteratorFetchNextCandidate(IndexIterator* iterator,
+		void* indexValue, size_t* _keyLength, size_t bufferSize)
+	{
+		Volume* volume = iterator->indexNode->GetVolume();
+		char* key = (char*)indexValue;
+
+		while (iterator->nextCandidate < iterator->candidateCount) {
+			ino_t id = iterator->candidates[iterator->nextCandidate++];
+
+			Vnode vnode(volume, id);
+			Inode* inode;
+			if (vnode.Get(&inode) != B_OK)
+				continue;
+
+			status_t status;
+			size_t length = min_c(bufferSize - 1, MAX_INDEX_KEY_LENGTH);
+			if (!strcmp(iterator->attribute, "name"))
+				status = inode->GetName(key, length + 1);
+			else {
+				status = inode->ReadAttribute(iterator->attribute,
+					B_STRING_TYPE, 0, (uint8*)key, &length);
+				if (status == B_OK)
+					key[length] = '\0';
+			}
+			if (status != B_OK)
+				continue;
+
+			length = strlen(key);
+			if (length == 0)
+				continue;
+
+			iterator->offset = id;
+			*_keyLength = length;
+			return B_OK;
+		}
+
+		return B_ENTRY_NOT_FOUND;
+	}
+
 	static status_t IndexIteratorGetEntry(Context* context, IndexIterator* iterator,
 		NodeHolder& holder, Inode** _entry)
 	{
-		holder.vnode.SetTo(context->fVolume, iterator->offset);
-		Inode* inode;
-		status_t status = holder.vnode.Get(&inode);
+		status_t status = ContextGetEntry(context, iterator->offset, holder,
+			_entry);
 		if (status != B_OK) {
 			REPORT_ERROR(status);
 			FATAL(("could not get inode %" B_PRIdOFF " in index!\n", iterator->offset));
 			return status;
 		}
 
-		*_entry = inode;
 		return B_OK;
 	}
 
+	static ino_t IndexIteratorGetNodeID(IndexIterator* iterator)
+	{
+		return iterator->offset;
+	}
+
 	static void IndexIteratorSkipDuplicates(IndexIterator* iterator)
 	{
 		iterator->SkipDuplicates();
@@ -297,6 +431,13 @@ struct Query::QueryPolicy {
 	{
 		return context->fVolume->ID();
 	}
+
+	static status_t ContextGetEntry(Context* context, ino_t id,
+		NodeHolder& holder, Inode** _entry)
+	{
+		holder.vnode.SetTo(context->fVolume, id);
+		return holder.vnode.Get(_entry);
+	}
 };
 
 
@@ -355,6 +496,13 @@ Query::GetNextEntry(struct dirent* entry, size_t size)
 }
 
 
+status_t
+Query::Explain(char* buffer, size_t size)
+{
+	return fImpl->Explain(buffer, size);
+}
+
+
 void
 Query::LiveUpdate(Inode* inode, const char* attribute, int32 type,
 	const void* oldKey, size_t oldLength, const void* newKey, size_t newLength)
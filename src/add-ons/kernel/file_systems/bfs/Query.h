@@ -28,6 +28,7 @@ public:
 
 			status_t		Rewind();
 			status_t		GetNextEntry(struct dirent* entry, size_t size);
+			status_t		Explain(char* buffer, size_t size);
 
 			void			LiveUpdate(Inode* inode,
 								const char* attribute, int32 type,
@@ -8,9 +8,11 @@
 
 
 #include "Attribute.h"
+#include "bfs_disk_system.h"
 #include "CheckVisitor.h"
 #include "Debug.h"
 #include "file_systems/DeviceOpener.h"
+#include "IndexCache.h"
 #include "Inode.h"
 #include "Journal.h"
 #include "Query.h"
@@ -37,7 +39,8 @@ disk_super_block::IsMagicValid() const
 {
 	return Magic1() == (int32)SUPER_BLOCK_MAGIC1
 		&& Magic2() == (int32)SUPER_BLOCK_MAGIC2
-		&& Magic3() == (int32)SUPER_BLOCK_MAGIC3;
+		&& (Magic3() == (int32)SUPER_BLOCK_MAGIC3
+			|| Magic3() == (int32)SUPER_BLOCK_MAGIC3_FEATURES);
 }
 
 
@@ -132,6 +135,7 @@ Volume::Volume(fs_volume* volume)
 	fRootNode(NULL),
 	fIndicesNode(NULL),
 	fDirtyCachedBlocks(0),
+	fIndexCache(NULL),
 	fFlags(0),
 	fCheckingThread(-1),
 	fCheckVisitor(NULL)
@@ -164,6 +168,22 @@ Volume::IsValidInodeBlock(off_t block) const
 }
 
 
+/*!	Returns how many bytes of file data may be stored in an inode. This
+	always leaves enough room for the longest possible name, so that renaming
+	a file never needs to move its data out of the inode.
+*/
+uint32
+Volume::MaxInlineDataSize() const
+{
+	uint32 nameSpace = sizeof(small_data) + FILE_NAME_NAME_LENGTH + 3
+		+ B_FILE_NAME_LENGTH;
+	uint32 dataOverhead = sizeof(small_data) + FILE_DATA_NAME_LENGTH + 3 + 1;
+
+	return (InodeSize() - sizeof(bfs_inode) - sizeof(small_data) - nameSpace
+		- dataOverhead) & ~7UL;
+}
+
+
 void
 Volume::Panic()
 {
@@ -200,6 +220,13 @@ Volume::Mount(const char* deviceName, uint32 flags)
 		return B_BAD_VALUE;
 	}
 
+	status_t status = check_volume_features(fSuperBlock);
+	if (status != B_OK) {
+		FATAL(("volume uses unsupported features %#" B_PRIx32 "!\n",
+			fSuperBlock.Features()));
+		return status;
+	}
+
 	// initialize short hands to the superblock (to save byte swapping)
 	fBlockSize = fSuperBlock.BlockSize();
 	fBlockShift = fSuperBlock.BlockShift();
@@ -226,12 +253,16 @@ Volume::Mount(const char* deviceName, uint32 flags)
 	if (fJournal == NULL)
 		return B_NO_MEMORY;
 
-	status_t status = fJournal->InitCheck();
+	status = fJournal->InitCheck();
 	if (status < B_OK) {
 		FATAL(("could not initialize journal: %s!\n", strerror(status)));
 		return status;
 	}
 
+	fIndexCache = new(std::nothrow) ::IndexCache(this);
+	if (fIndexCache == NULL)
+		return B_NO_MEMORY;
+
 	// replaying the log is the first thing we will do on this disk
 	status = fJournal->ReplayLog();
 	if (status != B_OK) {
@@ -308,6 +339,9 @@ Volume::Unmount()
 	delete fJournal;
 	fJournal = NULL;
 
+	delete fIndexCache;
+	fIndexCache = NULL;
+
 	delete fIndicesNode;
 
 	block_cache_delete(fBlockCache, !IsReadOnly());
@@ -580,6 +614,13 @@ Volume::Initialize(int fd, const char* name, uint32 blockSize,
 	// create valid superblock
 
 	fSuperBlock.Initialize(name, numBlocks, blockSize);
+	if ((flags & VOLUME_INLINE_DATA) != 0) {
+		// older implementations must not mount the volume
+		fSuperBlock.magic3
+			= HOST_ENDIAN_TO_BFS_INT32(SUPER_BLOCK_MAGIC3_FEATURES);
+		fSuperBlock.features
+			= HOST_ENDIAN_TO_BFS_INT32(SUPER_BLOCK_FEATURE_INLINE_DATA);
+	}
 
 	// initialize short hands to the superblock (to save byte swapping)
 	fBlockSize = fSuperBlock.BlockSize();
@@ -13,6 +13,7 @@
 
 
 class CheckVisitor;
+class IndexCache;
 class Journal;
 class Inode;
 class Query;
@@ -24,6 +25,7 @@ enum volume_flags {
 
 enum volume_initialize_flags {
 	VOLUME_NO_INDICES	= 0x0001,
+	VOLUME_INLINE_DATA	= 0x0002,
 };
 
 typedef DoublyLinkedList<Inode> InodeList;
@@ -44,6 +46,9 @@ public:
 			bool			IsValidSuperBlock() const;
 			bool			IsValidInodeBlock(off_t block) const;
 			bool			IsReadOnly() const;
+			bool			HasInlineData() const
+								{ return (fSuperBlock.Features()
+									& SUPER_BLOCK_FEATURE_INLINE_DATA) != 0; }
 			void			Panic();
 			mutex&			Lock();
 
@@ -75,6 +80,7 @@ public:
 			uint32			BlockShift() const { return fBlockShift; }
 			uint32			InodeSize() const
 								{ return fSuperBlock.InodeSize(); }
+			uint32			MaxInlineDataSize() const;
 			uint32			AllocationGroups() const
 								{ return fSuperBlock.AllocationGroups(); }
 			uint32			AllocationGroupShift() const
@@ -139,6 +145,8 @@ public:
 			void			AddQuery(Query* query);
 			void			RemoveQuery(Query* query);
 
+			::IndexCache*	IndexCache() const { return fIndexCache; }
+
 			status_t		Sync();
 			Journal*		GetJournal(off_t refBlock) const;
 
@@ -174,6 +182,7 @@ protected:
 
 			mutex			fQueryLock;
 			DoublyLinkedList<Query> fQueries;
+			::IndexCache*	fIndexCache;
 
 			uint32			fFlags;
 
@@ -76,7 +76,8 @@ struct disk_super_block {
 	int32		magic3;
 	inode_addr	root_dir;
 	inode_addr	indices;
-	int32		_reserved[8];
+	uint32		features;
+	int32		_reserved[7];
 	int32		pad_to_block[87];
 		// this also contains parts of the boot block
 
@@ -95,6 +96,7 @@ struct disk_super_block {
 	int32 AllocationGroupShift() const
 		{ return BFS_ENDIAN_TO_HOST_INT32(ag_shift); }
 	int32 Flags() const { return BFS_ENDIAN_TO_HOST_INT32(flags); }
+	inline uint32 Features() const;
 	off_t LogStart() const { return BFS_ENDIAN_TO_HOST_INT64(log_start); }
 	off_t LogEnd() const { return BFS_ENDIAN_TO_HOST_INT64(log_end); }
 
@@ -109,10 +111,22 @@ struct disk_super_block {
 #define SUPER_BLOCK_MAGIC1			'BFS1'		/* BFS1 */
 #define SUPER_BLOCK_MAGIC2			0xdd121031
 #define SUPER_BLOCK_MAGIC3			0x15b6830e
+#define SUPER_BLOCK_MAGIC3_FEATURES	'BFSF'		/* BFSF */
 
 #define SUPER_BLOCK_DISK_CLEAN		'CLEN'		/* CLEN */
 #define SUPER_BLOCK_DISK_DIRTY		'DIRT'		/* DIRT */
 
+// Optional on-disk format features; a volume that uses a feature that is
+// not known to the implementation must not be mounted.
+// The features field is only used when magic3 is set to
+// SUPER_BLOCK_MAGIC3_FEATURES. Implementations that predate the field don't
+// know that magic, and therefore refuse such a volume instead of
+// misinterpreting it.
+#define SUPER_BLOCK_FEATURE_INLINE_DATA	0x00000001
+	// the data of small files may be stored in the inode
+
+#define SUPER_BLOCK_KNOWN_FEATURES	SUPER_BLOCK_FEATURE_INLINE_DATA
+
 //**************************************
 
 #define NUM_DIRECT_BLOCKS			12
@@ -172,6 +186,11 @@ struct small_data {
 #define FILE_NAME_NAME			0x13
 #define FILE_NAME_NAME_LENGTH	1
 
+// The data of a file with the INODE_INLINE_DATA flag is a small_data item
+#define FILE_DATA_TYPE			B_RAW_TYPE
+#define FILE_DATA_NAME			0x14
+#define FILE_DATA_NAME_LENGTH	1
+
 // The maximum key length of attribute data that is put  in the index.
 // This excludes a terminating null byte.
 // This must be smaller than or equal as BPLUSTREE_MAX_KEY_LENGTH.
@@ -266,6 +285,7 @@ enum inode_flags {
 	INODE_DELETED			= 0x00000010,
 	INODE_NOT_READY			= 0x00000020,	// used during Inode construction
 	INODE_LONG_SYMLINK		= 0x00000040,	// symlink in data stream
+	INODE_INLINE_DATA		= 0x00000080,	// file data in small_data
 
 	INODE_PERMANENT_FLAGS	= 0x0000ffff,
 
@@ -318,6 +338,19 @@ unique_from_nsec(uint32 time)
 }
 
 
+//	#pragma mark - disk_super_block inline functions
+
+
+inline uint32
+disk_super_block::Features() const
+{
+	if (Magic3() != (int32)SUPER_BLOCK_MAGIC3_FEATURES)
+		return 0;
+
+	return BFS_ENDIAN_TO_HOST_INT32(features);
+}
+
+
 //	#pragma mark - block_run inline functions
 
 
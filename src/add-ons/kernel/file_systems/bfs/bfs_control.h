@@ -68,6 +68,10 @@ struct check_control {
 		uint32	block_size;
 	} stats;
 	status_t	status;
+
+	/* Added later; only used if the ioctl's buffer length covers them. */
+	uint64		file_extents;
+	uint64		fragmented_files;
 };
 
 /* values for the flags field */
@@ -103,5 +107,60 @@ struct check_control {
  */
 #define BFS_IOCTL_RESIZE		14205
 
+/* The index cache keeps trigram indices in memory that let queries for
+ * patterns like "*foo*" find their matches without reading every key of the
+ * index. It is disabled by default; BFS_IOCTL_SET_INDEX_CACHE takes a uint64
+ * with the maximum amount of memory it may use, zero disables it again.
+ * Only root may set it, and the size is limited to 256 MB; GET_INDEX_CACHE_INFO
+ * reports the size actually in effect.
+ */
+#define BFS_IOCTL_SET_INDEX_CACHE		14206
+#define BFS_IOCTL_GET_INDEX_CACHE_INFO	14207
+
+struct index_cache_info {
+	uint64		max_size;
+	uint64		size;
+	uint32		indices;
+	uint32		lookups;
+	uint32		builds;
+};
+
+/* ioctl to see how a query would be evaluated, which indices it would use,
+ * and how many entries BFS expects to find in them. If BFS_EXPLAIN_RUN is
+ * set, the query is also run, and the description contains how many entries
+ * each step actually read and found.
+ */
+#define BFS_IOCTL_EXPLAIN_QUERY			14208
+
+#define BFS_EXPLAIN_RUN					0x0001
+
+struct explain_query_control {
+	const char*	query;
+	char*		buffer;
+	uint32		buffer_size;
+	uint32		flags;
+	uint32		entries_found;
+};
+
+/* Merges underfull nodes of the B+tree of a directory, or of the index named
+ * in "index", and gives the nodes that are no longer needed back to the file
+ * system. If "index" is empty, the directory the ioctl is called on is
+ * compacted. The node counts do not include the header node.
+ * The tree is changed in many small transactions, not in a single one. If
+ * the system crashes, or the ioctl fails, the tree is still valid, but
+ * might only be compacted partly.
+ */
+#define BFS_IOCTL_COMPACT_TREE			14209
+
+struct compact_tree_control {
+	char		index[B_FILE_NAME_LENGTH];
+	uint32		levels_before;
+	uint32		levels_after;
+	uint64		nodes_before;
+	uint64		nodes_after;
+	uint64		free_nodes_before;
+	uint64		free_nodes_after;
+};
+
 
 #endif	/* BFS_CONTROL_H */
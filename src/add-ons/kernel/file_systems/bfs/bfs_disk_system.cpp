@@ -22,6 +22,8 @@ parse_initialize_parameters(const char* parameterString,
 
 	if (get_driver_boolean_parameter(handle, "noindex", false, true))
 		parameters.flags |= VOLUME_NO_INDICES;
+	if (get_driver_boolean_parameter(handle, "inline_data", false, true))
+		parameters.flags |= VOLUME_INLINE_DATA;
 	if (get_driver_boolean_parameter(handle, "verbose", false, true))
 		parameters.verbose = true;
 
@@ -55,3 +57,16 @@ check_volume_name(const char* name)
 	return B_OK;
 }
 
+
+
+/*!	Checks whether all on-disk format features the volume uses are
+	understood by this implementation.
+*/
+status_t
+check_volume_features(const disk_super_block& superBlock)
+{
+	if ((superBlock.Features() & ~SUPER_BLOCK_KNOWN_FEATURES) != 0)
+		return B_UNSUPPORTED;
+
+	return B_OK;
+}
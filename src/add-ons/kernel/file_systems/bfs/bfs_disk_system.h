@@ -14,9 +14,12 @@ struct initialize_parameters {
 	bool	verbose;
 };
 
+struct disk_super_block;
+
 status_t parse_initialize_parameters(const char* parameterString,
 	initialize_parameters& parameters);
 status_t check_volume_name(const char* name);
+status_t check_volume_features(const disk_super_block& superBlock);
 
 
 #endif	// _BFS_DISK_SYSTEM_H
@@ -13,6 +13,7 @@
 #include "Volume.h"
 #include "Inode.h"
 #include "Index.h"
+#include "IndexCache.h"
 #include "BPlusTree.h"
 #include "Query.h"
 #include "ResizeVisitor.h"
@@ -21,6 +22,7 @@
 
 // TODO: temporary solution as long as there is no public I/O requests API
 #ifndef FS_SHELL
+#	include <fs/dir_stat.h>
 #	include <io_requests.h>
 #	include <util/fs_trim_support.h>
 #endif
@@ -420,6 +422,9 @@ bfs_read_pages(fs_volume* _volume, fs_vnode* _node, void* _cookie,
 
 	InodeReadLocker _(inode);
 
+	if (inode->HasInlineData())
+		return inode->ReadInlineData(pos, vecs, count, _numBytes);
+
 	uint32 vecIndex = 0;
 	size_t vecOffset = 0;
 	size_t bytesLeft = *_numBytes;
@@ -463,6 +468,13 @@ bfs_write_pages(fs_volume* _volume, fs_vnode* _node, void* _cookie,
 	if (inode->FileCache() == NULL)
 		RETURN_ERROR(B_BAD_VALUE);
 
+	if (inode->HasInlineData()) {
+		// this needs a transaction, so we must not hold the inode lock yet
+		status_t status = inode->WriteInlineData(pos, vecs, count, _numBytes);
+		if (status != B_NOT_SUPPORTED)
+			return status;
+	}
+
 	InodeReadLocker _(inode);
 
 	uint32 vecIndex = 0;
@@ -495,6 +507,44 @@ bfs_write_pages(fs_volume* _volume, fs_vnode* _node, void* _cookie,
 }
 
 
+#ifndef FS_SHELL
+/*!	Inline data cannot be described by file vecs, so it is transferred
+	synchronously through a bounce buffer instead.
+*/
+static status_t
+inline_io(fs_volume* _volume, fs_vnode* _node, io_request* request)
+{
+	off_t offset = io_request_offset(request);
+	size_t length = io_request_length(request);
+
+	void* buffer = malloc(length);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+
+	MemoryDeleter bufferDeleter(buffer);
+	iovec vec = { buffer, length };
+
+	if (io_request_is_write(request)) {
+		status_t status = read_from_io_request(request, buffer, length);
+		if (status == B_OK) {
+			// this falls back to the data stream if the inode has lost its
+			// inline data in the mean time
+			status = bfs_write_pages(_volume, _node, NULL, offset, &vec, 1,
+				&length);
+		}
+		return status;
+	}
+
+	status_t status = bfs_read_pages(_volume, _node, NULL, offset, &vec, 1,
+		&length);
+	if (status == B_OK)
+		status = write_to_io_request(request, buffer, length);
+
+	return status;
+}
+#endif
+
+
 static status_t
 bfs_io(fs_volume* _volume, fs_vnode* _node, void* _cookie, io_request* request)
 {
@@ -520,6 +570,14 @@ bfs_io(fs_volume* _volume, fs_vnode* _node, void* _cookie, io_request* request)
 		RETURN_ERROR(B_BAD_VALUE);
 	}
 
+#ifndef FS_SHELL
+	if (inode->HasInlineData()) {
+		status_t status = inline_io(_volume, _node, request);
+		notify_io_request(request, status);
+		return status;
+	}
+#endif
+
 	// We lock the node here and will unlock it in the "finished" hook.
 	rw_lock_read_lock(&inode->Lock());
 
@@ -643,6 +701,17 @@ bfs_get_vnode_name(fs_volume* _volume, fs_vnode* _node, char* buffer,
 }
 
 
+/*!	Returns how much of a check_control the caller of the checking ioctls
+	knows about; older callers don't have the fields appended later.
+*/
+static inline size_t
+check_control_size(size_t bufferLength)
+{
+	return bufferLength >= sizeof(check_control)
+		? sizeof(check_control) : offsetof(check_control, file_extents);
+}
+
+
 static status_t
 bfs_ioctl(fs_volume* _volume, fs_vnode* _node, void* _cookie, uint32 cmd,
 	void* buffer, size_t bufferLength)
@@ -694,8 +763,9 @@ bfs_ioctl(fs_volume* _volume, fs_vnode* _node, void* _cookie, uint32 cmd,
 
 			CheckVisitor* checker = volume->CheckVisitor();
 
+			memset(&checker->Control(), 0, sizeof(check_control));
 			if (user_memcpy(&checker->Control(), buffer,
-					sizeof(check_control)) != B_OK) {
+					check_control_size(bufferLength)) != B_OK) {
 				return B_BAD_ADDRESS;
 			}
 
@@ -721,7 +791,7 @@ bfs_ioctl(fs_volume* _volume, fs_vnode* _node, void* _cookie, uint32 cmd,
 				cookie->open_mode &= ~BFS_OPEN_MODE_CHECKING;
 
 				status = user_memcpy(buffer, &checker->Control(),
-					sizeof(check_control));
+					check_control_size(bufferLength));
 			}
 
 			volume->DeleteCheckVisitor();
@@ -753,7 +823,7 @@ bfs_ioctl(fs_volume* _volume, fs_vnode* _node, void* _cookie, uint32 cmd,
 
 			if (status == B_OK) {
 				status = user_memcpy(buffer, &checker->Control(),
-					sizeof(check_control));
+					check_control_size(bufferLength));
 			}
 
 			return status;
@@ -793,6 +863,136 @@ bfs_ioctl(fs_volume* _volume, fs_vnode* _node, void* _cookie, uint32 cmd,
 			ResizeVisitor resizer(volume);
 			return resizer.Resize(size, -1);
 		}
+		case BFS_IOCTL_SET_INDEX_CACHE:
+		{
+			// the cache is kernel memory, only root may size it
+			if (geteuid() != 0)
+				return B_NOT_ALLOWED;
+			if (bufferLength != sizeof(uint64))
+				return B_BAD_VALUE;
+
+			uint64 size;
+			if (user_memcpy(&size, buffer, sizeof(uint64)) != B_OK)
+				return B_BAD_ADDRESS;
+			if (size > SIZE_MAX)
+				return B_BAD_VALUE;
+
+			return volume->IndexCache()->SetMaxSize(size);
+		}
+		case BFS_IOCTL_GET_INDEX_CACHE_INFO:
+		{
+			if (bufferLength != sizeof(index_cache_info))
+				return B_BAD_VALUE;
+
+			index_cache_info info;
+			volume->IndexCache()->GetInfo(info);
+
+			return user_memcpy(buffer, &info, sizeof(index_cache_info));
+		}
+		case BFS_IOCTL_EXPLAIN_QUERY:
+		{
+			explain_query_control control;
+			if (bufferLength != sizeof(explain_query_control))
+				return B_BAD_VALUE;
+			if (user_memcpy(&control, buffer, sizeof(control)) != B_OK)
+				return B_BAD_ADDRESS;
+			if (control.buffer_size == 0 || control.buffer_size > 65536)
+				return B_BAD_VALUE;
+
+			char* queryString = (char*)malloc(B_PAGE_SIZE);
+			char* explanation = (char*)malloc(control.buffer_size);
+			MemoryDeleter queryDeleter(queryString);
+			MemoryDeleter explanationDeleter(explanation);
+			if (queryString == NULL || explanation == NULL)
+				return B_NO_MEMORY;
+
+			ssize_t length = user_strlcpy(queryString, control.query,
+				B_PAGE_SIZE);
+			if (length < B_OK)
+				return B_BAD_ADDRESS;
+			if (length >= B_PAGE_SIZE)
+				return B_NAME_TOO_LONG;
+
+			Query* query;
+			status_t status = Query::Create(volume, queryString, 0, -1, 0,
+				query);
+			if (status != B_OK)
+				return status;
+
+			control.entries_found = 0;
+			if ((control.flags & BFS_EXPLAIN_RUN) != 0) {
+				union {
+					struct dirent dirent;
+					char buffer[sizeof(struct dirent) + B_FILE_NAME_LENGTH];
+				} entry;
+				while (query->GetNextEntry(&entry.dirent, sizeof(entry))
+						== B_OK) {
+					control.entries_found++;
+				}
+			}
+
+			status = query->Explain(explanation, control.buffer_size);
+			delete query;
+
+			if (user_memcpy(control.buffer, explanation,
+					strlen(explanation) + 1) != B_OK
+				|| user_memcpy(buffer, &control, sizeof(control)) != B_OK) {
+				return B_BAD_ADDRESS;
+			}
+			return status;
+		}
+		case BFS_IOCTL_COMPACT_TREE:
+		{
+			// rewrites most nodes of a tree, only root may do that
+			if (geteuid() != 0)
+				return B_NOT_ALLOWED;
+
+			compact_tree_control control;
+			if (bufferLength != sizeof(compact_tree_control))
+				return B_BAD_VALUE;
+			if (user_memcpy(&control, buffer, sizeof(control)) != B_OK)
+				return B_BAD_ADDRESS;
+			if (volume->IsReadOnly())
+				return B_READ_ONLY_DEVICE;
+
+			control.index[sizeof(control.index) - 1] = '\0';
+
+			Inode* inode = (Inode*)_node->private_node;
+			Index index(volume);
+			Inode* node = inode;
+			if (control.index[0] != '\0') {
+				status_t status = index.SetTo(control.index);
+				if (status != B_OK)
+					return status;
+
+				node = index.Node();
+			} else if (!inode->IsContainer())
+				return B_NOT_A_DIRECTORY;
+
+			BPlusTree* tree = node->Tree();
+			if (tree == NULL)
+				return B_BAD_VALUE;
+
+			off_t nodes, freeNodes;
+			status_t status = tree->CountNodes(control.levels_before, nodes,
+				freeNodes);
+			if (status != B_OK)
+				return status;
+			control.nodes_before = nodes;
+			control.free_nodes_before = freeNodes;
+
+			status = tree->Compact();
+			if (status != B_OK)
+				return status;
+
+			status = tree->CountNodes(control.levels_after, nodes, freeNodes);
+			if (status != B_OK)
+				return status;
+			control.nodes_after = nodes;
+			control.free_nodes_after = freeNodes;
+
+			return user_memcpy(buffer, &control, sizeof(control));
+		}
 
 #ifdef DEBUG_FRAGMENTER
 		case 56741:
@@ -853,8 +1053,16 @@ bfs_fsync(fs_volume* _volume, fs_vnode* _node, bool dataOnly)
 {
 	FUNCTION();
 
+	Volume* volume = (Volume*)_volume->private_volume;
 	Inode* inode = (Inode*)_node->private_node;
-	return inode->Sync();
+
+	status_t status = inode->Sync();
+	if (status != B_OK || dataOnly || volume->IsReadOnly())
+		return status;
+
+	// Make the metadata changes to the inode persistent as well; concurrent
+	// callers share a single log write.
+	return volume->GetJournal(inode->BlockNumber())->Commit();
 }
 
 
@@ -1031,6 +1239,9 @@ bfs_create(fs_volume* _volume, fs_vnode* _directory, const char* name,
 		// register the cookie
 		*_cookie = cookie;
 
+		if ((openMode & O_RWMASK) != O_RDONLY)
+			inode->AddWriter();
+
 		if (created) {
 			notify_entry_created(volume->ID(), directory->ID(), name,
 				*_vnodeID);
@@ -1387,6 +1598,9 @@ bfs_open(fs_volume* _volume, fs_vnode* _node, int openMode, void** _cookie)
 			return status;
 	}
 
+	if ((openMode & O_RWMASK) != O_RDONLY)
+		inode->AddWriter();
+
 	fileCacheEnabler.Detach();
 	cookieDeleter.Detach();
 	*_cookie = cookie;
@@ -1479,9 +1693,15 @@ bfs_free_cookie(fs_volume* _volume, fs_vnode* _node, void* _cookie)
 	Transaction transaction;
 	bool needsTrimming = false;
 
+	// Preallocated blocks are kept until the last writer is gone, so that
+	// files written to by several writers at once can continue to grow
+	// contiguously.
+	bool lastWriter = (cookie->open_mode & O_RWMASK) != 0
+		&& inode->RemoveWriter();
+
 	if (!volume->IsReadOnly() && !volume->IsCheckingThread()) {
 		InodeReadLocker locker(inode);
-		needsTrimming = inode->NeedsTrimming();
+		needsTrimming = lastWriter && inode->NeedsTrimming();
 
 		if ((cookie->open_mode & O_RWMASK) != 0
 			&& !inode->IsDeleted()
@@ -1757,6 +1977,167 @@ bfs_read_dir(fs_volume* _volume, fs_vnode* _node, void* _cookie,
 }
 
 
+#ifndef FS_SHELL
+struct dir_stat_slot {
+	dir_stat_entry*	entry;
+	ino_t			id;
+};
+
+
+static int
+compare_dir_stat_slots(const void* _a, const void* _b)
+{
+	const dir_stat_slot* a = (const dir_stat_slot*)_a;
+	const dir_stat_slot* b = (const dir_stat_slot*)_b;
+
+	if (a->id < b->id)
+		return -1;
+	if (a->id > b->id)
+		return 1;
+	return 0;
+}
+
+
+static void
+fill_dir_stat_entry(Volume* volume, dir_stat_entry* entry,
+	const char* const* attributes, size_t maxAttributeSize)
+{
+	Vnode vnode(volume, dir_stat_entry_dirent(entry)->d_ino);
+	Inode* inode;
+	status_t status = vnode.Get(&inode);
+	if (status != B_OK) {
+		entry->stat_status = status;
+		for (uint32 i = 0; i < entry->attribute_count; i++)
+			entry->attributes[i].size = status;
+		return;
+	}
+
+	fill_stat_buffer(inode, entry->stat);
+	entry->stat_status = B_OK;
+
+	for (uint32 i = 0; i < entry->attribute_count; i++) {
+		dir_stat_attr& info = entry->attributes[i];
+		Attribute attribute(inode);
+
+		status = attribute.CheckAccess(attributes[i], O_RDONLY);
+		if (status == B_OK)
+			status = attribute.Get(attributes[i]);
+
+		struct stat stat;
+		if (status == B_OK)
+			status = attribute.Stat(stat);
+		if (status == B_OK) {
+			attr_cookie cookie;
+			strlcpy(cookie.name, attributes[i], B_ATTR_NAME_LENGTH);
+
+			size_t length = min_c((off_t)maxAttributeSize, stat.st_size);
+			status = attribute.Read(&cookie, 0,
+				(uint8*)dir_stat_entry_attribute_data(entry, i), &length);
+		}
+
+		if (status == B_OK) {
+			info.type = stat.st_type;
+			info.size = stat.st_size;
+		} else
+			info.size = status;
+	}
+}
+
+
+/*!	Reads the next directory entries together with their stat data and
+	attributes. The entries are collected first, and their inodes are then
+	read sorted by block number, with the ones not yet in the block cache
+	being read ahead in runs; the entries stay in directory order.
+*/
+static status_t
+bfs_read_dir_stat(fs_volume* _volume, fs_vnode* _node, void* _cookie,
+	const char* const* attributes, uint32 attributeCount,
+	size_t maxAttributeSize, dir_stat_entry* buffer, size_t bufferSize,
+	uint32* _num)
+{
+	FUNCTION();
+
+	TreeIterator* iterator = (TreeIterator*)_cookie;
+	Volume* volume = (Volume*)_volume->private_volume;
+
+	size_t maxEntrySize = dir_stat_entry_size(attributeCount,
+		maxAttributeSize, B_FILE_NAME_LENGTH - 1);
+	if (bufferSize < maxEntrySize)
+		RETURN_ERROR(B_BUFFER_OVERFLOW);
+
+	uint32 maxCount = min_c(*_num, bufferSize
+		/ dir_stat_entry_size(attributeCount, maxAttributeSize, 1));
+	dir_stat_slot* slots = (dir_stat_slot*)malloc(
+		maxCount * sizeof(dir_stat_slot));
+	if (slots == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	MemoryDeleter slotsDeleter(slots);
+
+	char direntBuffer[offsetof(struct dirent, d_name) + B_FILE_NAME_LENGTH];
+	struct dirent* dirent = (struct dirent*)direntBuffer;
+	dirent->d_dev = volume->ID();
+
+	uint8* next = (uint8*)buffer;
+	size_t bytesLeft = bufferSize;
+	uint32 count = 0;
+
+	while (count < maxCount && bytesLeft >= maxEntrySize) {
+		uint16 length;
+		ino_t id;
+		status_t status = iterator->GetNextEntry(dirent->d_name, &length,
+			B_FILE_NAME_LENGTH, &id);
+		if (status == B_ENTRY_NOT_FOUND)
+			break;
+		if (status != B_OK) {
+			if (count > 0)
+				break;
+			RETURN_ERROR(status);
+		}
+
+		dirent->d_ino = id;
+
+		dir_stat_entry* entry = (dir_stat_entry*)next;
+		init_dir_stat_entry(entry, attributeCount, maxAttributeSize, dirent);
+
+		slots[count].entry = entry;
+		slots[count].id = id;
+		count++;
+
+		next += entry->length;
+		bytesLeft -= entry->length;
+	}
+
+	qsort(slots, count, sizeof(dir_stat_slot), &compare_dir_stat_slots);
+
+	// Inode IDs are block numbers; start reading consecutive inodes that are
+	// not cached yet in one go
+	for (uint32 i = 0; i < count;) {
+		uint32 run = 1;
+		while (i + run < count && slots[i + run].id == slots[i].id + run)
+			run++;
+
+		for (uint32 offset = 0; offset < run;) {
+			size_t numBlocks = run - offset;
+			if (block_cache_prefetch(volume->BlockCache(),
+					slots[i + offset].id, &numBlocks) != B_OK) {
+				break;
+			}
+			offset += max_c(numBlocks, (size_t)1);
+		}
+		i += run;
+	}
+
+	for (uint32 i = 0; i < count; i++) {
+		fill_dir_stat_entry(volume, slots[i].entry, attributes,
+			maxAttributeSize);
+	}
+
+	*_num = count;
+	return B_OK;
+}
+#endif	// !FS_SHELL
+
+
 /*!	Sets the TreeIterator back to the beginning of the directory. */
 static status_t
 bfs_rewind_dir(fs_volume* /*_volume*/, fs_vnode* /*node*/, void* _cookie)
@@ -2522,7 +2903,18 @@ fs_vnode_ops gBFSVnodeOps = {
 	&bfs_remove_attr,
 
 	/* special nodes */
-	&bfs_create_special_node
+	&bfs_create_special_node,
+	NULL,	// get_super_vnode
+
+#ifndef FS_SHELL
+	/* lock operations */
+	NULL,	// test_lock
+	NULL,	// acquire_lock
+	NULL,	// release_lock
+
+	/* batched directory reading */
+	&bfs_read_dir_stat
+#endif
 };
 
 static file_system_module_info sBeFileSystem = {
@@ -109,6 +109,12 @@ struct Query::QueryPolicy {
 		return index.index->KeyLength();
 	}
 
+	static status_t IndexEstimateCount(Index& index, int32 op,
+		const void* value, size_t size, bool prefix, int64* _count)
+	{
+		return B_UNSUPPORTED;
+	}
+
 	static IndexIterator* IndexCreateIterator(Index& index)
 	{
 		IndexIterator* iterator = new(std::nothrow) IndexIterator(index.index);
@@ -139,6 +145,12 @@ struct Query::QueryPolicy {
 		return B_OK;
 	}
 
+	static status_t IndexIteratorFindPattern(IndexIterator* indexIterator,
+		const char* pattern)
+	{
+		return B_UNSUPPORTED;
+	}
+
 	static status_t IndexIteratorFetchNextEntry(IndexIterator* indexIterator,
 		void* value, size_t* _valueLength, size_t bufferSize, size_t* duplicate)
 	{
@@ -157,6 +169,11 @@ struct Query::QueryPolicy {
 		return B_OK;
 	}
 
+	static ino_t IndexIteratorGetNodeID(IndexIterator* indexIterator)
+	{
+		return -1;
+	}
+
 	static void IndexIteratorSkipDuplicates(IndexIterator* indexIterator)
 	{
 		// Nothing to do.
@@ -231,6 +248,12 @@ struct Query::QueryPolicy {
 	{
 		return context->fVolume->ID();
 	}
+
+	static status_t ContextGetEntry(Context* context, ino_t id,
+		NodeHolder& holder, Entry** _entry)
+	{
+		return B_UNSUPPORTED;
+	}
 };
 
 
@@ -23,6 +23,7 @@
 
 #include "AttributeCookie.h"
 #include "AttributeDirectoryCookie.h"
+#include "ChunkCache.h"
 #include "DebugSupport.h"
 #include "Directory.h"
 #include "Query.h"
@@ -1159,9 +1160,19 @@ packagefs_std_ops(int32 op, ...)
 				create_object_cache("pkgfs TKAVLTreeNodes",
 					sizeof(TwoKeyAVLTreeNode<void*>), CACHE_NO_DEPOT);
 
+			error = ChunkCache::GlobalInit();
+			if (error != B_OK) {
+				ERROR("Failed to init ChunkCache\n");
+				StringConstants::Cleanup();
+				StringPool::Cleanup();
+				exit_debugging();
+				return error;
+			}
+
 			error = PackageFSRoot::GlobalInit();
 			if (error != B_OK) {
 				ERROR("Failed to init PackageFSRoot\n");
+				ChunkCache::GlobalUninit();
 				StringConstants::Cleanup();
 				StringPool::Cleanup();
 				exit_debugging();
@@ -1175,6 +1186,7 @@ packagefs_std_ops(int32 op, ...)
 		{
 			PRINT("package_std_ops(): B_MODULE_UNINIT\n");
 			PackageFSRoot::GlobalUninit();
+			ChunkCache::GlobalUninit();
 			delete_object_cache(TwoKeyAVLTreeNode<void*>::sNodeCache);
 			delete_object_cache((object_cache*)
 				PackageFileHeapAccessorBase::sQuadChunkCache);
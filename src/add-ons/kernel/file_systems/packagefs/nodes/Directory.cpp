@@ -12,9 +12,16 @@
 #include "Utils.h"
 
 
+// Most directories have only a few entries. Looking those up by iterating
+// the child list is cheap enough, so they don't get a hash table. This only
+// saves the smallest table (8 slots, 64 bytes on 64 bit) per directory.
+static const uint32 kMinHashedChildCount = 8;
+
+
 Directory::Directory(ino_t id)
 	:
-	Node(id)
+	Node(id),
+	fChildCount(0)
 {
 	rw_lock_init(&fLock, "packagefs directory");
 }
@@ -22,12 +29,10 @@ Directory::Directory(ino_t id)
 
 Directory::~Directory()
 {
-	Node* child = fChildTable.Clear(true);
-	while (child != NULL) {
-		Node* next = child->NameHashTableNext();
+	fChildTable.Clear();
+	while (Node* child = fChildList.RemoveHead()) {
 		child->_SetParent(NULL);
 		child->ReleaseReference();
-		child = next;
 	}
 
 	rw_lock_destroy(&fLock);
@@ -37,11 +42,7 @@ Directory::~Directory()
 status_t
 Directory::Init(const String& name)
 {
-	status_t error = Node::Init(name);
-	if (error != B_OK)
-		return error;
-
-	return fChildTable.Init();
+	return Node::Init(name);
 }
 
 
@@ -86,8 +87,13 @@ Directory::AddChild(Node* node)
 	ASSERT_WRITE_LOCKED_RW_LOCK(&fLock);
 	ASSERT(node->fParent == NULL);
 
-	fChildTable.Insert(node);
 	fChildList.Add(node);
+	fChildCount++;
+	if (fChildTable.TableSize() > 0)
+		fChildTable.Insert(node);
+	else if (fChildCount >= kMinHashedChildCount)
+		_CreateChildTable();
+
 	node->_SetParent(this);
 	node->AcquireReference();
 }
@@ -101,8 +107,10 @@ Directory::RemoveChild(Node* node)
 
 	Node* nextNode = fChildList.GetNext(node);
 
-	fChildTable.Remove(node);
+	if (fChildTable.TableSize() > 0)
+		fChildTable.Remove(node);
 	fChildList.Remove(node);
+	fChildCount--;
 	node->_SetParent(NULL);
 	node->ReleaseReference();
 
@@ -118,7 +126,16 @@ Directory::RemoveChild(Node* node)
 Node*
 Directory::FindChild(const StringKey& name)
 {
-	return fChildTable.Lookup(name);
+	if (fChildTable.TableSize() > 0)
+		return fChildTable.Lookup(name);
+
+	for (NodeList::Iterator it = fChildList.GetIterator();
+			Node* child = it.Next();) {
+		if (name == child->Name())
+			return child;
+	}
+
+	return NULL;
 }
 
 
@@ -136,3 +153,17 @@ Directory::RemoveDirectoryIterator(DirectoryIterator* iterator)
 	ASSERT_WRITE_LOCKED_RW_LOCK(&fLock);
 	fIterators.Remove(iterator);
 }
+
+
+void
+Directory::_CreateChildTable()
+{
+	if (fChildTable.Init(kMinHashedChildCount * 2) != B_OK)
+		return;
+			// lookups fall back to iterating the child list
+
+	for (NodeList::Iterator it = fChildList.GetIterator();
+			Node* child = it.Next();) {
+		fChildTable.Insert(child);
+	}
+}
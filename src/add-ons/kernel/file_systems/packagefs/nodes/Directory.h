@@ -58,13 +58,23 @@ public:
 			void				RemoveDirectoryIterator(
 									DirectoryIterator* iterator);
 
+			size_t				ChildTableMemoryUsage() const
+									{ return fChildTable.TableSize()
+										* sizeof(Node*); }
+									// 0, if the directory has no hash table
+
 protected:
 			rw_lock				fLock;
 
+private:
+			void				_CreateChildTable();
+
 private:
 			NodeNameHashTable	fChildTable;
+									// only used for larger directories
 			NodeList			fChildList;
 			DirectoryIteratorList fIterators;
+			uint32				fChildCount;
 };
 
 
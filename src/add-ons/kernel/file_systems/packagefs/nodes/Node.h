@@ -86,6 +86,10 @@ public:
 	virtual	void*				IndexCookieForAttribute(const StringKey& name)
 									const;
 
+	virtual	size_t				MemoryUsage() const = 0;
+									// of the object and the memory only it
+									// owns, in bytes
+
 private:
 			friend class Directory;
 
@@ -226,6 +226,13 @@ UnpackingDirectory::IndexCookieForAttribute(const StringKey& name) const
 }
 
 
+size_t
+UnpackingDirectory::MemoryUsage() const
+{
+	return sizeof(*this) + ChildTableMemoryUsage();
+}
+
+
 // #pragma mark - RootDirectory
 
 
@@ -269,3 +276,10 @@ RootDirectory::ModifiedTime() const
 {
 	return fModifiedTime;
 }
+
+
+size_t
+RootDirectory::MemoryUsage() const
+{
+	return sizeof(*this) + ChildTableMemoryUsage();
+}
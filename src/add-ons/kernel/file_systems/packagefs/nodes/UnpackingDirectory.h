@@ -51,6 +51,8 @@ public:
 	virtual	void*				IndexCookieForAttribute(const StringKey& name)
 									const;
 
+	virtual	size_t				MemoryUsage() const;
+
 private:
 			PackageDirectoryList fPackageDirectories;
 };
@@ -69,6 +71,8 @@ public:
 
 	virtual	timespec			ModifiedTime() const;
 
+	virtual	size_t				MemoryUsage() const;
+
 private:
 			timespec			fModifiedTime;
 };
@@ -330,6 +330,13 @@ UnpackingLeafNode::IndexCookieForAttribute(const StringKey& name) const
 }
 
 
+size_t
+UnpackingLeafNode::MemoryUsage() const
+{
+	return sizeof(*this);
+}
+
+
 PackageLeafNode*
 UnpackingLeafNode::_ActivePackageNode() const
 {
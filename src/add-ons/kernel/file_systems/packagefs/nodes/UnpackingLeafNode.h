@@ -60,6 +60,8 @@ public:
 	virtual	void*				IndexCookieForAttribute(const StringKey& name)
 									const;
 
+	virtual	size_t				MemoryUsage() const;
+
 private:
 	inline	PackageLeafNode*	_ActivePackageNode() const;
 
@@ -14,6 +14,7 @@
 #include <vm/VMCache.h>
 #include <vm/vm_page.h>
 
+#include "ChunkCache.h"
 #include "DebugSupport.h"
 
 
@@ -82,7 +83,8 @@ CachedDataReader::CachedDataReader()
 	:
 	fReader(NULL),
 	fCache(NULL),
-	fCacheLineLockers()
+	fCacheLineLockers(),
+	fLastMissedCacheLine(-1)
 {
 	mutex_init(&fLock, "packagefs cached reader");
 }
@@ -90,6 +92,8 @@ CachedDataReader::CachedDataReader()
 
 CachedDataReader::~CachedDataReader()
 {
+	Uninit();
+
 	if (fCache != NULL) {
 		fCache->Lock();
 		fCache->ReleaseRefAndUnlock();
@@ -118,6 +122,51 @@ CachedDataReader::Init(BAbstractBufferedDataReader* reader, off_t size)
 }
 
 
+/*!	Drops the chunks of this reader from the chunk cache and waits for pending
+	prefetches. Must be called before the underlying reader is deleted.
+*/
+void
+CachedDataReader::Uninit()
+{
+	if (ChunkCache* chunkCache = ChunkCache::Default())
+		chunkCache->RemoveReader(this);
+}
+
+
+/*!	Reads and decompresses the complete given cache line, bypassing all
+	caches. Used by the chunk cache's prefetcher.
+	\a buffer must be at least kCacheLineSize bytes large.
+*/
+status_t
+CachedDataReader::ReadChunk(uint32 chunkIndex, void* buffer, size_t& _size)
+{
+	off_t lineOffset = (off_t)chunkIndex * kCacheLineSize;
+	if (lineOffset >= fCache->virtual_end)
+		return B_BAD_VALUE;
+
+	size_t lineSize = std::min((off_t)kCacheLineSize,
+		fCache->virtual_end - lineOffset);
+	BMemoryIO output(buffer, lineSize);
+	status_t error = fReader->ReadDataToOutput(lineOffset, lineSize, &output);
+	if (error != B_OK)
+		return error;
+
+	_size = lineSize;
+	return B_OK;
+}
+
+
+/*!	Returns whether the first page of the given cache line is in the page
+	cache, in which case the rest of it most likely is, too.
+*/
+bool
+CachedDataReader::HasCachedChunk(uint32 chunkIndex)
+{
+	AutoLocker<VMCache> cacheLocker(fCache);
+	return fCache->LookupPage((off_t)chunkIndex * kCacheLineSize) != NULL;
+}
+
+
 status_t
 CachedDataReader::ReadDataToOutput(off_t offset, size_t size,
 	BDataIO* output)
@@ -256,6 +305,9 @@ CachedDataReader::_ReadCacheLine(off_t lineOffset, size_t lineSize,
 
 		cacheLocker.Unlock();
 
+		// a sequential reader will want the following cache lines soon
+		_Prefetch(lineOffset);
+
 		// read in the missing pages
 		status_t error = _ReadIntoPages(pages, firstMissing - firstPageOffset,
 			missingPages);
@@ -406,7 +458,58 @@ CachedDataReader::_ReadIntoPages(vm_page** pages, size_t firstPage,
 			fCache->virtual_end)
 		- firstPageOffset;
 
-	return fReader->ReadDataToOutput(firstPageOffset, requestLength, &output);
+	// The pages all belong to the same cache line, i.e. heap chunk. Use the
+	// chunk cache to avoid decompressing the chunk again, if possible.
+	ChunkCache* chunkCache = ChunkCache::Default();
+	uint32 chunkIndex = uint32(firstPageOffset / kCacheLineSize);
+	size_t inChunkOffset = firstPageOffset % kCacheLineSize;
+
+	status_t error;
+	if (chunkCache->Read(this, chunkIndex, inChunkOffset, requestLength,
+			&output, error)) {
+		return error;
+	}
+
+	void* buffer = chunkCache->AllocateBuffer();
+	if (buffer == NULL)
+		return fReader->ReadDataToOutput(firstPageOffset, requestLength, &output);
+
+	size_t chunkSize;
+	error = ReadChunk(chunkIndex, buffer, chunkSize);
+	if (error == B_OK) {
+		error = output.WriteExactly((uint8*)buffer + inChunkOffset,
+			requestLength);
+	}
+
+	if (error != B_OK) {
+		chunkCache->FreeBuffer(buffer);
+		return error;
+	}
+
+	chunkCache->Insert(this, chunkIndex, buffer, chunkSize, false);
+	return B_OK;
+}
+
+
+/*!	Called when the cache line at \a lineOffset had to be read in. If the
+	previous cache line had been read in before, queues the following cache
+	lines for prefetching into the chunk cache.
+*/
+void
+CachedDataReader::_Prefetch(off_t lineOffset)
+{
+	int64 line = lineOffset / kCacheLineSize;
+	int64 lastLine = atomic_get_and_set64(&fLastMissedCacheLine, line);
+	if (lastLine != line - 1)
+		return;
+
+	int64 lineCount = (fCache->virtual_end + kCacheLineSize - 1)
+		/ kCacheLineSize;
+	ChunkCache* chunkCache = ChunkCache::Default();
+	for (int64 i = line + 1; i <= line + kPrefetchCacheLines && i < lineCount;
+			i++) {
+		chunkCache->Prefetch(this, (uint32)i);
+	}
 }
 
 
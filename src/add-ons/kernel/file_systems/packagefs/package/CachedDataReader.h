@@ -25,6 +25,11 @@ public:
 
 			status_t			Init(BAbstractBufferedDataReader* reader,
 									off_t size);
+			void				Uninit();
+
+			status_t			ReadChunk(uint32 chunkIndex, void* buffer,
+									size_t& _size);
+			bool				HasCachedChunk(uint32 chunkIndex);
 
 	virtual	status_t			ReadDataToOutput(off_t offset, size_t size,
 									BDataIO* output);
@@ -129,6 +134,7 @@ private:
 									size_t requestLength, BDataIO* output);
 			status_t			_ReadIntoPages(vm_page** pages,
 									size_t firstPage, size_t pageCount);
+			void				_Prefetch(off_t lineOffset);
 
 			void				_LockCacheLine(CacheLineLocker* lineLocker);
 			void				_UnlockCacheLine(CacheLineLocker* lineLocker);
@@ -137,12 +143,14 @@ private:
 			static const size_t kCacheLineSize = 64 * 1024;
 			static const size_t kPagesPerCacheLine
 				= kCacheLineSize / B_PAGE_SIZE;
+			static const uint32 kPrefetchCacheLines = 2;
 
 private:
 			mutex				fLock;
 			BAbstractBufferedDataReader* fReader;
 			VMCache*			fCache;
 			LockerTable			fCacheLineLockers;
+			int64				fLastMissedCacheLine;
 };
 
 
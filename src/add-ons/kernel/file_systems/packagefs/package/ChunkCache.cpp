@@ -0,0 +1,496 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "ChunkCache.h"
+
+#include <algorithm>
+#include <new>
+
+#include <DataIO.h>
+
+#include <package/hpkg/PackageFileHeapAccessorBase.h>
+#include <packagefs.h>
+
+#include <low_resource_manager.h>
+#include <util/AutoLock.h>
+#include <vm/vm_page.h>
+
+#include "CachedDataReader.h"
+#include "DebugSupport.h"
+
+
+using BPackageKit::BHPKG::BPrivate::PackageFileHeapAccessorBase;
+
+
+static const size_t kChunkSize = PackageFileHeapAccessorBase::kChunkSize;
+
+// bounds for the number of cached chunks, the actual maximum depends on the
+// amount of memory
+static const uint32 kMinCachedChunks = 16;
+static const uint32 kMaxCachedChunks = 256;
+
+
+struct ChunkCache::Entry : DoublyLinkedListLinkImpl<Entry> {
+	CachedDataReader*	reader;
+	uint32				chunkIndex;
+	size_t				size;
+	void*				data;
+	bool				prefetched;
+	Entry*				hashNext;
+};
+
+
+struct ChunkCache::EntryHashDefinition {
+	struct KeyType {
+		CachedDataReader*	reader;
+		uint32				chunkIndex;
+
+		KeyType(CachedDataReader* reader, uint32 chunkIndex)
+			:
+			reader(reader),
+			chunkIndex(chunkIndex)
+		{
+		}
+	};
+
+	typedef Entry ValueType;
+
+	size_t HashKey(const KeyType& key) const
+	{
+		return ((addr_t)key.reader >> 4) ^ (key.chunkIndex * 31);
+	}
+
+	size_t Hash(const Entry* value) const
+	{
+		return HashKey(KeyType(value->reader, value->chunkIndex));
+	}
+
+	bool Compare(const KeyType& key, const Entry* value) const
+	{
+		return value->reader == key.reader
+			&& value->chunkIndex == key.chunkIndex;
+	}
+
+	Entry*& GetLink(Entry* value) const
+	{
+		return value->hashNext;
+	}
+};
+
+
+struct ChunkCache::PrefetchRequest {
+	CachedDataReader*	reader;
+	uint32				chunkIndex;
+};
+
+
+ChunkCache* ChunkCache::sDefault = NULL;
+
+
+ChunkCache::ChunkCache()
+	:
+	fBufferCache(NULL),
+	fEntries(NULL),
+	fLRUList(),
+	fEntryCount(0),
+	fMaxEntryCount(0),
+	fPrefetchRequests(NULL),
+	fPrefetchRequestHead(0),
+	fPrefetchRequestCount(0),
+	fPrefetchingReader(NULL),
+	fPrefetcher(-1),
+	fTerminating(false),
+	fLookups(0),
+	fHits(0),
+	fPrefetches(0),
+	fPrefetchHits(0),
+	fEvictions(0)
+{
+	mutex_init(&fLock, "packagefs chunk cache");
+	fPrefetchCondition.Init(this, "packagefs chunk prefetch");
+	fPrefetchDoneCondition.Init(&fPrefetchingReader,
+		"packagefs chunk prefetch done");
+}
+
+
+ChunkCache::~ChunkCache()
+{
+	if (fPrefetcher >= 0) {
+		mutex_lock(&fLock);
+		fTerminating = true;
+		fPrefetchCondition.NotifyAll();
+		mutex_unlock(&fLock);
+
+		wait_for_thread(fPrefetcher, NULL);
+	}
+
+	unregister_low_resource_handler(&_LowMemoryHandler, this);
+
+	while (Entry* entry = fLRUList.Head())
+		_Remove(entry);
+
+	delete fEntries;
+	delete[] fPrefetchRequests;
+
+	if (fBufferCache != NULL)
+		delete_object_cache(fBufferCache);
+
+	mutex_destroy(&fLock);
+}
+
+
+/*static*/ status_t
+ChunkCache::GlobalInit()
+{
+	sDefault = new(std::nothrow) ChunkCache;
+	if (sDefault == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+
+	status_t error = sDefault->_Init();
+	if (error != B_OK) {
+		delete sDefault;
+		sDefault = NULL;
+		RETURN_ERROR(error);
+	}
+
+	return B_OK;
+}
+
+
+/*static*/ void
+ChunkCache::GlobalUninit()
+{
+	delete sDefault;
+	sDefault = NULL;
+}
+
+
+/*!	Writes \a size bytes at \a offset of the given chunk to \a output, if the
+	chunk is cached. Returns whether it was; \a _error is set to the result
+	of the write only in that case.
+*/
+bool
+ChunkCache::Read(CachedDataReader* reader, uint32 chunkIndex, size_t offset,
+	size_t size, BDataIO* output, status_t& _error)
+{
+	MutexLocker locker(fLock);
+
+	fLookups++;
+
+	Entry* entry = _Lookup(reader, chunkIndex);
+	if (entry == NULL || offset + size > entry->size)
+		return false;
+
+	fHits++;
+	if (entry->prefetched) {
+		fPrefetchHits++;
+		entry->prefetched = false;
+	}
+
+	fLRUList.Remove(entry);
+	fLRUList.Add(entry);
+
+	// Copying the data while holding the lock keeps the entry from going
+	// away. The output is a memory or page buffer, so this doesn't block.
+	_error = output->WriteExactly((uint8*)entry->data + offset, size);
+	return true;
+}
+
+
+/*!	Adds the decompressed chunk \a data of \a size bytes to the cache. \a data
+	must have been allocated with AllocateBuffer(); the cache takes over
+	ownership in any case.
+*/
+void
+ChunkCache::Insert(CachedDataReader* reader, uint32 chunkIndex, void* data,
+	size_t size, bool prefetched)
+{
+	// allocate the entry before locking, we must not wait for memory while
+	// holding the lock the low memory handler needs
+	Entry* entry = new(std::nothrow) Entry;
+	if (entry == NULL) {
+		FreeBuffer(data);
+		return;
+	}
+
+	MutexLocker locker(fLock);
+
+	if (_Lookup(reader, chunkIndex) != NULL) {
+		// someone else was faster
+		locker.Unlock();
+		delete entry;
+		FreeBuffer(data);
+		return;
+	}
+
+	entry->reader = reader;
+	entry->chunkIndex = chunkIndex;
+	entry->size = size;
+	entry->data = data;
+	entry->prefetched = prefetched;
+
+	if (fEntryCount >= fMaxEntryCount)
+		_Evict(fEntryCount - fMaxEntryCount + 1);
+
+	fEntries->InsertUnchecked(entry);
+	fLRUList.Add(entry);
+	fEntryCount++;
+}
+
+
+/*!	Returns a chunk sized buffer, or \c NULL, if the system is low on memory
+	and the chunk shouldn't be cached.
+*/
+void*
+ChunkCache::AllocateBuffer()
+{
+	if (low_resource_state(B_KERNEL_RESOURCE_PAGES | B_KERNEL_RESOURCE_MEMORY)
+			!= B_NO_LOW_RESOURCE) {
+		return NULL;
+	}
+
+	return object_cache_alloc(fBufferCache, CACHE_DONT_WAIT_FOR_MEMORY);
+}
+
+
+void
+ChunkCache::FreeBuffer(void* buffer)
+{
+	if (buffer != NULL)
+		object_cache_free(fBufferCache, buffer, 0);
+}
+
+
+/*!	Asks the prefetcher thread to decompress the given chunk into the cache.
+	Does nothing, if the chunk is cached already or too many requests are
+	pending.
+*/
+void
+ChunkCache::Prefetch(CachedDataReader* reader, uint32 chunkIndex)
+{
+	MutexLocker locker(fLock);
+
+	if (fTerminating || fPrefetchRequestCount == kMaxPrefetchRequests
+		|| _Lookup(reader, chunkIndex) != NULL) {
+		return;
+	}
+
+	for (uint32 i = 0; i < fPrefetchRequestCount; i++) {
+		const PrefetchRequest& request = fPrefetchRequests[
+			(fPrefetchRequestHead + i) % kMaxPrefetchRequests];
+		if (request.reader == reader && request.chunkIndex == chunkIndex)
+			return;
+	}
+
+	PrefetchRequest& request = fPrefetchRequests[
+		(fPrefetchRequestHead + fPrefetchRequestCount++)
+			% kMaxPrefetchRequests];
+	request.reader = reader;
+	request.chunkIndex = chunkIndex;
+
+	fPrefetchCondition.NotifyOne();
+}
+
+
+/*!	Removes all cached chunks and pending prefetch requests of \a reader and
+	waits for the prefetcher to be done with it. Must be called before the
+	reader goes away.
+*/
+void
+ChunkCache::RemoveReader(CachedDataReader* reader)
+{
+	MutexLocker locker(fLock);
+
+	// drop the pending requests
+	uint32 count = 0;
+	for (uint32 i = 0; i < fPrefetchRequestCount; i++) {
+		const PrefetchRequest& request = fPrefetchRequests[
+			(fPrefetchRequestHead + i) % kMaxPrefetchRequests];
+		if (request.reader == reader)
+			continue;
+
+		fPrefetchRequests[(fPrefetchRequestHead + count++)
+			% kMaxPrefetchRequests] = request;
+	}
+	fPrefetchRequestCount = count;
+
+	while (fPrefetchingReader == reader)
+		fPrefetchDoneCondition.Wait(&fLock);
+
+	// remove the cached chunks
+	for (EntryList::Iterator it = fLRUList.GetIterator();
+			Entry* entry = it.Next();) {
+		if (entry->reader == reader)
+			_Remove(entry);
+	}
+}
+
+
+void
+ChunkCache::GetInfo(PackageFSChunkCacheInfo& info)
+{
+	MutexLocker locker(fLock);
+
+	info.lookups = fLookups;
+	info.hits = fHits;
+	info.prefetches = fPrefetches;
+	info.prefetchHits = fPrefetchHits;
+	info.evictions = fEvictions;
+	info.chunkCount = fEntryCount;
+	info.maxChunkCount = fMaxEntryCount;
+	info.chunkSize = kChunkSize;
+}
+
+
+status_t
+ChunkCache::_Init()
+{
+	// use up to 1/256 of the memory
+	fMaxEntryCount = std::max(kMinCachedChunks, std::min(kMaxCachedChunks,
+		uint32(vm_page_num_pages() * B_PAGE_SIZE / 256 / kChunkSize)));
+
+	fBufferCache = create_object_cache("pkgfs chunk cache", kChunkSize, 0);
+	if (fBufferCache == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+
+	fEntries = new(std::nothrow) EntryTable;
+	if (fEntries == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+
+	status_t error = fEntries->Init(fMaxEntryCount);
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	fPrefetchRequests = new(std::nothrow) PrefetchRequest[
+		kMaxPrefetchRequests];
+	if (fPrefetchRequests == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+
+	error = register_low_resource_handler(&_LowMemoryHandler, this,
+		B_KERNEL_RESOURCE_PAGES | B_KERNEL_RESOURCE_MEMORY, 0);
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	fPrefetcher = spawn_kernel_thread(&_PrefetcherEntry,
+		"packagefs chunk prefetcher", B_NORMAL_PRIORITY, this);
+	if (fPrefetcher < 0)
+		RETURN_ERROR(fPrefetcher);
+
+	resume_thread(fPrefetcher);
+	return B_OK;
+}
+
+
+ChunkCache::Entry*
+ChunkCache::_Lookup(CachedDataReader* reader, uint32 chunkIndex) const
+{
+	return fEntries->Lookup(
+		EntryHashDefinition::KeyType(reader, chunkIndex));
+}
+
+
+void
+ChunkCache::_Remove(Entry* entry)
+{
+	fEntries->RemoveUnchecked(entry);
+	fLRUList.Remove(entry);
+	fEntryCount--;
+
+	FreeBuffer(entry->data);
+	delete entry;
+}
+
+
+void
+ChunkCache::_Evict(uint32 count)
+{
+	while (count-- > 0) {
+		Entry* entry = fLRUList.Head();
+		if (entry == NULL)
+			break;
+
+		_Remove(entry);
+		fEvictions++;
+	}
+}
+
+
+/*static*/ void
+ChunkCache::_LowMemoryHandler(void* data, uint32 resources, int32 level)
+{
+	ChunkCache* self = (ChunkCache*)data;
+	MutexLocker locker(self->fLock);
+
+	uint32 count;
+	switch (level) {
+		case B_LOW_RESOURCE_NOTE:
+			count = self->fEntryCount / 2;
+			break;
+		case B_LOW_RESOURCE_WARNING:
+			count = self->fEntryCount * 3 / 4;
+			break;
+		case B_LOW_RESOURCE_CRITICAL:
+		default:
+			count = self->fEntryCount;
+			break;
+	}
+
+	self->_Evict(count);
+}
+
+
+/*static*/ status_t
+ChunkCache::_PrefetcherEntry(void* data)
+{
+	((ChunkCache*)data)->_Prefetcher();
+	return B_OK;
+}
+
+
+void
+ChunkCache::_Prefetcher()
+{
+	MutexLocker locker(fLock);
+
+	while (!fTerminating) {
+		if (fPrefetchRequestCount == 0) {
+			fPrefetchCondition.Wait(&fLock);
+			continue;
+		}
+
+		PrefetchRequest request = fPrefetchRequests[fPrefetchRequestHead];
+		fPrefetchRequestHead = (fPrefetchRequestHead + 1)
+			% kMaxPrefetchRequests;
+		fPrefetchRequestCount--;
+
+		if (_Lookup(request.reader, request.chunkIndex) != NULL)
+			continue;
+
+		// RemoveReader() waits for us while we're working for the reader
+		fPrefetchingReader = request.reader;
+		locker.Unlock();
+
+		if (!request.reader->HasCachedChunk(request.chunkIndex)) {
+			if (void* buffer = AllocateBuffer()) {
+				size_t size;
+				if (request.reader->ReadChunk(request.chunkIndex, buffer, size)
+						== B_OK) {
+					Insert(request.reader, request.chunkIndex, buffer, size,
+						true);
+
+					locker.Lock();
+					fPrefetches++;
+					locker.Unlock();
+				} else
+					FreeBuffer(buffer);
+			}
+		}
+
+		locker.Lock();
+		fPrefetchingReader = NULL;
+		fPrefetchDoneCondition.NotifyAll();
+	}
+}
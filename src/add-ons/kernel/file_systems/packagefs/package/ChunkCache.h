@@ -0,0 +1,109 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef CHUNK_CACHE_H
+#define CHUNK_CACHE_H
+
+
+#include <condition_variable.h>
+#include <lock.h>
+#include <slab/Slab.h>
+#include <util/DoublyLinkedList.h>
+#include <util/OpenHashTable.h>
+
+
+class BDataIO;
+class CachedDataReader;
+struct PackageFSChunkCacheInfo;
+
+
+/*!	A global, size bounded cache of decompressed package heap chunks, keyed
+	by the CachedDataReader of the package and the chunk index.
+	The page caches of the readers only hold the pages that have actually been
+	read and lose them page by page under memory pressure, so reading a
+	partially cached chunk again would mean decompressing it again. This
+	cache keeps recently decompressed chunks as a whole instead, and also
+	holds the chunks decompressed ahead of time by the prefetcher thread for
+	sequential readers. It shrinks when the system runs low on memory.
+*/
+class ChunkCache {
+public:
+	static	status_t			GlobalInit();
+	static	void				GlobalUninit();
+
+	static	ChunkCache*			Default()
+									{ return sDefault; }
+
+			bool				Read(CachedDataReader* reader,
+									uint32 chunkIndex, size_t offset,
+									size_t size, BDataIO* output,
+									status_t& _error);
+			void				Insert(CachedDataReader* reader,
+									uint32 chunkIndex, void* data,
+									size_t size, bool prefetched);
+
+			void*				AllocateBuffer();
+			void				FreeBuffer(void* buffer);
+
+			void				Prefetch(CachedDataReader* reader,
+									uint32 chunkIndex);
+			void				RemoveReader(CachedDataReader* reader);
+
+			void				GetInfo(PackageFSChunkCacheInfo& info);
+
+private:
+			struct Entry;
+			struct EntryHashDefinition;
+			struct PrefetchRequest;
+
+			typedef DoublyLinkedList<Entry> EntryList;
+			typedef BOpenHashTable<EntryHashDefinition> EntryTable;
+
+private:
+								ChunkCache();
+								~ChunkCache();
+
+			status_t			_Init();
+
+			Entry*				_Lookup(CachedDataReader* reader,
+									uint32 chunkIndex) const;
+			void				_Remove(Entry* entry);
+			void				_Evict(uint32 count);
+
+	static	void				_LowMemoryHandler(void* data,
+									uint32 resources, int32 level);
+
+	static	status_t			_PrefetcherEntry(void* data);
+			void				_Prefetcher();
+
+private:
+	static	const uint32		kMaxPrefetchRequests = 32;
+
+	static	ChunkCache*			sDefault;
+
+			mutex				fLock;
+			object_cache*		fBufferCache;
+			EntryTable*			fEntries;
+			EntryList			fLRUList;
+			uint32				fEntryCount;
+			uint32				fMaxEntryCount;
+
+			PrefetchRequest*	fPrefetchRequests;
+			uint32				fPrefetchRequestHead;
+			uint32				fPrefetchRequestCount;
+			CachedDataReader*	fPrefetchingReader;
+			thread_id			fPrefetcher;
+			ConditionVariable	fPrefetchCondition;
+			ConditionVariable	fPrefetchDoneCondition;
+			bool				fTerminating;
+
+			uint64				fLookups;
+			uint64				fHits;
+			uint64				fPrefetches;
+			uint64				fPrefetchHits;
+			uint64				fEvictions;
+};
+
+
+#endif	// CHUNK_CACHE_H
@@ -21,12 +21,15 @@
 #include <FdIO.h>
 #include <package/hpkg/PackageFileHeapReader.h>
 #include <package/hpkg/PackageReaderImpl.h>
+#include <package/packagefs.h>
 #include <util/AutoLock.h>
 
 #include "CachedDataReader.h"
 #include "DebugSupport.h"
+#include "MountIndex.h"
 #include "PackageDirectory.h"
 #include "PackageFile.h"
+#include "PackageNodeAttribute.h"
 #include "PackagesDirectory.h"
 #include "PackageSettings.h"
 #include "PackageSymlink.h"
@@ -402,6 +405,7 @@ public:
 
 	~HeapReaderV2()
 	{
+		CachedDataReader::Uninit();
 		delete fHeapReader;
 	}
 
@@ -567,9 +571,9 @@ Package::Init(const char* fileName)
 
 
 status_t
-Package::Load(const PackageSettings& settings)
+Package::Load(const PackageSettings& settings, MountIndex* mountIndex)
 {
-	status_t error = _Load(settings);
+	status_t error = _Load(settings, mountIndex);
 	if (error != B_OK)
 		return error;
 
@@ -638,6 +642,70 @@ Package::AddDependency(Dependency* dependency)
 }
 
 
+/*!	Computes the memory used by the package's node tree.
+	The nodes are immutable once loaded, so the caller only needs to make sure
+	the package isn't unloaded meanwhile.
+*/
+void
+Package::GetMemoryUsage(PackageFSPackageMemoryUsage& usage) const
+{
+	usage.nodeCount = 0;
+	usage.attributeCount = 0;
+	usage.size = sizeof(Package);
+
+	for (ResolvableList::ConstIterator it = fResolvables.GetIterator();
+			it.HasNext(); it.Next()) {
+		usage.size += sizeof(Resolvable);
+	}
+	for (DependencyList::ConstIterator it = fDependencies.GetIterator();
+			it.HasNext(); it.Next()) {
+		usage.size += sizeof(Dependency);
+	}
+
+	for (PackageNodeList::ConstIterator it = fNodes.GetIterator();
+			PackageNode* topNode = it.Next();) {
+		// walk the subtree without recursion
+		PackageNode* node = topNode;
+		while (true) {
+			usage.nodeCount++;
+			if (S_ISDIR(node->Mode()))
+				usage.size += sizeof(PackageDirectory);
+			else if (S_ISLNK(node->Mode()))
+				usage.size += sizeof(PackageSymlink);
+			else
+				usage.size += sizeof(PackageFile);
+
+			for (PackageNodeAttributeList::ConstIterator attributeIt
+					= node->Attributes().GetIterator(); attributeIt.HasNext();
+					attributeIt.Next()) {
+				usage.attributeCount++;
+				usage.size += sizeof(PackageNodeAttribute);
+			}
+
+			PackageDirectory* directory = dynamic_cast<PackageDirectory*>(node);
+			if (directory != NULL && directory->FirstChild() != NULL) {
+				node = directory->FirstChild();
+				continue;
+			}
+
+			// continue with the next sibling of the node or its ancestors
+			while (node != topNode) {
+				PackageDirectory* parent = node->Parent();
+				PackageNode* next = parent->NextChild(node);
+				node = parent;
+				if (next != NULL) {
+					node = next;
+					break;
+				}
+			}
+
+			if (node == topNode)
+				break;
+		}
+	}
+}
+
+
 int
 Package::Open()
 {
@@ -712,7 +780,7 @@ Package::CreateDataReader(const PackageData& data,
 
 
 status_t
-Package::_Load(const PackageSettings& settings)
+Package::_Load(const PackageSettings& settings, MountIndex* mountIndex)
 {
 	// open package file
 	int fd = Open();
@@ -729,15 +797,30 @@ Package::_Load(const PackageSettings& settings)
 		status_t error = packageReader.Init(fd, false,
 			BHPKG::B_HPKG_READER_DONT_PRINT_VERSION_MISMATCH_MESSAGE);
 		if (error == B_OK) {
-			// parse content
-			LoaderContentHandler handler(this, settings);
-			error = handler.Init();
-			if (error != B_OK)
-				RETURN_ERROR(error);
+			// restore the content from the mount index, if it knows the
+			// package file
+			error = B_ENTRY_NOT_FOUND;
+			if (mountIndex != NULL) {
+				struct stat st;
+				if (fstat(fd, &st) == 0)
+					error = mountIndex->RestorePackage(this, st, settings);
+				if (error == B_NO_MEMORY)
+					RETURN_ERROR(error);
+				if (error != B_OK)
+					_UnloadContent();
+			}
 
-			error = packageReader.ParseContent(&handler);
-			if (error != B_OK)
-				RETURN_ERROR(error);
+			if (error != B_OK) {
+				// parse content
+				LoaderContentHandler handler(this, settings);
+				error = handler.Init();
+				if (error != B_OK)
+					RETURN_ERROR(error);
+
+				error = packageReader.ParseContent(&handler);
+				if (error != B_OK)
+					RETURN_ERROR(error);
+			}
 
 			// get the heap reader
 			fHeapReader = packageReader.DetachCachedHeapReader();
@@ -753,6 +836,26 @@ Package::_Load(const PackageSettings& settings)
 }
 
 
+void
+Package::_UnloadContent()
+{
+	while (PackageNode* node = fNodes.RemoveHead())
+		node->ReleaseReference();
+
+	while (Resolvable* resolvable = fResolvables.RemoveHead())
+		delete resolvable;
+
+	while (Dependency* dependency = fDependencies.RemoveHead())
+		delete dependency;
+
+	SetVersion(NULL);
+	fName = String();
+	fInstallPath = String();
+	fFlags = 0;
+	fArchitecture = B_PACKAGE_ARCHITECTURE_ENUM_COUNT;
+}
+
+
 bool
 Package::_InitVersionedName()
 {
@@ -28,11 +28,13 @@ using BPackageKit::BPackageArchitecture;
 using BPackageKit::BHPKG::BAbstractBufferedDataReader;
 
 
+class MountIndex;
 class PackageLinkDirectory;
 class PackagesDirectory;
 class PackageSettings;
 class Volume;
 class Version;
+struct PackageFSPackageMemoryUsage;
 
 
 class Package : public BWeakReferenceable,
@@ -44,7 +46,8 @@ public:
 								~Package();
 
 			status_t			Init(const char* fileName);
-			status_t			Load(const PackageSettings& settings);
+			status_t			Load(const PackageSettings& settings,
+									MountIndex* mountIndex);
 
 			::Volume*			Volume() const		{ return fVolume; }
 			const String&		FileName() const	{ return fFileName; }
@@ -101,6 +104,9 @@ public:
 			status_t			CreateDataReader(const PackageData& data,
 									BAbstractBufferedDataReader*& _reader);
 
+			void				GetMemoryUsage(
+									PackageFSPackageMemoryUsage& usage) const;
+
 			const PackageNodeList& Nodes() const	{ return fNodes; }
 			const ResolvableList& Resolvables() const
 									{ return fResolvables; }
@@ -117,7 +123,9 @@ private:
 			struct CachingPackageReader;
 
 private:
-			status_t			_Load(const PackageSettings& settings);
+			status_t			_Load(const PackageSettings& settings,
+									MountIndex* mountIndex);
+			void				_UnloadContent();
 			bool				_InitVersionedName();
 
 private:
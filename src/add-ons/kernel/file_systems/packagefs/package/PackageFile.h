@@ -24,6 +24,8 @@ public:
 
 	virtual	off_t				FileSize() const;
 
+			const PackageData&	Data() const	{ return fData; }
+
 	virtual	status_t			Read(off_t offset, void* buffer,
 									size_t* bufferSize);
 	virtual	status_t			Read(io_request* request);
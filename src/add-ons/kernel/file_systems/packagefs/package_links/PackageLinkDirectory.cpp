@@ -160,6 +160,13 @@ PackageLinkDirectory::UpdatePackageDependencies(Package* package,
 }
 
 
+size_t
+PackageLinkDirectory::MemoryUsage() const
+{
+	return sizeof(*this) + ChildTableMemoryUsage();
+}
+
+
 status_t
 PackageLinkDirectory::_Update(PackageLinksListener* listener)
 {
@@ -36,6 +36,8 @@ public:
 			void				UpdatePackageDependencies(Package* package,
 									PackageLinksListener* listener);
 
+	virtual	size_t				MemoryUsage() const;
+
 			bool				IsEmpty() const
 									{ return fPackages.IsEmpty(); }
 
@@ -49,6 +51,11 @@ private:
 				{
 				}
 
+				virtual size_t MemoryUsage() const
+				{
+					return sizeof(*this);
+				}
+
 				DoublyLinkedListLink<DependencyLink> fPackageLinkDirectoryLink;
 			};
 
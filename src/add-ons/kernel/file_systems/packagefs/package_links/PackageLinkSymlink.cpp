@@ -192,3 +192,11 @@ PackageLinkSymlink::OpenAttribute(const StringKey& name, int openMode,
 
 	return AutoPackageAttributes::OpenCookie(fPackage, name, openMode, _cookie);
 }
+
+
+size_t
+PackageLinkSymlink::MemoryUsage() const
+{
+	// the link path is either a constant or belongs to the package
+	return sizeof(*this);
+}
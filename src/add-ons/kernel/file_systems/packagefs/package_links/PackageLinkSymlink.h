@@ -47,6 +47,8 @@ public:
 	virtual	status_t			OpenAttribute(const StringKey& name,
 									int openMode, AttributeCookie*& _cookie);
 
+	virtual	size_t				MemoryUsage() const;
+
 private:
 			struct OldAttributes;
 
@@ -118,3 +118,10 @@ PackageLinksDirectory::UpdatePackageDependencies(Package* package)
 	linkDirectory->UpdatePackageDependencies(package, fListener);
 }
 
+
+size_t
+PackageLinksDirectory::MemoryUsage() const
+{
+	return sizeof(*this) + ChildTableMemoryUsage();
+}
+
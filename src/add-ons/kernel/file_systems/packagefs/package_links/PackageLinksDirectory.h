@@ -27,6 +27,8 @@ public:
 			void				RemovePackage(Package* package);
 			void				UpdatePackageDependencies(Package* package);
 
+	virtual	size_t				MemoryUsage() const;
+
 private:
 			timespec			fModifiedTime;
 			PackageLinksListener* fListener;
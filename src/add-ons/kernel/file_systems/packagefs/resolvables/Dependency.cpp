@@ -65,7 +65,7 @@ Dependency::Init(const char* name)
 
 void
 Dependency::SetVersionRequirement(BPackageResolvableOperator op,
-	Version* version)
+	::Version* version)
 {
 	fVersionOperator = op;
 	fVersion = version;
@@ -73,7 +73,7 @@ Dependency::SetVersionRequirement(BPackageResolvableOperator op,
 
 
 bool
-Dependency::ResolvableVersionMatches(Version* resolvableVersion) const
+Dependency::ResolvableVersionMatches(::Version* resolvableVersion) const
 {
 	if (fVersion == NULL)
 		return true;
@@ -84,7 +84,8 @@ Dependency::ResolvableVersionMatches(Version* resolvableVersion) const
 
 
 bool
-Dependency::ResolvableCompatibleVersionMatches(Version* resolvableVersion) const
+Dependency::ResolvableCompatibleVersionMatches(
+	::Version* resolvableVersion) const
 {
 	if (fVersion == NULL)
 		return true;
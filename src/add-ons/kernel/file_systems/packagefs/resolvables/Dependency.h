@@ -33,7 +33,7 @@ public:
 			status_t			Init(const char* name);
 			void				SetVersionRequirement(
 									BPackageResolvableOperator op,
-									Version* version);
+									::Version* version);
 									// version is optional; object takes over
 									// ownership
 
@@ -50,12 +50,15 @@ public:
 			::Resolvable*		Resolvable() const
 									{ return fResolvable; }
 			bool				ResolvableVersionMatches(
-									Version* resolvableVersion) const;
+									::Version* resolvableVersion) const;
 			bool				ResolvableCompatibleVersionMatches(
-									Version* resolvableVersion) const;
+									::Version* resolvableVersion) const;
 
 			const String&		Name() const		{ return fName; }
 			const String&		FileName() const	{ return fFileName; }
+			::Version*			Version() const		{ return fVersion; }
+			BPackageResolvableOperator VersionOperator() const
+									{ return fVersionOperator; }
 
 private:
 			::Package*			fPackage;
@@ -64,7 +67,7 @@ private:
 			String				fName;
 			String				fFileName;
 									// fName with ':' replaced by '~'
-			Version*			fVersion;
+			::Version*			fVersion;
 			BPackageResolvableOperator fVersionOperator;
 
 public:	// conceptually package private
@@ -0,0 +1,1091 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "MountIndex.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <new>
+
+#include <AutoDeleter.h>
+#include <AutoDeleterPosix.h>
+#include <PackagesDirectoryDefs.h>
+#include <syscalls.h>
+#include <util/Vector.h>
+
+#include "DebugSupport.h"
+#include "PackageDirectory.h"
+#include "PackageFile.h"
+#include "PackageSettings.h"
+#include "PackageSymlink.h"
+#include "PackagesDirectory.h"
+#include "Version.h"
+
+
+static const char* const kMountIndexFileName
+	= PACKAGES_DIRECTORY_MOUNT_INDEX_FILE;
+static const char* const kMountIndexTemporaryFileName
+	= PACKAGES_DIRECTORY_MOUNT_INDEX_FILE ".tmp";
+
+static const uint32 kMountIndexMagic = 'PfMi';
+static const uint32 kMountIndexVersion = 1;
+
+// sanity limit for the mount index file size
+static const size_t kMaxMountIndexSize = 64 * 1024 * 1024;
+
+
+struct mount_index_header {
+	uint32	magic;
+	uint32	version;
+	uint32	package_data_size;
+		// sizeof(PackageDataV2), which is stored verbatim
+	uint32	package_count;
+	uint64	data_size;
+		// of the package records following the header
+	uint32	checksum;
+		// of the package records
+	uint32	reserved;
+};
+
+
+static uint32
+compute_checksum(const uint8* data, size_t size)
+{
+	// FNV-1a
+	uint32 checksum = 2166136261U;
+	for (size_t i = 0; i < size; i++) {
+		checksum ^= data[i];
+		checksum *= 16777619U;
+	}
+	return checksum;
+}
+
+
+static inline const char*
+empty_to_null(const char* string)
+{
+	return string[0] != '\0' ? string : NULL;
+}
+
+
+/*!	Returns a newly allocated array with the elements of the given singly
+	linked list in reverse order. The lists of package nodes and attributes
+	are built by prepending the elements in TOC order, so writing them in
+	reverse and restoring them the same way yields the very same lists.
+*/
+template<typename Element>
+static Element**
+reversed_list_array(const SinglyLinkedList<Element>& list, uint32& _count)
+{
+	uint32 count = 0;
+	for (typename SinglyLinkedList<Element>::ConstIterator it
+			= list.GetIterator(); it.HasNext(); it.Next()) {
+		count++;
+	}
+
+	Element** array = (Element**)malloc(
+		sizeof(Element*) * std::max(count, (uint32)1));
+	if (array == NULL)
+		return NULL;
+
+	uint32 index = count;
+	for (typename SinglyLinkedList<Element>::ConstIterator it
+			= list.GetIterator(); Element* element = it.Next();) {
+		array[--index] = element;
+	}
+
+	_count = count;
+	return array;
+}
+
+
+// #pragma mark - Entry
+
+
+struct MountIndex::Entry {
+	Entry*			hashNext;
+	const char*		fileName;
+	ino_t			nodeID;
+	off_t			size;
+	timespec		modifiedTime;
+	timespec		creationTime;
+	const uint8*	data;
+	size_t			dataSize;
+	bool			restored;
+
+	bool Matches(const struct stat& st) const
+	{
+		return st.st_ino == nodeID && st.st_size == size
+			&& st.st_mtim.tv_sec == modifiedTime.tv_sec
+			&& st.st_mtim.tv_nsec == modifiedTime.tv_nsec
+			&& st.st_crtim.tv_sec == creationTime.tv_sec
+			&& st.st_crtim.tv_nsec == creationTime.tv_nsec;
+	}
+};
+
+
+struct MountIndex::EntryHashDefinition {
+	typedef const char*		KeyType;
+	typedef	Entry			ValueType;
+
+	size_t HashKey(const char* key) const
+	{
+		return hash_hash_string(key);
+	}
+
+	size_t Hash(const Entry* value) const
+	{
+		return HashKey(value->fileName);
+	}
+
+	bool Compare(const char* key, const Entry* value) const
+	{
+		return strcmp(value->fileName, key) == 0;
+	}
+
+	Entry*& GetLink(Entry* value) const
+	{
+		return value->hashNext;
+	}
+};
+
+
+// #pragma mark - Reader
+
+
+struct MountIndex::Reader {
+	Reader(const uint8* data, size_t size)
+		:
+		fData(data),
+		fRemaining(size)
+	{
+	}
+
+	bool Read(void* buffer, size_t size)
+	{
+		const uint8* data;
+		if (!ReadData(data, size))
+			return false;
+
+		memcpy(buffer, data, size);
+		return true;
+	}
+
+	template<typename Value>
+	bool ReadValue(Value& _value)
+	{
+		return Read(&_value, sizeof(_value));
+	}
+
+	bool ReadTime(timespec& _time)
+	{
+		int64 seconds;
+		int32 nanoSeconds;
+		if (!ReadValue(seconds) || !ReadValue(nanoSeconds))
+			return false;
+
+		_time.tv_sec = seconds;
+		_time.tv_nsec = nanoSeconds;
+		return true;
+	}
+
+	bool ReadData(const uint8*& _data, size_t size)
+	{
+		if (size > fRemaining)
+			return false;
+
+		_data = fData;
+		fData += size;
+		fRemaining -= size;
+		return true;
+	}
+
+	bool ReadString(const char*& _string)
+	{
+		// the strings are stored with their terminating null
+		uint32 length;
+		const uint8* data;
+		if (!ReadValue(length) || length >= fRemaining
+			|| fData[length] != '\0' || !ReadData(data, length + 1)) {
+			return false;
+		}
+
+		_string = (const char*)data;
+		return true;
+	}
+
+	size_t Remaining() const
+	{
+		return fRemaining;
+	}
+
+	bool IsAtEnd() const
+	{
+		return fRemaining == 0;
+	}
+
+private:
+	const uint8*	fData;
+	size_t			fRemaining;
+};
+
+
+// #pragma mark - Writer
+
+
+struct MountIndex::Writer {
+	Writer()
+		:
+		fData(NULL),
+		fSize(0),
+		fCapacity(0),
+		fError(B_OK)
+	{
+	}
+
+	~Writer()
+	{
+		free(fData);
+	}
+
+	status_t Status() const
+	{
+		return fError;
+	}
+
+	void SetError(status_t error)
+	{
+		if (fError == B_OK)
+			fError = error;
+	}
+
+	uint8* Data() const
+	{
+		return fData;
+	}
+
+	size_t Size() const
+	{
+		return fSize;
+	}
+
+	void Write(const void* buffer, size_t size)
+	{
+		if (fError != B_OK)
+			return;
+
+		if (fSize + size > fCapacity) {
+			size_t capacity = std::max(std::max(fCapacity * 2, fSize + size),
+				(size_t)64 * 1024);
+			if (capacity > kMaxMountIndexSize) {
+				capacity = kMaxMountIndexSize;
+				if (fSize + size > capacity) {
+					SetError(B_BUFFER_OVERFLOW);
+					return;
+				}
+			}
+
+			uint8* data = (uint8*)realloc(fData, capacity);
+			if (data == NULL) {
+				SetError(B_NO_MEMORY);
+				return;
+			}
+
+			fData = data;
+			fCapacity = capacity;
+		}
+
+		memcpy(fData + fSize, buffer, size);
+		fSize += size;
+	}
+
+	void WriteAt(size_t offset, const void* buffer, size_t size)
+	{
+		if (fError == B_OK)
+			memcpy(fData + offset, buffer, size);
+	}
+
+	template<typename Value>
+	void WriteValue(const Value& value)
+	{
+		Write(&value, sizeof(value));
+	}
+
+	void WriteTime(const timespec& time)
+	{
+		WriteValue((int64)time.tv_sec);
+		WriteValue((int32)time.tv_nsec);
+	}
+
+	void WriteString(const char* string)
+	{
+		uint32 length = strlen(string);
+		WriteValue(length);
+		Write(string, length + 1);
+	}
+
+private:
+	uint8*		fData;
+	size_t		fSize;
+	size_t		fCapacity;
+	status_t	fError;
+};
+
+
+// #pragma mark - MountIndex
+
+
+MountIndex::MountIndex()
+	:
+	fData(NULL),
+	fEntries(NULL),
+	fEntryCount(0),
+	fRestoredCount(0)
+{
+}
+
+
+MountIndex::~MountIndex()
+{
+	_Unset();
+}
+
+
+/*!	Reads the mount index from the given administrative directory.
+	Fails with \c B_ENTRY_NOT_FOUND, if there is none yet, and with
+	\c B_MISMATCHED_VALUES, if it has been written by an incompatible
+	packagefs.
+*/
+status_t
+MountIndex::Load(int directoryFD)
+{
+	_Unset();
+
+	FileDescriptorCloser fd(openat(directoryFD, kMountIndexFileName,
+		O_RDONLY));
+	if (!fd.IsSet())
+		return errno;
+
+	struct stat st;
+	if (fstat(fd.Get(), &st) != 0)
+		RETURN_ERROR(errno);
+
+	if (st.st_size < (off_t)sizeof(mount_index_header)
+		|| st.st_size > (off_t)kMaxMountIndexSize) {
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	// read the whole file into memory, the entries refer to it directly
+	uint8* data = (uint8*)malloc(st.st_size);
+	if (data == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	MemoryDeleter dataDeleter(data);
+
+	ssize_t bytesRead = read(fd.Get(), data, st.st_size);
+	if (bytesRead < 0)
+		RETURN_ERROR(errno);
+	if (bytesRead != st.st_size)
+		RETURN_ERROR(B_ERROR);
+
+	// check the header
+	mount_index_header header;
+	memcpy(&header, data, sizeof(header));
+	if (header.magic != kMountIndexMagic
+		|| header.version != kMountIndexVersion
+		|| header.package_data_size != sizeof(PackageDataV2)) {
+		RETURN_ERROR(B_MISMATCHED_VALUES);
+	}
+
+	if (header.data_size != (uint64)st.st_size - sizeof(header)
+		|| compute_checksum(data + sizeof(header), header.data_size)
+			!= header.checksum) {
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	fEntries = new(std::nothrow) EntryTable;
+	if (fEntries == NULL || fEntries->Init(header.package_count) != B_OK) {
+		_Unset();
+		RETURN_ERROR(B_NO_MEMORY);
+	}
+
+	fData = (uint8*)dataDeleter.Detach();
+
+	// index the package records
+	Reader reader(fData + sizeof(header), header.data_size);
+	for (uint32 i = 0; i < header.package_count; i++) {
+		uint32 recordSize;
+		const uint8* record;
+		if (!reader.ReadValue(recordSize)
+			|| !reader.ReadData(record, recordSize)) {
+			_Unset();
+			RETURN_ERROR(B_BAD_DATA);
+		}
+
+		Entry* entry = new(std::nothrow) Entry;
+		if (entry == NULL) {
+			_Unset();
+			RETURN_ERROR(B_NO_MEMORY);
+		}
+
+		Reader recordReader(record, recordSize);
+		int64 nodeID;
+		int64 size;
+		if (!recordReader.ReadValue(nodeID)
+			|| !recordReader.ReadValue(size)
+			|| !recordReader.ReadTime(entry->modifiedTime)
+			|| !recordReader.ReadTime(entry->creationTime)
+			|| !recordReader.ReadString(entry->fileName)
+			|| fEntries->Lookup(entry->fileName) != NULL) {
+			delete entry;
+			_Unset();
+			RETURN_ERROR(B_BAD_DATA);
+		}
+
+		entry->nodeID = nodeID;
+		entry->size = size;
+		entry->data = record + (recordSize - recordReader.Remaining());
+		entry->dataSize = recordReader.Remaining();
+		entry->restored = false;
+
+		fEntries->Insert(entry);
+		fEntryCount++;
+	}
+
+	if (!reader.IsAtEnd()) {
+		_Unset();
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	return B_OK;
+}
+
+
+/*!	Writes a new mount index for the given packages to the given
+	administrative directory, replacing the existing one atomically.
+*/
+status_t
+MountIndex::Store(int directoryFD, const PackageFileNameHashTable& packages,
+	const PackageSettings& settings) const
+{
+	Writer writer;
+
+	mount_index_header header;
+	memset(&header, 0, sizeof(header));
+	writer.WriteValue(header);
+
+	for (PackageFileNameHashTable::Iterator it = packages.GetIterator();
+			Package* package = it.Next();) {
+		if (!_IsEligible(package, settings))
+			continue;
+
+		// get the current identity of the package file
+		struct stat st;
+		if (fstatat(package->Directory()->DirectoryFD(), package->FileName(),
+				&st, 0) != 0
+			|| st.st_ino != package->NodeID()) {
+			continue;
+		}
+
+		_WritePackage(writer, package, st);
+		header.package_count++;
+	}
+
+	if (writer.Status() != B_OK)
+		RETURN_ERROR(writer.Status());
+
+	header.magic = kMountIndexMagic;
+	header.version = kMountIndexVersion;
+	header.package_data_size = sizeof(PackageDataV2);
+	header.data_size = writer.Size() - sizeof(header);
+	header.checksum = compute_checksum(writer.Data() + sizeof(header),
+		header.data_size);
+	writer.WriteAt(0, &header, sizeof(header));
+
+	// write a temporary file and move it over the old index
+	FileDescriptorCloser fd(openat(directoryFD, kMountIndexTemporaryFileName,
+		O_WRONLY | O_CREAT | O_TRUNC, 0644));
+	if (!fd.IsSet())
+		RETURN_ERROR(errno);
+
+	ssize_t bytesWritten = write(fd.Get(), writer.Data(), writer.Size());
+	status_t error = B_OK;
+	if (bytesWritten < 0)
+		error = errno;
+	else if ((size_t)bytesWritten != writer.Size())
+		error = B_ERROR;
+	fd.Unset();
+
+	if (error == B_OK) {
+		error = _kern_rename(directoryFD, kMountIndexTemporaryFileName,
+			directoryFD, kMountIndexFileName);
+	}
+
+	if (error != B_OK) {
+		unlinkat(directoryFD, kMountIndexTemporaryFileName, 0);
+		RETURN_ERROR(error);
+	}
+
+	return B_OK;
+}
+
+
+/*!	Recreates the content of the given package from its mount index entry.
+	Fails with \c B_ENTRY_NOT_FOUND, if there is no entry matching the package
+	file described by \a st. On any other error the package may have been
+	partially populated.
+*/
+status_t
+MountIndex::RestorePackage(Package* package, const struct stat& st,
+	const PackageSettings& settings)
+{
+	if (fEntries == NULL)
+		return B_ENTRY_NOT_FOUND;
+
+	Entry* entry = fEntries->Lookup(package->FileName());
+	if (entry == NULL || !entry->Matches(st))
+		return B_ENTRY_NOT_FOUND;
+
+	Reader reader(entry->data, entry->dataSize);
+
+	// name -- the nodes of packages with blocked entries have been filtered
+	// while parsing the TOC, so they are never restored
+	const char* nameString;
+	if (!reader.ReadString(nameString))
+		RETURN_ERROR(B_BAD_DATA);
+
+	String name;
+	if (!name.SetTo(nameString))
+		RETURN_ERROR(B_NO_MEMORY);
+
+	if (settings.PackageItemFor(name) != NULL)
+		return B_ENTRY_NOT_FOUND;
+
+	package->SetName(name);
+
+	// install path
+	const char* installPathString;
+	if (!reader.ReadString(installPathString))
+		RETURN_ERROR(B_BAD_DATA);
+
+	if (installPathString[0] != '\0') {
+		String installPath;
+		if (!installPath.SetTo(installPathString))
+			RETURN_ERROR(B_NO_MEMORY);
+		package->SetInstallPath(installPath);
+	}
+
+	// version
+	::Version* version;
+	status_t error = _ReadVersion(reader, version);
+	if (error != B_OK)
+		RETURN_ERROR(error);
+	if (version != NULL)
+		package->SetVersion(version);
+
+	// flags and architecture
+	uint32 flags;
+	uint32 architecture;
+	if (!reader.ReadValue(flags) || !reader.ReadValue(architecture)
+		|| architecture >= B_PACKAGE_ARCHITECTURE_ENUM_COUNT) {
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	package->SetFlags(flags);
+	package->SetArchitecture((BPackageArchitecture)architecture);
+
+	// resolvables
+	uint32 resolvableCount;
+	if (!reader.ReadValue(resolvableCount))
+		RETURN_ERROR(B_BAD_DATA);
+
+	for (uint32 i = 0; i < resolvableCount; i++) {
+		const char* resolvableName;
+		if (!reader.ReadString(resolvableName))
+			RETURN_ERROR(B_BAD_DATA);
+
+		::Version* version;
+		error = _ReadVersion(reader, version);
+		if (error != B_OK)
+			RETURN_ERROR(error);
+		ObjectDeleter< ::Version> versionDeleter(version);
+
+		::Version* compatibleVersion;
+		error = _ReadVersion(reader, compatibleVersion);
+		if (error != B_OK)
+			RETURN_ERROR(error);
+		ObjectDeleter< ::Version> compatibleVersionDeleter(compatibleVersion);
+
+		Resolvable* resolvable = new(std::nothrow) Resolvable(package);
+		if (resolvable == NULL)
+			RETURN_ERROR(B_NO_MEMORY);
+		ObjectDeleter<Resolvable> resolvableDeleter(resolvable);
+
+		error = resolvable->Init(resolvableName, versionDeleter.Detach(),
+			compatibleVersionDeleter.Detach());
+		if (error != B_OK)
+			RETURN_ERROR(error);
+
+		package->AddResolvable(resolvableDeleter.Detach());
+	}
+
+	// dependencies
+	uint32 dependencyCount;
+	if (!reader.ReadValue(dependencyCount))
+		RETURN_ERROR(B_BAD_DATA);
+
+	for (uint32 i = 0; i < dependencyCount; i++) {
+		const char* dependencyName;
+		uint32 op;
+		if (!reader.ReadString(dependencyName) || !reader.ReadValue(op))
+			RETURN_ERROR(B_BAD_DATA);
+
+		Dependency* dependency = new(std::nothrow) Dependency(package);
+		if (dependency == NULL)
+			RETURN_ERROR(B_NO_MEMORY);
+		ObjectDeleter<Dependency> dependencyDeleter(dependency);
+
+		error = dependency->Init(dependencyName);
+		if (error != B_OK)
+			RETURN_ERROR(error);
+
+		::Version* version;
+		error = _ReadVersion(reader, version);
+		if (error != B_OK)
+			RETURN_ERROR(error);
+
+		if (version != NULL) {
+			dependency->SetVersionRequirement((BPackageResolvableOperator)op,
+				version);
+		}
+
+		package->AddDependency(dependencyDeleter.Detach());
+	}
+
+	// nodes
+	error = _ReadNodes(reader, package);
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	if (!reader.IsAtEnd())
+		RETURN_ERROR(B_BAD_DATA);
+
+	if (!entry->restored) {
+		entry->restored = true;
+		fRestoredCount++;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Returns whether the index has an entry for each of the given packages
+	that it can be restored from and no others, i.e. whether writing it anew
+	would be pointless.
+*/
+bool
+MountIndex::IsUpToDate(const PackageFileNameHashTable& packages,
+	const PackageSettings& settings) const
+{
+	if (fEntries == NULL)
+		return false;
+
+	uint32 packageCount = 0;
+	for (PackageFileNameHashTable::Iterator it = packages.GetIterator();
+			Package* package = it.Next();) {
+		if (!_IsEligible(package, settings))
+			continue;
+
+		Entry* entry = fEntries->Lookup(package->FileName());
+		if (entry == NULL || !entry->restored
+			|| entry->nodeID != package->NodeID()) {
+			return false;
+		}
+
+		packageCount++;
+	}
+
+	return packageCount == fEntryCount;
+}
+
+
+void
+MountIndex::_Unset()
+{
+	if (fEntries != NULL) {
+		Entry* entry = fEntries->Clear(true);
+		while (entry != NULL) {
+			Entry* next = entry->hashNext;
+			delete entry;
+			entry = next;
+		}
+
+		delete fEntries;
+		fEntries = NULL;
+	}
+
+	free(fData);
+	fData = NULL;
+	fEntryCount = 0;
+	fRestoredCount = 0;
+}
+
+
+/*static*/ bool
+MountIndex::_IsEligible(Package* package, const PackageSettings& settings)
+{
+	return settings.PackageItemFor(package->Name()) == NULL;
+}
+
+
+/*static*/ status_t
+MountIndex::_ReadVersion(Reader& reader, ::Version*& _version)
+{
+	uint8 hasVersion;
+	if (!reader.ReadValue(hasVersion))
+		RETURN_ERROR(B_BAD_DATA);
+
+	if (!hasVersion) {
+		_version = NULL;
+		return B_OK;
+	}
+
+	const char* major;
+	const char* minor;
+	const char* micro;
+	const char* preRelease;
+	uint32 revision;
+	if (!reader.ReadString(major) || !reader.ReadString(minor)
+		|| !reader.ReadString(micro) || !reader.ReadString(preRelease)
+		|| !reader.ReadValue(revision)) {
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	return ::Version::Create(empty_to_null(major), empty_to_null(minor),
+		empty_to_null(micro), empty_to_null(preRelease), revision, _version);
+}
+
+
+/*!	Reads the node tree of the package. The tree is walked with an explicit
+	stack rather than recursively, since it may be nested arbitrarily deep
+	and we are running on a kernel stack.
+*/
+/*static*/ status_t
+MountIndex::_ReadNodes(Reader& reader, Package* package)
+{
+	struct Level {
+		PackageDirectory*	directory;
+		uint32				remaining;
+	};
+
+	Level root = { NULL, 0 };
+	if (!reader.ReadValue(root.remaining))
+		RETURN_ERROR(B_BAD_DATA);
+
+	Vector<Level> stack;
+	if (stack.PushBack(root) != B_OK)
+		RETURN_ERROR(B_NO_MEMORY);
+
+	while (!stack.IsEmpty()) {
+		Level& level = stack.ElementAt(stack.Count() - 1);
+		if (level.remaining == 0) {
+			stack.PopBack();
+			continue;
+		}
+		level.remaining--;
+
+		PackageDirectory* directory;
+		status_t error = _ReadNode(reader, package, level.directory,
+			directory);
+		if (error != B_OK)
+			RETURN_ERROR(error);
+
+		if (directory == NULL)
+			continue;
+
+		// descend into the directory -- it is referenced by its parent
+		Level child = { directory, 0 };
+		if (!reader.ReadValue(child.remaining))
+			RETURN_ERROR(B_BAD_DATA);
+		if (stack.PushBack(child) != B_OK)
+			RETURN_ERROR(B_NO_MEMORY);
+	}
+
+	return B_OK;
+}
+
+
+/*!	Reads a single node without its children and adds it to  parent, or to
+	the package, if \c NULL. If the node is a directory, it is returned in
+	 _directory, so that the caller can read its children next.
+*/
+/*static*/ status_t
+MountIndex::_ReadNode(Reader& reader, Package* package,
+	PackageDirectory* parent, PackageDirectory*& _directory)
+{
+	_directory = NULL;
+
+	uint32 mode;
+	timespec modifiedTime;
+	const char* nameString;
+	if (!reader.ReadValue(mode) || !reader.ReadTime(modifiedTime)
+		|| !reader.ReadString(nameString)) {
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	// create the package node
+	PackageNode* node;
+	PackageDirectory* directory = NULL;
+	if (S_ISREG(mode)) {
+		// file
+		PackageDataV2 data;
+		if (!reader.Read(&data, sizeof(data)))
+			RETURN_ERROR(B_BAD_DATA);
+
+		node = new PackageFile(package, mode, PackageData(data));
+	} else if (S_ISLNK(mode)) {
+		// symlink
+		const char* pathString;
+		if (!reader.ReadString(pathString))
+			RETURN_ERROR(B_BAD_DATA);
+
+		String path;
+		if (!path.SetTo(pathString))
+			RETURN_ERROR(B_NO_MEMORY);
+
+		PackageSymlink* symlink = new PackageSymlink(package, mode);
+		if (symlink == NULL)
+			RETURN_ERROR(B_NO_MEMORY);
+
+		symlink->SetSymlinkPath(path);
+		node = symlink;
+	} else if (S_ISDIR(mode)) {
+		// directory
+		node = directory = new PackageDirectory(package, mode);
+	} else
+		RETURN_ERROR(B_BAD_DATA);
+
+	if (node == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	BReference<PackageNode> nodeReference(node, true);
+
+	String name;
+	if (!name.SetTo(nameString))
+		RETURN_ERROR(B_NO_MEMORY);
+
+	status_t error = node->Init(parent, name);
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	node->SetModifiedTime(modifiedTime);
+
+	// attributes
+	uint32 attributeCount;
+	if (!reader.ReadValue(attributeCount))
+		RETURN_ERROR(B_BAD_DATA);
+
+	for (uint32 i = 0; i < attributeCount; i++) {
+		const char* attributeNameString;
+		uint32 type;
+		PackageDataV2 data;
+		if (!reader.ReadString(attributeNameString) || !reader.ReadValue(type)
+			|| !reader.Read(&data, sizeof(data))) {
+			RETURN_ERROR(B_BAD_DATA);
+		}
+
+		String attributeName;
+		if (!attributeName.SetTo(attributeNameString))
+			RETURN_ERROR(B_NO_MEMORY);
+
+		PackageNodeAttribute* attribute = new PackageNodeAttribute(type,
+			PackageData(data));
+		if (attribute == NULL)
+			RETURN_ERROR(B_NO_MEMORY);
+
+		attribute->Init(attributeName);
+		node->AddAttribute(attribute);
+	}
+
+	// add it to the parent directory
+	if (parent != NULL)
+		parent->AddChild(node);
+	else
+		package->AddNode(node);
+
+	_directory = directory;
+	return B_OK;
+}
+
+
+/*static*/ void
+MountIndex::_WritePackage(Writer& writer, Package* package,
+	const struct stat& st)
+{
+	size_t recordOffset = writer.Size();
+	uint32 recordSize = 0;
+	writer.WriteValue(recordSize);
+
+	// identity of the package file
+	writer.WriteValue((int64)st.st_ino);
+	writer.WriteValue((int64)st.st_size);
+	writer.WriteTime(st.st_mtim);
+	writer.WriteTime(st.st_crtim);
+	writer.WriteString(package->FileName());
+
+	// package attributes
+	writer.WriteString(package->Name());
+	writer.WriteString(package->InstallPath());
+	_WriteVersion(writer, package->Version());
+	writer.WriteValue((uint32)package->Flags());
+	writer.WriteValue((uint32)package->Architecture());
+
+	uint32 resolvableCount = 0;
+	for (ResolvableList::ConstIterator it
+			= package->Resolvables().GetIterator(); it.HasNext(); it.Next()) {
+		resolvableCount++;
+	}
+	writer.WriteValue(resolvableCount);
+
+	for (ResolvableList::ConstIterator it
+			= package->Resolvables().GetIterator();
+			Resolvable* resolvable = it.Next();) {
+		writer.WriteString(resolvable->Name());
+		_WriteVersion(writer, resolvable->Version());
+		_WriteVersion(writer, resolvable->CompatibleVersion());
+	}
+
+	uint32 dependencyCount = 0;
+	for (DependencyList::ConstIterator it
+			= package->Dependencies().GetIterator(); it.HasNext(); it.Next()) {
+		dependencyCount++;
+	}
+	writer.WriteValue(dependencyCount);
+
+	for (DependencyList::ConstIterator it
+			= package->Dependencies().GetIterator();
+			Dependency* dependency = it.Next();) {
+		writer.WriteString(dependency->Name());
+		writer.WriteValue((uint32)dependency->VersionOperator());
+		_WriteVersion(writer, dependency->Version());
+	}
+
+	// nodes
+	_WriteNodes(writer, package->Nodes());
+
+	if (writer.Status() == B_OK) {
+		recordSize = writer.Size() - recordOffset - sizeof(recordSize);
+		writer.WriteAt(recordOffset, &recordSize, sizeof(recordSize));
+	}
+}
+
+
+/*static*/ void
+MountIndex::_WriteVersion(Writer& writer, ::Version* version)
+{
+	writer.WriteValue((uint8)(version != NULL));
+	if (version == NULL)
+		return;
+
+	writer.WriteString(version->Major());
+	writer.WriteString(version->Minor());
+	writer.WriteString(version->Micro());
+	writer.WriteString(version->PreRelease());
+	writer.WriteValue(version->Revision());
+}
+
+
+/*!	Writes the given node tree, each node followed by its children. Like
+	_ReadNodes(), this doesn't recurse.
+*/
+/*static*/ void
+MountIndex::_WriteNodes(Writer& writer, const PackageNodeList& nodes)
+{
+	struct Level {
+		PackageNode**	nodes;
+		uint32			count;
+		uint32			index;
+	};
+
+	Vector<Level> stack;
+
+	Level root = { NULL, 0, 0 };
+	root.nodes = reversed_list_array(nodes, root.count);
+	if (root.nodes == NULL || stack.PushBack(root) != B_OK) {
+		free(root.nodes);
+		writer.SetError(B_NO_MEMORY);
+		return;
+	}
+	writer.WriteValue(root.count);
+
+	while (!stack.IsEmpty() && writer.Status() == B_OK) {
+		Level& level = stack.ElementAt(stack.Count() - 1);
+		if (level.index == level.count) {
+			free(level.nodes);
+			stack.PopBack();
+			continue;
+		}
+
+		PackageNode* node = level.nodes[level.index++];
+		_WriteNode(writer, node);
+
+		PackageDirectory* directory = dynamic_cast<PackageDirectory*>(node);
+		if (directory == NULL)
+			continue;
+
+		Level child = { NULL, 0, 0 };
+		child.nodes = reversed_list_array(directory->Children(), child.count);
+		if (child.nodes == NULL || stack.PushBack(child) != B_OK) {
+			free(child.nodes);
+			writer.SetError(B_NO_MEMORY);
+			break;
+		}
+		writer.WriteValue(child.count);
+	}
+
+	// clean up after an error
+	for (int32 i = 0; i < stack.Count(); i++)
+		free(stack.ElementAt(i).nodes);
+}
+
+
+/*!	Writes a single node without its children.
+*/
+/*static*/ void
+MountIndex::_WriteNode(Writer& writer, PackageNode* node)
+{
+	writer.WriteValue((uint32)node->Mode());
+	writer.WriteTime(node->ModifiedTime());
+	writer.WriteString(node->Name());
+
+	if (PackageFile* file = dynamic_cast<PackageFile*>(node)) {
+		const PackageDataV2& data = file->Data().DataV2();
+		writer.Write(&data, sizeof(data));
+	} else if (PackageSymlink* symlink = dynamic_cast<PackageSymlink*>(node))
+		writer.WriteString(symlink->SymlinkPath());
+
+	// attributes
+	uint32 attributeCount;
+	PackageNodeAttribute** attributes = reversed_list_array(
+		node->Attributes(), attributeCount);
+	if (attributes == NULL) {
+		writer.SetError(B_NO_MEMORY);
+		return;
+	}
+	MemoryDeleter attributesDeleter(attributes);
+
+	writer.WriteValue(attributeCount);
+	for (uint32 i = 0; i < attributeCount; i++) {
+		PackageNodeAttribute* attribute = attributes[i];
+		writer.WriteString(attribute->Name());
+		writer.WriteValue(attribute->Type());
+		const PackageDataV2& data = attribute->Data().DataV2();
+		writer.Write(&data, sizeof(data));
+	}
+}
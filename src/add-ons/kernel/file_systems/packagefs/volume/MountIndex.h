@@ -0,0 +1,89 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef MOUNT_INDEX_H
+#define MOUNT_INDEX_H
+
+
+#include <sys/stat.h>
+
+#include <util/OpenHashTable.h>
+
+#include "Package.h"
+
+
+class PackageSettings;
+
+
+/*!	A persistent snapshot of the contents of the packages of a volume, kept
+	in the administrative directory of its packages directory.
+	Parsing the TOCs of all packages dominates mounting a volume with many
+	packages. The index stores the package attributes and the package node
+	tree of each package as they were read from its TOC, so that the next
+	mount can recreate them without touching the TOC at all. Each entry is
+	validated against the identity of its package file (node ID, size,
+	modification and creation time), packages that don't match or have
+	blocked entries configured are parsed as usual.
+*/
+class MountIndex {
+public:
+								MountIndex();
+								~MountIndex();
+
+			status_t			Load(int directoryFD);
+			status_t			Store(int directoryFD,
+									const PackageFileNameHashTable& packages,
+									const PackageSettings& settings) const;
+
+			status_t			RestorePackage(Package* package,
+									const struct stat& st,
+									const PackageSettings& settings);
+
+			bool				IsUpToDate(
+									const PackageFileNameHashTable& packages,
+									const PackageSettings& settings) const;
+
+			uint32				CountEntries() const
+									{ return fEntryCount; }
+			uint32				CountRestoredPackages() const
+									{ return fRestoredCount; }
+
+private:
+			struct Entry;
+			struct EntryHashDefinition;
+			struct Reader;
+			struct Writer;
+
+			typedef BOpenHashTable<EntryHashDefinition> EntryTable;
+
+private:
+			void				_Unset();
+
+	static	bool				_IsEligible(Package* package,
+									const PackageSettings& settings);
+
+	static	status_t			_ReadVersion(Reader& reader,
+									::Version*& _version);
+	static	status_t			_ReadNodes(Reader& reader, Package* package);
+	static	status_t			_ReadNode(Reader& reader, Package* package,
+									PackageDirectory* parent,
+									PackageDirectory*& _directory);
+
+	static	void				_WritePackage(Writer& writer,
+									Package* package, const struct stat& st);
+	static	void				_WriteVersion(Writer& writer,
+									::Version* version);
+	static	void				_WriteNodes(Writer& writer,
+									const PackageNodeList& nodes);
+	static	void				_WriteNode(Writer& writer, PackageNode* node);
+
+private:
+			uint8*				fData;
+			EntryTable*			fEntries;
+			uint32				fEntryCount;
+			uint32				fRestoredCount;
+};
+
+
+#endif	// MOUNT_INDEX_H
@@ -29,9 +29,11 @@
 #include <vfs.h>
 
 #include "AttributeIndex.h"
+#include "ChunkCache.h"
 #include "DebugSupport.h"
 #include "kernel_interface.h"
 #include "LastModifiedIndex.h"
+#include "MountIndex.h"
 #include "NameIndex.h"
 #include "OldUnpackingNodeAttributes.h"
 #include "PackageFSRoot.h"
@@ -88,6 +90,11 @@ struct Volume::ShineThroughDirectory : public Directory {
 		return fModifiedTime;
 	}
 
+	virtual size_t MemoryUsage() const
+	{
+		return sizeof(*this) + ChildTableMemoryUsage();
+	}
+
 private:
 	timespec	fModifiedTime;
 };
@@ -173,6 +180,7 @@ Volume::Volume(fs_volume* fsVolume)
 	fPackagesDirectories(),
 	fPackagesDirectoriesByNodeRef(),
 	fPackageSettings(),
+	fMountIndex(NULL),
 	fNextNodeID(kRootDirectoryID + 1)
 {
 	rw_lock_init(&fLock, "packagefs volume");
@@ -560,6 +568,61 @@ Volume::IOCtl(Node* node, uint32 operation, void* buffer, size_t size)
 			return _ChangeActivation(request);
 		}
 
+		case PACKAGE_FS_OPERATION_GET_CHUNK_CACHE_INFO:
+		{
+			if (size < sizeof(PackageFSChunkCacheInfo))
+				RETURN_ERROR(B_BAD_VALUE);
+
+			PackageFSChunkCacheInfo info;
+			ChunkCache::Default()->GetInfo(info);
+
+			RETURN_ERROR(user_memcpy(buffer, &info, sizeof(info)));
+		}
+
+		case PACKAGE_FS_OPERATION_GET_MEMORY_USAGE:
+		{
+			if (size < sizeof(PackageFSGetMemoryUsageRequest))
+				RETURN_ERROR(B_BAD_VALUE);
+
+			PackageFSGetMemoryUsageRequest* request
+				= (PackageFSGetMemoryUsageRequest*)buffer;
+
+			VolumeReadLocker volumeReadLocker(this);
+
+			PackageFSGetMemoryUsageRequest header;
+			header.nodeCount = fNodes.CountElements();
+			header.nodeSize = 0;
+			for (NodeIDHashTable::Iterator it = fNodes.GetIterator();
+					Node* node = it.Next();) {
+				header.nodeSize += node->MemoryUsage();
+			}
+			header.nodeSize += fNodes.TableSize() * sizeof(Node*);
+			header.packageCount = fPackages.CountElements();
+
+			addr_t bufferEnd = (addr_t)buffer + size;
+			uint32 packageIndex = 0;
+			for (PackageFileNameHashTable::Iterator it
+					= fPackages.GetIterator(); it.HasNext();
+				packageIndex++) {
+				PackageFSPackageMemoryUsage* userUsage
+					= request->packages + packageIndex;
+				if (addr_t(userUsage + 1) > bufferEnd)
+					break;
+
+				Package* package = it.Next();
+				PackageFSPackageMemoryUsage usage;
+				usage.packageDeviceID = package->DeviceID();
+				usage.packageNodeID = package->NodeID();
+				package->GetMemoryUsage(usage);
+
+				if (user_memcpy(userUsage, &usage, sizeof(usage)) != B_OK)
+					return B_BAD_ADDRESS;
+			}
+
+			size_t headerSize = (char*)&request->packages - (char*)request;
+			RETURN_ERROR(user_memcpy(request, &header, headerSize));
+		}
+
 		default:
 			return B_BAD_VALUE;
 	}
@@ -755,6 +818,78 @@ Volume::_LoadOldPackagesStates(const char* packagesState)
 
 status_t
 Volume::_AddInitialPackages()
+{
+	bigtime_t startTime = system_time();
+
+	// Load the mount index, so that the packages it knows don't need to be
+	// parsed.
+	MountIndex mountIndex;
+	FileDescriptorCloser adminDirectoryFD(openat(
+		fPackagesDirectory->DirectoryFD(), kAdministrativeDirectoryName,
+		O_RDONLY));
+	if (adminDirectoryFD.IsSet()) {
+		status_t error = mountIndex.Load(adminDirectoryFD.Get());
+		if (error == B_OK)
+			fMountIndex = &mountIndex;
+		else if (error != B_ENTRY_NOT_FOUND) {
+			INFORM("Failed to load mount index, ignoring it: %s\n",
+				strerror(error));
+		}
+	}
+
+	status_t error = _LoadInitialPackages();
+	fMountIndex = NULL;
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	bigtime_t loadTime = system_time() - startTime;
+
+	// add the packages to the node tree
+	{
+		VolumeWriteLocker systemVolumeLocker(_SystemVolumeIfNotSelf());
+		VolumeWriteLocker volumeLocker(this);
+		for (PackageFileNameHashTable::Iterator it = fPackages.GetIterator();
+			Package* package = it.Next();) {
+			error = _AddPackageContent(package, false);
+			if (error != B_OK) {
+				for (it.Rewind(); Package* activePackage = it.Next();) {
+					if (activePackage == package)
+						break;
+					_RemovePackageContent(activePackage, NULL, false);
+				}
+				RETURN_ERROR(error);
+			}
+		}
+	}
+
+	bigtime_t addTime = system_time() - startTime - loadTime;
+
+	INFORM("Loaded %" B_PRIu32 " packages (%" B_PRIu32 " from the mount "
+		"index) in %" B_PRId64 " ms, added their content in %" B_PRId64
+		" ms\n", (uint32)fPackages.CountElements(),
+		mountIndex.CountRestoredPackages(), loadTime / 1000, addTime / 1000);
+
+	// write a new mount index, if the packages have changed
+	if (adminDirectoryFD.IsSet()
+		&& !mountIndex.IsUpToDate(fPackages, fPackageSettings)) {
+		VolumeReadLocker volumeLocker(this);
+		bigtime_t storeStartTime = system_time();
+		error = mountIndex.Store(adminDirectoryFD.Get(), fPackages,
+			fPackageSettings);
+		if (error != B_OK) {
+			INFORM("Failed to write mount index: %s\n", strerror(error));
+		} else {
+			INFORM("Wrote mount index in %" B_PRId64 " ms\n",
+				(system_time() - storeStartTime) / 1000);
+		}
+	}
+
+	return B_OK;
+}
+
+
+status_t
+Volume::_LoadInitialPackages()
 {
 	PackagesDirectory* packagesDirectory = fPackagesDirectories.Last();
 	INFORM("Adding packages from \"%s\"\n", packagesDirectory->Path());
@@ -798,22 +933,6 @@ Volume::_AddInitialPackages()
 			RETURN_ERROR(error);
 	}
 
-	// add the packages to the node tree
-	VolumeWriteLocker systemVolumeLocker(_SystemVolumeIfNotSelf());
-	VolumeWriteLocker volumeLocker(this);
-	for (PackageFileNameHashTable::Iterator it = fPackages.GetIterator();
-		Package* package = it.Next();) {
-		error = _AddPackageContent(package, false);
-		if (error != B_OK) {
-			for (it.Rewind(); Package* activePackage = it.Next();) {
-				if (activePackage == package)
-					break;
-				_RemovePackageContent(activePackage, NULL, false);
-			}
-			RETURN_ERROR(error);
-		}
-	}
-
 	return B_OK;
 }
 
@@ -1538,7 +1657,7 @@ Volume::_LoadPackage(PackagesDirectory* packagesDirectory, const char* name,
 	if (error != B_OK)
 		return error;
 
-	error = package->Load(fPackageSettings);
+	error = package->Load(fPackageSettings, fMountIndex);
 	if (error != B_OK)
 		return error;
 
@@ -27,6 +27,7 @@
 
 
 class Directory;
+class MountIndex;
 class PackageFSRoot;
 class PackagesDirectory;
 class UnpackingNode;
@@ -115,6 +116,7 @@ private:
 									const char* packagesState);
 
 			status_t			_AddInitialPackages();
+			status_t			_LoadInitialPackages();
 			status_t			_AddInitialPackagesFromActivationFile(
 									PackagesDirectory* packagesDirectory);
 			status_t			_AddInitialPackagesFromDirectory();
@@ -190,6 +192,9 @@ private:
 			PackagesDirectoryList fPackagesDirectories;
 			PackagesDirectoryHashTable fPackagesDirectoriesByNodeRef;
 			PackageSettings		fPackageSettings;
+			MountIndex*			fMountIndex;
+									// only set while adding the initial
+									// packages
 
 			struct {
 				dev_t			deviceID;
@@ -190,6 +190,12 @@ struct Query::QueryPolicy {
 		return index.index->GetKeyLength();
 	}
 
+	static status_t IndexEstimateCount(Index& index, int32 op,
+		const void* value, size_t size, bool prefix, int64* _count)
+	{
+		return B_UNSUPPORTED;
+	}
+
 	static IndexIterator* IndexCreateIterator(Index& index)
 	{
 		IndexIterator* iterator = new(std::nothrow) IndexIterator(index.index);
@@ -212,6 +218,12 @@ struct Query::QueryPolicy {
 		return indexIterator->Find((const uint8*)value, size);
 	}
 
+	static status_t IndexIteratorFindPattern(IndexIterator* indexIterator,
+		const char* pattern)
+	{
+		return B_UNSUPPORTED;
+	}
+
 	static status_t IndexIteratorFetchNextEntry(IndexIterator* indexIterator,
 		void* value, size_t* _valueLength, size_t bufferSize, size_t* duplicate)
 	{
@@ -225,6 +237,11 @@ struct Query::QueryPolicy {
 		return B_OK;
 	}
 
+	static ino_t IndexIteratorGetNodeID(IndexIterator* indexIterator)
+	{
+		return -1;
+	}
+
 	static void IndexIteratorSkipDuplicates(IndexIterator* indexIterator)
 	{
 		// Nothing to do.
@@ -287,6 +304,12 @@ struct Query::QueryPolicy {
 	{
 		return context->fVolume->GetID();
 	}
+
+	static status_t ContextGetEntry(Context* context, ino_t id,
+		NodeHolder& holder, Entry** _entry)
+	{
+		return B_UNSUPPORTED;
+	}
 };
 
 
@@ -392,9 +392,10 @@ userlandfs_create_file_system(const char* fsName, image_id image,
 	if (error != B_OK)
 		RETURN_ERROR(error);
 
-	// module name must match "file_systems/<name>/v1"
+	// module name must match "file_systems/<name>" B_CURRENT_FS_API_VERSION
 	char moduleName[B_PATH_NAME_LENGTH];
-	snprintf(moduleName, sizeof(moduleName), "file_systems/%s/v1", fsName);
+	snprintf(moduleName, sizeof(moduleName),
+		"file_systems/%s" B_CURRENT_FS_API_VERSION, fsName);
 
 	// find the module
 	file_system_module_info* module = NULL;
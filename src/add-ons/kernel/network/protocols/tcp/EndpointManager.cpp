@@ -311,6 +311,7 @@ EndpointManager::SetPassive(TCPEndpoint* endpoint)
 		SocketAddressStorage local(AddressModule());
 		local.SetToEmpty();
 
+		endpoint->fOwner = geteuid();
 		status_t status = _BindToEphemeral(endpoint, *local);
 		if (status < B_OK)
 			return status;
@@ -319,7 +320,9 @@ EndpointManager::SetPassive(TCPEndpoint* endpoint)
 	SocketAddressStorage passive(AddressModule());
 	passive.SetToEmpty();
 
-	if (_LookupConnection(*endpoint->LocalAddress(), *passive))
+	TCPEndpoint* listener = _LookupConnection(*endpoint->LocalAddress(),
+		*passive);
+	if (listener != NULL && !_CanShareListener(endpoint, listener))
 		return EADDRINUSE;
 
 	endpoint->PeerAddress().SetTo(*passive);
@@ -343,10 +346,7 @@ EndpointManager::FindConnection(sockaddr* local, sockaddr* peer)
 
 	// no explicit endpoint exists, check for wildcard endpoints
 
-	SocketAddressStorage wildcard(AddressModule());
-	wildcard.SetToEmpty();
-
-	endpoint = _LookupConnection(local, *wildcard);
+	endpoint = _LookupListener(local, local, peer);
 	if (endpoint != NULL) {
 		TRACE(("TCP: Received packet corresponds to wildcard endpoint %p\n",
 			endpoint));
@@ -358,7 +358,7 @@ EndpointManager::FindConnection(sockaddr* local, sockaddr* peer)
 	localWildcard.SetToEmpty();
 	localWildcard.SetPort(AddressModule()->get_port(local));
 
-	endpoint = _LookupConnection(*localWildcard, *wildcard);
+	endpoint = _LookupListener(*localWildcard, local, peer);
 	if (endpoint != NULL) {
 		TRACE(("TCP: Received packet corresponds to local wildcard endpoint "
 			"%p\n", endpoint));
@@ -373,6 +373,70 @@ EndpointManager::FindConnection(sockaddr* local, sockaddr* peer)
 }
 
 
+/*!	Returns the listening endpoint for the local address \a key.
+	If several endpoints are listening on that address using SO_REUSEPORT,
+	one of them is chosen by the hash of the connection's \a local and
+	\a peer addresses, so that all segments of a connection (and its
+	retransmitted SYNs) end up in the accept queue of the same socket.
+	You must hold the manager's lock when calling this method (either read or
+	write).
+*/
+TCPEndpoint*
+EndpointManager::_LookupListener(const sockaddr* key, const sockaddr* local,
+	const sockaddr* peer)
+{
+	SocketAddressStorage wildcard(AddressModule());
+	wildcard.SetToEmpty();
+
+	TCPEndpoint* listener = _LookupConnection(key, *wildcard);
+	if (listener == NULL || (listener->socket->options & SO_REUSEPORT) == 0)
+		return listener;
+
+	// All members of the group share the same hash chain; the first match
+	// in it is the listener we've just found.
+	ConnectionHashDefinition definition(this);
+	ConnectionHashDefinition::KeyType groupKey(key, *wildcard);
+
+	uint32 count = 0;
+	for (TCPEndpoint* member = listener; member != NULL;
+			member = member->fConnectionHashLink) {
+		if (definition.Compare(groupKey, member)
+			&& (member->socket->options & SO_REUSEPORT) != 0)
+			count++;
+	}
+	if (count < 2)
+		return listener;
+
+	uint32 index = reuse_port_select(AddressModule()->hash_address_pair(local,
+		peer), count);
+	for (TCPEndpoint* member = listener; member != NULL;
+			member = member->fConnectionHashLink) {
+		if (definition.Compare(groupKey, member)
+			&& (member->socket->options & SO_REUSEPORT) != 0
+			&& index-- == 0)
+			return member;
+	}
+
+	return listener;
+}
+
+
+/*!	Returns whether or not \a endpoint may listen on the same address as the
+	existing \a listener, forming a SO_REUSEPORT group with it. Both sockets
+	need to have the option set, and they must belong to the same user so
+	that other users cannot steal connections from a server.
+	You must hold the manager's lock when calling this method.
+*/
+bool
+EndpointManager::_CanShareListener(TCPEndpoint* endpoint,
+	TCPEndpoint* listener) const
+{
+	return (endpoint->socket->options & SO_REUSEPORT) != 0
+		&& (listener->socket->options & SO_REUSEPORT) != 0
+		&& listener->fOwner == endpoint->fOwner;
+}
+
+
 //	#pragma mark - endpoints
 
 
@@ -385,6 +449,11 @@ EndpointManager::Bind(TCPEndpoint* endpoint, const sockaddr* address)
 
 	WriteLocker locker(fLock);
 
+	// Only the user binding the socket owns it; children spawned by a
+	// listener are bound in the kernel's context, and inherit its owner
+	// instead.
+	endpoint->fOwner = geteuid();
+
 	if (AddressModule()->get_port(address) == 0)
 		return _BindToEphemeral(endpoint, address);
 
@@ -448,6 +517,14 @@ EndpointManager::_BindToAddress(WriteLocker& locker, TCPEndpoint* endpoint,
 					break;
 				}
 
+				// Sockets of the same user that all set SO_REUSEPORT may
+				// share the address; SetPassive() decides whether they may
+				// also listen on it together.
+				if ((endpoint->socket->options & SO_REUSEPORT) != 0
+					&& (user->socket->options & SO_REUSEPORT) != 0
+					&& user->fOwner == endpoint->fOwner)
+					continue;
+
 				if ((endpoint->socket->options & SO_REUSEADDR) == 0)
 					return EADDRINUSE;
 
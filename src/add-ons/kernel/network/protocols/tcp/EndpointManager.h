@@ -98,6 +98,10 @@ public:
 private:
 			TCPEndpoint*	_LookupConnection(const sockaddr* local,
 								const sockaddr* peer);
+			TCPEndpoint*	_LookupListener(const sockaddr* key,
+								const sockaddr* local, const sockaddr* peer);
+			bool			_CanShareListener(TCPEndpoint* endpoint,
+								TCPEndpoint* listener) const;
 			status_t		_Bind(TCPEndpoint* endpoint,
 								const sockaddr* address);
 			status_t		_BindToAddress(WriteLocker& locker,
@@ -424,6 +424,7 @@ state_needs_finish(int32 state)
 TCPEndpoint::TCPEndpoint(net_socket* socket)
 	:
 	ProtocolSocket(socket),
+	fOwner(0),
 	fManager(NULL),
 	fOptions(0),
 	fSendWindowShift(0),
@@ -1577,6 +1578,7 @@ TCPEndpoint::_Spawn(TCPEndpoint* parent, tcp_segment_header& segment,
 	T(Spawn(parent, this));
 
 	fManager = parent->fManager;
+	fOwner = parent->fOwner;
 
 	if (fManager->BindChild(this, buffer->destination) != B_OK) {
 		T(Error(this, "binding failed", __LINE__));
@@ -130,6 +130,7 @@ private:
 private:
 	TCPEndpoint*	fConnectionHashLink;
 	TCPEndpoint*	fEndpointHashLink;
+	uid_t			fOwner;
 	friend class	EndpointManager;
 	friend struct	ConnectionHashDefinition;
 	friend class	EndpointHashDefinition;
@@ -28,9 +28,11 @@
 #include <algorithm>
 #include <netinet/in.h>
 #include <netinet/ip.h>
+#include <netinet/udp.h>
 #include <new>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <utility>
 
 
@@ -81,6 +83,10 @@ enum {
 	FLAG_NO_SEND				= 0x02,
 };
 
+// the maximum number of datagrams a single send may be split into with
+// UDP_SEGMENT
+static const uint32 kMaxSegments = 64;
+
 
 class UdpEndpoint : public net_protocol, public DatagramSocket<> {
 public:
@@ -100,6 +106,11 @@ public:
 			status_t			SendData(net_buffer* buffer);
 			ssize_t				SendAvailable();
 
+			status_t			GetOption(int option, void* value,
+									int* _length);
+			status_t			SetOption(int option, const void* value,
+									int length);
+
 			ssize_t				BytesAvailable();
 			status_t			FetchData(size_t numBytes, uint32 flags,
 									net_buffer** _buffer);
@@ -114,8 +125,17 @@ public:
 
 			UdpEndpoint*&		HashTableLink() { return fLink; }
 
+			// the user that bound the endpoint; only endpoints of the same
+			// user may form a SO_REUSEPORT group.
+			uid_t				Owner() const { return fOwner; }
+			void				SetOwner(uid_t owner) { fOwner = owner; }
+
 			void				Dump() const;
 
+private:
+			status_t			_SendDatagram(net_buffer* buffer,
+									net_route* route);
+
 private:
 			UdpDomainSupport*	fManager;
 			bool				fActive;
@@ -125,6 +145,8 @@ private:
 
 			UdpEndpoint*		fLink;
 			uint32				fFlags;
+			uid_t				fOwner;
+			uint16				fSegmentSize;
 };
 
 
@@ -202,6 +224,11 @@ private:
 
 	UdpEndpoint *_FindActiveEndpoint(const sockaddr *ourAddress,
 		const sockaddr *peerAddress, uint32 index = 0);
+	UdpEndpoint *_SelectReusePortMember(UdpEndpoint *endpoint,
+		const sockaddr *ourAddress, const sockaddr *peerAddress,
+		uint32 index);
+	bool _IsReusePortMember(UdpEndpoint *endpoint, UdpEndpoint *member,
+		uint32 index) const;
 	status_t _DemuxBroadcast(net_buffer *buffer);
 	status_t _DemuxUnicast(net_buffer *buffer);
 
@@ -473,10 +500,13 @@ UdpDomainSupport::_Bind(UdpEndpoint *endpoint, const sockaddr *address)
 				|| (socketOptions & (SO_REUSEADDR | SO_REUSEPORT)) == 0)
 				return EADDRINUSE;
 
-			// if both addresses are the same, SO_REUSEPORT is required:
+			// if both addresses are the same, SO_REUSEPORT is required, and
+			// both sockets must belong to the same user, as they will share
+			// the incoming datagrams:
 			if (otherEndpoint->LocalAddress().EqualTo(address, false)
 				&& ((otherEndpoint->Socket()->options & SO_REUSEPORT) == 0
-					|| (socketOptions & SO_REUSEPORT) == 0))
+					|| (socketOptions & SO_REUSEPORT) == 0
+					|| otherEndpoint->Owner() != geteuid()))
 				return EADDRINUSE;
 		}
 	}
@@ -513,6 +543,7 @@ UdpDomainSupport::_FinishBind(UdpEndpoint *endpoint, const sockaddr *address)
 
 	fActiveEndpoints.Insert(endpoint);
 	endpoint->SetActive(true);
+	endpoint->SetOwner(geteuid());
 
 	return B_OK;
 }
@@ -545,6 +576,57 @@ UdpDomainSupport::_FindActiveEndpoint(const sockaddr *ourAddress,
 }
 
 
+/*!	If \a endpoint is an unconnected member of a SO_REUSEPORT group, this
+	distributes the datagrams among all members of the group by the hash of
+	their source and destination, so that all datagrams of a flow end up at
+	the same socket. Otherwise, \a endpoint is returned unchanged.
+*/
+UdpEndpoint *
+UdpDomainSupport::_SelectReusePortMember(UdpEndpoint *endpoint,
+	const sockaddr *ourAddress, const sockaddr *peerAddress, uint32 index)
+{
+	ASSERT_LOCKED_MUTEX(&fLock);
+
+	if ((endpoint->socket->options & SO_REUSEPORT) == 0
+		|| !endpoint->PeerAddress().IsEmpty(true))
+		return endpoint;
+
+	// All members of the group are in the same hash chain, following the
+	// endpoint that _FindActiveEndpoint() found first
+	uint32 count = 0;
+	for (UdpEndpoint *member = endpoint; member != NULL;
+			member = member->HashTableLink()) {
+		if (_IsReusePortMember(endpoint, member, index))
+			count++;
+	}
+	if (count < 2)
+		return endpoint;
+
+	uint32 selected = reuse_port_select(
+		AddressModule()->hash_address_pair(ourAddress, peerAddress), count);
+	for (UdpEndpoint *member = endpoint; member != NULL;
+			member = member->HashTableLink()) {
+		if (_IsReusePortMember(endpoint, member, index) && selected-- == 0)
+			return member;
+	}
+
+	return endpoint;
+}
+
+
+bool
+UdpDomainSupport::_IsReusePortMember(UdpEndpoint *endpoint,
+	UdpEndpoint *member, uint32 index) const
+{
+	return (member->socket->options & SO_REUSEPORT) != 0
+		&& (member->socket->bound_to_device == 0 || index == 0
+			|| member->socket->bound_to_device == index)
+		&& member->Owner() == endpoint->Owner()
+		&& member->LocalAddress().EqualTo(*endpoint->LocalAddress(), true)
+		&& member->PeerAddress().EqualTo(*endpoint->PeerAddress(), true);
+}
+
+
 status_t
 UdpDomainSupport::_DemuxBroadcast(net_buffer* buffer)
 {
@@ -626,6 +708,8 @@ UdpDomainSupport::_DemuxUnicast(net_buffer* buffer)
 		return B_NAME_NOT_FOUND;
 	}
 
+	endpoint = _SelectReusePortMember(endpoint, localAddress, peerAddress,
+		buffer->index);
 	endpoint->StoreData(buffer);
 	return B_OK;
 }
@@ -957,7 +1041,9 @@ UdpEndpoint::UdpEndpoint(net_socket *socket)
 	:
 	DatagramSocket<>("udp endpoint", socket),
 	fActive(false),
-	fFlags(0)
+	fFlags(0),
+	fOwner(0),
+	fSegmentSize(0)
 {
 }
 
@@ -1062,6 +1148,43 @@ UdpEndpoint::SendRoutedData(net_buffer *buffer, net_route *route)
 	if (status != B_OK)
 		return status;
 
+	uint16 segmentSize = fSegmentSize;
+	if (segmentSize == 0 || buffer->size <= segmentSize)
+		return _SendDatagram(buffer, route);
+
+	if ((buffer->size + segmentSize - 1) / segmentSize > kMaxSegments)
+		return EMSGSIZE;
+
+	// Send the segments as clones of the front of the buffer, and only remove
+	// them from it once they went out. If one fails, the buffer contains
+	// just the data that hasn't been sent, so that the socket layer can
+	// report the segments that were.
+	while (buffer->size > 0) {
+		net_buffer* segment = gBufferModule->clone(buffer, false);
+		if (segment == NULL)
+			return ENOBUFS;
+
+		uint32 size = min_c(buffer->size, segmentSize);
+		status = gBufferModule->trim(segment, size);
+		if (status == B_OK)
+			status = _SendDatagram(segment, route);
+		if (status != B_OK) {
+			gBufferModule->free(segment);
+			return status;
+		}
+
+		gBufferModule->remove_header(buffer, size);
+	}
+
+	gBufferModule->free(buffer);
+	return B_OK;
+}
+
+
+/*!	Adds the UDP header to \a buffer, and sends it as a single datagram. */
+status_t
+UdpEndpoint::_SendDatagram(net_buffer *buffer, net_route *route)
+{
 	buffer->protocol = IPPROTO_UDP;
 
 	// add and fill UDP-specific header:
@@ -1115,6 +1238,52 @@ UdpEndpoint::SendAvailable()
 }
 
 
+// #pragma mark - options
+
+
+status_t
+UdpEndpoint::GetOption(int option, void* _value, int* _length)
+{
+	if (*_length != sizeof(int))
+		return B_BAD_VALUE;
+
+	int* value = (int*)_value;
+
+	switch (option) {
+		case UDP_SEGMENT:
+			*value = fSegmentSize;
+			return B_OK;
+
+		default:
+			return B_BAD_VALUE;
+	}
+}
+
+
+/*!	With UDP_SEGMENT set to a non-zero size, every send that is larger is
+	split into datagrams of that size, with only the last one being shorter.
+	This saves one syscall per datagram for senders like QUIC servers.
+	If one of the datagrams cannot be sent, the send returns the size of
+	those before it, and only fails if it was the first.
+*/
+status_t
+UdpEndpoint::SetOption(int option, const void* _value, int length)
+{
+	if (option != UDP_SEGMENT)
+		return B_BAD_VALUE;
+
+	if (length != sizeof(int))
+		return B_BAD_VALUE;
+
+	int value = *(const int*)_value;
+	if (value < 0 || value > int(0xffff - sizeof(udp_header)))
+		return B_BAD_VALUE;
+
+	fSegmentSize = value;
+	return B_OK;
+}
+
+
 // #pragma mark - inbound
 
 
@@ -1263,6 +1432,9 @@ status_t
 udp_getsockopt(net_protocol *protocol, int level, int option, void *value,
 	int *length)
 {
+	if (level == IPPROTO_UDP)
+		return ((UdpEndpoint *)protocol)->GetOption(option, value, length);
+
 	return protocol->next->module->getsockopt(protocol->next, level, option,
 		value, length);
 }
@@ -1272,6 +1444,9 @@ status_t
 udp_setsockopt(net_protocol *protocol, int level, int option,
 	const void *value, int length)
 {
+	if (level == IPPROTO_UDP)
+		return ((UdpEndpoint *)protocol)->SetOption(option, value, length);
+
 	return protocol->next->module->setsockopt(protocol->next, level, option,
 		value, length);
 }
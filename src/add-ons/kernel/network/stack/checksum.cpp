@@ -0,0 +1,518 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Internet checksum (RFC 1071) routines.
+
+	All routines sum up the data as 32 bit words into 64 bit accumulators;
+	since 2^16 is congruent to 1 modulo 0xffff, folding such a sum yields the
+	same result as adding up 16 bit words. The vector variants do the same
+	in every lane of their registers.
+*/
+
+
+#include "checksum.h"
+
+#include <ByteOrder.h>
+#include <KernelExport.h>
+
+#include <string.h>
+
+#ifdef _KERNEL_MODE
+#	include <kernel.h>
+#	if defined(__x86_64__)
+#		include <arch_cpu.h>
+#	endif
+#endif
+
+#if defined(__x86_64__)
+#	include <immintrin.h>
+#elif defined(__aarch64__)
+#	include <arm_neon.h>
+#endif
+
+
+// The amount of user data copied at once before it is checksummed; it
+// should comfortably fit into the L1 data cache.
+static const size_t kUserCopyChunkSize = 2048;
+
+static const checksum_kernel* sChecksumKernel = &gChecksumKernels[0];
+
+
+static inline uint32
+load_32(const uint8* buffer)
+{
+	uint32 value;
+	memcpy(&value, buffer, sizeof(value));
+	return value;
+}
+
+
+static inline uint16
+fold_checksum(uint64 sum)
+{
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+	return (uint16)sum;
+}
+
+
+/*!	Adds the remaining (less than a vector's worth of) bytes to \a sum.
+*/
+static inline uint64
+checksum_tail(const uint8* buffer, size_t length, uint64 sum)
+{
+	while (length >= 4) {
+		sum += load_32(buffer);
+		buffer += 4;
+		length -= 4;
+	}
+
+	if (length >= 2) {
+		uint16 value;
+		memcpy(&value, buffer, sizeof(value));
+		sum += value;
+		buffer += 2;
+		length -= 2;
+	}
+
+	if (length != 0) {
+		// give the last byte its proper endian-aware treatment
+#if B_HOST_IS_LENDIAN
+		sum += *buffer;
+#else
+		sum += (uint16)*buffer << 8;
+#endif
+	}
+
+	return sum;
+}
+
+
+static bool
+always_supported()
+{
+	return true;
+}
+
+
+// #pragma mark - generic
+
+
+static uint16
+checksum_generic(const uint8* buffer, size_t length)
+{
+	uint64 sum0 = 0;
+	uint64 sum1 = 0;
+
+	while (length >= 16) {
+		sum0 += load_32(buffer);
+		sum1 += load_32(buffer + 4);
+		sum0 += load_32(buffer + 8);
+		sum1 += load_32(buffer + 12);
+		buffer += 16;
+		length -= 16;
+	}
+
+	return fold_checksum(checksum_tail(buffer, length, sum0 + sum1));
+}
+
+
+static uint16
+copy_and_checksum_generic(uint8* to, const uint8* from, size_t length)
+{
+	uint64 sum0 = 0;
+	uint64 sum1 = 0;
+
+	while (length >= 16) {
+		uint32 a = load_32(from);
+		uint32 b = load_32(from + 4);
+		uint32 c = load_32(from + 8);
+		uint32 d = load_32(from + 12);
+		memcpy(to, &a, 4);
+		memcpy(to + 4, &b, 4);
+		memcpy(to + 8, &c, 4);
+		memcpy(to + 12, &d, 4);
+		sum0 += a;
+		sum1 += b;
+		sum0 += c;
+		sum1 += d;
+		from += 16;
+		to += 16;
+		length -= 16;
+	}
+
+	memcpy(to, from, length);
+	return fold_checksum(checksum_tail(to, length, sum0 + sum1));
+}
+
+
+#if defined(__x86_64__)
+
+
+// #pragma mark - SSE2
+
+
+#define SSE2_ADD(sum0, sum1, vector) \
+	sum0 = _mm_add_epi64(sum0, _mm_unpacklo_epi32(vector, zero)); \
+	sum1 = _mm_add_epi64(sum1, _mm_unpackhi_epi32(vector, zero));
+
+
+static inline uint64
+sse2_reduce(__m128i sum)
+{
+	uint64 lanes[2];
+	_mm_storeu_si128((__m128i*)lanes, sum);
+	return lanes[0] + lanes[1];
+}
+
+
+static uint16
+checksum_sse2(const uint8* buffer, size_t length)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sum0 = zero;
+	__m128i sum1 = zero;
+
+	while (length >= 64) {
+		__m128i a = _mm_loadu_si128((const __m128i*)buffer);
+		__m128i b = _mm_loadu_si128((const __m128i*)(buffer + 16));
+		__m128i c = _mm_loadu_si128((const __m128i*)(buffer + 32));
+		__m128i d = _mm_loadu_si128((const __m128i*)(buffer + 48));
+		SSE2_ADD(sum0, sum1, a);
+		SSE2_ADD(sum0, sum1, b);
+		SSE2_ADD(sum0, sum1, c);
+		SSE2_ADD(sum0, sum1, d);
+		buffer += 64;
+		length -= 64;
+	}
+
+	while (length >= 16) {
+		__m128i a = _mm_loadu_si128((const __m128i*)buffer);
+		SSE2_ADD(sum0, sum1, a);
+		buffer += 16;
+		length -= 16;
+	}
+
+	return fold_checksum(checksum_tail(buffer, length,
+		sse2_reduce(_mm_add_epi64(sum0, sum1))));
+}
+
+
+static uint16
+copy_and_checksum_sse2(uint8* to, const uint8* from, size_t length)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sum0 = zero;
+	__m128i sum1 = zero;
+
+	while (length >= 64) {
+		__m128i a = _mm_loadu_si128((const __m128i*)from);
+		__m128i b = _mm_loadu_si128((const __m128i*)(from + 16));
+		__m128i c = _mm_loadu_si128((const __m128i*)(from + 32));
+		__m128i d = _mm_loadu_si128((const __m128i*)(from + 48));
+		_mm_storeu_si128((__m128i*)to, a);
+		_mm_storeu_si128((__m128i*)(to + 16), b);
+		_mm_storeu_si128((__m128i*)(to + 32), c);
+		_mm_storeu_si128((__m128i*)(to + 48), d);
+		SSE2_ADD(sum0, sum1, a);
+		SSE2_ADD(sum0, sum1, b);
+		SSE2_ADD(sum0, sum1, c);
+		SSE2_ADD(sum0, sum1, d);
+		from += 64;
+		to += 64;
+		length -= 64;
+	}
+
+	while (length >= 16) {
+		__m128i a = _mm_loadu_si128((const __m128i*)from);
+		_mm_storeu_si128((__m128i*)to, a);
+		SSE2_ADD(sum0, sum1, a);
+		from += 16;
+		to += 16;
+		length -= 16;
+	}
+
+	memcpy(to, from, length);
+	return fold_checksum(checksum_tail(to, length,
+		sse2_reduce(_mm_add_epi64(sum0, sum1))));
+}
+
+
+// #pragma mark - AVX2
+
+
+#define AVX2_ADD(sum0, sum1, vector) \
+	sum0 = _mm256_add_epi64(sum0, _mm256_unpacklo_epi32(vector, zero)); \
+	sum1 = _mm256_add_epi64(sum1, _mm256_unpackhi_epi32(vector, zero));
+
+
+static bool
+avx2_supported()
+{
+#ifdef _KERNEL_MODE
+	// The FPU state is only saved with XSAVE if AVX is enabled
+	return x86_check_feature(IA32_FEATURE_EXT_XSAVE, FEATURE_EXT)
+		&& x86_check_feature(IA32_FEATURE_EXT_AVX, FEATURE_EXT)
+		&& x86_check_feature(IA32_FEATURE_AVX2, FEATURE_7_EBX);
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+
+__attribute__((target("avx2"))) static inline uint64
+avx2_reduce(__m256i sum)
+{
+	return sse2_reduce(_mm_add_epi64(_mm256_castsi256_si128(sum),
+		_mm256_extracti128_si256(sum, 1)));
+}
+
+
+__attribute__((target("avx2"))) static uint16
+checksum_avx2(const uint8* buffer, size_t length)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i sum0 = zero;
+	__m256i sum1 = zero;
+
+	while (length >= 128) {
+		__m256i a = _mm256_loadu_si256((const __m256i*)buffer);
+		__m256i b = _mm256_loadu_si256((const __m256i*)(buffer + 32));
+		__m256i c = _mm256_loadu_si256((const __m256i*)(buffer + 64));
+		__m256i d = _mm256_loadu_si256((const __m256i*)(buffer + 96));
+		AVX2_ADD(sum0, sum1, a);
+		AVX2_ADD(sum0, sum1, b);
+		AVX2_ADD(sum0, sum1, c);
+		AVX2_ADD(sum0, sum1, d);
+		buffer += 128;
+		length -= 128;
+	}
+
+	while (length >= 32) {
+		__m256i a = _mm256_loadu_si256((const __m256i*)buffer);
+		AVX2_ADD(sum0, sum1, a);
+		buffer += 32;
+		length -= 32;
+	}
+
+	return fold_checksum(checksum_tail(buffer, length,
+		avx2_reduce(_mm256_add_epi64(sum0, sum1))));
+}
+
+
+__attribute__((target("avx2"))) static uint16
+copy_and_checksum_avx2(uint8* to, const uint8* from, size_t length)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i sum0 = zero;
+	__m256i sum1 = zero;
+
+	while (length >= 128) {
+		__m256i a = _mm256_loadu_si256((const __m256i*)from);
+		__m256i b = _mm256_loadu_si256((const __m256i*)(from + 32));
+		__m256i c = _mm256_loadu_si256((const __m256i*)(from + 64));
+		__m256i d = _mm256_loadu_si256((const __m256i*)(from + 96));
+		_mm256_storeu_si256((__m256i*)to, a);
+		_mm256_storeu_si256((__m256i*)(to + 32), b);
+		_mm256_storeu_si256((__m256i*)(to + 64), c);
+		_mm256_storeu_si256((__m256i*)(to + 96), d);
+		AVX2_ADD(sum0, sum1, a);
+		AVX2_ADD(sum0, sum1, b);
+		AVX2_ADD(sum0, sum1, c);
+		AVX2_ADD(sum0, sum1, d);
+		from += 128;
+		to += 128;
+		length -= 128;
+	}
+
+	while (length >= 32) {
+		__m256i a = _mm256_loadu_si256((const __m256i*)from);
+		_mm256_storeu_si256((__m256i*)to, a);
+		AVX2_ADD(sum0, sum1, a);
+		from += 32;
+		to += 32;
+		length -= 32;
+	}
+
+	memcpy(to, from, length);
+	return fold_checksum(checksum_tail(to, length,
+		avx2_reduce(_mm256_add_epi64(sum0, sum1))));
+}
+
+
+#elif defined(__aarch64__)
+
+
+// #pragma mark - NEON
+
+
+static uint16
+checksum_neon(const uint8* buffer, size_t length)
+{
+	uint64x2_t sum0 = vdupq_n_u64(0);
+	uint64x2_t sum1 = vdupq_n_u64(0);
+
+	while (length >= 64) {
+		sum0 = vpadalq_u32(sum0, vreinterpretq_u32_u8(vld1q_u8(buffer)));
+		sum1 = vpadalq_u32(sum1, vreinterpretq_u32_u8(vld1q_u8(buffer + 16)));
+		sum0 = vpadalq_u32(sum0, vreinterpretq_u32_u8(vld1q_u8(buffer + 32)));
+		sum1 = vpadalq_u32(sum1, vreinterpretq_u32_u8(vld1q_u8(buffer + 48)));
+		buffer += 64;
+		length -= 64;
+	}
+
+	while (length >= 16) {
+		sum0 = vpadalq_u32(sum0, vreinterpretq_u32_u8(vld1q_u8(buffer)));
+		buffer += 16;
+		length -= 16;
+	}
+
+	return fold_checksum(checksum_tail(buffer, length,
+		vaddvq_u64(vaddq_u64(sum0, sum1))));
+}
+
+
+static uint16
+copy_and_checksum_neon(uint8* to, const uint8* from, size_t length)
+{
+	uint64x2_t sum0 = vdupq_n_u64(0);
+	uint64x2_t sum1 = vdupq_n_u64(0);
+
+	while (length >= 32) {
+		uint8x16_t a = vld1q_u8(from);
+		uint8x16_t b = vld1q_u8(from + 16);
+		vst1q_u8(to, a);
+		vst1q_u8(to + 16, b);
+		sum0 = vpadalq_u32(sum0, vreinterpretq_u32_u8(a));
+		sum1 = vpadalq_u32(sum1, vreinterpretq_u32_u8(b));
+		from += 32;
+		to += 32;
+		length -= 32;
+	}
+
+	memcpy(to, from, length);
+	return fold_checksum(checksum_tail(to, length,
+		vaddvq_u64(vaddq_u64(sum0, sum1))));
+}
+
+
+#endif	// __aarch64__
+
+
+// #pragma mark -
+
+
+//! Ordered from the least to the most preferred implementation
+const checksum_kernel gChecksumKernels[] = {
+	{ "generic", &always_supported, &checksum_generic,
+		&copy_and_checksum_generic },
+#if defined(__x86_64__)
+	{ "sse2", &always_supported, &checksum_sse2, &copy_and_checksum_sse2 },
+	{ "avx2", &avx2_supported, &checksum_avx2, &copy_and_checksum_avx2 },
+#elif defined(__aarch64__)
+	{ "neon", &always_supported, &checksum_neon, &copy_and_checksum_neon },
+#endif
+};
+const uint32 gChecksumKernelCount = B_COUNT_OF(gChecksumKernels);
+
+
+/*!	Chooses the best checksum implementation the CPU supports. Must be called
+	before any other thread uses the checksum functions.
+*/
+void
+select_checksum_kernel()
+{
+	for (uint32 i = 0; i < gChecksumKernelCount; i++) {
+		if (gChecksumKernels[i].is_supported())
+			sChecksumKernel = &gChecksumKernels[i];
+	}
+
+#ifdef _KERNEL_MODE
+	dprintf("net stack: using %s checksum routines\n", sChecksumKernel->name);
+#endif
+}
+
+
+const checksum_kernel*
+current_checksum_kernel()
+{
+	return sChecksumKernel;
+}
+
+
+uint16
+compute_checksum(const uint8* buffer, size_t length)
+{
+	return sChecksumKernel->checksum(buffer, length);
+}
+
+
+uint16
+checksum(uint8* buffer, size_t length)
+{
+	return ~compute_checksum(buffer, length);
+}
+
+
+/*!	Copies \a length bytes from \a from to \a to, and returns the checksum
+	of the data as compute_checksum() would. Both buffers must be in kernel
+	memory.
+*/
+uint16
+copy_and_checksum(uint8* to, const uint8* from, size_t length)
+{
+	return sChecksumKernel->copy_and_checksum(to, from, length);
+}
+
+
+/*!	Like copy_and_checksum(), but \a from may also point to userland memory.
+	Since user_memcpy() must be able to handle page faults, copying and
+	checksumming cannot be fused in this case; instead, the data is copied
+	in chunks that are checksummed while they are still in the cache.
+*/
+status_t
+user_copy_and_checksum(uint8* to, const uint8* from, size_t length,
+	uint16* _checksum)
+{
+#ifdef _KERNEL_MODE
+	if (IS_USER_ADDRESS(from)) {
+		uint16 sum = 0;
+		size_t offset = 0;
+
+		while (offset < length) {
+			size_t chunk = min_c(length - offset, kUserCopyChunkSize);
+			if (user_memcpy(to + offset, from + offset, chunk) != B_OK)
+				return B_BAD_ADDRESS;
+
+			sum = add_checksum(sum, compute_checksum(to + offset, chunk),
+				(offset & 1) != 0);
+			offset += chunk;
+		}
+
+		*_checksum = sum;
+		return B_OK;
+	}
+#endif
+
+	*_checksum = copy_and_checksum(to, from, length);
+	return B_OK;
+}
+
+
+/*!	Combines two partial checksums; \a odd specifies whether the data \a add
+	was computed for started at an odd offset relative to the data of \a sum.
+*/
+uint16
+add_checksum(uint16 sum, uint16 add, bool odd)
+{
+	uint32 result = sum;
+	result += odd ? __swap_int16(add) : add;
+	result = (result & 0xffff) + (result >> 16);
+	return (uint16)result;
+}
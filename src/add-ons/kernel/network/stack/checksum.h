@@ -0,0 +1,42 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef NET_CHECKSUM_H
+#define NET_CHECKSUM_H
+
+
+#include <SupportDefs.h>
+
+
+/*!	A set of Internet checksum routines optimized for a specific CPU.
+	Both functions return the folded, but not yet complemented 16 bit one's
+	complement sum of the data, with the first byte being treated as being
+	at an even offset.
+*/
+struct checksum_kernel {
+	const char*	name;
+	bool		(*is_supported)();
+	uint16		(*checksum)(const uint8* buffer, size_t length);
+	uint16		(*copy_and_checksum)(uint8* to, const uint8* from,
+					size_t length);
+};
+
+
+extern const checksum_kernel gChecksumKernels[];
+extern const uint32 gChecksumKernelCount;
+
+
+void		select_checksum_kernel();
+const checksum_kernel* current_checksum_kernel();
+
+uint16		compute_checksum(const uint8* buffer, size_t length);
+uint16		checksum(uint8* buffer, size_t length);
+uint16		copy_and_checksum(uint8* to, const uint8* from, size_t length);
+status_t	user_copy_and_checksum(uint8* to, const uint8* from, size_t length,
+				uint16* _checksum);
+
+uint16		add_checksum(uint16 sum, uint16 add, bool odd);
+
+
+#endif	// NET_CHECKSUM_H
@@ -139,6 +139,10 @@ register_domain(int family, const char* name,
 	domain->module = module;
 	domain->address_module = addressModule;
 
+	domain->forwarding_table_valid = false;
+	domain->route_generation = 0;
+	init_forwarding_table(domain);
+
 	sDomains.Add(domain);
 
 	*_domain = domain;
@@ -13,6 +13,7 @@
 #include <util/list.h>
 #include <util/DoublyLinkedList.h>
 
+#include "fib.h"
 #include "routes.h"
 
 
@@ -25,6 +26,10 @@ struct net_domain_private : net_domain,
 
 	RouteList			routes;
 	RouteInfoList		route_infos;
+
+	ForwardingTable		forwarding_table;
+	int32				forwarding_table_valid;
+	int32				route_generation;
 };
 
 
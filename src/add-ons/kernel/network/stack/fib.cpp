@@ -0,0 +1,588 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "fib.h"
+
+#include <KernelExport.h>
+#include <OS.h>
+
+#include <cpu.h>
+#include <smp.h>
+#include <util/atomic.h>
+
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static const uint32 kRootBits = 16;
+static const uint32 kRootSize = 1 << kRootBits;
+static const uint32 kLevelBits = 8;
+static const uint32 kLevelSize = 1 << kLevelBits;
+static const uint32 kMaxLevels = 16;
+static const uint32 kMaxSkip = kMaxLevels - 1;
+
+// Entries pointing to another table have this bit set
+static const addr_t kTableFlag = 1;
+
+
+struct ForwardingTable::reader_slot {
+	int32	count[2];
+	uint8	_reserved[CACHE_LINE_SIZE - 2 * sizeof(int32)];
+};
+
+/*!	A table below the root. Before its entries are indexed, it skips \c skip
+	bytes of the address, which all prefixes stored in it share with \c key.
+	An address that differs from the key there gets the \c fallback value,
+	the value of the slot that points to the table, as if the table wasn't
+	there. \c next links tables that wait to be freed, as lookups might still
+	be reading their entries.
+*/
+struct ForwardingTable::trie_table {
+	addr_t			entries[kLevelSize];
+	addr_t			fallback;
+	trie_table*		next;
+	uint8			skip;
+	uint8			key[kMaxSkip];
+};
+
+
+static inline addr_t
+get_entry(const addr_t* slot)
+{
+	return *(volatile const addr_t*)slot;
+}
+
+
+/*!	Stores an entry, making sure everything written before (ie. the contents
+	of a new table) is visible to readers that see the new entry.
+*/
+static inline void
+set_entry(addr_t* slot, addr_t entry)
+{
+	atomic_pointer_set((void**)slot, (void*)entry);
+}
+
+
+static inline ForwardingTable::trie_table*
+entry_table(addr_t entry)
+{
+	return (ForwardingTable::trie_table*)(entry & ~kTableFlag);
+}
+
+
+static inline addr_t
+table_entry(ForwardingTable::trie_table* table)
+{
+	return (addr_t)table | kTableFlag;
+}
+
+
+static inline uint32
+root_index(const uint8* address)
+{
+	return ((uint32)address[0] << 8) | address[1];
+}
+
+
+/*!	Returns whether all addresses that lead to \a table get the same value,
+	so that the table can be replaced by it.
+*/
+static bool
+is_uniform(const ForwardingTable::trie_table* table)
+{
+	addr_t first = table->entries[0];
+	if ((first & kTableFlag) != 0
+		|| (table->skip != 0 && table->fallback != first))
+		return false;
+
+	for (uint32 i = 1; i < kLevelSize; i++) {
+		if (table->entries[i] != first)
+			return false;
+	}
+	return true;
+}
+
+
+/*!	Returns the number of bytes of \a table's key that \a prefix, which is
+	\a length bits long, can pass; its first byte is compared to the key at
+	bit \a start. If this is less than the table's skip, \a prefix cannot
+	be stored below the table without splitting it there.
+*/
+static uint32
+matching_key_bytes(const ForwardingTable::trie_table* table,
+	const uint8* prefix, uint32 start, uint32 length)
+{
+	// the prefix ends in this byte, which must be indexed by a table
+	uint32 lastByte = (length - 1) / 8 - start / 8;
+
+	for (uint32 i = 0; i < table->skip; i++) {
+		if (i == lastByte || prefix[start / 8 + i] != table->key[i])
+			return i;
+	}
+	return table->skip;
+}
+
+
+//	#pragma mark -
+
+
+ForwardingTable::ForwardingTable()
+	:
+	fRoot(NULL),
+	fAddressBits(0),
+	fPrefixLength(NULL),
+	fTableCount(0),
+	fRetiredTables(NULL),
+	fEpoch(0),
+	fReaders(NULL)
+{
+}
+
+
+ForwardingTable::~ForwardingTable()
+{
+	if (fRoot != NULL) {
+		for (uint32 i = 0; i < kRootSize; i++) {
+			if ((fRoot[i] & kTableFlag) != 0)
+				_FreeTable(entry_table(fRoot[i]), true);
+		}
+		free(fRoot);
+	}
+
+	while (fRetiredTables != NULL) {
+		trie_table* table = fRetiredTables;
+		fRetiredTables = table->next;
+		_FreeTable(table, false);
+	}
+
+	free(fReaders);
+}
+
+
+status_t
+ForwardingTable::Init(uint32 addressBits, prefix_length_func prefixLength)
+{
+	if (addressBits <= kRootBits || addressBits % kLevelBits != 0
+		|| addressBits > kRootBits + (kMaxLevels - 1) * kLevelBits)
+		return B_BAD_VALUE;
+
+	int32 readerCount = smp_get_num_cpus();
+	fReaders = (reader_slot*)memalign(CACHE_LINE_SIZE,
+		readerCount * sizeof(reader_slot));
+	if (fReaders == NULL)
+		return B_NO_MEMORY;
+
+	memset(fReaders, 0, readerCount * sizeof(reader_slot));
+
+	fRoot = (addr_t*)calloc(kRootSize, sizeof(addr_t));
+	if (fRoot == NULL) {
+		free(fReaders);
+		fReaders = NULL;
+		return B_NO_MEMORY;
+	}
+
+	fAddressBits = addressBits;
+	fPrefixLength = prefixLength;
+	return B_OK;
+}
+
+
+/*!	Adds a route for the \a length bits long \a prefix. It replaces all
+	routes that have a shorter, or the same prefix length.
+	If this fails, the table might contain parts of the prefix only.
+*/
+status_t
+ForwardingTable::Insert(const uint8* prefix, uint8 length, void* value)
+{
+	if (fRoot == NULL)
+		return B_NO_INIT;
+	if (length > fAddressBits || value == NULL
+		|| ((addr_t)value & kTableFlag) != 0)
+		return B_BAD_VALUE;
+
+	addr_t* entries = fRoot;
+	uint32 start = 0;
+	uint32 bits = kRootBits;
+	uint32 index = root_index(prefix);
+
+	while (length > start + bits) {
+		addr_t* slot = &entries[index];
+		addr_t entry = *slot;
+		trie_table* table;
+		start += bits;
+
+		if ((entry & kTableFlag) == 0) {
+			// expand the entry into a table of its own, that skips right to
+			// the byte the prefix ends in
+			table = _AllocateTable(entry, prefix + start / 8,
+				(length - 1) / 8 - start / 8);
+			if (table == NULL)
+				return B_NO_MEMORY;
+
+			set_entry(slot, table_entry(table));
+		} else {
+			table = entry_table(entry);
+
+			uint32 matching = matching_key_bytes(table, prefix, start,
+				length);
+			if (matching < table->skip) {
+				// the prefix leaves the key of the table, or ends within it
+				table = _Split(slot, matching);
+				if (table == NULL)
+					return B_NO_MEMORY;
+			}
+		}
+
+		entries = table->entries;
+		start += table->skip * 8;
+		bits = kLevelBits;
+		index = prefix[start / 8];
+	}
+
+	uint32 expansion = start + bits - length;
+	index &= ~((1UL << expansion) - 1);
+
+	for (uint32 i = 0; i < (1UL << expansion); i++)
+		_Set(&entries[index + i], value, length);
+
+	return B_OK;
+}
+
+
+/*!	Replaces all occurrences of \a oldValue within the \a length bits long
+	\a prefix with \a newValue, which may be \c NULL.
+	To remove a route, \a newValue should be the route with the next shorter
+	prefix that covers \a prefix.
+*/
+void
+ForwardingTable::Replace(const uint8* prefix, uint8 length, void* oldValue,
+	void* newValue)
+{
+	if (fRoot == NULL || length > fAddressBits)
+		return;
+
+	addr_t* path[kMaxLevels];
+	addr_t* entries = fRoot;
+	uint32 depth = 0;
+	uint32 start = 0;
+	uint32 bits = kRootBits;
+	uint32 index = root_index(prefix);
+
+	while (length > start + bits) {
+		addr_t* slot = &entries[index];
+		addr_t entry = *slot;
+		if ((entry & kTableFlag) == 0) {
+			// there is no longer prefix below this entry
+			return;
+		}
+
+		trie_table* table = entry_table(entry);
+		start += bits;
+		if (matching_key_bytes(table, prefix, start, length) < table->skip) {
+			// the prefix has never been inserted
+			return;
+		}
+
+		path[depth++] = slot;
+		entries = table->entries;
+		start += table->skip * 8;
+		bits = kLevelBits;
+		index = prefix[start / 8];
+	}
+
+	uint32 expansion = start + bits - length;
+	index &= ~((1UL << expansion) - 1);
+
+	for (uint32 i = 0; i < (1UL << expansion); i++)
+		_Replace(&entries[index + i], oldValue, newValue);
+
+	// Tables that have become uniform are no longer needed, and those that
+	// only lead to a single other table are merged with it
+	while (depth > 0) {
+		addr_t* slot = path[--depth];
+		trie_table* table = entry_table(*slot);
+
+		if (is_uniform(table)) {
+			set_entry(slot, table->entries[0]);
+			_RetireTable(table);
+		} else if (!_Merge(slot))
+			break;
+	}
+}
+
+
+/*!	Marks the beginning of a lookup; the returned cookie must be passed to
+	ExitRead(). This never blocks.
+*/
+int32
+ForwardingTable::EnterRead()
+{
+	int32 slot = smp_get_current_cpu() % smp_get_num_cpus();
+
+	while (true) {
+		int32 epoch = atomic_get(&fEpoch);
+		int32* count = &fReaders[slot].count[epoch & 1];
+		atomic_add(count, 1);
+
+		// Synchronize() may have flipped the epoch after we read it, and
+		// already found our counter empty. If so, we must not access the table
+		// under the old epoch; try again with the new one.
+		if (atomic_get(&fEpoch) == epoch) {
+			// don't let the table loads be done before the counter update
+			memory_full_barrier();
+			return (slot << 1) | (epoch & 1);
+		}
+
+		atomic_add(count, -1);
+	}
+}
+
+
+void
+ForwardingTable::ExitRead(int32 cookie)
+{
+	// complete the table loads before the counter update
+	memory_full_barrier();
+	atomic_add(&fReaders[cookie >> 1].count[cookie & 1], -1);
+}
+
+
+/*!	Returns the value with the longest prefix matching \a address, or \c NULL.
+	Must be called between EnterRead() and ExitRead().
+*/
+void*
+ForwardingTable::Lookup(const uint8* address) const
+{
+	if (fRoot == NULL)
+		return NULL;
+
+	addr_t entry = get_entry(&fRoot[root_index(address)]);
+	const uint8* next = address + kRootBits / 8;
+
+	while ((entry & kTableFlag) != 0) {
+		const trie_table* table = entry_table(entry);
+		if (table->skip != 0) {
+			if (memcmp(next, table->key, table->skip) != 0)
+				return (void*)get_entry(&table->fallback);
+			next += table->skip;
+		}
+
+		entry = get_entry(&table->entries[*next++]);
+	}
+
+	return (void*)entry;
+}
+
+
+/*!	Waits until all lookups that could still see values or tables that have
+	been replaced have finished, and frees the tables that were removed.
+	Must not be called between EnterRead() and ExitRead().
+*/
+void
+ForwardingTable::Synchronize()
+{
+	if (fReaders == NULL)
+		return;
+
+	int32 epoch = atomic_add(&fEpoch, 1) & 1;
+	int32 readerCount = smp_get_num_cpus();
+
+	while (true) {
+		int32 readers = 0;
+		for (int32 i = 0; i < readerCount; i++)
+			readers += atomic_get(&fReaders[i].count[epoch]);
+
+		if (readers == 0)
+			break;
+
+		snooze(100);
+	}
+
+	while (fRetiredTables != NULL) {
+		trie_table* table = fRetiredTables;
+		fRetiredTables = table->next;
+		_FreeTable(table, false);
+	}
+}
+
+
+size_t
+ForwardingTable::MemoryUsage() const
+{
+	return fTableCount * sizeof(trie_table);
+}
+
+
+void
+ForwardingTable::_Set(addr_t* slot, void* value, uint8 length)
+{
+	addr_t entry = *slot;
+
+	if ((entry & kTableFlag) != 0) {
+		trie_table* table = entry_table(entry);
+		_Set(&table->fallback, value, length);
+		for (uint32 i = 0; i < kLevelSize; i++)
+			_Set(&table->entries[i], value, length);
+		return;
+	}
+
+	if (entry == 0 || fPrefixLength((void*)entry) <= length)
+		set_entry(slot, (addr_t)value);
+}
+
+
+void
+ForwardingTable::_Replace(addr_t* slot, void* oldValue, void* newValue)
+{
+	addr_t entry = *slot;
+
+	if ((entry & kTableFlag) != 0) {
+		trie_table* table = entry_table(entry);
+		_Replace(&table->fallback, oldValue, newValue);
+		for (uint32 i = 0; i < kLevelSize; i++)
+			_Replace(&table->entries[i], oldValue, newValue);
+
+		if (is_uniform(table)) {
+			set_entry(slot, table->entries[0]);
+			_RetireTable(table);
+		} else
+			_Merge(slot);
+		return;
+	}
+
+	if (entry == (addr_t)oldValue)
+		set_entry(slot, (addr_t)newValue);
+}
+
+
+/*!	Allocates a table whose entries all are \a initialEntry, and that skips
+	the \a skip bytes of \a key.
+*/
+ForwardingTable::trie_table*
+ForwardingTable::_AllocateTable(addr_t initialEntry, const uint8* key,
+	uint32 skip)
+{
+	trie_table* table = (trie_table*)malloc(sizeof(trie_table));
+	if (table == NULL)
+		return NULL;
+
+	for (uint32 i = 0; i < kLevelSize; i++)
+		table->entries[i] = initialEntry;
+
+	table->fallback = initialEntry;
+	table->next = NULL;
+	table->skip = skip;
+	memcpy(table->key, key, skip);
+
+	fTableCount++;
+	return table;
+}
+
+
+/*!	Splits the table \a slot points to after \a matching bytes of its key:
+	a new table that only skips these takes its place, and leads to a copy
+	of the table, that skips the rest of the key behind the byte the new
+	table indexes. Lookups see either the old table, or both new ones.
+	Returns the new table, or \c NULL if there was not enough memory.
+*/
+ForwardingTable::trie_table*
+ForwardingTable::_Split(addr_t* slot, uint32 matching)
+{
+	trie_table* table = entry_table(*slot);
+
+	trie_table* parent = _AllocateTable(table->fallback, table->key,
+		matching);
+	if (parent == NULL)
+		return NULL;
+
+	uint32 skip = table->skip - matching - 1;
+	trie_table* child = _AllocateTable(0, table->key + matching + 1, skip);
+	if (child == NULL) {
+		_FreeTable(parent, false);
+		return NULL;
+	}
+
+	memcpy(child->entries, table->entries, sizeof(child->entries));
+	child->fallback = table->fallback;
+	parent->entries[table->key[matching]] = table_entry(child);
+
+	set_entry(slot, table_entry(parent));
+	_RetireTable(table);
+	return parent;
+}
+
+
+/*!	If the only addresses of the table \a slot points to that don't get its
+	fallback value lead to another table, both are replaced by a single
+	table that skips the bytes in between.
+	Returns whether the tables have been merged.
+*/
+bool
+ForwardingTable::_Merge(addr_t* slot)
+{
+	trie_table* table = entry_table(*slot);
+	uint32 childIndex = kLevelSize;
+
+	for (uint32 i = 0; i < kLevelSize; i++) {
+		addr_t entry = table->entries[i];
+		if (entry == table->fallback)
+			continue;
+		if ((entry & kTableFlag) == 0 || childIndex != kLevelSize)
+			return false;
+
+		childIndex = i;
+	}
+
+	if (childIndex == kLevelSize)
+		return false;
+
+	trie_table* child = entry_table(table->entries[childIndex]);
+	uint32 skip = table->skip + 1 + child->skip;
+	if (child->fallback != table->fallback || skip > kMaxSkip)
+		return false;
+
+	trie_table* merged = _AllocateTable(0, table->key, table->skip);
+	if (merged == NULL)
+		return false;
+
+	merged->key[table->skip] = childIndex;
+	memcpy(merged->key + table->skip + 1, child->key, child->skip);
+	merged->skip = skip;
+	memcpy(merged->entries, child->entries, sizeof(merged->entries));
+	merged->fallback = child->fallback;
+
+	set_entry(slot, table_entry(merged));
+	_RetireTable(table);
+	_RetireTable(child);
+	return true;
+}
+
+
+/*!	Queues a table that has been unlinked to be freed by the next
+	Synchronize(), as lookups might still be using it.
+*/
+void
+ForwardingTable::_RetireTable(trie_table* table)
+{
+	table->next = fRetiredTables;
+	fRetiredTables = table;
+}
+
+
+void
+ForwardingTable::_FreeTable(trie_table* table, bool recursive)
+{
+	if (recursive) {
+		for (uint32 i = 0; i < kLevelSize; i++) {
+			if ((table->entries[i] & kTableFlag) != 0)
+				_FreeTable(entry_table(table->entries[i]), true);
+		}
+	}
+
+	free(table);
+	fTableCount--;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef FIB_H
+#define FIB_H
+
+
+#include <SupportDefs.h>
+
+
+/*!	A multibit trie mapping address prefixes to routes (or any other values
+	that are at least 2 byte aligned) for longest prefix matching.
+
+	The first 16 bits of an address are resolved by a single root table,
+	every following level resolves another 8 bits. Prefixes that end within
+	a level are expanded to all of its entries they cover, so that a lookup
+	never needs to backtrack: an IPv4 lookup takes at most three memory
+	accesses.
+
+	The levels are path compressed: a table first compares the bytes all of
+	its prefixes have in common, and only indexes the byte after them. A
+	long IPv6 prefix therefore only needs a table where it branches off from
+	the others, instead of one for each of its bytes.
+
+	Lookups don't need any locks, they only need to be enclosed by
+	EnterRead() and ExitRead(). Changes must be serialized by the caller;
+	values and memory that are no longer referenced by the table may only be
+	freed after Synchronize() returned.
+*/
+class ForwardingTable {
+public:
+	typedef uint8 (*prefix_length_func)(const void* value);
+
+								ForwardingTable();
+								~ForwardingTable();
+
+			status_t			Init(uint32 addressBits,
+									prefix_length_func prefixLength);
+			bool				IsEnabled() const
+									{ return fRoot != NULL; }
+
+			status_t			Insert(const uint8* prefix, uint8 length,
+									void* value);
+			void				Replace(const uint8* prefix, uint8 length,
+									void* oldValue, void* newValue);
+
+			int32				EnterRead();
+			void				ExitRead(int32 cookie);
+			void*				Lookup(const uint8* address) const;
+
+			void				Synchronize();
+
+			size_t				TableCount() const
+									{ return fTableCount; }
+			size_t				MemoryUsage() const;
+
+			struct trie_table;
+
+private:
+			struct reader_slot;
+
+			void				_Set(addr_t* slot, void* value,
+									uint8 length);
+			void				_Replace(addr_t* slot, void* oldValue,
+									void* newValue);
+			trie_table*			_AllocateTable(addr_t initialEntry,
+									const uint8* key, uint32 skip);
+			trie_table*			_Split(addr_t* slot, uint32 matching);
+			bool				_Merge(addr_t* slot);
+			void				_RetireTable(trie_table* table);
+			void				_FreeTable(trie_table* table,
+									bool recursive);
+
+private:
+			addr_t*				fRoot;
+			uint32				fAddressBits;
+			prefix_length_func	fPrefixLength;
+			size_t				fTableCount;
+			trie_table*			fRetiredTables;
+
+			int32				fEpoch;
+			reader_slot*		fReaders;
+};
+
+
+#endif	// FIB_H
@@ -71,6 +71,9 @@ struct data_header {
 	uint8*			data_end;
 	header_space	space;
 	uint16			tail_space;
+	int64			checksum_cache;
+		// the checksum of a range of data in this header, see
+		// set_checksum_cache()
 };
 
 struct data_node {
@@ -154,6 +157,14 @@ struct net_buffer_private : net_buffer {
 #define MAX_FREE_BUFFER_SIZE			(BUFFER_SIZE - DATA_HEADER_SIZE)
 
 
+// The slab depot keeps per-CPU magazines of free objects; the default
+// magazines for objects of our size are rather small for the rates at which
+// buffers are allocated and freed under load.
+static const size_t kNetBufferMagazineCapacity = 64;
+static const size_t kNetBufferMaxMagazineCount = 32;
+static const size_t kDataHeaderMagazineCapacity = 32;
+static const size_t kDataHeaderMaxMagazineCount = 16;
+
 static object_cache* sNetBufferCache;
 static object_cache* sDataNodeCache;
 
@@ -175,6 +186,12 @@ static int32 sEverAllocatedDataHeaderCount = 0;
 static int32 sEverAllocatedNetBufferCount = 0;
 static int32 sMaxAllocatedDataHeaderCount = 0;
 static int32 sMaxAllocatedNetBufferCount = 0;
+static int32 sChecksumCacheHits = 0;
+
+// used to compute the allocation rates since the last dump
+static bigtime_t sLastStatsTime = 0;
+static int32 sLastEverAllocatedDataHeaderCount = 0;
+static int32 sLastEverAllocatedNetBufferCount = 0;
 #endif
 
 
@@ -653,15 +670,40 @@ dump_net_buffer(int argc, char** argv)
 
 #if ENABLE_STATS
 
+static int32
+allocation_rate(int32 count, int32 lastCount, bigtime_t interval)
+{
+	if (interval <= 0)
+		return 0;
+
+	return (int32)((int64)(uint32)(count - lastCount) * 1000000 / interval);
+}
+
+
 static int
 dump_net_buffer_stats(int argc, char** argv)
 {
+	bigtime_t now = system_time();
+	bigtime_t interval = now - sLastStatsTime;
+
 	kprintf("allocated data headers: %7" B_PRId32 " / %7" B_PRId32 ", peak %7"
-		B_PRId32 "\n", sAllocatedDataHeaderCount, sEverAllocatedDataHeaderCount,
-		sMaxAllocatedDataHeaderCount);
+		B_PRId32 ", %7" B_PRId32 "/s\n", sAllocatedDataHeaderCount,
+		sEverAllocatedDataHeaderCount, sMaxAllocatedDataHeaderCount,
+		allocation_rate(sEverAllocatedDataHeaderCount,
+			sLastEverAllocatedDataHeaderCount, interval));
 	kprintf("allocated net buffers:  %7" B_PRId32 " / %7" B_PRId32 ", peak %7"
-		B_PRId32 "\n", sAllocatedNetBufferCount, sEverAllocatedNetBufferCount,
-		sMaxAllocatedNetBufferCount);
+		B_PRId32 ", %7" B_PRId32 "/s\n", sAllocatedNetBufferCount,
+		sEverAllocatedNetBufferCount, sMaxAllocatedNetBufferCount,
+		allocation_rate(sEverAllocatedNetBufferCount,
+			sLastEverAllocatedNetBufferCount, interval));
+	kprintf("  (rates over the last %" B_PRId64 " ms)\n", interval / 1000);
+
+	sLastStatsTime = now;
+	sLastEverAllocatedDataHeaderCount = sEverAllocatedDataHeaderCount;
+	sLastEverAllocatedNetBufferCount = sEverAllocatedNetBufferCount;
+
+	kprintf("checksum cache hits:    %7" B_PRId32 "\n", sChecksumCacheHits);
+	kprintf("checksum routines:      %s\n", current_checksum_kernel()->name);
 	return 0;
 }
 
@@ -817,6 +859,7 @@ create_data_header(size_t headerSpace)
 	header->tail_space = (uint8*)header + BUFFER_SIZE - header->data_end
 		- headerSpace;
 	header->first_free = NULL;
+	header->checksum_cache = 0;
 
 	TRACE(("%d:   create new data header %p\n", find_thread(NULL), header));
 	T2(CreateDataHeader(header));
@@ -846,6 +889,84 @@ acquire_data_header(data_header* header)
 }
 
 
+/*!	Remembers the checksum of the \a size bytes at \a start in \a header.
+	The range and its checksum are packed into a single value, so that they
+	can be read and replaced atomically, as the header might be shared by
+	several buffers.
+*/
+static inline void
+set_checksum_cache(data_header* header, uint8* start, size_t size,
+	uint16 checksum)
+{
+	if (start < (uint8*)header || start + size > (uint8*)header + BUFFER_SIZE
+		|| size == 0) {
+		atomic_set64(&header->checksum_cache, 0);
+		return;
+	}
+
+	uint64 offset = start - (uint8*)header;
+	atomic_set64(&header->checksum_cache,
+		offset | ((uint64)size << 16) | ((uint64)checksum << 32));
+}
+
+
+static inline bool
+get_checksum_cache(data_header* header, uint8*& start, size_t& size,
+	uint16& checksum)
+{
+	uint64 cache = atomic_get64(&header->checksum_cache);
+	size = (cache >> 16) & 0xffff;
+	if (size == 0)
+		return false;
+
+	start = (uint8*)header + (cache & 0xffff);
+	checksum = (uint16)(cache >> 32);
+	return true;
+}
+
+
+/*!	Must be called before the \a size bytes at \a start are changed, so that
+	the cached checksum of \a header is thrown away if it covers them.
+*/
+static inline void
+invalidate_checksum_cache(data_header* header, uint8* start, size_t size)
+{
+	uint8* cacheStart;
+	size_t cacheSize;
+	uint16 checksum;
+	if (get_checksum_cache(header, cacheStart, cacheSize, checksum)
+		&& start < cacheStart + cacheSize && cacheStart < start + size)
+		atomic_set64(&header->checksum_cache, 0);
+}
+
+
+/*!	Adds the checksum of the \a size bytes that were just written to \a start
+	to the checksum cache of the \a node's header. If it extends the range
+	already cached, both are combined, otherwise the cache is replaced.
+*/
+static void
+update_checksum_cache(data_node* node, uint8* start, size_t size,
+	uint16 checksum)
+{
+	if ((node->flags & DATA_NODE_EXTERNAL) != 0)
+		return;
+
+	data_header* header = node->header;
+
+	uint8* cacheStart;
+	size_t cacheSize;
+	uint16 cached;
+	if (get_checksum_cache(header, cacheStart, cacheSize, cached)
+		&& cacheStart + cacheSize == start) {
+		checksum = add_checksum(cached, checksum, (cacheSize & 1) != 0);
+		start = cacheStart;
+		size += cacheSize;
+	}
+
+	set_checksum_cache(header, start, size, checksum);
+}
+
+
 static void
 free_data_header_space(data_header* header, uint8* data, size_t size)
 {
@@ -879,6 +1000,7 @@ alloc_data_header_space(data_header* header, size_t size)
 		// thus the free space entries will always have the right size.
 		uint8* data = (uint8*)header->first_free;
 		header->first_free = header->first_free->next;
+		invalidate_checksum_cache(header, data, size);
 		return data;
 	}
 
@@ -890,6 +1012,7 @@ alloc_data_header_space(data_header* header, size_t size)
 			if (last != NULL && freeData->size >= size) {
 				// take this one
 				last->next = freeData->next;
+				invalidate_checksum_cache(header, (uint8*)freeData, size);
 				return (uint8*)freeData;
 			}
 
@@ -906,6 +1029,7 @@ alloc_data_header_space(data_header* header, size_t size)
 	header->data_end += size;
 	header->space.free -= size;
 
+	invalidate_checksum_cache(header, data, size);
 	return data;
 }
 
@@ -1492,6 +1616,8 @@ write_data(net_buffer* _buffer, size_t offset, const void* data, size_t size)
 
 	while (true) {
 		size_t written = min_c(size, node->used - offset);
+		invalidate_checksum_cache(node->header, node->start + offset, written);
+
 		if (IS_USER_ADDRESS(data)) {
 			if (user_memcpy(node->start + offset, data, written) != B_OK)
 				return B_BAD_ADDRESS;
@@ -1516,6 +1642,47 @@ write_data(net_buffer* _buffer, size_t offset, const void* data, size_t size)
 }
 
 
+/*!	Like write_data(), but also computes the checksum of the data while
+	copying it, and remembers it in the data headers, so that checksum_data()
+	doesn't need to read the data again. \a node must be the node containing
+	\a offset.
+*/
+static status_t
+write_data_checksummed(net_buffer_private* buffer, data_node* node,
+	size_t offset, const void* data, size_t size)
+{
+	offset -= node->offset;
+
+	while (true) {
+		size_t written = min_c(size, node->used - offset);
+		uint8* target = node->start + offset;
+
+		uint16 checksum;
+		if (user_copy_and_checksum(target, (const uint8*)data, written,
+				&checksum) != B_OK) {
+			invalidate_checksum_cache(node->header, target, written);
+			return B_BAD_ADDRESS;
+		}
+		update_checksum_cache(node, target, written, checksum);
+
+		size -= written;
+		if (size == 0)
+			break;
+
+		offset = 0;
+		data = (void*)((uint8*)data + written);
+
+		node = (data_node*)list_get_next_item(&buffer->buffers, node);
+		if (node == NULL)
+			return B_BAD_VALUE;
+	}
+
+	CHECK_BUFFER(buffer);
+
+	return B_OK;
+}
+
+
 static status_t
 read_data(net_buffer* _buffer, size_t offset, void* data, size_t size)
 {
@@ -1619,6 +1786,7 @@ prepend_size(net_buffer* _buffer, size_t size, void** _contiguousBuffer)
 			node->SubtractHeaderSpace(willConsume);
 			node->start -= willConsume;
 			node->used += willConsume;
+			invalidate_checksum_cache(node->header, node->start, willConsume);
 			bytesLeft -= willConsume;
 			sizePrepended += willConsume;
 		} while (bytesLeft > 0);
@@ -1640,6 +1808,7 @@ prepend_size(net_buffer* _buffer, size_t size, void** _contiguousBuffer)
 		node->SubtractHeaderSpace(size);
 		node->start -= size;
 		node->used += size;
+		invalidate_checksum_cache(node->header, node->start, size);
 
 		if (_contiguousBuffer)
 			*_contiguousBuffer = node->start;
@@ -1713,6 +1882,8 @@ append_size(net_buffer* _buffer, size_t size, void** _contiguousBuffer)
 		uint32 sizeUsed = MAX_FREE_BUFFER_SIZE - headerSpace;
 
 		// allocate space left in the node
+		invalidate_checksum_cache(node->header, node->start + node->used,
+			previousTailSpace);
 		node->SetTailSpace(0);
 		node->used += previousTailSpace;
 		buffer->size += previousTailSpace;
@@ -1768,6 +1939,7 @@ append_size(net_buffer* _buffer, size_t size, void** _contiguousBuffer)
 
 	// the data fits into this buffer
 	node->SetTailSpace(node->TailSpace() - size);
+	invalidate_checksum_cache(node->header, node->start + node->used, size);
 
 	if (_contiguousBuffer)
 		*_contiguousBuffer = node->start + node->used;
@@ -1795,16 +1967,18 @@ append_data(net_buffer* buffer, const void* data, size_t size)
 	if (status < B_OK)
 		return status;
 
-	if (contiguousBuffer) {
-		if (IS_USER_ADDRESS(data)) {
-			if (user_memcpy(contiguousBuffer, data, size) != B_OK)
-				return B_BAD_ADDRESS;
-		} else
-			memcpy(contiguousBuffer, data, size);
-	} else
-		write_data(buffer, used, data, size);
+	// Most of the data that is appended is going to be sent, so we compute
+	// its checksum while we have to touch it anyway
+	net_buffer_private* privateBuffer = (net_buffer_private*)buffer;
+	data_node* node;
+	if (contiguousBuffer != NULL)
+		node = (data_node*)list_get_last_item(&privateBuffer->buffers);
+	else
+		node = get_node_at_offset(privateBuffer, used);
+	if (node == NULL)
+		return B_BAD_VALUE;
 
-	return B_OK;
+	return write_data_checksummed(privateBuffer, node, used, data, size);
 }
 
 
@@ -2212,11 +2386,43 @@ direct_access(net_buffer* _buffer, uint32 offset, size_t size,
 	if (size > node->used - offset)
 		return B_ERROR;
 
+	// the caller may change the data
+	invalidate_checksum_cache(node->header, node->start + offset, size);
+
 	*_contiguousBuffer = node->start + offset;
 	return B_OK;
 }
 
 
+/*!	Computes the checksum of the \a size bytes at \a start of \a node, using
+	the checksum cached in the node's header where possible.
+*/
+static uint16
+checksum_node_data(data_node* node, uint8* start, size_t size)
+{
+	uint8* cacheStart;
+	size_t cacheSize;
+	uint16 cached;
+	if ((node->flags & DATA_NODE_EXTERNAL) != 0
+		|| !get_checksum_cache(node->header, cacheStart, cacheSize, cached)
+		|| cacheStart < start || cacheStart + cacheSize > start + size) {
+		return compute_checksum(start, size);
+	}
+
+#if ENABLE_STATS
+	atomic_add(&sChecksumCacheHits, 1);
+#endif
+
+	size_t before = cacheStart - start;
+	size_t after = before + cacheSize;
+
+	uint16 sum = compute_checksum(start, before);
+	sum = add_checksum(sum, cached, (before & 1) != 0);
+	return add_checksum(sum, compute_checksum(cacheStart + cacheSize,
+		size - after), (after & 1) != 0);
+}
+
+
 static int32
 checksum_data(net_buffer* _buffer, uint32 offset, size_t size, bool finalize)
 {
@@ -2241,9 +2447,10 @@ checksum_data(net_buffer* _buffer, uint32 offset, size_t size, bool finalize)
 		size_t bytes = min_c(size, node->used - offset);
 		if ((offset + node->offset) & 1) {
 			// if we're at an uneven offset, we have to swap the checksum
-			sum += __swap_int16(compute_checksum(node->start + offset, bytes));
+			sum += __swap_int16(checksum_node_data(node, node->start + offset,
+				bytes));
 		} else
-			sum += compute_checksum(node->start + offset, bytes);
+			sum += checksum_node_data(node, node->start + offset, bytes);
 
 		size -= bytes;
 		if (size == 0)
@@ -2361,19 +2568,22 @@ std_ops(int32 op, ...)
 			// TODO: improve our code a bit so we can add constructors
 			//	and keep around half-constructed buffers in the slab
 
-			sNetBufferCache = create_object_cache("net buffer cache",
-				sizeof(net_buffer_private), 0);
+			sNetBufferCache = create_object_cache_etc("net buffer cache",
+				sizeof(net_buffer_private), 0, 0, kNetBufferMagazineCapacity,
+				kNetBufferMaxMagazineCount, 0, NULL, NULL, NULL, NULL);
 			if (sNetBufferCache == NULL)
 				return B_NO_MEMORY;
 
-			sDataNodeCache = create_object_cache("data node cache",
-				BUFFER_SIZE, 0);
+			sDataNodeCache = create_object_cache_etc("data node cache",
+				BUFFER_SIZE, 0, 0, kDataHeaderMagazineCapacity,
+				kDataHeaderMaxMagazineCount, 0, NULL, NULL, NULL, NULL);
 			if (sDataNodeCache == NULL) {
 				delete_object_cache(sNetBufferCache);
 				return B_NO_MEMORY;
 			}
 
 #if ENABLE_STATS
+			sLastStatsTime = system_time();
 			add_debugger_command_etc("net_buffer_stats", &dump_net_buffer_stats,
 				"Print net buffer statistics",
 				"\nPrint net buffer statistics.\n", 0);
@@ -34,6 +34,7 @@
 #include <net_stat.h>
 
 #include "ancillary_data.h"
+#include "routes.h"
 #include "utility.h"
 
 
@@ -68,6 +69,8 @@ struct net_socket_private : net_socket,
 
 	bool						is_connected;
 	bool						is_in_socket_list;
+
+	struct route_cache			route_cache;
 };
 
 
@@ -101,6 +104,7 @@ net_socket_private::net_socket_private()
 	peer.ss_len = 0;
 
 	mutex_init(&lock, "socket");
+	init_route_cache(&route_cache);
 
 	// set defaults (may be overridden by the protocols)
 	send.buffer_size = 65535;
@@ -136,6 +140,7 @@ net_socket_private::~net_socket_private()
 
 	mutex_unlock(&lock);
 
+	flush_route_cache(&route_cache);
 	put_domain_protocols(this);
 
 	mutex_destroy(&lock);
@@ -457,6 +462,13 @@ socket_free(net_socket* _socket)
 }
 
 
+route_cache*
+socket_route_cache(net_socket* socket)
+{
+	return &((net_socket_private*)socket)->route_cache;
+}
+
+
 status_t
 socket_control(net_socket* socket, uint32 op, void* data, size_t length)
 {
@@ -1437,6 +1449,11 @@ socket_send(net_socket* socket, msghdr* header, const void* data, size_t length,
 				// this appears to be a partial write
 				return bytesSent + (bufferSize - sizeAfterSend);
 			}
+			if (socket->type == SOCK_DGRAM && sizeAfterSend < bufferSize) {
+				// the protocol sent the buffer as several datagrams (as UDP
+				// does with UDP_SEGMENT), and only a later one failed
+				return bytesSent + (bufferSize - sizeAfterSend);
+			}
 			return status;
 		}
 
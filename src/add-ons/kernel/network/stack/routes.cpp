@@ -23,6 +23,8 @@
 
 #include <net/if_dl.h>
 #include <net/route.h>
+#include <netinet/in.h>
+#include <netinet6/in6.h>
 #include <new>
 #include <stdlib.h>
 #include <string.h>
@@ -40,6 +42,7 @@
 net_route_private::net_route_private()
 {
 	destination = mask = gateway = NULL;
+	prefix_length = 0;
 }
 
 
@@ -51,9 +54,266 @@ net_route_private::~net_route_private()
 }
 
 
+typedef DoublyLinkedList<route_cache> RouteCacheList;
+
+static mutex sRouteCachesLock = MUTEX_INITIALIZER("route caches");
+static RouteCacheList sRouteCaches;
+
+
 //	#pragma mark - private functions
 
 
+/*!	Returns the raw address bits of \a address, or \c NULL if the forwarding
+	table does not support the address family.
+*/
+static const uint8*
+address_bits(const sockaddr* address, int family, uint32* _bitCount = NULL)
+{
+	if (address == NULL || address->sa_family != family)
+		return NULL;
+
+	switch (family) {
+		case AF_INET:
+			if (_bitCount != NULL)
+				*_bitCount = 32;
+			return (const uint8*)&((const sockaddr_in*)address)->sin_addr;
+		case AF_INET6:
+			if (_bitCount != NULL)
+				*_bitCount = 128;
+			return (const uint8*)&((const sockaddr_in6*)address)->sin6_addr;
+	}
+
+	return NULL;
+}
+
+
+static uint8
+route_prefix_length(const void* route)
+{
+	return ((const net_route_private*)route)->prefix_length;
+}
+
+
+/*!	Computes the length of the route's prefix from its mask; routes without
+	a mask are host routes.
+*/
+static uint8
+compute_prefix_length(net_domain_private* domain, net_route_private* route)
+{
+	uint32 bitCount = 0;
+	sockaddr_storage probe;
+	probe.ss_family = domain->family;
+	if (address_bits((sockaddr*)&probe, domain->family, &bitCount) == NULL) {
+		// other families are only sorted by their masks' first bit
+		return 255 - domain->address_module->first_mask_bit(route->mask);
+	}
+
+	if (route->mask == NULL)
+		return bitCount;
+
+	const uint8* mask = address_bits(route->mask, domain->family);
+	if (mask == NULL)
+		return 0;
+
+	uint8 length = 0;
+	for (uint32 i = 0; i < bitCount / 8; i++) {
+		if (mask[i] == 0xff) {
+			length += 8;
+			continue;
+		}
+		for (uint8 bits = mask[i]; (bits & 0x80) != 0; bits <<= 1)
+			length++;
+		break;
+	}
+
+	return length;
+}
+
+
+static void
+release_route(net_route_private* route)
+{
+	if (route == NULL || atomic_add(&route->ref_count, -1) != 1)
+		return;
+
+	// delete route - it must already have been removed at this point
+	if (route->interface_address != NULL)
+		((InterfaceAddress*)route->interface_address)->ReleaseReference();
+
+	delete route;
+}
+
+
+/*!	Lets all route caches drop the routes they hold for \a domain. Called
+	after a route has been removed, since a cached route would otherwise
+	keep it, and the interface address it leads to, around until its socket
+	sends again.
+*/
+static void
+flush_route_caches(net_domain_private* domain)
+{
+	MutexLocker locker(sRouteCachesLock);
+
+	RouteCacheList::Iterator iterator = sRouteCaches.GetIterator();
+	while (route_cache* cache = iterator.Next()) {
+		InterruptsSpinLocker cacheLocker(cache->lock);
+		if (cache->domain != domain || cache->route == NULL)
+			continue;
+
+		net_route_private* route = cache->route;
+		cache->route = NULL;
+		cacheLocker.Unlock();
+
+		release_route(route);
+	}
+}
+
+
+static inline bool
+has_link(net_route_private* route)
+{
+	return (route->interface_address->interface->device->flags & IFF_LINK)
+		!= 0;
+}
+
+
+/*!	Returns whether \a route matches all addresses within the prefix of
+	\a other.
+*/
+static bool
+route_covers(net_domain_private* domain, net_route_private* route,
+	net_route_private* other)
+{
+	if (route->prefix_length > other->prefix_length)
+		return false;
+
+	if (route->mask == NULL) {
+		return domain->address_module->equal_addresses(route->destination,
+			other->destination);
+	}
+
+	return domain->address_module->equal_masked_addresses(route->destination,
+		other->destination, route->mask);
+}
+
+
+/*!	Enters a route that has just been added to the domain's route list into
+	the forwarding table. Of several routes to the same destination, only
+	the first one in the list is used, as in find_route().
+*/
+static void
+add_forwarding_entry(net_domain_private* domain, net_route_private* route)
+{
+	if (!domain->forwarding_table_valid)
+		return;
+
+	RouteList::Iterator iterator = domain->routes.GetIterator();
+	while (net_route_private* first = iterator.Next()) {
+		if (first->prefix_length != route->prefix_length
+			|| !route_covers(domain, first, route))
+			continue;
+
+		if (first != route)
+			return;
+		break;
+	}
+
+	status_t status = domain->forwarding_table.Insert(
+		address_bits(route->destination, domain->family),
+		route->prefix_length, route);
+	if (status != B_OK) {
+		// fall back to the route list for good
+		dprintf("net stack: could not update %s forwarding table: %s\n",
+			domain->name, strerror(status));
+		atomic_set(&domain->forwarding_table_valid, false);
+	}
+}
+
+
+/*!	Removes a route that has just been removed from the domain's route list
+	from the forwarding table. When this returns, no lookup can find the
+	route anymore.
+*/
+static void
+remove_forwarding_entry(net_domain_private* domain, net_route_private* route)
+{
+	if (!domain->forwarding_table.IsEnabled())
+		return;
+
+	// find the best route for the addresses the removed route covered
+	net_route_private* replacement = NULL;
+
+	RouteList::Iterator iterator = domain->routes.GetIterator();
+	while (net_route_private* other = iterator.Next()) {
+		if ((replacement == NULL
+				|| other->prefix_length > replacement->prefix_length)
+			&& route_covers(domain, other, route))
+			replacement = other;
+	}
+
+	domain->forwarding_table.Replace(
+		address_bits(route->destination, domain->family),
+		route->prefix_length, route, replacement);
+	domain->forwarding_table.Synchronize();
+}
+
+
+/*!	Looks up the route for \a address in the forwarding table, without
+	holding the domain lock.
+	Returns \c false if the table cannot answer the request, and the route
+	list must be searched instead.
+*/
+static bool
+lookup_forwarding_table(net_domain_private* domain, const sockaddr* address,
+	net_route_private** _route)
+{
+	if (!atomic_get(&domain->forwarding_table_valid))
+		return false;
+
+	const uint8* bits = address_bits(address, domain->family);
+	if (bits == NULL)
+		return false;
+
+	ForwardingTable& table = domain->forwarding_table;
+	int32 cookie = table.EnterRead();
+
+	net_route_private* route = (net_route_private*)table.Lookup(bits);
+	if (route != NULL)
+		atomic_add(&route->ref_count, 1);
+
+	table.ExitRead(cookie);
+
+	if (route != NULL && !has_link(route)) {
+		// find_route() prefers routes to devices that have a link
+		release_route(route);
+		return false;
+	}
+
+	*_route = route;
+	return true;
+}
+
+
+/*!	Lets the source address of \a buffer default to the local address of
+	the interface \a route leads to.
+*/
+static status_t
+update_buffer_source(net_domain_private* domain, net_buffer* buffer,
+	net_route* route)
+{
+	// TODO: we are quite relaxed in the address checking here
+	// as we might proceed with source = INADDR_ANY.
+
+	if (route->interface_address != NULL
+		&& route->interface_address->local != NULL) {
+		return domain->address_module->update_to(buffer->source,
+			route->interface_address->local);
+	}
+
+	return B_OK;
+}
+
+
 static status_t
 user_copy_address(const sockaddr* from, sockaddr** to)
 {
@@ -188,19 +448,11 @@ find_route(net_domain* _domain, const sockaddr* address)
 
 
 static void
-put_route_internal(struct net_domain_private* domain, net_route* _route)
+put_route_internal(struct net_domain_private* domain, net_route* route)
 {
 	ASSERT_LOCKED_RECURSIVE(&domain->lock);
 
-	net_route_private* route = (net_route_private*)_route;
-	if (route == NULL || atomic_add(&route->ref_count, -1) != 1)
-		return;
-
-	// delete route - it must already have been removed at this point
-	if (route->interface_address != NULL)
-		((InterfaceAddress*)route->interface_address)->ReleaseReference();
-
-	delete route;
+	release_route((net_route_private*)route);
 }
 
 
@@ -490,6 +742,7 @@ add_route(struct net_domain* _domain, const struct net_route* newRoute)
 	((InterfaceAddress*)route->interface_address)->AcquireReference();
 	route->mtu = 0;
 	route->ref_count = 1;
+	route->prefix_length = compute_prefix_length(domain, route);
 
 	// Insert the route sorted by completeness of its mask
 
@@ -499,8 +752,7 @@ add_route(struct net_domain* _domain, const struct net_route* newRoute)
 	while ((before = iterator.Next()) != NULL) {
 		// if the before mask is less specific than the one of the route,
 		// we can insert it before that route.
-		if (domain->address_module->first_mask_bit(before->mask)
-				> domain->address_module->first_mask_bit(route->mask))
+		if (before->prefix_length < route->prefix_length)
 			break;
 
 		if ((route->flags & RTF_DEFAULT) != 0
@@ -514,6 +766,9 @@ add_route(struct net_domain* _domain, const struct net_route* newRoute)
 	}
 
 	domain->routes.InsertBefore(before, route);
+	add_forwarding_entry(domain, route);
+	atomic_add(&domain->route_generation, 1);
+
 	update_route_infos(domain);
 
 	return B_OK;
@@ -542,9 +797,12 @@ remove_route(struct net_domain* _domain, const struct net_route* removeRoute)
 		return B_ENTRY_NOT_FOUND;
 
 	domain->routes.Remove(route);
+	remove_forwarding_entry(domain, route);
+	atomic_add(&domain->route_generation, 1);
 
 	put_route_internal(domain, route);
 	update_route_infos(domain);
+	flush_route_caches(domain);
 
 	return B_OK;
 }
@@ -623,6 +881,11 @@ struct net_route*
 get_route(struct net_domain* _domain, const struct sockaddr* address)
 {
 	struct net_domain_private* domain = (net_domain_private*)_domain;
+
+	net_route_private* route;
+	if (lookup_forwarding_table(domain, address, &route))
+		return route;
+
 	RecursiveLocker locker(domain->lock);
 
 	return get_route_internal(domain, address);
@@ -652,26 +915,18 @@ get_buffer_route(net_domain* _domain, net_buffer* buffer, net_route** _route)
 {
 	net_domain_private* domain = (net_domain_private*)_domain;
 
-	RecursiveLocker _(domain->lock);
-
-	net_route* route = get_route_internal(domain, buffer->destination);
+	net_route_private* route;
+	if (!lookup_forwarding_table(domain, buffer->destination, &route)) {
+		RecursiveLocker _(domain->lock);
+		route = (net_route_private*)get_route_internal(domain,
+			buffer->destination);
+	}
 	if (route == NULL)
 		return ENETUNREACH;
 
-	status_t status = B_OK;
-	sockaddr* source = buffer->source;
-
-	// TODO: we are quite relaxed in the address checking here
-	// as we might proceed with source = INADDR_ANY.
-
-	if (route->interface_address != NULL
-		&& route->interface_address->local != NULL) {
-		status = domain->address_module->update_to(source,
-			route->interface_address->local);
-	}
-
+	status_t status = update_buffer_source(domain, buffer, route);
 	if (status != B_OK)
-		put_route_internal(domain, route);
+		release_route(route);
 	else
 		*_route = route;
 
@@ -686,9 +941,147 @@ put_route(struct net_domain* _domain, net_route* route)
 	if (domain == NULL || route == NULL)
 		return;
 
-	RecursiveLocker locker(domain->lock);
+	// Routes are only deleted after they have been removed from the domain,
+	// so this doesn't need the domain lock
+	release_route((net_route_private*)route);
+}
+
+
+/*!	Creates the forwarding table of the domain, if its address family is
+	supported. Otherwise, all lookups will search the route list.
+*/
+status_t
+init_forwarding_table(net_domain_private* domain)
+{
+	uint32 bitCount;
+	sockaddr address;
+	address.sa_family = domain->family;
+	if (address_bits(&address, domain->family, &bitCount) == NULL)
+		return B_OK;
+
+	status_t status = domain->forwarding_table.Init(bitCount,
+		&route_prefix_length);
+	if (status != B_OK)
+		return status;
+
+	domain->forwarding_table_valid = true;
+	return B_OK;
+}
+
+
+/*!	Initializes \a cache. This doesn't take any locks; the cache is only
+	registered, so that removing a route flushes it, once it is filled the
+	first time. flush_route_cache() must be called before it goes away.
+*/
+void
+init_route_cache(route_cache* cache)
+{
+	B_INITIALIZE_SPINLOCK(&cache->lock);
+	cache->route = NULL;
+	cache->domain = NULL;
+	cache->generation = 0;
+	cache->registered = false;
+}
+
+
+/*!	Releases the route \a cache holds, and unregisters it. Must not be called
+	while another thread could still use the cache.
+*/
+void
+flush_route_cache(route_cache* cache)
+{
+	if (cache->registered) {
+		MutexLocker listLocker(sRouteCachesLock);
+		sRouteCaches.Remove(cache);
+		cache->registered = false;
+	}
+
+	InterruptsSpinLocker locker(cache->lock);
+	net_route_private* route = cache->route;
+	cache->route = NULL;
+	locker.Unlock();
+
+	release_route(route);
+}
+
+
+/*!	Like get_buffer_route(), but first checks if \a cache still contains
+	the route to the buffer's destination, and updates it otherwise.
+*/
+status_t
+get_cached_buffer_route(route_cache* cache, net_domain* _domain,
+	net_buffer* buffer, net_route** _route)
+{
+	net_domain_private* domain = (net_domain_private*)_domain;
+	int32 generation = atomic_get(&domain->route_generation);
+	net_route_private* route = NULL;
+
+	InterruptsSpinLocker locker(cache->lock);
+
+	if (cache->route != NULL && cache->domain == domain
+		&& cache->generation == generation
+		&& domain->address_module->equal_addresses(
+			(sockaddr*)&cache->destination, buffer->destination)) {
+		route = cache->route;
+		atomic_add(&route->ref_count, 1);
+	}
+
+	locker.Unlock();
 
-	put_route_internal(domain, (net_route*)route);
+	if (route != NULL && has_link(route)) {
+		status_t status = update_buffer_source(domain, buffer, route);
+		if (status != B_OK) {
+			release_route(route);
+			return status;
+		}
+
+		*_route = route;
+		return B_OK;
+	}
+
+	release_route(route);
+
+	status_t status = get_buffer_route(domain, buffer, (net_route**)&route);
+	if (status != B_OK)
+		return status;
+
+	if (buffer->destination->sa_len > sizeof(sockaddr_storage)) {
+		*_route = route;
+		return B_OK;
+	}
+
+	if (!cache->registered) {
+		// Register before the route is cached, so that removing it will
+		// find the cache
+		MutexLocker listLocker(sRouteCachesLock);
+		if (!cache->registered) {
+			sRouteCaches.Add(cache);
+			cache->registered = true;
+		}
+	}
+
+	locker.Lock();
+
+	// If a route has been removed in the mean time, flush_route_caches() may
+	// already have been here, and the route must not be cached anymore.
+	net_route_private* previous = NULL;
+	if (atomic_get(&domain->route_generation) == generation) {
+		atomic_add(&route->ref_count, 1);
+
+		previous = cache->route;
+		cache->route = route;
+		cache->domain = domain;
+		cache->generation = generation;
+		memcpy(&cache->destination, buffer->destination,
+			buffer->destination->sa_len);
+	}
+
+	locker.Unlock();
+
+	release_route(previous);
+
+	*_route = route;
+	return B_OK;
 }
 
 
@@ -12,8 +12,11 @@
 #include <net_datalink.h>
 #include <net_stack.h>
 
+#include <lock.h>
 #include <util/DoublyLinkedList.h>
 
+#include <sys/socket.h>
+
 
 struct InterfaceAddress;
 
@@ -21,11 +24,29 @@ struct InterfaceAddress;
 struct net_route_private
 	: net_route, DoublyLinkedListLinkImpl<net_route_private> {
 	int32	ref_count;
+	uint8	prefix_length;
 
 	net_route_private();
 	~net_route_private();
 };
 
+/*!	Remembers the route last used for a destination, so that a socket
+	sending to the same peer over and over again doesn't need to look it up
+	each time. It becomes invalid whenever the domain's routes change, and
+	drops its reference as soon as a route of the domain is removed, so that
+	it doesn't keep the interface address alive.
+	A cache is only registered for that once it caches a route for the first
+	time, so that sockets that never send don't pay for it.
+*/
+struct route_cache : DoublyLinkedListLinkImpl<route_cache> {
+	spinlock				lock;
+	net_route_private*		route;
+	struct net_domain*		domain;
+	int32					generation;
+	bool					registered;
+	struct sockaddr_storage	destination;
+};
+
 typedef DoublyLinkedList<net_route_private> RouteList;
 typedef DoublyLinkedList<net_route_info,
 	DoublyLinkedListCLink<net_route_info> > RouteInfoList;
@@ -53,6 +74,14 @@ status_t get_buffer_route(struct net_domain* domain,
 				struct net_buffer* buffer, struct net_route** _route);
 void put_route(struct net_domain* domain, struct net_route* route);
 
+status_t init_forwarding_table(struct net_domain_private* domain);
+
+void init_route_cache(struct route_cache* cache);
+void flush_route_cache(struct route_cache* cache);
+status_t get_cached_buffer_route(struct route_cache* cache,
+				struct net_domain* domain, struct net_buffer* buffer,
+				struct net_route** _route);
+
 status_t register_route_info(struct net_domain* domain,
 				struct net_route_info* info);
 status_t unregister_route_info(struct net_domain* domain,
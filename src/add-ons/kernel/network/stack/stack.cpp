@@ -772,6 +772,8 @@ scan_modules(const char* path)
 status_t
 init_stack()
 {
+	select_checksum_kernel();
+
 	status_t status = init_domains();
 	if (status != B_OK)
 		return status;
@@ -55,5 +55,8 @@ void uninit_notifications();
 status_t init_stack();
 status_t uninit_stack();
 
+// net_socket.cpp
+struct route_cache* socket_route_cache(net_socket* socket);
+
 
 #endif	// STACK_PRIVATE_H
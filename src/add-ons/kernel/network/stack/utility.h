@@ -11,6 +11,8 @@
 
 #include <net_stack.h>
 
+#include "checksum.h"
+
 
 class UserBuffer {
 public:
@@ -44,10 +46,6 @@ UserBuffer::UserBuffer(void* buffer, size_t size)
 }
 
 
-// checksums
-uint16		compute_checksum(uint8* _buffer, size_t length);
-uint16		checksum(uint8* buffer, size_t length);
-
 // notifications
 status_t	notify_socket(net_socket* socket, uint8 event, int32 value);
 
@@ -40,6 +40,7 @@ static const FlagsTypeHandler::FlagInfo kRecvFlagInfos[] = {
 	FLAG_INFO_ENTRY(MSG_NOSIGNAL),
 	FLAG_INFO_ENTRY(MSG_CMSG_CLOEXEC),
 	FLAG_INFO_ENTRY(MSG_CMSG_CLOFORK),
+	FLAG_INFO_ENTRY(MSG_WAITFORONE),
 	{ 0, NULL }
 };
 
@@ -252,10 +253,14 @@ patch_network()
 	recvfrom->GetParameter("flags")->SetHandler(new FlagsTypeHandler(kRecvFlags));
 	Syscall *recvmsg = get_syscall("_kern_recvmsg");
 	recvmsg->GetParameter("flags")->SetHandler(new FlagsTypeHandler(kRecvFlags));
+	Syscall *recvmmsg = get_syscall("_kern_recvmmsg");
+	recvmmsg->GetParameter("flags")->SetHandler(new FlagsTypeHandler(kRecvFlags));
 	Syscall *send = get_syscall("_kern_send");
 	send->GetParameter("flags")->SetHandler(new FlagsTypeHandler(kRecvFlags));
 	Syscall *sendmsg = get_syscall("_kern_sendmsg");
 	sendmsg->GetParameter("flags")->SetHandler(new FlagsTypeHandler(kRecvFlags));
+	Syscall *sendmmsg = get_syscall("_kern_sendmmsg");
+	sendmmsg->GetParameter("flags")->SetHandler(new FlagsTypeHandler(kRecvFlags));
 	Syscall *sendto = get_syscall("_kern_sendto");
 	sendto->GetParameter("flags")->SetHandler(new FlagsTypeHandler(kRecvFlags));
 
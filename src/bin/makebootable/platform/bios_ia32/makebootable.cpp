@@ -196,7 +196,8 @@ is_bfs_partition(int fd, off_t offset)
 		return false;
 	if (magic2 != 0xdd121031)
 		return false;
-	if (magic3 != 0x15b6830e)
+	// the latter magic is used by volumes with optional features
+	if (magic3 != 0x15b6830e && magic3 != 0x42465346)
 		return false;
 
 	return true;
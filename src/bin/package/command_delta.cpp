@@ -0,0 +1,114 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <getopt.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <Entry.h>
+#include <String.h>
+
+#include <package/PackageDelta.h>
+
+#include "package.h"
+
+
+using BPackageKit::BPrivate::PackageDelta;
+
+
+int
+command_delta(int argc, const char* const* argv)
+{
+	bool quiet = false;
+	bool verbose = false;
+
+	while (true) {
+		static struct option sLongOptions[] = {
+			{ "help", no_argument, 0, 'h' },
+			{ "quiet", no_argument, 0, 'q' },
+			{ "verbose", no_argument, 0, 'v' },
+			{ 0, 0, 0, 0 }
+		};
+
+		opterr = 0; // don't print errors
+		int c = getopt_long(argc, (char**)argv, "+hqv", sLongOptions, NULL);
+		if (c == -1)
+			break;
+
+		switch (c) {
+			case 'h':
+				print_usage_and_exit(false);
+				break;
+
+			case 'q':
+				quiet = true;
+				break;
+
+			case 'v':
+				verbose = true;
+				break;
+
+			default:
+				print_usage_and_exit(true);
+				break;
+		}
+	}
+
+	// The remaining three arguments are the old and new package file plus the
+	// delta file.
+	if (optind + 3 != argc)
+		print_usage_and_exit(true);
+
+	const char* oldPackageFileName = argv[optind++];
+	const char* newPackageFileName = argv[optind++];
+	const char* deltaFileName = argv[optind++];
+
+	BEntry oldPackageEntry(oldPackageFileName);
+	BEntry newPackageEntry(newPackageFileName);
+	if (!oldPackageEntry.Exists() || !newPackageEntry.Exists()) {
+		fprintf(stderr, "Error: given package file '%s' doesn't exist!\n",
+			oldPackageEntry.Exists() ? newPackageFileName : oldPackageFileName);
+		return 1;
+	}
+
+	BEntry deltaEntry(deltaFileName);
+	PackageDelta delta;
+	status_t result = delta.Create(oldPackageEntry, newPackageEntry,
+		deltaEntry);
+	if (result != B_OK) {
+		fprintf(stderr, "Error: failed to compute the package delta: %s\n",
+			strerror(result));
+		deltaEntry.Remove();
+		return 1;
+	}
+
+	// make sure the delta reproduces the new package exactly
+	BString checkFileName(deltaFileName);
+	checkFileName << ".check";
+	BEntry checkEntry(checkFileName);
+	result = delta.Apply(oldPackageEntry, checkEntry);
+	checkEntry.Remove();
+	if (result != B_OK) {
+		fprintf(stderr, "Error: failed to verify the package delta: %s\n",
+			strerror(result));
+		deltaEntry.Remove();
+		return 1;
+	}
+
+	if (!quiet) {
+		off_t deltaSize = 0;
+		deltaEntry.GetSize(&deltaSize);
+		printf("created delta for '%s' (%" B_PRIdOFF " of %" B_PRIdOFF
+			" bytes)\n", newPackageFileName, deltaSize, delta.TargetSize());
+	}
+	if (verbose) {
+		printf("reused bytes:    %" B_PRIdOFF "\n", delta.CopiedSize());
+		printf("base checksum:   %s\n", delta.BaseChecksum().String());
+		printf("target checksum: %s\n", delta.TargetChecksum().String());
+	}
+
+	return 0;
+}
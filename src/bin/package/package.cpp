@@ -12,6 +12,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <package/hpkg/HPKGDefs.h>
 
@@ -37,6 +38,8 @@ static const char* kUsage =
 	"        -i <info>  - Use the package info file <info>. It will be added as\n"
 	"                     \".PackageInfo\", overriding a \".PackageInfo\" file,\n"
 	"                     existing.\n"
+	"        -j <count> - Compress the data using <count> threads. 0 means one\n"
+	"                     per CPU. Defaults to 1.\n"
 	"        -q         - Be quiet (don't show any output except for errors).\n"
 	"        -v         - Be verbose (show more info about created package).\n"
 	"\n"
@@ -63,10 +66,20 @@ static const char* kUsage =
 	"                     an option only for use in package building. It will cause\n"
 	"                     the package .self link to point to <path>, which is useful\n"
 	"                     to redirect a \"make install\". Only allowed with -b.\n"
+	"        -j <count> - Compress the data using <count> threads. 0 means one\n"
+	"                     per CPU. Defaults to 1.\n"
 	"        -z <type>  - Specify compression method to use.\n"
 	"        -q         - Be quiet (don't show any output except for errors).\n"
 	"        -v         - Be verbose (show more info about created package).\n"
 	"\n"
+	"    delta [ <options> ] <old package> <new package> <delta file>\n"
+	"        Computes the binary delta that turns package file <old package> into\n"
+	"        <new package> and writes it to <delta file>. The delta is checked\n"
+	"        to reproduce <new package> exactly before the command succeeds.\n"
+	"\n"
+	"        -q         - Be quiet (don't show any output except for errors).\n"
+	"        -v         - Be verbose (show statistics about the delta).\n"
+	"\n"
 	"    dump [ <options> ] <package>\n"
 	"        Dumps the TOC section of package file <package>. For debugging only.\n"
 	"\n"
@@ -109,6 +122,8 @@ static const char* kUsage =
 	"\n"
 	"        -0 ... -9  - Use compression level 0 ... 9. 0 means no, 9 best\n"
 	"                     compression. Defaults to 9.\n"
+	"        -j <count> - Compress the data using <count> threads. 0 means one\n"
+	"                     per CPU. Defaults to 1.\n"
 	"        -z <type>  - Specify compression method to use.\n"
 	"        -q         - Be quiet (don't show any output except for errors).\n"
 	"        -v         - Be verbose (show more info about created package).\n"
@@ -149,6 +164,27 @@ parse_compression_argument(const char* arg)
 }
 
 
+int32
+parse_thread_count_argument(const char* arg)
+{
+	char* end;
+	long count = strtol(arg, &end, 10);
+	if (*arg == '\0' || *end != '\0' || count < 0 || count > 256) {
+		fprintf(stderr, "error: invalid thread count '%s'\n", arg);
+		exit(1);
+	}
+
+	if (count == 0) {
+		// one thread per CPU
+		count = sysconf(_SC_NPROCESSORS_ONLN);
+		if (count < 1)
+			count = 1;
+	}
+
+	return count;
+}
+
+
 int
 main(int argc, const char* const* argv)
 {
@@ -165,6 +201,9 @@ main(int argc, const char* const* argv)
 	if (strcmp(command, "create") == 0)
 		return command_create(argc - 1, argv + 1);
 
+	if (strcmp(command, "delta") == 0)
+		return command_delta(argc - 1, argv + 1);
+
 	if (strcmp(command, "dump") == 0)
 		return command_dump(argc - 1, argv + 1);
 
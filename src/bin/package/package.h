@@ -10,10 +10,12 @@
 
 void	print_usage_and_exit(bool error);
 int32	parse_compression_argument(const char* arg);
+int32	parse_thread_count_argument(const char* arg);
 
 int		command_add(int argc, const char* const* argv);
 int		command_checksum(int argc, const char* const* argv);
 int		command_create(int argc, const char* const* argv);
+int		command_delta(int argc, const char* const* argv);
 int		command_dump(int argc, const char* const* argv);
 int		command_extract(int argc, const char* const* argv);
 int		command_info(int argc, const char* const* argv);
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <getopt.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <Entry.h>
+
+#include <package/RepositoryDelta.h>
+
+#include "package_repo.h"
+
+
+using BPackageKit::BPrivate::RepositoryDelta;
+
+
+int
+command_delta(int argc, const char* const* argv)
+{
+	bool quiet = false;
+	bool verbose = false;
+
+	while (true) {
+		static struct option sLongOptions[] = {
+			{ "help", no_argument, 0, 'h' },
+			{ "quiet", no_argument, 0, 'q' },
+			{ "verbose", no_argument, 0, 'v' },
+			{ 0, 0, 0, 0 }
+		};
+
+		opterr = 0; // don't print errors
+		int c = getopt_long(argc, (char**)argv, "+hqv", sLongOptions, NULL);
+		if (c == -1)
+			break;
+
+		switch (c) {
+			case 'h':
+				print_usage_and_exit(false);
+				break;
+
+			case 'q':
+				quiet = true;
+				break;
+
+			case 'v':
+				verbose = true;
+				break;
+
+			default:
+				print_usage_and_exit(true);
+				break;
+		}
+	}
+
+	// The remaining three arguments are the old and new repository file plus
+	// the delta file.
+	if (optind + 3 != argc)
+		print_usage_and_exit(true);
+
+	const char* oldRepositoryFileName = argv[optind++];
+	const char* newRepositoryFileName = argv[optind++];
+	const char* deltaFileName = argv[optind++];
+
+	BEntry oldRepositoryEntry(oldRepositoryFileName);
+	BEntry newRepositoryEntry(newRepositoryFileName);
+	if (!oldRepositoryEntry.Exists() || !newRepositoryEntry.Exists()) {
+		fprintf(stderr, "Error: given repository file '%s' doesn't exist!\n",
+			oldRepositoryEntry.Exists()
+				? newRepositoryFileName : oldRepositoryFileName);
+		return 1;
+	}
+
+	RepositoryDelta delta;
+	status_t result = delta.Create(oldRepositoryEntry, newRepositoryEntry);
+	if (result != B_OK) {
+		fprintf(stderr, "Error: failed to compute the repository delta: %s\n",
+			strerror(result));
+		return 1;
+	}
+
+	result = delta.WriteToFile(BEntry(deltaFileName));
+	if (result != B_OK) {
+		fprintf(stderr, "Error: failed to write delta file \"%s\": %s\n",
+			deltaFileName, strerror(result));
+		return 1;
+	}
+
+	if (!quiet) {
+		printf("created delta for '%s' (%" B_PRId32 " packages, %" B_PRId32
+			" added or changed)\n", oldRepositoryFileName,
+			delta.CountPackages(), delta.CountAddedPackages());
+	}
+	if (verbose)
+		printf("base checksum: %s\n", delta.BaseChecksum().String());
+
+	return 0;
+}
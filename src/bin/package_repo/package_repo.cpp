@@ -29,6 +29,16 @@ static const char* kUsage =
 	"    -q         - be quiet (don't show any output except for errors).\n"
 	"    -v         - be verbose (list package attributes as encountered).\n"
 	"\n"
+	"  delta [ <options> ] <old-repo> <new-repo> <delta-file>\n"
+	"    Creates <delta-file>, which allows clients that have cached\n"
+	"    <old-repo> to reconstruct <new-repo>. The delta has to be published\n"
+	"    as \"repo.deltas/<sha256 of old-repo>\" relative to the base URL of\n"
+	"    the repository. Clients fall back to fetching the complete\n"
+	"    repository, if the delta is missing or doesn't apply.\n"
+	"\n"
+	"    -q         - be quiet (don't show any output except for errors).\n"
+	"    -v         - be verbose (show the delta's statistics).\n"
+	"\n"
 	"  list [ <options> ] <package-repo>\n"
 	"    Lists the contents of package repository file <package-repo>.\n"
 	"\n"
@@ -74,6 +84,9 @@ main(int argc, const char* const* argv)
 	if (strcmp(command, "create") == 0)
 		return command_create(argc - 1, argv + 1);
 
+	if (strcmp(command, "delta") == 0)
+		return command_delta(argc - 1, argv + 1);
+
 	if (strcmp(command, "list") == 0)
 		return command_list(argc - 1, argv + 1);
 
@@ -40,7 +40,12 @@ PackageManager::PackageManager(BPackageInstallationLocation location,
 	BPackageManager::UserInteractionHandler(),
 	fDecisionProvider(interactive),
 	fClientInstallationInterface(),
-	fInteractive(interactive)
+	fInteractive(interactive),
+	fShowProgress(false),
+	fProgressShown(false),
+	fLastBytes(0),
+	fLastRateCalcTime(0),
+	fDownloadRate(0)
 {
 }
 
@@ -170,19 +175,31 @@ PackageManager::Warn(status_t error, const char* format, ...)
 }
 
 
+/*!	Packages and repositories are fetched concurrently. The notifications
+	arrive one at a time, but interleaved, so a single progress line shows
+	the combined progress of all active downloads, and each download gets
+	its own line once it is complete.
+*/
 void
 PackageManager::ProgressPackageDownloadStarted(const char* packageName)
 {
-	fShowProgress = isatty(STDOUT_FILENO);
-	fLastBytes = 0;
-	fLastRateCalcTime = system_time();
-	fDownloadRate = 0;
+	if (fDownloads.empty()) {
+		fShowProgress = isatty(STDOUT_FILENO);
+		fLastBytes = 0;
+		fLastRateCalcTime = system_time();
+		fDownloadRate = 0;
+	}
+
+	DownloadProgress progress = { 0, 0 };
+	fDownloads[packageName] = progress;
 
-	if (fShowProgress) {
+	if (fShowProgress && !fProgressShown) {
 		char percentString[32];
 		fNumberFormat.FormatPercent(percentString, sizeof(percentString), 0.0);
 		// Make sure there is enough space for '100 %' percent format
 		printf("%6s", percentString);
+		fflush(stdout);
+		fProgressShown = true;
 	}
 }
 
@@ -191,22 +208,48 @@ void
 PackageManager::ProgressPackageDownloadActive(const char* packageName,
 	float completionPercentage, off_t bytes, off_t totalBytes)
 {
-	if (bytes == totalBytes)
-		fLastBytes = totalBytes;
+	DownloadMap::iterator found = fDownloads.find(packageName);
+	if (found == fDownloads.end())
+		return;
+
+	found->second.bytes = bytes;
+	found->second.totalBytes = totalBytes;
 	if (!fShowProgress)
 		return;
 
+	// combine all active downloads
+	off_t allBytes = 0;
+	off_t allTotalBytes = 0;
+	for (DownloadMap::iterator it = fDownloads.begin(); it != fDownloads.end();
+			++it) {
+		allBytes += it->second.bytes;
+		allTotalBytes += std::max(it->second.totalBytes, it->second.bytes);
+	}
+
 	// Do not update if nothing changed in the last 500ms
-	if (bytes <= fLastBytes || (system_time() - fLastRateCalcTime) < 500000)
+	if (allBytes <= fLastBytes
+		|| (system_time() - fLastRateCalcTime) < 500000) {
 		return;
+	}
 
 	const bigtime_t time = system_time();
 	if (time != fLastRateCalcTime) {
-		fDownloadRate = (bytes - fLastBytes) * 1000000
+		fDownloadRate = (allBytes - fLastBytes) * 1000000
 			/ (time - fLastRateCalcTime);
 	}
 	fLastRateCalcTime = time;
-	fLastBytes = bytes;
+	fLastBytes = allBytes;
+
+	if (fDownloads.size() > 1) {
+		completionPercentage = allTotalBytes > 0
+			? (float)allBytes / allTotalBytes : 0;
+	}
+
+	BString label;
+	if (fDownloads.size() > 1)
+		label.SetToFormat("%d packages", (int)fDownloads.size());
+	else
+		label = packageName;
 
 	// Build the current file progress percentage and size string
 	BString leftStr;
@@ -224,14 +267,15 @@ PackageManager::ProgressPackageDownloadActive(const char* packageName,
 		BString dataString;
 		fNumberFormat.FormatPercent(dataString, completionPercentage);
 		// Make sure there is enough space for '100 %' percent format
-		leftStr.SetToFormat("%6s %s", dataString.String(), packageName);
+		leftStr.SetToFormat("%6s %s", dataString.String(), label.String());
 
 		char byteBuffer[32];
 		char totalBuffer[32];
 		char rateBuffer[32];
 		rightStr.SetToFormat("%s/%s  %s ",
-				string_for_size(bytes, byteBuffer, sizeof(byteBuffer)),
-				string_for_size(totalBytes, totalBuffer, sizeof(totalBuffer)),
+				string_for_size(allBytes, byteBuffer, sizeof(byteBuffer)),
+				string_for_size(allTotalBytes, totalBuffer,
+					sizeof(totalBuffer)),
 				fDownloadRate == 0 ? "--.-" :
 				string_for_rate(fDownloadRate, rateBuffer, sizeof(rateBuffer)));
 
@@ -257,6 +301,7 @@ PackageManager::ProgressPackageDownloadActive(const char* packageName,
 	// And finally remove any stray chars at the end of the line
 	printf("\r\x1B[42;37m%.*s\x1B[0m%s\x1B[K", progChars, leftStr.String(),
 		leftStr.String() + progChars);
+	fProgressShown = true;
 
 	// Force terminal to update when the line is complete, to avoid flickering
 	// because of updates at random times
@@ -267,17 +312,24 @@ PackageManager::ProgressPackageDownloadActive(const char* packageName,
 void
 PackageManager::ProgressPackageDownloadComplete(const char* packageName)
 {
-	if (fShowProgress) {
-		// Erase the line, return to the start, and reset colors
-		printf("\r\33[2K\r\x1B[0m");
+	off_t bytes = 0;
+	DownloadMap::iterator found = fDownloads.find(packageName);
+	if (found != fDownloads.end()) {
+		bytes = std::max(found->second.bytes, (off_t)0);
+		fDownloads.erase(found);
 	}
 
+	// the bytes of this download are no longer part of the combined progress
+	fLastBytes = std::max(fLastBytes - bytes, (off_t)0);
+
+	_ClearProgressLine();
+
 	char byteBuffer[32];
 	char percentString[32];
 	fNumberFormat.FormatPercent(percentString, sizeof(percentString), 1.0);
 	// Make sure there is enough space for '100 %' percent format
 	printf("%6s %s [%s]\n", percentString, packageName,
-		string_for_size(fLastBytes, byteBuffer, sizeof(byteBuffer)));
+		string_for_size(bytes, byteBuffer, sizeof(byteBuffer)));
 	fflush(stdout);
 }
 
@@ -285,14 +337,17 @@ PackageManager::ProgressPackageDownloadComplete(const char* packageName)
 void
 PackageManager::ProgressPackageChecksumStarted(const char* title)
 {
-	printf("%s...", title);
+	// Other downloads may still be going on, so the title is only printed
+	// together with the result.
 }
 
 
 void
 PackageManager::ProgressPackageChecksumComplete(const char* title)
 {
-	printf("done.\n");
+	_ClearProgressLine();
+	printf("%s...done.\n", title);
+	fflush(stdout);
 }
 
 
@@ -400,3 +455,15 @@ PackageManager::_PrintResult(InstalledRepository& installationRepository)
 // other information) should, however, be provided by the repository cache in
 // some way. Extend BPackageInfo? Create a BPackageFileInfo?
 }
+
+
+void
+PackageManager::_ClearProgressLine()
+{
+	if (!fProgressShown)
+		return;
+
+	// Erase the line, return to the start, and reset colors
+	printf("\r\33[2K\r\x1B[0m");
+	fProgressShown = false;
+}
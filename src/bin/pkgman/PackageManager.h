@@ -10,6 +10,8 @@
 #define PACKAGE_MANAGER_H
 
 
+#include <map>
+
 #include <package/DaemonClient.h>
 #include <package/manager/PackageManager.h>
 
@@ -64,9 +66,18 @@ private:
 	virtual	void				ProgressApplyingChangesDone(
 									InstalledRepository& repository);
 
+private:
+			struct DownloadProgress {
+				off_t			bytes;
+				off_t			totalBytes;
+			};
+
+			typedef std::map<BString, DownloadProgress> DownloadMap;
+
 private:
 			void				_PrintResult(InstalledRepository&
 									installationRepository);
+			void				_ClearProgressLine();
 
 private:
 			DecisionProvider	fDecisionProvider;
@@ -75,7 +86,9 @@ private:
 									fClientInstallationInterface;
 			bool				fInteractive;
 
+			DownloadMap			fDownloads;
 			bool				fShowProgress;
+			bool				fProgressShown;
 			off_t				fLastBytes;
 			bigtime_t			fLastRateCalcTime;
 			float				fDownloadRate;
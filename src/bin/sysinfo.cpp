@@ -12,7 +12,11 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <new>
+
 #include <cpu_type.h>
+#include <syscalls.h>
+#include <system_info.h>
 
 
 // TODO: -disable_cpu_sn option is not yet implemented
@@ -778,6 +782,36 @@ dump_mem(system_info *info)
 }
 
 
+static void
+dump_writeback()
+{
+	uint32 count = 0;
+	if (_kern_get_writeback_info(NULL, &count) != B_OK || count == 0)
+		return;
+
+	writeback_device_info* infos
+		= new(std::nothrow) writeback_device_info[count];
+	if (infos == NULL)
+		return;
+
+	if (_kern_get_writeback_info(infos, &count) == B_OK) {
+		printf("device  dirty (limit)          written  pages/s  throttled  "
+			"throttle time\n");
+		for (uint32 i = 0; i < count; i++) {
+			writeback_device_info& info = infos[i];
+			printf("%6" B_PRIdDEV " %10" B_PRIu64 " (%10" B_PRIu64 ") %10"
+				B_PRIu64 " %8" B_PRIu32 " %10" B_PRIu64 " %10" B_PRId64 " ms\n",
+				info.device, B_PAGE_SIZE * (uint64)info.dirty_pages,
+				B_PAGE_SIZE * (uint64)info.dirty_limit,
+				B_PAGE_SIZE * info.written_pages, info.bandwidth,
+				info.throttled_writes, info.throttle_time / 1000);
+		}
+	}
+
+	delete[] infos;
+}
+
+
 static void
 dump_sem(system_info *info)
 {
@@ -867,6 +901,8 @@ main(int argc, char *argv[])
 				dump_cpus(&info);
 			} else if (strncmp(opt, "-mem", strlen(opt)) == 0) {
 				dump_mem(&info);
+			} else if (strncmp(opt, "-writeback", strlen(opt)) == 0) {
+				dump_writeback();
 			} else if (strncmp(opt, "-semaphores", strlen(opt)) == 0) {
 				dump_sem(&info);
 			} else if (strncmp(opt, "-ports", strlen(opt)) == 0) {
@@ -890,7 +926,7 @@ main(int argc, char *argv[])
 					name++;
 
 				fprintf(stderr, "Usage:\n");
-				fprintf(stderr, "  %s [-id|-cpu|-mem|-semaphore|-ports|-threads|-teams|-platform|-disable_cpu_sn|-kinfo]\n", name);
+				fprintf(stderr, "  %s [-id|-cpu|-mem|-writeback|-semaphore|-ports|-threads|-teams|-platform|-disable_cpu_sn|-kinfo]\n", name);
 				return 0;
 			}
 		}
@@ -635,6 +635,16 @@ _kern_read_dir(int fd, struct dirent *buffer, size_t bufferSize,
 	return 1;
 }
 
+// _kern_read_dir_stat
+ssize_t
+_kern_read_dir_stat(int fd, const char *const *attributes,
+	uint32 attributeCount, size_t maxAttributeSize,
+	struct dir_stat_entry *buffer, size_t bufferSize, uint32 maxCount)
+{
+	// not needed by the build tools
+	return B_UNSUPPORTED;
+}
+
 // _kern_rewind_dir
 status_t
 _kern_rewind_dir(int fd)
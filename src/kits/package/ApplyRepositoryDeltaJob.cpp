@@ -0,0 +1,111 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <package/ApplyRepositoryDeltaJob.h>
+
+#include <package/ChecksumAccessors.h>
+#include <package/Context.h>
+#include <package/hpkg/NoErrorOutput.h>
+#include <package/RepositoryDelta.h>
+
+#include "FetchFileJob.h"
+
+
+namespace BPackageKit {
+
+namespace BPrivate {
+
+
+ApplyRepositoryDeltaJob::ApplyRepositoryDeltaJob(const BContext& context,
+	const BString& title, const BString& baseURL,
+	const BEntry& baseRepoCacheEntry, const BEntry& checksumEntry,
+	const BEntry& targetEntry)
+	:
+	inherited(context, title),
+	fBaseURL(baseURL),
+	fBaseRepoCacheEntry(baseRepoCacheEntry),
+	fChecksumEntry(checksumEntry),
+	fTargetEntry(targetEntry),
+	fDeltaApplied(false)
+{
+}
+
+
+ApplyRepositoryDeltaJob::~ApplyRepositoryDeltaJob()
+{
+}
+
+
+status_t
+ApplyRepositoryDeltaJob::Execute()
+{
+	fDeltaApplied = false;
+
+	BString baseChecksum;
+	status_t result = GeneralFileChecksumAccessor(fBaseRepoCacheEntry, true)
+		.GetChecksum(baseChecksum);
+	if (result != B_OK || baseChecksum.IsEmpty())
+		return B_OK;
+
+	BEntry deltaEntry;
+	result = fContext.GetNewTempfile("repodelta-", &deltaEntry);
+	if (result != B_OK)
+		return result;
+
+	// Not every repository publishes deltas, so the fetch job doesn't report
+	// to the context's listener -- a failure here isn't worth telling about.
+	FetchFileJob fetchDeltaJob(fContext, Title(),
+		RepositoryDelta::DeltaURL(fBaseURL, baseChecksum), deltaEntry);
+	result = fetchDeltaJob.Run();
+	if (result == B_OK)
+		result = _ApplyDelta(deltaEntry);
+
+	deltaEntry.Remove();
+	if (result == B_CANCELED)
+		return result;
+
+	if (result == B_OK)
+		fDeltaApplied = true;
+	else
+		fTargetEntry.Remove();
+
+	return B_OK;
+}
+
+
+status_t
+ApplyRepositoryDeltaJob::_ApplyDelta(const BEntry& deltaEntry)
+{
+	RepositoryDelta delta;
+	status_t result = delta.ReadFromFile(deltaEntry);
+	if (result != B_OK)
+		return result;
+
+	BHPKG::BNoErrorOutput errorOutput;
+	result = delta.Apply(fBaseRepoCacheEntry, fTargetEntry, &errorOutput);
+	if (result != B_OK)
+		return result;
+
+	// The rebuilt file must be identical to the published one, otherwise the
+	// cache would never match the repository's checksum.
+	BString expectedChecksum;
+	BString realChecksum;
+	result = ChecksumFileChecksumAccessor(fChecksumEntry)
+		.GetChecksum(expectedChecksum);
+	if (result == B_OK) {
+		result = GeneralFileChecksumAccessor(fTargetEntry)
+			.GetChecksum(realChecksum);
+	}
+	if (result != B_OK)
+		return result;
+
+	return expectedChecksum.ICompare(realChecksum) == 0 ? B_OK : B_BAD_DATA;
+}
+
+
+}	// namespace BPrivate
+
+}	// namespace BPackageKit
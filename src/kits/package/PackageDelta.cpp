@@ -0,0 +1,685 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <package/PackageDelta.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <new>
+
+#include <ByteOrder.h>
+#include <File.h>
+
+#include <AutoDeleter.h>
+#include <package/ChecksumAccessors.h>
+
+
+namespace BPackageKit {
+
+namespace BPrivate {
+
+
+static const uint32 kPackageDeltaMagic = 'hpkd';
+static const uint16 kPackageDeltaVersion = 1;
+
+static const size_t kChecksumSize = 64;
+	// hex dump of a SHA-256 digest
+
+// Size of the base file blocks that are indexed for matching. Smaller blocks
+// find more matches in files that changed in many places, but make the index
+// larger and the operations more numerous.
+static const size_t kBlockSize = 1024;
+
+static const size_t kMaxDataOperationSize = 64 * 1024;
+static const size_t kIOBufferSize = 64 * 1024;
+
+enum {
+	OPERATION_END	= 0,
+	OPERATION_COPY	= 1,
+	OPERATION_DATA	= 2
+};
+
+
+struct PackageDelta::Header {
+	uint32	magic;
+	uint16	version;
+	uint16	headerSize;
+	uint64	baseSize;
+	uint64	targetSize;
+	char	baseChecksum[kChecksumSize];
+	char	targetChecksum[kChecksumSize];
+} _PACKED;
+
+
+// #pragma mark - Writer
+
+
+struct PackageDelta::Writer {
+	Writer()
+		:
+		fBuffer(NULL),
+		fBufferSize(0)
+	{
+	}
+
+	~Writer()
+	{
+		free(fBuffer);
+	}
+
+	status_t Init(const BEntry& entry)
+	{
+		fBuffer = (uint8*)malloc(kIOBufferSize);
+		if (fBuffer == NULL)
+			return B_NO_MEMORY;
+
+		return fFile.SetTo(&entry, B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	}
+
+	status_t Write(const void* data, size_t size)
+	{
+		while (size > 0) {
+			if (fBufferSize == kIOBufferSize) {
+				status_t error = Flush();
+				if (error != B_OK)
+					return error;
+			}
+
+			size_t toCopy = std::min(size, kIOBufferSize - fBufferSize);
+			memcpy(fBuffer + fBufferSize, data, toCopy);
+			fBufferSize += toCopy;
+			data = (const uint8*)data + toCopy;
+			size -= toCopy;
+		}
+
+		return B_OK;
+	}
+
+	status_t WriteCopy(uint64 offset, size_t size)
+	{
+		while (size > 0) {
+			uint32 chunkSize = (uint32)std::min(size, (size_t)0xffffffff);
+			uint8 operation = OPERATION_COPY;
+			uint64 offsetBE = B_HOST_TO_BENDIAN_INT64(offset);
+			uint32 sizeBE = B_HOST_TO_BENDIAN_INT32(chunkSize);
+			status_t error = Write(&operation, sizeof(operation));
+			if (error == B_OK)
+				error = Write(&offsetBE, sizeof(offsetBE));
+			if (error == B_OK)
+				error = Write(&sizeBE, sizeof(sizeBE));
+			if (error != B_OK)
+				return error;
+
+			offset += chunkSize;
+			size -= chunkSize;
+		}
+
+		return B_OK;
+	}
+
+	status_t WriteData(const uint8* data, size_t size)
+	{
+		while (size > 0) {
+			uint32 chunkSize = (uint32)std::min(size, kMaxDataOperationSize);
+			uint8 operation = OPERATION_DATA;
+			uint32 sizeBE = B_HOST_TO_BENDIAN_INT32(chunkSize);
+			status_t error = Write(&operation, sizeof(operation));
+			if (error == B_OK)
+				error = Write(&sizeBE, sizeof(sizeBE));
+			if (error == B_OK)
+				error = Write(data, chunkSize);
+			if (error != B_OK)
+				return error;
+
+			data += chunkSize;
+			size -= chunkSize;
+		}
+
+		return B_OK;
+	}
+
+	status_t Flush()
+	{
+		if (fBufferSize == 0)
+			return B_OK;
+
+		ssize_t bytesWritten = fFile.Write(fBuffer, fBufferSize);
+		if (bytesWritten < 0)
+			return bytesWritten;
+		if ((size_t)bytesWritten != fBufferSize)
+			return B_IO_ERROR;
+
+		fBufferSize = 0;
+		return B_OK;
+	}
+
+private:
+	BFile	fFile;
+	uint8*	fBuffer;
+	size_t	fBufferSize;
+};
+
+
+// #pragma mark - Reader
+
+
+struct PackageDelta::Reader {
+	Reader()
+		:
+		fBuffer(NULL),
+		fBufferSize(0),
+		fBufferOffset(0)
+	{
+	}
+
+	~Reader()
+	{
+		free(fBuffer);
+	}
+
+	status_t Init(const BEntry& entry)
+	{
+		fBuffer = (uint8*)malloc(kIOBufferSize);
+		if (fBuffer == NULL)
+			return B_NO_MEMORY;
+
+		return fFile.SetTo(&entry, B_READ_ONLY);
+	}
+
+	status_t Read(void* data, size_t size)
+	{
+		while (size > 0) {
+			if (fBufferOffset == fBufferSize) {
+				ssize_t bytesRead = fFile.Read(fBuffer, kIOBufferSize);
+				if (bytesRead < 0)
+					return bytesRead;
+				if (bytesRead == 0)
+					return B_BAD_DATA;
+				fBufferSize = bytesRead;
+				fBufferOffset = 0;
+			}
+
+			size_t toCopy = std::min(size, fBufferSize - fBufferOffset);
+			memcpy(data, fBuffer + fBufferOffset, toCopy);
+			fBufferOffset += toCopy;
+			data = (uint8*)data + toCopy;
+			size -= toCopy;
+		}
+
+		return B_OK;
+	}
+
+	status_t ReadHeader(Header& header)
+	{
+		status_t error = Read(&header, sizeof(header));
+		if (error != B_OK)
+			return error;
+
+		header.magic = B_BENDIAN_TO_HOST_INT32(header.magic);
+		header.version = B_BENDIAN_TO_HOST_INT16(header.version);
+		header.headerSize = B_BENDIAN_TO_HOST_INT16(header.headerSize);
+		header.baseSize = B_BENDIAN_TO_HOST_INT64(header.baseSize);
+		header.targetSize = B_BENDIAN_TO_HOST_INT64(header.targetSize);
+
+		if (header.magic != kPackageDeltaMagic
+			|| header.version != kPackageDeltaVersion
+			|| header.headerSize != sizeof(header)) {
+			return B_BAD_DATA;
+		}
+
+		return B_OK;
+	}
+
+private:
+	BFile	fFile;
+	uint8*	fBuffer;
+	size_t	fBufferSize;
+	size_t	fBufferOffset;
+};
+
+
+// #pragma mark - BlockIndex
+
+
+/*!	Maps the weak checksums of the aligned blocks of the base file to the
+	index of the first block with that checksum. Collisions are simply
+	dropped -- the index only has to produce candidates, which are verified by
+	comparing the actual data.
+*/
+struct BlockIndex {
+	BlockIndex()
+		:
+		fSlots(NULL),
+		fMask(0)
+	{
+	}
+
+	~BlockIndex()
+	{
+		free(fSlots);
+	}
+
+	status_t Init(const uint8* data, size_t size)
+	{
+		size_t blockCount = size / kBlockSize;
+		size_t slotCount = 1024;
+		while (slotCount < blockCount * 2)
+			slotCount *= 2;
+
+		fSlots = (uint32*)calloc(slotCount, sizeof(uint32));
+		if (fSlots == NULL)
+			return B_NO_MEMORY;
+		fMask = slotCount - 1;
+
+		for (size_t i = 0; i < blockCount; i++) {
+			uint32 a;
+			uint32 b;
+			ComputeChecksum(data + i * kBlockSize, a, b);
+			uint32& slot = fSlots[_SlotFor(a, b)];
+			if (slot == 0)
+				slot = i + 1;
+		}
+
+		return B_OK;
+	}
+
+	// Returns the index of the candidate block + 1, or 0, if there's none.
+	uint32 Lookup(uint32 a, uint32 b) const
+	{
+		return fSlots[_SlotFor(a, b)];
+	}
+
+	static void ComputeChecksum(const uint8* data, uint32& _a, uint32& _b)
+	{
+		uint32 a = 0;
+		uint32 b = 0;
+		for (size_t i = 0; i < kBlockSize; i++) {
+			a += data[i];
+			b += a;
+		}
+
+		_a = a;
+		_b = b;
+	}
+
+	static void RollChecksum(uint8 out, uint8 in, uint32& a, uint32& b)
+	{
+		a += (uint32)in - out;
+		b += a - (uint32)kBlockSize * out;
+	}
+
+private:
+	size_t _SlotFor(uint32 a, uint32 b) const
+	{
+		uint32 hash = ((a & 0xffff) | (b << 16)) * 2654435761U;
+		return (hash ^ (hash >> 15)) & fMask;
+	}
+
+private:
+	uint32*	fSlots;
+	size_t	fMask;
+};
+
+
+// #pragma mark - PackageDelta
+
+
+PackageDelta::PackageDelta()
+	:
+	fDeltaEntry(),
+	fBaseChecksum(),
+	fTargetChecksum(),
+	fBaseSize(0),
+	fTargetSize(0),
+	fCopiedSize(0)
+{
+}
+
+
+PackageDelta::~PackageDelta()
+{
+}
+
+
+/*!	Computes the delta that turns \a basePackage into \a targetPackage and
+	writes it to \a deltaEntry.
+	Both files are read into memory completely, so this is meant for tools
+	preparing a repository rather than for the system applying the delta.
+*/
+status_t
+PackageDelta::Create(const BEntry& basePackage, const BEntry& targetPackage,
+	const BEntry& deltaEntry)
+{
+	fCopiedSize = 0;
+
+	status_t error = GeneralFileChecksumAccessor(basePackage)
+		.GetChecksum(fBaseChecksum);
+	if (error == B_OK) {
+		error = GeneralFileChecksumAccessor(targetPackage)
+			.GetChecksum(fTargetChecksum);
+	}
+	if (error != B_OK)
+		return error;
+	if (fBaseChecksum.Length() != (int32)kChecksumSize
+		|| fTargetChecksum.Length() != (int32)kChecksumSize) {
+		return B_BAD_VALUE;
+	}
+
+	// read both files
+	uint8* files[2] = { NULL, NULL };
+	off_t sizes[2];
+	MemoryDeleter baseDeleter;
+	MemoryDeleter targetDeleter;
+	const BEntry* entries[2] = { &basePackage, &targetPackage };
+	for (int i = 0; i < 2; i++) {
+		BFile file(entries[i], B_READ_ONLY);
+		error = file.InitCheck();
+		if (error == B_OK)
+			error = file.GetSize(&sizes[i]);
+		if (error != B_OK)
+			return error;
+		if ((uint64)sizes[i] > (uint64)(size_t)-1 / 2)
+			return B_FILE_TOO_LARGE;
+
+		files[i] = (uint8*)malloc(std::max(sizes[i], (off_t)1));
+		if (files[i] == NULL)
+			return B_NO_MEMORY;
+		(i == 0 ? baseDeleter : targetDeleter).SetTo(files[i]);
+
+		ssize_t bytesRead = file.ReadAt(0, files[i], sizes[i]);
+		if (bytesRead < 0)
+			return bytesRead;
+		if (bytesRead != sizes[i])
+			return B_IO_ERROR;
+	}
+
+	fBaseSize = sizes[0];
+	fTargetSize = sizes[1];
+
+	// write the header, followed by the operations
+	Writer writer;
+	error = writer.Init(deltaEntry);
+	if (error != B_OK)
+		return error;
+
+	Header header;
+	header.magic = B_HOST_TO_BENDIAN_INT32(kPackageDeltaMagic);
+	header.version = B_HOST_TO_BENDIAN_INT16(kPackageDeltaVersion);
+	header.headerSize = B_HOST_TO_BENDIAN_INT16((uint16)sizeof(header));
+	header.baseSize = B_HOST_TO_BENDIAN_INT64((uint64)fBaseSize);
+	header.targetSize = B_HOST_TO_BENDIAN_INT64((uint64)fTargetSize);
+	memcpy(header.baseChecksum, fBaseChecksum.String(), kChecksumSize);
+	memcpy(header.targetChecksum, fTargetChecksum.String(), kChecksumSize);
+
+	error = writer.Write(&header, sizeof(header));
+	if (error == B_OK)
+		error = _Diff(files[0], fBaseSize, files[1], fTargetSize, writer);
+	if (error == B_OK) {
+		uint8 operation = OPERATION_END;
+		error = writer.Write(&operation, sizeof(operation));
+	}
+	if (error == B_OK)
+		error = writer.Flush();
+	if (error != B_OK)
+		return error;
+
+	fDeltaEntry = deltaEntry;
+	return B_OK;
+}
+
+
+/*!	Reads the header of the delta file \a deltaEntry.
+*/
+status_t
+PackageDelta::SetTo(const BEntry& deltaEntry)
+{
+	Reader reader;
+	status_t error = reader.Init(deltaEntry);
+	if (error != B_OK)
+		return error;
+
+	Header header;
+	error = reader.ReadHeader(header);
+	if (error != B_OK)
+		return error;
+
+	fBaseChecksum.SetTo(header.baseChecksum, kChecksumSize);
+	fTargetChecksum.SetTo(header.targetChecksum, kChecksumSize);
+	fBaseSize = header.baseSize;
+	fTargetSize = header.targetSize;
+	fCopiedSize = 0;
+	fDeltaEntry = deltaEntry;
+
+	return B_OK;
+}
+
+
+/*!	Reconstructs the target package file from \a basePackage and writes it to
+	\a targetPackage.
+	Fails with \c B_MISMATCHED_VALUES, if \a basePackage isn't the file the
+	delta was created for, and with \c B_BAD_DATA, if the delta is corrupt or
+	the result doesn't have the expected checksum. The target file is left
+	behind in either case, it is up to the caller to remove it.
+*/
+status_t
+PackageDelta::Apply(const BEntry& basePackage,
+	const BEntry& targetPackage) const
+{
+	if (fDeltaEntry.InitCheck() != B_OK)
+		return B_NO_INIT;
+
+	// check the base package
+	BFile baseFile(&basePackage, B_READ_ONLY);
+	status_t error = baseFile.InitCheck();
+	off_t baseSize;
+	if (error == B_OK)
+		error = baseFile.GetSize(&baseSize);
+	if (error != B_OK)
+		return error;
+	if (baseSize != fBaseSize)
+		return B_MISMATCHED_VALUES;
+
+	BString baseChecksum;
+	error = GeneralFileChecksumAccessor(basePackage).GetChecksum(baseChecksum);
+	if (error != B_OK)
+		return error;
+	if (baseChecksum.ICompare(fBaseChecksum) != 0)
+		return B_MISMATCHED_VALUES;
+
+	// execute the operations
+	Reader reader;
+	error = reader.Init(fDeltaEntry);
+	Header header;
+	if (error == B_OK)
+		error = reader.ReadHeader(header);
+	if (error != B_OK)
+		return error;
+
+	BFile targetFile(&targetPackage,
+		B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	error = targetFile.InitCheck();
+	if (error != B_OK)
+		return error;
+
+	uint8* buffer = (uint8*)malloc(kIOBufferSize);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter bufferDeleter(buffer);
+
+	off_t targetSize = 0;
+	while (true) {
+		uint8 operation;
+		error = reader.Read(&operation, sizeof(operation));
+		if (error != B_OK)
+			return error;
+		if (operation == OPERATION_END)
+			break;
+
+		uint64 offset = 0;
+		uint32 size;
+		if (operation == OPERATION_COPY) {
+			error = reader.Read(&offset, sizeof(offset));
+			if (error != B_OK)
+				return error;
+			offset = B_BENDIAN_TO_HOST_INT64(offset);
+		} else if (operation != OPERATION_DATA)
+			return B_BAD_DATA;
+
+		error = reader.Read(&size, sizeof(size));
+		if (error != B_OK)
+			return error;
+		size = B_BENDIAN_TO_HOST_INT32(size);
+
+		if ((uint64)size > (uint64)(fTargetSize - targetSize)
+			|| (operation == OPERATION_COPY
+				&& (offset > (uint64)baseSize
+					|| (uint64)size > (uint64)baseSize - offset))) {
+			return B_BAD_DATA;
+		}
+
+		while (size > 0) {
+			size_t toCopy = std::min((size_t)size, kIOBufferSize);
+			if (operation == OPERATION_COPY) {
+				ssize_t bytesRead = baseFile.ReadAt(offset, buffer, toCopy);
+				if (bytesRead < 0)
+					return bytesRead;
+				if ((size_t)bytesRead != toCopy)
+					return B_IO_ERROR;
+				offset += toCopy;
+			} else {
+				error = reader.Read(buffer, toCopy);
+				if (error != B_OK)
+					return error;
+			}
+
+			ssize_t bytesWritten = targetFile.Write(buffer, toCopy);
+			if (bytesWritten < 0)
+				return bytesWritten;
+			if ((size_t)bytesWritten != toCopy)
+				return B_IO_ERROR;
+
+			targetSize += toCopy;
+			size -= toCopy;
+		}
+	}
+
+	if (targetSize != fTargetSize)
+		return B_BAD_DATA;
+
+	// verify the result
+	targetFile.Unset();
+
+	BString targetChecksum;
+	error = GeneralFileChecksumAccessor(targetPackage)
+		.GetChecksum(targetChecksum);
+	if (error != B_OK)
+		return error;
+
+	return targetChecksum.ICompare(fTargetChecksum) == 0 ? B_OK : B_BAD_DATA;
+}
+
+
+/*!	Returns the name of the file the delta for the package file
+	\a packageFileName is stored under in a transaction directory.
+*/
+/*static*/ BString
+PackageDelta::DeltaFileName(const BString& packageFileName)
+{
+	return BString(packageFileName) << ".delta";
+}
+
+
+/*!	Returns the URL the delta from the package file with the checksum
+	\a baseChecksum to the package file \a packageFileName is published at.
+*/
+/*static*/ BString
+PackageDelta::DeltaURL(const BString& packagesURL,
+	const BString& packageFileName, const BString& baseChecksum)
+{
+	BString url(packagesURL);
+	url << "/deltas/" << packageFileName << '/' << baseChecksum;
+	return url;
+}
+
+
+/*!	Finds the ranges of \a target that also occur in \a base and writes the
+	operations reconstructing \a target to \a writer.
+	The aligned blocks of \a base are indexed by a rolling checksum, which is
+	then slid over \a target one byte at a time. Each verified match is
+	extended in both directions as far as the data agree.
+*/
+status_t
+PackageDelta::_Diff(const uint8* base, size_t baseSize, const uint8* target,
+	size_t targetSize, Writer& writer)
+{
+	size_t literalStart = 0;
+
+	if (baseSize >= kBlockSize && targetSize >= kBlockSize) {
+		BlockIndex index;
+		status_t error = index.Init(base, baseSize);
+		if (error != B_OK)
+			return error;
+
+		size_t position = 0;
+		uint32 a;
+		uint32 b;
+		BlockIndex::ComputeChecksum(target, a, b);
+
+		while (position + kBlockSize <= targetSize) {
+			uint32 block = index.Lookup(a, b);
+			size_t candidate = (size_t)(block - 1) * kBlockSize;
+			if (block != 0 && memcmp(base + candidate, target + position,
+					kBlockSize) == 0) {
+				size_t baseStart = candidate;
+				size_t targetStart = position;
+				while (targetStart > literalStart && baseStart > 0
+					&& base[baseStart - 1] == target[targetStart - 1]) {
+					baseStart--;
+					targetStart--;
+				}
+
+				size_t baseEnd = candidate + kBlockSize;
+				size_t targetEnd = position + kBlockSize;
+				while (targetEnd < targetSize && baseEnd < baseSize
+					&& base[baseEnd] == target[targetEnd]) {
+					baseEnd++;
+					targetEnd++;
+				}
+
+				error = writer.WriteData(target + literalStart,
+					targetStart - literalStart);
+				if (error == B_OK) {
+					error = writer.WriteCopy(baseStart,
+						targetEnd - targetStart);
+				}
+				if (error != B_OK)
+					return error;
+
+				fCopiedSize += targetEnd - targetStart;
+				position = literalStart = targetEnd;
+				if (position + kBlockSize <= targetSize)
+					BlockIndex::ComputeChecksum(target + position, a, b);
+				continue;
+			}
+
+			if (position + kBlockSize == targetSize)
+				break;
+
+			BlockIndex::RollChecksum(target[position],
+				target[position + kBlockSize], a, b);
+			position++;
+		}
+	}
+
+	return writer.WriteData(target + literalStart, targetSize - literalStart);
+}
+
+
+}	// namespace BPrivate
+
+}	// namespace BPackageKit
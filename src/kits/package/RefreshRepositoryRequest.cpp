@@ -16,6 +16,7 @@
 #include <JobQueue.h>
 
 #include <package/ActivateRepositoryCacheJob.h>
+#include <package/ApplyRepositoryDeltaJob.h>
 #include <package/ChecksumAccessors.h>
 #include <package/ValidateChecksumJob.h>
 #include <package/RepositoryCache.h>
@@ -38,7 +39,8 @@ BRefreshRepositoryRequest::BRefreshRepositoryRequest(const BContext& context,
 	const BRepositoryConfig& repoConfig)
 	:
 	inherited(context),
-	fRepoConfig(repoConfig)
+	fRepoConfig(repoConfig),
+	fValidateChecksumJob(NULL)
 {
 }
 
@@ -110,16 +112,58 @@ BRefreshRepositoryRequest::CreateInitialJobs()
 void
 BRefreshRepositoryRequest::JobSucceeded(BSupportKit::BJob* job)
 {
+	// The class layout is part of the public API, so the current cache and
+	// the delta job aren't kept in members, but looked up as needed. There is
+	// at most one delta job per request.
 	if (job == fValidateChecksumJob
 		&& !fValidateChecksumJob->ChecksumsMatch()) {
 		// the remote repo cache has a different checksum, we fetch it
 		fValidateChecksumJob = NULL;
 			// don't re-trigger fetching if anything goes wrong, fail instead
-		_FetchRepositoryCache();
+		BRepositoryCache repoCache;
+		BPackageRoster roster;
+		if (roster.GetRepositoryCache(fRepoConfig.Name(), &repoCache) == B_OK
+			&& repoCache.Entry().Exists()) {
+			_ApplyRepositoryDelta(repoCache.Entry());
+		} else
+			_FetchRepositoryCache();
+	} else if (ApplyRepositoryDeltaJob* applyDeltaJob
+			= dynamic_cast<ApplyRepositoryDeltaJob*>(job)) {
+		// fall back to fetching the complete cache, if the delta didn't work
+		if (applyDeltaJob->DeltaApplied())
+			_ActivateRepositoryCache(applyDeltaJob->TargetEntry(), NULL);
+		else
+			_FetchRepositoryCache();
 	}
 }
 
 
+status_t
+BRefreshRepositoryRequest::_ApplyRepositoryDelta(const BEntry& repoCacheEntry)
+{
+	// try to update the existing cache with the delta the repository
+	// published for it, which is usually a lot smaller than the cache
+	BEntry tempRepoCache;
+	status_t result = fContext.GetNewTempfile("repocache-", &tempRepoCache);
+	if (result != B_OK)
+		return result;
+	BString title = B_TRANSLATE("Fetching repository-delta from %url");
+	title.ReplaceAll("%url", fRepoConfig.BaseURL());
+	ApplyRepositoryDeltaJob* applyDeltaJob
+		= new (std::nothrow) ApplyRepositoryDeltaJob(fContext, title,
+			fRepoConfig.BaseURL(), repoCacheEntry, fFetchedChecksumFile,
+			tempRepoCache);
+	if (applyDeltaJob == NULL)
+		return B_NO_MEMORY;
+	if ((result = QueueJob(applyDeltaJob)) != B_OK) {
+		delete applyDeltaJob;
+		return result;
+	}
+
+	return B_OK;
+}
+
+
 status_t
 BRefreshRepositoryRequest::_FetchRepositoryCache()
 {
@@ -160,10 +204,18 @@ BRefreshRepositoryRequest::_FetchRepositoryCache()
 		return result;
 	}
 
+	return _ActivateRepositoryCache(tempRepoCache, validateChecksumJob);
+}
+
+
+status_t
+BRefreshRepositoryRequest::_ActivateRepositoryCache(
+	const BEntry& repoCacheEntry, BSupportKit::BJob* dependency)
+{
 	// job activating the cache
 	BPath targetRepoCachePath;
 	BPackageRoster roster;
-	result = fRepoConfig.IsUserSpecific()
+	status_t result = fRepoConfig.IsUserSpecific()
 		? roster.GetUserRepositoryCachePath(&targetRepoCachePath, true)
 		: roster.GetCommonRepositoryCachePath(&targetRepoCachePath, true);
 	if (result != B_OK)
@@ -172,10 +224,11 @@ BRefreshRepositoryRequest::_FetchRepositoryCache()
 	ActivateRepositoryCacheJob* activateJob
 		= new (std::nothrow) ActivateRepositoryCacheJob(fContext,
 			BString("Activating repository cache for ") << fRepoConfig.Name(),
-			tempRepoCache, fRepoConfig.Name(), targetDirectory);
+			repoCacheEntry, fRepoConfig.Name(), targetDirectory);
 	if (activateJob == NULL)
 		return B_NO_MEMORY;
-	activateJob->AddDependency(validateChecksumJob);
+	if (dependency != NULL)
+		activateJob->AddDependency(dependency);
 	if ((result = QueueJob(activateJob)) != B_OK) {
 		delete activateJob;
 		return result;
@@ -0,0 +1,367 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <package/RepositoryDelta.h>
+
+#include <map>
+#include <new>
+
+#include <File.h>
+#include <Message.h>
+#include <Path.h>
+
+#include <package/ChecksumAccessors.h>
+#include <package/hpkg/ErrorOutput.h>
+#include <package/hpkg/RepositoryWriter.h>
+#include <package/RepositoryCache.h>
+
+
+namespace BPackageKit {
+
+namespace BPrivate {
+
+
+using namespace BHPKG;
+
+
+static const uint32 kRepositoryDeltaMessageWhat = 'rpdt';
+
+static const char* const kBaseChecksumField = "base checksum";
+static const char* const kRepositoryInfoField = "repository info";
+static const char* const kPackageField = "package";
+static const char* const kAddedPackageField = "added package";
+
+
+typedef std::map<BString, const BPackageInfo*> PackageInfoMap;
+
+
+// #pragma mark - RepositoryWriterListener
+
+
+struct RepositoryWriterListener : BRepositoryWriterListener {
+	RepositoryWriterListener(BErrorOutput* errorOutput)
+		:
+		fErrorOutput(errorOutput)
+	{
+	}
+
+	virtual void PrintErrorVarArgs(const char* format, va_list args)
+	{
+		if (fErrorOutput != NULL)
+			fErrorOutput->PrintErrorVarArgs(format, args);
+	}
+
+	virtual void OnPackageAdded(const BPackageInfo& packageInfo)
+	{
+	}
+
+	virtual void OnRepositoryInfoSectionDone(uint32 uncompressedSize)
+	{
+	}
+
+	virtual void OnPackageAttributesSectionDone(uint32 stringCount,
+		uint32 uncompressedSize)
+	{
+	}
+
+	virtual void OnRepositoryDone(uint32 headerSize, uint32 repositoryInfoSize,
+		uint32 licenseCount, uint32 packageCount, uint32 packageAttributesSize,
+		uint64 totalSize)
+	{
+	}
+
+private:
+	BErrorOutput*	fErrorOutput;
+};
+
+
+// #pragma mark - RepositoryDelta
+
+
+RepositoryDelta::RepositoryDelta()
+	:
+	fBaseChecksum(),
+	fRepositoryInfo(),
+	fPackageFileNames(),
+	fAddedPackages(20)
+{
+}
+
+
+RepositoryDelta::~RepositoryDelta()
+{
+}
+
+
+/*!	Computes the delta that turns \a baseRepository into \a targetRepository.
+*/
+status_t
+RepositoryDelta::Create(const BEntry& baseRepository,
+	const BEntry& targetRepository)
+{
+	fPackageFileNames.MakeEmpty();
+	fAddedPackages.MakeEmpty();
+
+	status_t error = GeneralFileChecksumAccessor(baseRepository)
+		.GetChecksum(fBaseChecksum);
+	if (error != B_OK)
+		return error;
+
+	PackageInfoList basePackages(20);
+	error = _ReadPackageInfos(baseRepository, NULL, basePackages);
+	if (error != B_OK)
+		return error;
+
+	PackageInfoList targetPackages(20);
+	error = _ReadPackageInfos(targetRepository, &fRepositoryInfo,
+		targetPackages);
+	if (error != B_OK)
+		return error;
+
+	PackageInfoMap basePackageMap;
+	for (int32 i = 0; const BPackageInfo* info = basePackages.ItemAt(i); i++)
+		basePackageMap[info->CanonicalFileName()] = info;
+
+	// Record all package file names in order, but only transfer the package
+	// infos the base doesn't know yet. A package that keeps its name, but
+	// whose info changed, is transferred as well.
+	while (!targetPackages.IsEmpty()) {
+		BPackageInfo* info = targetPackages.RemoveItemAt(0);
+		BString fileName = info->CanonicalFileName();
+		if (!fPackageFileNames.Add(fileName)) {
+			delete info;
+			return B_NO_MEMORY;
+		}
+
+		PackageInfoMap::const_iterator it = basePackageMap.find(fileName);
+		const BPackageInfo* baseInfo
+			= it != basePackageMap.end() ? it->second : NULL;
+		BMessage baseArchive;
+		BMessage archive;
+		if (baseInfo != NULL && baseInfo->Archive(&baseArchive) == B_OK
+			&& info->Archive(&archive) == B_OK
+			&& baseArchive.HasSameData(archive, true, true)) {
+			delete info;
+			continue;
+		}
+
+		if (!fAddedPackages.AddItem(info)) {
+			delete info;
+			return B_NO_MEMORY;
+		}
+	}
+
+	return B_OK;
+}
+
+
+/*!	Writes the repository file described by the delta to \a targetRepository,
+	taking all package infos the delta doesn't carry from \a baseRepository.
+	Fails with \c B_MISMATCHED_VALUES, if \a baseRepository isn't the file the
+	delta was created for.
+*/
+status_t
+RepositoryDelta::Apply(const BEntry& baseRepository,
+	const BEntry& targetRepository, BErrorOutput* errorOutput) const
+{
+	BString baseChecksum;
+	status_t error = GeneralFileChecksumAccessor(baseRepository)
+		.GetChecksum(baseChecksum);
+	if (error != B_OK)
+		return error;
+	if (baseChecksum.ICompare(fBaseChecksum) != 0)
+		return B_MISMATCHED_VALUES;
+
+	PackageInfoList basePackages(20);
+	error = _ReadPackageInfos(baseRepository, NULL, basePackages);
+	if (error != B_OK)
+		return error;
+
+	// added packages take precedence over the base ones of the same name
+	PackageInfoMap packageMap;
+	for (int32 i = 0; const BPackageInfo* info = basePackages.ItemAt(i); i++)
+		packageMap[info->CanonicalFileName()] = info;
+	for (int32 i = 0; const BPackageInfo* info = fAddedPackages.ItemAt(i);
+			i++) {
+		packageMap[info->CanonicalFileName()] = info;
+	}
+
+	BPath targetPath;
+	error = targetRepository.GetPath(&targetPath);
+	if (error != B_OK)
+		return error;
+
+	BRepositoryInfo repositoryInfo(fRepositoryInfo);
+	RepositoryWriterListener listener(errorOutput);
+	BRepositoryWriter writer(&listener, &repositoryInfo);
+	error = writer.Init(targetPath.Path());
+	if (error != B_OK)
+		return error;
+
+	int32 count = fPackageFileNames.CountStrings();
+	for (int32 i = 0; i < count; i++) {
+		PackageInfoMap::const_iterator it
+			= packageMap.find(fPackageFileNames.StringAt(i));
+		if (it == packageMap.end()) {
+			if (errorOutput != NULL) {
+				errorOutput->PrintError("Repository delta refers to unknown "
+					"package \"%s\"\n",
+					fPackageFileNames.StringAt(i).String());
+			}
+			return B_BAD_DATA;
+		}
+
+		error = writer.AddPackageInfo(*it->second);
+		if (error != B_OK)
+			return error;
+	}
+
+	return writer.Finish();
+}
+
+
+status_t
+RepositoryDelta::ReadFromFile(const BEntry& entry)
+{
+	fPackageFileNames.MakeEmpty();
+	fAddedPackages.MakeEmpty();
+
+	BFile file(&entry, B_READ_ONLY);
+	status_t error = file.InitCheck();
+	if (error != B_OK)
+		return error;
+
+	BMessage archive;
+	error = archive.Unflatten(&file);
+	if (error != B_OK)
+		return error;
+	if (archive.what != kRepositoryDeltaMessageWhat)
+		return B_BAD_DATA;
+
+	error = archive.FindString(kBaseChecksumField, &fBaseChecksum);
+	if (error != B_OK)
+		return error;
+
+	BMessage repositoryInfoArchive;
+	error = archive.FindMessage(kRepositoryInfoField, &repositoryInfoArchive);
+	if (error != B_OK)
+		return error;
+	error = fRepositoryInfo.SetTo(&repositoryInfoArchive);
+	if (error != B_OK)
+		return error;
+
+	error = archive.FindStrings(kPackageField, &fPackageFileNames);
+	if (error != B_OK && error != B_NAME_NOT_FOUND)
+		return error;
+
+	BMessage packageArchive;
+	for (int32 i = 0; archive.FindMessage(kAddedPackageField, i,
+			&packageArchive) == B_OK; i++) {
+		BPackageInfo* info = new(std::nothrow) BPackageInfo(&packageArchive,
+			&error);
+		if (info == NULL)
+			return B_NO_MEMORY;
+		if (error != B_OK || !fAddedPackages.AddItem(info)) {
+			delete info;
+			return error != B_OK ? error : B_NO_MEMORY;
+		}
+	}
+
+	return B_OK;
+}
+
+
+status_t
+RepositoryDelta::WriteToFile(const BEntry& entry) const
+{
+	BMessage archive(kRepositoryDeltaMessageWhat);
+	status_t error = archive.AddString(kBaseChecksumField, fBaseChecksum);
+	if (error != B_OK)
+		return error;
+
+	BMessage repositoryInfoArchive;
+	error = fRepositoryInfo.Archive(&repositoryInfoArchive);
+	if (error == B_OK)
+		error = archive.AddMessage(kRepositoryInfoField, &repositoryInfoArchive);
+	if (error != B_OK)
+		return error;
+
+	error = archive.AddStrings(kPackageField, fPackageFileNames);
+	if (error != B_OK)
+		return error;
+
+	for (int32 i = 0; const BPackageInfo* info = fAddedPackages.ItemAt(i);
+			i++) {
+		BMessage packageArchive;
+		error = info->Archive(&packageArchive);
+		if (error == B_OK)
+			error = archive.AddMessage(kAddedPackageField, &packageArchive);
+		if (error != B_OK)
+			return error;
+	}
+
+	BFile file(&entry, B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	error = file.InitCheck();
+	if (error != B_OK)
+		return error;
+
+	return archive.Flatten(&file);
+}
+
+
+/*!	Returns the URL the delta for the repository file with the checksum
+	\a baseChecksum is published at.
+*/
+/*static*/ BString
+RepositoryDelta::DeltaURL(const BString& baseURL, const BString& baseChecksum)
+{
+	return BString(baseURL) << "/repo.deltas/" << baseChecksum;
+}
+
+
+/*static*/ status_t
+RepositoryDelta::_ReadPackageInfos(const BEntry& repositoryEntry,
+	BRepositoryInfo* _repositoryInfo, PackageInfoList& _packageInfos)
+{
+	struct Collector {
+		static bool AddPackageInfo(void* context, const BPackageInfo& info)
+		{
+			Collector* collector = (Collector*)context;
+			BPackageInfo* copy = new(std::nothrow) BPackageInfo(info);
+			if (copy == NULL || !collector->packageInfos.AddItem(copy)) {
+				delete copy;
+				collector->error = B_NO_MEMORY;
+				return false;
+			}
+			return true;
+		}
+
+		PackageInfoList&	packageInfos;
+		status_t			error;
+	};
+
+	BRepositoryCache repository;
+	status_t error = repository.SetTo(repositoryEntry);
+	if (error != B_OK)
+		return error;
+
+	Collector collector = { _packageInfos, B_OK };
+	error = repository.GetPackageInfos(&Collector::AddPackageInfo, &collector);
+	if (error == B_OK)
+		error = collector.error;
+	if (error != B_OK)
+		return error;
+
+	if (_repositoryInfo != NULL)
+		*_repositoryInfo = repository.Info();
+
+	return B_OK;
+}
+
+
+}	// namespace BPrivate
+
+}	// namespace BPackageKit
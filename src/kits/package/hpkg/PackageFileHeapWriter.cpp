@@ -24,6 +24,9 @@
 // minimum length of data we require before trying to compress them
 static const size_t kCompressionSizeThreshold = 64;
 
+// number of chunks per compression thread that may be in flight at a time
+static const int32 kJobsPerWorker = 2;
+
 
 namespace BPackageKit {
 
@@ -47,6 +50,38 @@ struct PackageFileHeapWriter::ChunkSegment {
 };
 
 
+struct PackageFileHeapWriter::CompressionJob {
+	void*		data;
+	void*		compressedData;
+	size_t		size;
+	size_t		compressedSize;
+	status_t	status;
+	bool		done;
+};
+
+
+/*!	Makes the writer compress and write all chunks directly while in scope.
+	Needed where the code relies on the compressed heap size and the offsets
+	being up to date at all times.
+*/
+struct PackageFileHeapWriter::SynchronousWriting {
+	SynchronousWriting(PackageFileHeapWriter* writer)
+		:
+		fWriter(writer)
+	{
+		fWriter->fSynchronousWriting++;
+	}
+
+	~SynchronousWriting()
+	{
+		fWriter->fSynchronousWriting--;
+	}
+
+private:
+	PackageFileHeapWriter*	fWriter;
+};
+
+
 struct PackageFileHeapWriter::ChunkBuffer {
 	ChunkBuffer(PackageFileHeapWriter* writer, size_t bufferSize)
 		:
@@ -205,10 +240,24 @@ PackageFileHeapWriter::PackageFileHeapWriter(BErrorOutput* errorOutput,
 	fCompressedDataBuffer(NULL),
 	fPendingDataSize(0),
 	fOffsets(),
-	fCompressionAlgorithm(compressionAlgorithm)
+	fCompressionAlgorithm(compressionAlgorithm),
+	fThreadCount(1),
+	fSynchronousWriting(0),
+	fWorkers(NULL),
+	fWorkerCount(0),
+	fJobs(NULL),
+	fJobCount(0),
+	fJobsQueued(0),
+	fJobsStarted(0),
+	fJobsWritten(0),
+	fTerminating(false)
 {
 	if (fCompressionAlgorithm != NULL)
 		fCompressionAlgorithm->AcquireReference();
+
+	pthread_mutex_init(&fJobLock, NULL);
+	pthread_cond_init(&fJobQueuedCondition, NULL);
+	pthread_cond_init(&fJobDoneCondition, NULL);
 }
 
 
@@ -216,11 +265,27 @@ PackageFileHeapWriter::~PackageFileHeapWriter()
 {
 	_Uninit();
 
+	pthread_cond_destroy(&fJobDoneCondition);
+	pthread_cond_destroy(&fJobQueuedCondition);
+	pthread_mutex_destroy(&fJobLock);
+
 	if (fCompressionAlgorithm != NULL)
 		fCompressionAlgorithm->ReleaseReference();
 }
 
 
+/*!	Sets the number of threads to compress chunks with. With more than one
+	thread, chunks are handed to a pool of worker threads and written in the
+	order they were added as soon as they are done, so the resulting heap is
+	identical to the one written by a single thread.
+*/
+void
+PackageFileHeapWriter::SetThreadCount(int32 count)
+{
+	fThreadCount = std::max(count, (int32)1);
+}
+
+
 void
 PackageFileHeapWriter::Init()
 {
@@ -229,6 +294,9 @@ PackageFileHeapWriter::Init()
 	fCompressedDataBuffer = malloc(kChunkSize);
 	if (fPendingDataBuffer == NULL || fCompressedDataBuffer == NULL)
 		throw std::bad_alloc();
+
+	if (fThreadCount > 1 && fCompressionAlgorithm != NULL)
+		_StartWorkers();
 }
 
 
@@ -315,6 +383,10 @@ PackageFileHeapWriter::RemoveDataRanges(
 		throw status_t(B_BAD_VALUE);
 	}
 
+	// The code below relies on the compressed heap size being up to date, so
+	// all chunks need to be written directly.
+	SynchronousWriting synchronousWriting(this);
+
 	// Before we begin flush any pending data, so we don't need any special
 	// handling and also can use the pending data buffer.
 	status_t status = _FlushPendingData();
@@ -438,8 +510,10 @@ PackageFileHeapWriter::RemoveDataRanges(
 status_t
 PackageFileHeapWriter::Finish()
 {
-	// flush pending data, if any
+	// flush pending data, if any, and wait for all chunks to be written
 	status_t error = _FlushPendingData();
+	if (error == B_OK)
+		error = _FlushCompressionJobs();
 	if (error != B_OK)
 		return error;
 
@@ -491,6 +565,13 @@ PackageFileHeapWriter::ReadAndDecompressChunk(size_t chunkIndex,
 		return B_OK;
 	}
 
+	if (chunkIndex >= (size_t)fOffsets.Count()) {
+		// The chunk is still being compressed.
+		status_t error = _FlushCompressionJobs();
+		if (error != B_OK)
+			return error;
+	}
+
 	uint64 offset = fOffsets[chunkIndex];
 	size_t compressedSize = chunkIndex + 1 == (size_t)fOffsets.Count()
 		? fCompressedHeapSize - offset
@@ -504,6 +585,8 @@ PackageFileHeapWriter::ReadAndDecompressChunk(size_t chunkIndex,
 void
 PackageFileHeapWriter::_Uninit()
 {
+	_StopWorkers();
+
 	free(fPendingDataBuffer);
 	free(fCompressedDataBuffer);
 	fPendingDataBuffer = NULL;
@@ -511,13 +594,125 @@ PackageFileHeapWriter::_Uninit()
 }
 
 
+void
+PackageFileHeapWriter::_StartWorkers()
+{
+	fJobCount = fThreadCount * kJobsPerWorker;
+	fJobs = new CompressionJob[fJobCount];
+	for (int32 i = 0; i < fJobCount; i++) {
+		fJobs[i].data = NULL;
+		fJobs[i].compressedData = NULL;
+		fJobs[i].done = false;
+	}
+
+	for (int32 i = 0; i < fJobCount; i++) {
+		fJobs[i].data = malloc(kChunkSize);
+		fJobs[i].compressedData = malloc(kChunkSize);
+		if (fJobs[i].data == NULL || fJobs[i].compressedData == NULL)
+			throw std::bad_alloc();
+	}
+
+	fWorkers = new pthread_t[fThreadCount];
+	fTerminating = false;
+
+	for (int32 i = 0; i < fThreadCount; i++) {
+		if (pthread_create(&fWorkers[fWorkerCount], NULL, &_WorkerEntry,
+				this) != 0) {
+			break;
+		}
+		fWorkerCount++;
+	}
+
+	// If not a single worker could be started, we simply compress the chunks
+	// ourselves.
+}
+
+
+void
+PackageFileHeapWriter::_StopWorkers()
+{
+	if (fWorkers != NULL) {
+		pthread_mutex_lock(&fJobLock);
+		fTerminating = true;
+		pthread_cond_broadcast(&fJobQueuedCondition);
+		pthread_mutex_unlock(&fJobLock);
+
+		for (int32 i = 0; i < fWorkerCount; i++)
+			pthread_join(fWorkers[i], NULL);
+
+		delete[] fWorkers;
+		fWorkers = NULL;
+		fWorkerCount = 0;
+	}
+
+	if (fJobs != NULL) {
+		for (int32 i = 0; i < fJobCount; i++) {
+			free(fJobs[i].data);
+			free(fJobs[i].compressedData);
+		}
+
+		delete[] fJobs;
+		fJobs = NULL;
+		fJobCount = 0;
+	}
+
+	fJobsQueued = 0;
+	fJobsStarted = 0;
+	fJobsWritten = 0;
+}
+
+
+/*static*/ void*
+PackageFileHeapWriter::_WorkerEntry(void* data)
+{
+	((PackageFileHeapWriter*)data)->_Worker();
+	return NULL;
+}
+
+
+void
+PackageFileHeapWriter::_Worker()
+{
+	pthread_mutex_lock(&fJobLock);
+
+	while (true) {
+		while (fJobsStarted == fJobsQueued && !fTerminating)
+			pthread_cond_wait(&fJobQueuedCondition, &fJobLock);
+
+		if (fTerminating)
+			break;
+
+		CompressionJob& job = fJobs[fJobsStarted++ % fJobCount];
+		pthread_mutex_unlock(&fJobLock);
+
+		job.status = _CompressChunk(job.data, job.size, job.compressedData,
+			job.compressedSize);
+
+		pthread_mutex_lock(&fJobLock);
+		job.done = true;
+		pthread_cond_signal(&fJobDoneCondition);
+	}
+
+	pthread_mutex_unlock(&fJobLock);
+}
+
+
 status_t
 PackageFileHeapWriter::_FlushPendingData()
 {
 	if (fPendingDataSize == 0)
 		return B_OK;
 
-	status_t error = _WriteChunk(fPendingDataBuffer, fPendingDataSize, true);
+	status_t error;
+	if (fWorkerCount > 0 && fSynchronousWriting == 0) {
+		error = _QueueCompressionJob();
+	} else {
+		// write chunks still being compressed first
+		error = _FlushCompressionJobs();
+		if (error == B_OK)
+			error = _WriteChunk(fPendingDataBuffer, fPendingDataSize, true);
+	}
+
 	if (error == B_OK)
 		fPendingDataSize = 0;
 
@@ -526,29 +721,54 @@ PackageFileHeapWriter::_FlushPendingData()
 
 
 status_t
-PackageFileHeapWriter::_WriteChunk(const void* data, size_t size,
-	bool mayCompress)
+PackageFileHeapWriter::_QueueCompressionJob()
 {
-	// add offset
-	if (!fOffsets.Add(fCompressedHeapSize)) {
-		fErrorOutput->PrintError("Out of memory!\n");
-		return B_NO_MEMORY;
+	// If all jobs are in use, write the oldest one to free it.
+	if (fJobsQueued - fJobsWritten == (uint64)fJobCount) {
+		status_t error = _WriteNextCompressionJob();
+		if (error != B_OK)
+			return error;
 	}
 
-	// Try to use compression only for data large enough.
-	bool compress = mayCompress && size >= (off_t)kCompressionSizeThreshold;
-	if (compress) {
-		status_t error = _WriteDataCompressed(data, size);
-		if (error != B_OK) {
-			if (error != B_BUFFER_OVERFLOW)
-				return error;
-			compress = false;
-		}
-	}
+	// Hand the pending data buffer over to the job and use the job's buffer
+	// for the pending data instead.
+	CompressionJob& job = fJobs[fJobsQueued % fJobCount];
+	std::swap(job.data, fPendingDataBuffer);
+	job.size = fPendingDataSize;
+	job.done = false;
+
+	pthread_mutex_lock(&fJobLock);
+	fJobsQueued++;
+	pthread_cond_signal(&fJobQueuedCondition);
+	pthread_mutex_unlock(&fJobLock);
+
+	return B_OK;
+}
+
+
+status_t
+PackageFileHeapWriter::_WriteNextCompressionJob()
+{
+	CompressionJob& job = fJobs[fJobsWritten % fJobCount];
+
+	pthread_mutex_lock(&fJobLock);
+	while (!job.done)
+		pthread_cond_wait(&fJobDoneCondition, &fJobLock);
+	pthread_mutex_unlock(&fJobLock);
+
+	// Only we queue jobs, so the job can't be reused before we're done here.
+	fJobsWritten++;
+
+	return _WriteCompressedChunk(job.data, job.size, job.compressedData,
+		job.compressedSize, job.status);
+}
 
-	// Write uncompressed, if necessary.
-	if (!compress) {
-		status_t error = _WriteDataUncompressed(data, size);
+
+status_t
+PackageFileHeapWriter::_FlushCompressionJobs()
+{
+	while (fJobsWritten < fJobsQueued) {
+		status_t error = _WriteNextCompressionJob();
 		if (error != B_OK)
 			return error;
 	}
@@ -557,30 +777,71 @@ PackageFileHeapWriter::_WriteChunk(const void* data, size_t size,
 }
 
 
+/*!	Compresses the given chunk data into \a buffer, which must be at least
+	\a size bytes large. May be called by the worker threads concurrently.
+	Returns \c B_BUFFER_OVERFLOW, if the data shall be stored uncompressed.
+*/
 status_t
-PackageFileHeapWriter::_WriteDataCompressed(const void* data, size_t size)
+PackageFileHeapWriter::_CompressChunk(const void* data, size_t size,
+	void* buffer, size_t& _compressedSize) const
 {
-	if (fCompressionAlgorithm == NULL)
+	// Try to use compression only for data large enough.
+	if (fCompressionAlgorithm == NULL || size < kCompressionSizeThreshold)
 		return B_BUFFER_OVERFLOW;
 
 	const iovec uncompressed = { (void*)data, size };
-	iovec compressed = { fCompressedDataBuffer, size };
+	iovec compressed = { buffer, size };
 	status_t error = fCompressionAlgorithm->algorithm->CompressBuffer(
 		uncompressed, compressed,
 		fCompressionAlgorithm->parameters);
-	if (error != B_OK) {
-		if (error != B_BUFFER_OVERFLOW) {
-			fErrorOutput->PrintError("Failed to compress chunk data: %s\n",
-				strerror(error));
-		}
+	if (error != B_OK)
 		return error;
-	}
 
 	// only use compressed data when we've actually saved space
 	if (compressed.iov_len == size)
 		return B_BUFFER_OVERFLOW;
 
-	return _WriteDataUncompressed(fCompressedDataBuffer, compressed.iov_len);
+	_compressedSize = compressed.iov_len;
+	return B_OK;
+}
+
+
+status_t
+PackageFileHeapWriter::_WriteChunk(const void* data, size_t size,
+	bool mayCompress)
+{
+	size_t compressedSize = 0;
+	status_t compressionStatus = mayCompress
+		? _CompressChunk(data, size, fCompressedDataBuffer, compressedSize)
+		: B_BUFFER_OVERFLOW;
+
+	return _WriteCompressedChunk(data, size, fCompressedDataBuffer,
+		compressedSize, compressionStatus);
+}
+
+
+status_t
+PackageFileHeapWriter::_WriteCompressedChunk(const void* data, size_t size,
+	const void* compressedData, size_t compressedSize,
+	status_t compressionStatus)
+{
+	// add offset
+	if (!fOffsets.Add(fCompressedHeapSize)) {
+		fErrorOutput->PrintError("Out of memory!\n");
+		return B_NO_MEMORY;
+	}
+
+	if (compressionStatus == B_OK)
+		return _WriteDataUncompressed(compressedData, compressedSize);
+
+	if (compressionStatus != B_BUFFER_OVERFLOW) {
+		fErrorOutput->PrintError("Failed to compress chunk data: %s\n",
+			strerror(compressionStatus));
+		return compressionStatus;
+	}
+
+	// write uncompressed
+	return _WriteDataUncompressed(data, size);
 }
 
 
@@ -6,6 +6,7 @@
 
 #include <package/hpkg/PackageWriter.h>
 
+#include <algorithm>
 #include <new>
 
 #include <package/hpkg/PackageWriterImpl.h>
@@ -23,7 +24,8 @@ BPackageWriterParameters::BPackageWriterParameters()
 	:
 	fFlags(0),
 	fCompression(B_HPKG_COMPRESSION_ZLIB),
-	fCompressionLevel(B_HPKG_COMPRESSION_LEVEL_BEST)
+	fCompressionLevel(B_HPKG_COMPRESSION_LEVEL_BEST),
+	fThreadCount(1)
 {
 }
 
@@ -57,7 +59,8 @@ BPackageWriterParameters::Compression() const
 void
 BPackageWriterParameters::SetCompression(uint32 compression)
 {
-	fCompression = compression;
+	// values that don't fit are invalid anyway, make sure they stay so
+	fCompression = std::min(compression, (uint32)UINT16_MAX);
 }
 
 
@@ -71,7 +74,22 @@ BPackageWriterParameters::CompressionLevel() const
 void
 BPackageWriterParameters::SetCompressionLevel(int32 compressionLevel)
 {
-	fCompressionLevel = compressionLevel;
+	fCompressionLevel = std::max((int32)INT16_MIN,
+		std::min(compressionLevel, (int32)INT16_MAX));
+}
+
+
+int32
+BPackageWriterParameters::ThreadCount() const
+{
+	return fThreadCount;
+}
+
+
+void
+BPackageWriterParameters::SetThreadCount(int32 threadCount)
+{
+	fThreadCount = threadCount;
 }
 
 
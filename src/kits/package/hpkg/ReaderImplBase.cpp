@@ -34,6 +34,15 @@ namespace BHPKG {
 namespace BPrivate {
 
 
+// maximum nesting depth of attributes we support reading -- the deepest
+// attributes are those of entries in deeply nested directories, whose paths are
+// limited in length anyway
+static const int kMaxAttributeTreeDepth = 1024;
+
+// maximum number of bytes of an unsigned LEB128 encoded 64 bit value
+static const size_t kMaxUnsignedLEB128Size = 10;
+
+
 static const uint16 kAttributeTypes[B_HPKG_ATTRIBUTE_ID_ENUM_COUNT] = {
 	#define B_DEFINE_HPKG_ATTRIBUTE(id, type, name, constant)	\
 		B_HPKG_ATTRIBUTE_TYPE_##type,
@@ -797,6 +806,21 @@ ReaderImplBase::LowLevelAttributeHandler::NotifyDone(
 }
 
 
+// #pragma mark - LowLevelAttributeNode
+
+
+/*!	An attribute with children, whose children are currently being parsed by
+	_ParseLowLevelAttributeTree().
+*/
+struct ReaderImplBase::LowLevelAttributeNode {
+	LowLevelAttributeNode*	parent;
+	void*					parentToken;
+	void*					token;
+	uint8					id;
+	AttributeValue			value;
+};
+
+
 // #pragma mark - ReaderImplBase
 
 
@@ -1099,7 +1123,9 @@ ReaderImplBase::ParseAttributeTree(AttributeHandlerContext* context,
 		}
 	}
 
-	status_t error = _ParseAttributeTree(context);
+	status_t error = context->hasLowLevelHandler
+		? _ParseLowLevelAttributeTree(context)
+		: _ParseAttributeTree(context);
 
 	if (context->hasLowLevelHandler) {
 		status_t endError = context->lowLevelHandler->HandleSectionEnd(
@@ -1152,6 +1178,12 @@ ReaderImplBase::_ParseAttributeTree(AttributeHandlerContext* context)
 			continue;
 		}
 
+		if (hasChildren && level >= kMaxAttributeTreeDepth) {
+			fErrorOutput->PrintError("Error: Invalid %s section: attributes "
+				"nested too deeply\n", fCurrentSection->name);
+			return B_BAD_DATA;
+		}
+
 		AttributeHandler* childHandler = NULL;
 		error = CurrentAttributeHandler()->HandleAttribute(context, id, value,
 			hasChildren ? &childHandler : NULL);
@@ -1176,6 +1208,105 @@ ReaderImplBase::_ParseAttributeTree(AttributeHandlerContext* context)
 }
 
 
+/*!	Parses the attribute tree of the current section for a low-level content
+	handler. Does the same as _ParseAttributeTree() with LowLevelAttributeHandlers
+	would, but without creating a handler object per attribute with children
+	and dispatching every attribute through it. Only the open attributes are
+	remembered, in nodes allocated from the context's handler allocator.
+*/
+status_t
+ReaderImplBase::_ParseLowLevelAttributeTree(AttributeHandlerContext* context)
+{
+	BLowLevelPackageContentHandler* contentHandler = context->lowLevelHandler;
+	LowLevelAttributeNode* node = NULL;
+	int level = 0;
+	status_t error;
+
+	while (true) {
+		uint8 id;
+		AttributeValue value;
+		bool hasChildren;
+		uint64 tag;
+
+		error = _ReadAttribute(id, value, &hasChildren, &tag);
+		if (error != B_OK)
+			break;
+
+		if (tag == 0) {
+			// end of the section or of the children of the current node
+			if (node == NULL)
+				break;
+
+			error = contentHandler->HandleAttributeDone(
+				(BHPKGAttributeID)node->id, node->value, node->parentToken,
+				node->token);
+
+			LowLevelAttributeNode* parent = node->parent;
+			node->~LowLevelAttributeNode();
+			context->handlersAllocator.Free(node);
+			node = parent;
+			level--;
+
+			if (error != B_OK)
+				break;
+			continue;
+		}
+
+		if (hasChildren && level >= kMaxAttributeTreeDepth) {
+			fErrorOutput->PrintError("Error: Invalid %s section: attributes "
+				"nested too deeply\n", fCurrentSection->name);
+			error = B_BAD_DATA;
+			break;
+		}
+
+		void* parentToken = node != NULL ? node->token : NULL;
+		void* token;
+		error = contentHandler->HandleAttribute((BHPKGAttributeID)id, value,
+			parentToken, token);
+		if (error != B_OK)
+			break;
+
+		if (!hasChildren) {
+			error = contentHandler->HandleAttributeDone((BHPKGAttributeID)id,
+				value, parentToken, token);
+			if (error != B_OK)
+				break;
+			continue;
+		}
+
+		// remember the attribute while parsing its children
+		void* memory = context->handlersAllocator.Allocate(
+			sizeof(LowLevelAttributeNode));
+		if (memory == NULL) {
+			contentHandler->HandleAttributeDone((BHPKGAttributeID)id, value,
+				parentToken, token);
+			fErrorOutput->PrintError("Error: Out of memory!\n");
+			error = B_NO_MEMORY;
+			break;
+		}
+
+		LowLevelAttributeNode* child = new(memory) LowLevelAttributeNode;
+		child->parent = node;
+		child->parentToken = parentToken;
+		child->token = token;
+		child->id = id;
+		child->value = value;
+		node = child;
+		level++;
+	}
+
+	// free the nodes still open in case of error
+	while (node != NULL) {
+		LowLevelAttributeNode* parent = node->parent;
+		node->~LowLevelAttributeNode();
+		context->handlersAllocator.Free(node);
+		node = parent;
+	}
+
+	return error;
+}
+
+
 status_t
 ReaderImplBase::_ReadAttribute(uint8& _id, AttributeValue& _value,
 	bool* _hasChildren, uint64* _tag)
@@ -1209,9 +1340,14 @@ ReaderImplBase::_ReadAttribute(uint8& _id, AttributeValue& _value,
 			return B_BAD_DATA;
 		}
 
-		// get the value
-		error = ReadAttributeValue(type, attribute_tag_encoding(tag),
-			_value);
+		// get the value -- only raw values need the derived class' help
+		if (type == B_HPKG_ATTRIBUTE_TYPE_RAW) {
+			error = ReadAttributeValue(type, attribute_tag_encoding(tag),
+				_value);
+		} else {
+			error = ReaderImplBase::ReadAttributeValue(type,
+				attribute_tag_encoding(tag), _value);
+		}
 		if (error != B_OK)
 			return error;
 	}
@@ -1293,7 +1429,7 @@ ReaderImplBase::ReadAttributeValue(uint8 type, uint8 encoding,
 				if (error != B_OK)
 					return error;
 
-				if (index > fCurrentSection->stringsCount) {
+				if (index >= fCurrentSection->stringsCount) {
 					fErrorOutput->PrintError("Error: Invalid %s section: "
 						"string reference (%lld) out of bounds (%lld)\n",
 						fCurrentSection->name, index,
@@ -1329,22 +1465,32 @@ ReaderImplBase::ReadAttributeValue(uint8 type, uint8 encoding,
 status_t
 ReaderImplBase::ReadUnsignedLEB128(uint64& _value)
 {
-	uint64 result = 0;
-	int shift = 0;
-	while (true) {
-		uint8 byte;
-		status_t error = _Read(byte);
-		if (error != B_OK)
-			return error;
+	// This is called for virtually every attribute tag and value, so decode
+	// directly from the section data instead of reading byte by byte.
+	const uint8* data = fCurrentSection->data + fCurrentSection->currentOffset;
+	size_t available = std::min(kMaxUnsignedLEB128Size,
+		size_t(fCurrentSection->uncompressedLength
+			- fCurrentSection->currentOffset));
 
-		result |= uint64(byte & 0x7f) << shift;
-		if ((byte & 0x80) == 0)
-			break;
-		shift += 7;
+	uint64 result = 0;
+	for (size_t i = 0; i < available; i++) {
+		uint8 byte = data[i];
+		result |= uint64(byte & 0x7f) << (7 * i);
+		if ((byte & 0x80) == 0) {
+			fCurrentSection->currentOffset += i + 1;
+			_value = result;
+			return B_OK;
+		}
 	}
 
-	_value = result;
-	return B_OK;
+	if (available == kMaxUnsignedLEB128Size) {
+		fErrorOutput->PrintError("Error: Invalid %s section: LEB128 value too "
+			"long\n", fCurrentSection->name);
+	} else {
+		fErrorOutput->PrintError("ReadUnsignedLEB128(): read beyond %s end\n",
+			fCurrentSection->name);
+	}
+	return B_BAD_DATA;
 }
 
 
@@ -358,6 +358,7 @@ WriterImplBase::InitHeapReader(size_t headerSize)
 	// create heap writer
 	fHeapWriter = new PackageFileHeapWriter(fErrorOutput, fFile, headerSize,
 		compressionAlgorithm, decompressionAlgorithm);
+	fHeapWriter->SetThreadCount(fParameters.ThreadCount());
 	fHeapWriter->Init();
 
 	return B_OK;
@@ -12,8 +12,13 @@
 
 #include <glob.h>
 
+#include <algorithm>
+
+#include <Autolock.h>
 #include <Catalog.h>
 #include <Directory.h>
+#include <Locker.h>
+#include <OS.h>
 #include <package/CommitTransactionResult.h>
 #include <package/DownloadFileRequest.h>
 #include <package/PackageRoster.h>
@@ -28,8 +33,10 @@
 
 #include <CopyEngine.h>
 #include <package/ActivationTransaction.h>
+#include <package/ChecksumAccessors.h>
 #include <package/DaemonClient.h>
 #include <package/manager/RepositoryBuilder.h>
+#include <package/PackageDelta.h>
 #include <package/ValidateChecksumJob.h>
 
 #include "FetchFileJob.h"
@@ -42,6 +49,8 @@ using BPackageKit::BPrivate::FetchUtils;
 
 
 using BPackageKit::BPrivate::FetchFileJob;
+using BPackageKit::BPrivate::GeneralFileChecksumAccessor;
+using BPackageKit::BPrivate::PackageDelta;
 using BPackageKit::BPrivate::ValidateChecksumJob;
 
 
@@ -52,6 +61,109 @@ namespace BManager {
 namespace BPrivate {
 
 
+// Repository caches and packages are fetched by this many threads at most.
+static const int32 kMaxConcurrentFetches = 4;
+
+
+// #pragma mark - FetchTask
+
+
+/*!	Either a repository to refresh (if \c config is set) or a package to
+	download.
+*/
+struct BPackageManager::FetchTask {
+	FetchTask(const BRepositoryConfig* config)
+		:
+		config(config),
+		package(NULL),
+		reusingDownload(false),
+		result(B_OK)
+	{
+	}
+
+	FetchTask(BSolverPackage* package, const BString& url,
+		const BEntry& entry, bool reusingDownload)
+		:
+		config(NULL),
+		package(package),
+		url(url),
+		entry(entry),
+		reusingDownload(reusingDownload),
+		result(B_OK)
+	{
+	}
+
+	const BRepositoryConfig*	config;
+	BSolverPackage*				package;
+	BString						url;
+	BEntry						entry;
+	BString						deltaURL;
+	BPath						basePackagePath;
+	BEntry						deltaEntry;
+	bool						reusingDownload;
+	status_t					result;
+};
+
+
+struct BPackageManager::FetchTaskRunner {
+	BPackageManager*	manager;
+	FetchTaskList*		tasks;
+	int32				nextTask;
+};
+
+
+// #pragma mark - SerializedJobStateListener
+
+
+/*!	Forwards the job state notifications of concurrently running requests to
+	the package manager one at a time.
+*/
+class BPackageManager::SerializedJobStateListener
+	: public BSupportKit::BJobStateListener {
+public:
+	SerializedJobStateListener(BSupportKit::BJobStateListener& target)
+		:
+		fLock("package manager job state"),
+		fTarget(target)
+	{
+	}
+
+	virtual void JobStarted(BSupportKit::BJob* job)
+	{
+		BAutolock locker(fLock);
+		fTarget.JobStarted(job);
+	}
+
+	virtual void JobProgress(BSupportKit::BJob* job)
+	{
+		BAutolock locker(fLock);
+		fTarget.JobProgress(job);
+	}
+
+	virtual void JobSucceeded(BSupportKit::BJob* job)
+	{
+		BAutolock locker(fLock);
+		fTarget.JobSucceeded(job);
+	}
+
+	virtual void JobFailed(BSupportKit::BJob* job)
+	{
+		BAutolock locker(fLock);
+		fTarget.JobFailed(job);
+	}
+
+	virtual void JobAborted(BSupportKit::BJob* job)
+	{
+		BAutolock locker(fLock);
+		fTarget.JobAborted(job);
+	}
+
+private:
+	BLocker							fLock;
+	BSupportKit::BJobStateListener&	fTarget;
+};
+
+
 // #pragma mark - BPackageManager
 
 
@@ -70,6 +182,7 @@ BPackageManager::BPackageManager(BPackageInstallationLocation location,
 	fOtherRepositories(10),
 	fLocalRepository(new (std::nothrow) MiscLocalRepository),
 	fTransactions(5),
+	fJobStateListener(new (std::nothrow) SerializedJobStateListener(*this)),
 	fInstallationInterface(installationInterface),
 	fUserInteractionHandler(userInteractionHandler)
 {
@@ -82,6 +195,7 @@ BPackageManager::~BPackageManager()
 	delete fSystemRepository;
 	delete fHomeRepository;
 	delete fLocalRepository;
+	delete fJobStateListener;
 }
 
 
@@ -97,7 +211,7 @@ BPackageManager::Init(uint32 flags)
 		DIE(error, "Failed to create solver");
 
 	if (fSystemRepository == NULL || fHomeRepository == NULL
-		|| fLocalRepository == NULL) {
+		|| fLocalRepository == NULL || fJobStateListener == NULL) {
 		throw std::bad_alloc();
 	}
 
@@ -137,11 +251,32 @@ BPackageManager::Init(uint32 flags)
 				B_TRANSLATE("Failed to get repository names"));
 		}
 
+		RepositoryConfigList configs(10);
 		int32 repositoryNameCount = repositoryNames.CountStrings();
 		for (int32 i = 0; i < repositoryNameCount; i++) {
-			_AddRemoteRepository(roster, repositoryNames.StringAt(i),
-				(flags & B_REFRESH_REPOSITORIES) != 0);
+			const BString& name = repositoryNames.StringAt(i);
+			BRepositoryConfig* config = new BRepositoryConfig;
+			error = roster.GetRepositoryConfig(name, config);
+			if (error != B_OK) {
+				fUserInteractionHandler->Warn(error, B_TRANSLATE(
+					"Failed to get config for repository \"%s\". Skipping."),
+					name.String());
+				delete config;
+				continue;
+			}
+
+			if (!configs.AddItem(config)) {
+				delete config;
+				throw std::bad_alloc();
+			}
 		}
+
+		// refresh the caches concurrently before adding any of them
+		_RefreshRepositories(roster, configs,
+			(flags & B_REFRESH_REPOSITORIES) != 0);
+
+		for (int32 i = 0; BRepositoryConfig* config = configs.ItemAt(i); i++)
+			_AddRemoteRepository(roster, *config);
 	}
 }
 
@@ -550,7 +685,8 @@ BPackageManager::_PreparePackageChanges(
 	if (error != B_OK)
 		DIE(error, "Failed to create transaction");
 
-	// download the new packages and prepare the transaction
+	// prepare the transaction and collect the packages to download
+	FetchTaskList downloadTasks(20);
 	for (int32 i = 0; BSolverPackage* package = packagesToActivate.ItemAt(i);
 		i++) {
 		// get package URL and target entry
@@ -606,32 +742,35 @@ BPackageManager::_PreparePackageChanges(
 				}
 			}
 
-			// download the package (this will resume the download if the
-			// file already exists)
 			BString url = remoteRepository->Config().PackagesURL();
 			url << '/' << fileName;
 
-			status_t error;
-retryDownload:
-			error = DownloadPackage(url, entry,
-				package->Info().Checksum());
-			if (error != B_OK) {
-				if (error == B_BAD_DATA || error == ERANGE) {
-					// B_BAD_DATA is returned when there is a checksum
-					// mismatch. Make sure this download is not re-used.
-					entry.Remove();
-
-					if (reusingDownload) {
-						// Maybe the download we reused had some problem.
-						// Try again, this time without reusing the download.
-						printf("\nPrevious download '%s' was invalid. Redownloading.\n",
-							path.Path());
-						reusingDownload = false;
-						goto retryDownload;
-					}
-				}
-				DIE(error, "Failed to download package %s",
-					package->Info().Name().String());
+			FetchTask* task = new FetchTask(package, url, entry,
+				reusingDownload);
+			if (!downloadTasks.AddItem(task)) {
+				delete task;
+				throw std::bad_alloc();
+			}
+
+			// If the package replaces an installed version, the repository
+			// may provide a delta against that, which is much smaller than the
+			// package file. The package daemon reconstructs the package file.
+			BSolverPackage* installedPackage = NULL;
+			for (int32 k = 0; !reusingDownload
+					&& (installedPackage = packagesToDeactivate.ItemAt(k))
+						!= NULL; k++) {
+				if (installedPackage->Info().Name() == package->Info().Name())
+					break;
+			}
+			if (installedPackage != NULL) {
+				installationRepository.GetPackagePath(installedPackage,
+					task->basePackagePath);
+				task->deltaURL = remoteRepository->Config().PackagesURL();
+				error = task->deltaEntry.SetTo(
+					&transaction->TransactionDirectory(),
+					PackageDelta::DeltaFileName(fileName));
+				if (error != B_OK)
+					DIE(error, "Failed to create package delta entry");
 			}
 		} else if (package->Repository() != &installationRepository) {
 			// clone the existing package
@@ -651,6 +790,35 @@ retryDownload:
 		}
 	}
 
+	// download the packages concurrently (this will resume the downloads if
+	// the files already exist)
+	_RunFetchTasks(downloadTasks);
+
+	for (int32 i = 0; FetchTask* task = downloadTasks.ItemAt(i); i++) {
+		error = task->result;
+		if (error == B_BAD_DATA || error == ERANGE) {
+			// B_BAD_DATA is returned when there is a checksum mismatch. Make
+			// sure this download is not re-used.
+			task->entry.Remove();
+
+			if (task->reusingDownload) {
+				// Maybe the download we reused had some problem. Try again,
+				// this time without reusing the download.
+				printf("\nPrevious download '%s' was invalid. Redownloading.\n",
+					BPath(&task->entry).Path());
+				error = DownloadPackage(task->url, task->entry,
+					task->package->Info().Checksum());
+				if (error == B_BAD_DATA || error == ERANGE)
+					task->entry.Remove();
+			}
+		}
+
+		if (error != B_OK) {
+			DIE(error, "Failed to download package %s",
+				task->package->Info().Name().String());
+		}
+	}
+
 	for (int32 i = 0; BSolverPackage* package = packagesToDeactivate.ItemAt(i);
 		i++) {
 		// add package to transaction
@@ -773,22 +941,49 @@ BPackageManager::_AddInstalledRepository(InstalledRepository* repository)
 
 
 void
-BPackageManager::_AddRemoteRepository(BPackageRoster& roster, const char* name,
-	bool refresh)
+BPackageManager::_RefreshRepositories(BPackageRoster& roster,
+	const RepositoryConfigList& configs, bool refresh)
 {
-	BRepositoryConfig config;
-	status_t error = roster.GetRepositoryConfig(name, &config);
-	if (error != B_OK) {
-		fUserInteractionHandler->Warn(error, B_TRANSLATE(
-			"Failed to get config for repository \"%s\". Skipping."), name);
-		return;
+	// Refresh all repositories we're asked to, as well as those without a
+	// cache yet.
+	FetchTaskList tasks(10);
+	for (int32 i = 0; const BRepositoryConfig* config = configs.ItemAt(i);
+			i++) {
+		BRepositoryCache cache;
+		if (!refresh
+			&& roster.GetRepositoryCache(config->Name(), &cache) == B_OK) {
+			continue;
+		}
+
+		FetchTask* task = new FetchTask(config);
+		if (!tasks.AddItem(task)) {
+			delete task;
+			throw std::bad_alloc();
+		}
+	}
+
+	_RunFetchTasks(tasks);
+
+	for (int32 i = 0; FetchTask* task = tasks.ItemAt(i); i++) {
+		if (task->result != B_OK) {
+			fUserInteractionHandler->Warn(task->result, B_TRANSLATE(
+				"Refreshing repository \"%s\" failed"),
+				task->config->Name().String());
+		}
 	}
+}
+
 
+void
+BPackageManager::_AddRemoteRepository(BPackageRoster& roster,
+	const BRepositoryConfig& config)
+{
 	BRepositoryCache cache;
-	error = _GetRepositoryCache(roster, config, refresh, cache);
+	status_t error = roster.GetRepositoryCache(config.Name(), &cache);
 	if (error != B_OK) {
 		fUserInteractionHandler->Warn(error, B_TRANSLATE(
-			"Failed to get cache for repository \"%s\". Skipping."), name);
+			"Failed to get cache for repository \"%s\". Skipping."),
+			config.Name().String());
 		return;
 	}
 
@@ -803,20 +998,111 @@ BPackageManager::_AddRemoteRepository(BPackageRoster& roster, const char* name,
 }
 
 
+/*!	Runs the given refresh and download tasks on up to
+	\c kMaxConcurrentFetches threads and stores their results in the tasks.
+	Warning about or recovering from failures is left to the caller.
+*/
+void
+BPackageManager::_RunFetchTasks(FetchTaskList& tasks)
+{
+	FetchTaskRunner runner = { this, &tasks, 0 };
+
+	int32 threadCount = std::min(tasks.CountItems(), kMaxConcurrentFetches);
+	thread_id threads[kMaxConcurrentFetches];
+	for (int32 i = 1; i < threadCount; i++) {
+		threads[i] = spawn_thread(&_FetchTaskWorker, "package fetcher",
+			B_NORMAL_PRIORITY, &runner);
+		if (threads[i] >= 0)
+			resume_thread(threads[i]);
+	}
+
+	// the current thread works along
+	_FetchTaskWorker(&runner);
+
+	for (int32 i = 1; i < threadCount; i++) {
+		status_t result;
+		if (threads[i] >= 0)
+			wait_for_thread(threads[i], &result);
+	}
+}
+
+
+/*static*/ status_t
+BPackageManager::_FetchTaskWorker(void* data)
+{
+	FetchTaskRunner* runner = (FetchTaskRunner*)data;
+	BPackageManager* manager = runner->manager;
+
+	while (true) {
+		int32 index = atomic_add(&runner->nextTask, 1);
+		FetchTask* task = runner->tasks->ItemAt(index);
+		if (task == NULL)
+			return B_OK;
+
+		try {
+			if (task->config != NULL)
+				task->result = manager->RefreshRepository(*task->config);
+			else if (task->deltaURL.IsEmpty()
+				|| manager->_DownloadPackageDelta(*task) != B_OK) {
+				task->result = manager->DownloadPackage(task->url, task->entry,
+					task->package->Info().Checksum());
+			}
+		} catch (BFatalErrorException& exception) {
+			task->result = exception.Error();
+		} catch (std::bad_alloc&) {
+			task->result = B_NO_MEMORY;
+		} catch (...) {
+			task->result = B_ERROR;
+		}
+	}
+}
+
+
+/*!	Tries to fetch the delta from the installed package file to the one
+	\a task shall download. Returns \c B_OK, if the delta has been stored in
+	the transaction directory and turns the installed package into the expected
+	package file. Since most repositories don't publish deltas, the fetch isn't
+	reported to the job state listener; the job gets a listener that ignores
+	all notifications instead.
+*/
 status_t
-BPackageManager::_GetRepositoryCache(BPackageRoster& roster,
-	const BRepositoryConfig& config, bool refresh, BRepositoryCache& _cache)
+BPackageManager::_DownloadPackageDelta(FetchTask& task)
 {
-	if (!refresh && roster.GetRepositoryCache(config.Name(), &_cache) == B_OK)
-		return B_OK;
+	BString baseChecksum;
+	status_t error = GeneralFileChecksumAccessor(
+		BEntry(task.basePackagePath.Path())).GetChecksum(baseChecksum);
+	if (error != B_OK)
+		return error;
+
+	BString fileName(task.package->Info().FileName());
+	BDecisionProvider provider;
+	BSupportKit::BJobStateListener silentListener;
+	BContext context(provider, silentListener);
+	FetchFileJob fetchJob(context, BString("Downloading delta for ")
+			<< fileName,
+		PackageDelta::DeltaURL(task.deltaURL, fileName, baseChecksum),
+		task.deltaEntry);
+	error = fetchJob.Run();
+
+	// check that the delta connects the right files, the daemon verifies that
+	// the reconstructed package actually matches
+	PackageDelta delta;
+	if (error == B_OK)
+		error = delta.SetTo(task.deltaEntry);
+	if (error == B_OK && (delta.BaseChecksum().ICompare(baseChecksum) != 0
+			|| delta.TargetChecksum().ICompare(
+				task.package->Info().Checksum()) != 0)) {
+		error = B_BAD_DATA;
+	}
 
-	status_t error = RefreshRepository(config);
 	if (error != B_OK) {
-		fUserInteractionHandler->Warn(error, B_TRANSLATE(
-			"Refreshing repository \"%s\" failed"), config.Name().String());
+		task.deltaEntry.Remove();
+		return error;
 	}
 
-	return roster.GetRepositoryCache(config.Name(), &_cache);
+	printf("Using delta for package %s (%" B_PRIdOFF " bytes)\n",
+		fileName.String(), delta.TargetSize());
+	return B_OK;
 }
 
 
@@ -881,7 +1167,7 @@ BPackageManager::DownloadPackage(const BString& fileURL,
 	const BEntry& targetEntry, const BString& checksum)
 {
 	BDecisionProvider provider;
-	BContext context(provider, *this);
+	BContext context(provider, *fJobStateListener);
 	return DownloadFileRequest(context, fileURL, targetEntry, checksum)
 		.Process();
 }
@@ -891,7 +1177,7 @@ status_t
 BPackageManager::RefreshRepository(const BRepositoryConfig& repoConfig)
 {
 	BDecisionProvider provider;
-	BContext context(provider, *this);
+	BContext context(provider, *fJobStateListener);
 	return BRefreshRepositoryRequest(context, repoConfig).Process();
 }
 
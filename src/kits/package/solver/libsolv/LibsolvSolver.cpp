@@ -10,16 +10,31 @@
 #include "LibsolvSolver.h"
 
 #include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/utsname.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <new>
 
+#include <solv/chksum.h>
 #include <solv/policy.h>
 #include <solv/poolarch.h>
 #include <solv/repo.h>
 #include <solv/repo_haiku.h>
+#include <solv/repo_solv.h>
+#include <solv/repo_write.h>
 #include <solv/selection.h>
 #include <solv/solverdebug.h>
+#include <solv/solvversion.h>
+
+#include <Directory.h>
+#include <Entry.h>
+#include <FindDirectory.h>
+#include <OS.h>
+#include <Path.h>
 
 #include <package/PackageResolvableExpression.h>
 #include <package/RepositoryCache.h>
@@ -38,6 +53,15 @@
 // abort()s. Obviously that isn't good behavior for a library.
 
 
+// Name of the directory below the user's cache directory where the pool
+// repositories of remote repositories are cached in libsolv's own format.
+static const char* const kPoolCacheDirectoryName = "package-solver";
+
+// Age in seconds after which a temporary pool cache file is considered left
+// behind by a crashed solver.
+static const time_t kStaleTemporaryFileAge = 60 * 60;
+
+
 BSolver*
 BPackageKit::create_solver()
 {
@@ -77,7 +101,8 @@ struct LibsolvSolver::RepositoryInfo {
 		:
 		fRepository(repository),
 		fSolvRepo(NULL),
-		fChangeCount(repository->ChangeCount())
+		fChangeCount(repository->ChangeCount()),
+		fIsFromCache(false)
 	{
 	}
 
@@ -101,6 +126,16 @@ struct LibsolvSolver::RepositoryInfo {
 		return fChangeCount != fRepository->ChangeCount() || fSolvRepo == NULL;
 	}
 
+	bool IsFromCache() const
+	{
+		return fIsFromCache;
+	}
+
+	void SetFromCache(bool fromCache)
+	{
+		fIsFromCache = fromCache;
+	}
+
 	void SetUnchanged()
 	{
 		fChangeCount = fRepository->ChangeCount();
@@ -110,6 +145,7 @@ private:
 	BSolverRepository*	fRepository;
 	Repo*				fSolvRepo;
 	uint64				fChangeCount;
+	bool				fIsFromCache;
 };
 
 
@@ -725,44 +761,51 @@ LibsolvSolver::_HaveRepositoriesChanged() const
 }
 
 
+/*!	Brings the pool up to date with the repositories.
+	Only the repositories whose packages have changed are re-added to the pool,
+	for all others only the priority and installed state are updated. Remote
+	repositories are loaded from the pool cache, if possible.
+*/
 status_t
 LibsolvSolver::_AddRepositories()
 {
 	if (fPool != NULL && !_HaveRepositoriesChanged())
 		return B_OK;
 
-	// something has changed -- re-create the pool
-	status_t error = _InitPool();
-	if (error != B_OK)
-		return error;
+	bigtime_t startTime = system_time();
+	int32 addedCount = 0;
+	int32 cachedCount = 0;
+
+	if (fPool == NULL) {
+		status_t error = _InitPool();
+		if (error != B_OK)
+			return error;
+	} else {
+		// the solver and jobs refer to the pool's current state
+		_CleanupJobQueue();
+	}
 
 	fInstalledRepository = NULL;
+	pool_set_installed(fPool, NULL);
 
 	int32 repositoryCount = fRepositoryInfos.CountItems();
 	for (int32 i = 0; i < repositoryCount; i++) {
 		RepositoryInfo* repositoryInfo = fRepositoryInfos.ItemAt(i);
 		BSolverRepository* repository = repositoryInfo->Repository();
-		Repo* repo = repo_create(fPool, repository->Name());
-		repositoryInfo->SetSolvRepo(repo);
 
-		repo->priority = -1 - repository->Priority();
-		repo->appdata = (void*)repositoryInfo;
-
-		int32 packageCount = repository->CountPackages();
-		for (int32 k = 0; k < packageCount; k++) {
-			BSolverPackage* package = repository->PackageAt(k);
-			Id solvableId = repo_add_haiku_package_info(repo, package->Info(),
-				REPO_REUSE_REPODATA | REPO_NO_INTERNALIZE);
-
-			try {
-				fSolvablePackages[solvableId] = package;
-				fPackageSolvables[package] = solvableId;
-			} catch (std::bad_alloc&) {
-				return B_NO_MEMORY;
-			}
+		if (repositoryInfo->HasChanged()
+			&& _HavePackagesChanged(repositoryInfo)) {
+			status_t error = _AddSolvRepo(repositoryInfo);
+			if (error != B_OK)
+				return error;
+
+			addedCount++;
+			if (repositoryInfo->IsFromCache())
+				cachedCount++;
 		}
 
-		repo_internalize(repo);
+		Repo* repo = repositoryInfo->SolvRepo();
+		repo->priority = -1 - repository->Priority();
 
 		if (repository->IsInstalled()) {
 			fInstalledRepository = repositoryInfo;
@@ -775,10 +818,339 @@ LibsolvSolver::_AddRepositories()
 	// create "provides" lookup
 	pool_createwhatprovides(fPool);
 
+	if (fDebugLevel > 0) {
+		printf("LibsolvSolver: updated pool in %" B_PRId64 " us (%" B_PRId32
+			" of %" B_PRId32 " repositories added, %" B_PRId32
+			" from cache)\n", system_time() - startTime, addedCount,
+			repositoryCount, cachedCount);
+	}
+
+	return B_OK;
+}
+
+
+/*!	Returns whether the packages of the given repository differ from the
+	solvables of its pool repository, i.e. whether the pool repository has to
+	be rebuilt.
+*/
+bool
+LibsolvSolver::_HavePackagesChanged(RepositoryInfo* repositoryInfo) const
+{
+	Repo* repo = repositoryInfo->SolvRepo();
+	if (repo == NULL)
+		return true;
+
+	BSolverRepository* repository = repositoryInfo->Repository();
+	int32 packageCount = repository->CountPackages();
+	int32 solvableCount = 0;
+	for (int32 i = 0; i < packageCount; i++) {
+		BSolverPackage* package = repository->PackageAt(i);
+		if (package->Info().InitCheck() != B_OK)
+			continue;
+
+		// The package object might have been replaced by one at the same
+		// address, so compare the solvable's name and version, too.
+		Id solvableId = _GetSolvable(package);
+		if (solvableId == 0)
+			return true;
+
+		Solvable* solvable = pool_id2solvable(fPool, solvableId);
+		BString name("pkg:");
+		name << package->Info().Name();
+		if (solvable->repo != repo
+			|| solvable->name != pool_str2id(fPool, name, 0)
+			|| solvable->evr != pool_str2id(fPool,
+				package->Info().Version().ToString(), 0)) {
+			return true;
+		}
+
+		solvableCount++;
+	}
+
+	return solvableCount != repo->nsolvables;
+}
+
+
+/*!	(Re-)creates the pool repository for the given repository.
+*/
+status_t
+LibsolvSolver::_AddSolvRepo(RepositoryInfo* repositoryInfo)
+{
+	_RemoveSolvRepo(repositoryInfo);
+
+	BSolverRepository* repository = repositoryInfo->Repository();
+	Repo* repo = repo_create(fPool, repository->Name());
+	repositoryInfo->SetSolvRepo(repo);
+	repositoryInfo->SetFromCache(false);
+
+	repo->appdata = (void*)repositoryInfo;
+
+	BPath cachePath;
+	bool cacheable = _GetPoolCachePath(repository, cachePath);
+	if (cacheable) {
+		if (_LoadCachedSolvRepo(repositoryInfo, cachePath)) {
+			repositoryInfo->SetFromCache(true);
+			return B_OK;
+		}
+
+		// the cache doesn't match, start over
+		repo_empty(repo, 1);
+	}
+
+	int32 packageCount = repository->CountPackages();
+	for (int32 i = 0; i < packageCount; i++) {
+		BSolverPackage* package = repository->PackageAt(i);
+		Id solvableId = repo_add_haiku_package_info(repo, package->Info(),
+			REPO_REUSE_REPODATA | REPO_NO_INTERNALIZE);
+
+		try {
+			fSolvablePackages[solvableId] = package;
+			fPackageSolvables[package] = solvableId;
+		} catch (std::bad_alloc&) {
+			return B_NO_MEMORY;
+		}
+	}
+
+	repo_internalize(repo);
+
+	if (cacheable)
+		_StoreCachedSolvRepo(repo, cachePath);
+
 	return B_OK;
 }
 
 
+void
+LibsolvSolver::_RemoveSolvRepo(RepositoryInfo* repositoryInfo)
+{
+	Repo* repo = repositoryInfo->SolvRepo();
+	if (repo == NULL)
+		return;
+
+	_ForgetSolvables(repo);
+	repo_free(repo, 1);
+	repositoryInfo->SetSolvRepo(NULL);
+}
+
+
+/*!	Removes the mappings between packages and the solvables of the given pool
+	repository.
+*/
+void
+LibsolvSolver::_ForgetSolvables(Repo* repo)
+{
+	SolvableMap::iterator it = fSolvablePackages.begin();
+	while (it != fSolvablePackages.end()) {
+		if (it->first != 0 && fPool->solvables[it->first].repo != repo) {
+			++it;
+			continue;
+		}
+
+		fPackageSolvables.erase(it->second);
+		fSolvablePackages.erase(it++);
+	}
+}
+
+
+/*!	Returns the path of the file the pool repository for the given repository
+	is cached in. Only repositories that aren't installed and whose packages
+	all have checksums -- which is true for remote repositories -- can be
+	cached. The file name contains a SHA-256 digest of the canonical file names
+	and checksums of all packages, so a refreshed repository cache with
+	different contents results in a different file.
+*/
+bool
+LibsolvSolver::_GetPoolCachePath(BSolverRepository* repository,
+	BPath& _path) const
+{
+#ifdef HAIKU_TARGET_PLATFORM_HAIKU
+	if (repository->IsInstalled() || repository->IsEmpty())
+		return false;
+
+	void* digest = solv_chksum_create(REPOKEY_TYPE_SHA256);
+	if (digest == NULL)
+		return false;
+
+	solv_chksum_add(digest, solv_version, strlen(solv_version) + 1);
+
+	int32 packageCount = repository->CountPackages();
+	for (int32 i = 0; i < packageCount; i++) {
+		const BPackageInfo& info = repository->PackageAt(i)->Info();
+		if (info.Checksum().IsEmpty()) {
+			solv_chksum_free(digest, NULL);
+			return false;
+		}
+
+		BString fileName = info.CanonicalFileName();
+		solv_chksum_add(digest, fileName.String(), fileName.Length() + 1);
+		solv_chksum_add(digest, info.Checksum().String(),
+			info.Checksum().Length() + 1);
+	}
+
+	int digestLength;
+	const unsigned char* digestData = solv_chksum_get(digest, &digestLength);
+	BString fileName(repository->Name());
+	fileName.ReplaceAll('/', '_');
+	fileName << '-' << pool_bin2hex(fPool, digestData, digestLength)
+		<< ".solv";
+	solv_chksum_free(digest, NULL);
+
+	if (find_directory(B_USER_CACHE_DIRECTORY, &_path, true) != B_OK
+		|| _path.Append(kPoolCacheDirectoryName) != B_OK
+		|| create_directory(_path.Path(), 0755) != B_OK
+		|| _path.Append(fileName) != B_OK) {
+		return false;
+	}
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+bool
+LibsolvSolver::_LoadCachedSolvRepo(RepositoryInfo* repositoryInfo,
+	const BPath& path)
+{
+	FILE* file = fopen(path.Path(), "r");
+	if (file == NULL)
+		return false;
+
+	Repo* repo = repositoryInfo->SolvRepo();
+	int result = repo_add_solv(repo, file, 0);
+	fclose(file);
+	if (result != 0)
+		return false;
+
+	// The solvables have been written in the order of the packages. Map them
+	// the same way, checking that they do belong together.
+	BSolverRepository* repository = repositoryInfo->Repository();
+	int32 packageCount = repository->CountPackages();
+	Id solvableId = repo->start;
+	for (int32 i = 0; i < packageCount; i++) {
+		BSolverPackage* package = repository->PackageAt(i);
+		if (package->Info().InitCheck() != B_OK)
+			continue;
+
+		while (solvableId < repo->end
+			&& fPool->solvables[solvableId].repo != repo) {
+			solvableId++;
+		}
+		if (solvableId >= repo->end) {
+			_ForgetSolvables(repo);
+			return false;
+		}
+
+		Solvable* solvable = pool_id2solvable(fPool, solvableId);
+		if (!_SolvableMatchesPackage(solvable, package->Info())) {
+			_ForgetSolvables(repo);
+			return false;
+		}
+
+		try {
+			fSolvablePackages[solvableId] = package;
+			fPackageSolvables[package] = solvableId;
+		} catch (std::bad_alloc&) {
+			_ForgetSolvables(repo);
+			return false;
+		}
+
+		solvableId++;
+	}
+
+	// there mustn't be any solvables left
+	for (; solvableId < repo->end; solvableId++) {
+		if (fPool->solvables[solvableId].repo == repo) {
+			_ForgetSolvables(repo);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+void
+LibsolvSolver::_StoreCachedSolvRepo(Repo* repo, const BPath& path)
+{
+	// Remove outdated cache files of the repository first. Temporary files
+	// might still be written by another solver, so they are only removed
+	// when they have been left behind for a while.
+	BPath directoryPath;
+	if (path.GetParent(&directoryPath) != B_OK)
+		return;
+
+	BString prefix(path.Leaf());
+	prefix.Truncate(prefix.FindLast('-') + 1);
+
+	BDirectory directory(directoryPath.Path());
+	BEntry entry;
+	while (directory.GetNextEntry(&entry) == B_OK) {
+		char name[B_FILE_NAME_LENGTH];
+		if (entry.GetName(name) != B_OK || strncmp(name, prefix.String(),
+				prefix.Length()) != 0
+			|| strchr(name + prefix.Length(), '-') != NULL) {
+			continue;
+		}
+
+		time_t modified;
+		if (strstr(name, ".solv.") != NULL
+			&& (entry.GetModificationTime(&modified) != B_OK
+				|| time(NULL) - modified < kStaleTemporaryFileAge)) {
+			continue;
+		}
+
+		entry.Remove();
+	}
+
+	// Write to a temporary file with a unique name, so that neither a crash
+	// nor another solver storing the same repository at the same time can
+	// leave a broken one
+	BString tempPath(path.Path());
+	tempPath << ".XXXXXX";
+	int fd = mkstemp(tempPath.LockBuffer(0));
+	tempPath.UnlockBuffer();
+	if (fd < 0)
+		return;
+
+	FILE* file = fdopen(fd, "w");
+	if (file == NULL) {
+		close(fd);
+		unlink(tempPath.String());
+		return;
+	}
+
+	bool success = repo_write(repo, file) == 0;
+	success = fclose(file) == 0 && success;
+	if (!success || rename(tempPath.String(), path.Path()) != 0)
+		unlink(tempPath.String());
+}
+
+
+/*!	Returns whether \a solvable, which has been loaded from the pool cache,
+	describes the package \a info, ie. has the same name, version, and
+	checksum.
+*/
+bool
+LibsolvSolver::_SolvableMatchesPackage(Solvable* solvable,
+	const BPackageInfo& info) const
+{
+	BString name("pkg:");
+	name << info.Name();
+	if (solvable->name != pool_str2id(fPool, name, 0)
+		|| solvable->evr != pool_str2id(fPool, info.Version().ToString(), 0)) {
+		return false;
+	}
+
+	Id checksumType;
+	const char* checksum = solvable_lookup_checksum(solvable,
+		SOLVABLE_CHECKSUM, &checksumType);
+	return checksum != NULL && checksumType == REPOKEY_TYPE_SHA256
+		&& info.Checksum().ICompare(checksum) == 0;
+}
+
+
 LibsolvSolver::RepositoryInfo*
 LibsolvSolver::_InstalledRepository() const
 {
@@ -1317,7 +1689,12 @@ LibsolvSolver::_Solve()
 	if (fJobs == NULL || fSolver == NULL)
 		return B_BAD_VALUE;
 
+	bigtime_t startTime = system_time();
 	int problemCount = solver_solve(fSolver, fJobs);
+	if (fDebugLevel > 0) {
+		printf("LibsolvSolver: solved in %" B_PRId64 " us (%d problems)\n",
+			system_time() - startTime, problemCount);
+	}
 
 	// get the problems (if any)
 	fProblems.MakeEmpty();
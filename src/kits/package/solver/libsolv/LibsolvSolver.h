@@ -9,6 +9,7 @@
 #include <map>
 
 #include <ObjectList.h>
+#include <Path.h>
 #include <package/solver/Solver.h>
 #include <package/solver/SolverProblemSolution.h>
 
@@ -20,6 +21,7 @@ using namespace BPackageKit;
 
 
 namespace BPackageKit {
+	class BPackageInfo;
 	class BPackageResolvableExpression;
 	class BSolverPackage;
 }
@@ -95,6 +97,23 @@ private:
 
 			bool				_HaveRepositoriesChanged() const;
 			status_t			_AddRepositories();
+			bool				_HavePackagesChanged(
+									RepositoryInfo* repositoryInfo) const;
+			status_t			_AddSolvRepo(RepositoryInfo* repositoryInfo);
+			void				_RemoveSolvRepo(
+									RepositoryInfo* repositoryInfo);
+			void				_ForgetSolvables(Repo* repo);
+
+			bool				_GetPoolCachePath(
+									BSolverRepository* repository,
+									BPath& _path) const;
+			bool				_LoadCachedSolvRepo(
+									RepositoryInfo* repositoryInfo,
+									const BPath& path);
+			void				_StoreCachedSolvRepo(Repo* repo,
+									const BPath& path);
+			bool				_SolvableMatchesPackage(Solvable* solvable,
+									const BPackageInfo& info) const;
 			RepositoryInfo*		_InstalledRepository() const;
 			RepositoryInfo*		_GetRepositoryInfo(
 									BSolverRepository* repository) const;
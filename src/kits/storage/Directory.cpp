@@ -380,6 +380,20 @@ BDirectory::GetNextDirents(dirent* buf, size_t bufSize, int32 count)
 }
 
 
+int32
+BDirectory::GetNextDirentStats(dir_stat_entry* buf, size_t bufSize,
+	const char* const* attributes, int32 attributeCount,
+	size_t maxAttributeSize, int32 count)
+{
+	if (buf == NULL || attributeCount < 0)
+		return B_BAD_VALUE;
+	if (InitCheck() != B_OK)
+		return B_FILE_ERROR;
+	return _kern_read_dir_stat(fDirFd, attributes, attributeCount,
+		maxAttributeSize, buf, bufSize, count);
+}
+
+
 status_t
 BDirectory::Rewind()
 {
@@ -13,6 +13,8 @@
 #include <grp.h>
 #include <pwd.h>
 
+#include <vector>
+
 #include <File.h>
 #include <Path.h>
 #include <SymLink.h>
@@ -22,12 +24,15 @@
 #include <NotOwningEntryRef.h>
 #include <package/CommitTransactionResult.h>
 #include <package/DaemonDefs.h>
+#include <package/PackageDelta.h>
 #include <RemoveEngine.h>
 
 #include "Constants.h"
 #include "DebugSupport.h"
 #include "Exception.h"
+#include "Job.h"
 #include "PackageFileManager.h"
+#include "ParallelJobRunner.h"
 #include "VolumeState.h"
 
 
@@ -106,6 +111,192 @@ private:
 };
 
 
+// #pragma mark - PhaseTimer
+
+
+/*!	Logs how long the phases of a transaction take.
+*/
+struct CommitTransactionHandler::PhaseTimer {
+	PhaseTimer(const char* phase)
+		:
+		fPhase(phase),
+		fStartTime(system_time())
+	{
+	}
+
+	~PhaseTimer()
+	{
+		_Log();
+	}
+
+	void Next(const char* phase)
+	{
+		_Log();
+		fPhase = phase;
+		fStartTime = system_time();
+	}
+
+private:
+	void _Log()
+	{
+		INFORM("CommitTransactionHandler: %s took %" B_PRId64 " ms\n", fPhase,
+			(system_time() - fStartTime) / 1000);
+	}
+
+private:
+	const char*	fPhase;
+	bigtime_t	fStartTime;
+};
+
+
+// #pragma mark - ReadPackageJob
+
+
+/*!	Reads a package file of the transaction directory. The job owns the created
+	Package until it is detached.
+*/
+struct CommitTransactionHandler::ReadPackageJob : public Job {
+	ReadPackageJob(PackageFileManager* packageFileManager,
+		const node_ref& directoryRef, const BString& packageName)
+		:
+		fPackageFileManager(packageFileManager),
+		fDirectoryRef(directoryRef),
+		fPackageName(packageName),
+		fPackage(NULL),
+		fError(B_OK)
+	{
+	}
+
+	virtual ~ReadPackageJob()
+	{
+		delete fPackage;
+	}
+
+	virtual void Do()
+	{
+		try {
+			fError = fPackageFileManager->CreatePackage(
+				NotOwningEntryRef(fDirectoryRef, fPackageName), fPackage);
+		} catch (std::bad_alloc&) {
+			fError = B_NO_MEMORY;
+		}
+	}
+
+	const BString& PackageName() const
+	{
+		return fPackageName;
+	}
+
+	status_t Error() const
+	{
+		return fError;
+	}
+
+	Package* DetachPackage()
+	{
+		Package* package = fPackage;
+		fPackage = NULL;
+		return package;
+	}
+
+private:
+	PackageFileManager*	fPackageFileManager;
+	node_ref			fDirectoryRef;
+	BString				fPackageName;
+	Package*			fPackage;
+	status_t			fError;
+};
+
+
+// #pragma mark - ExtractWritableFilesJob
+
+
+/*!	Extracts the global writable files of a package into a temporary
+	subdirectory of the writable-files directory. Unlike
+	_ExtractPackageContent() it doesn't throw; if anything fails, the
+	temporary directory is removed again.
+*/
+struct CommitTransactionHandler::ExtractWritableFilesJob : public Job {
+	ExtractWritableFilesJob(const node_ref& directoryRef,
+		const BString& temporaryName, const entry_ref& packageRef,
+		const BStringList& contentPaths)
+		:
+		fDirectoryRef(directoryRef),
+		fTemporaryName(temporaryName),
+		fPackageRef(packageRef),
+		fContentPaths(contentPaths),
+		fError(B_OK)
+	{
+	}
+
+	virtual void Do()
+	{
+		try {
+			fError = _Extract();
+		} catch (std::bad_alloc&) {
+			fError = B_NO_MEMORY;
+		}
+
+		if (fError != B_OK) {
+			BRemoveEngine().RemoveEntry(
+				FSUtils::Entry(fDirectoryRef, fTemporaryName));
+		}
+	}
+
+	const BString& TemporaryName() const
+	{
+		return fTemporaryName;
+	}
+
+	status_t Error() const
+	{
+		return fError;
+	}
+
+private:
+	status_t _Extract()
+	{
+		BDirectory directory;
+		status_t error = directory.SetTo(&fDirectoryRef);
+		if (error != B_OK)
+			return error;
+
+		// remove a left-over temporary directory
+		BEntry entry;
+		error = entry.SetTo(&directory, fTemporaryName);
+		if (error != B_OK)
+			return error;
+		if (entry.Exists()) {
+			error = BRemoveEngine().RemoveEntry(FSUtils::Entry(entry));
+			if (error != B_OK)
+				return error;
+		}
+
+		BDirectory subDirectory;
+		error = directory.CreateDirectory(fTemporaryName, &subDirectory);
+		if (error != B_OK)
+			return error;
+
+		int32 contentPathCount = fContentPaths.CountStrings();
+		for (int32 i = 0; i < contentPathCount; i++) {
+			error = FSUtils::ExtractPackageContent(FSUtils::Entry(fPackageRef),
+				fContentPaths.StringAt(i), FSUtils::Entry(subDirectory));
+			if (error != B_OK)
+				return error;
+		}
+
+		return B_OK;
+	}
+
+private:
+	node_ref			fDirectoryRef;
+	BString				fTemporaryName;
+	entry_ref			fPackageRef;
+	BStringList			fContentPaths;
+	status_t			fError;
+};
+
+
 // #pragma mark - CommitTransactionHandler
 
 
@@ -131,6 +322,7 @@ CommitTransactionHandler::CommitTransactionHandler(Volume* volume,
 	fAddedGroups(),
 	fAddedUsers(),
 	fFSTransaction(),
+	fPreparedWritableFiles(),
 	fResult(result),
 	fCurrentPackage(NULL)
 {
@@ -139,6 +331,14 @@ CommitTransactionHandler::CommitTransactionHandler(Volume* volume,
 
 CommitTransactionHandler::~CommitTransactionHandler()
 {
+	// Remove writable files extracted in advance that haven't been used due to
+	// an error.
+	for (StringSet::const_iterator it = fPreparedWritableFiles.begin();
+			it != fPreparedWritableFiles.end(); ++it) {
+		BRemoveEngine().RemoveEntry(
+			FSUtils::Entry(fWritableFilesDirectory, it->c_str()));
+	}
+
 	// Delete Package objects we created in case of error (on success
 	// fPackagesToActivate will be empty).
 	int32 count = fPackagesToActivate.CountItems();
@@ -208,10 +408,13 @@ CommitTransactionHandler::HandleRequest(
 	fFirstBootProcessing = transaction.FirstBootProcessing();
 
 	// collect the packages to deactivate
+	PhaseTimer timer("collecting packages to deactivate");
 	_GetPackagesToDeactivate(transaction);
 
 	// read the packages to activate
+	timer.Next("reading packages to activate");
 	_ReadPackagesToActivate(transaction);
+	timer.Next("applying changes");
 
 	// anything to do at all?
 	if (fPackagesToActivate.IsEmpty() && fPackagesToDeactivate.empty()) {
@@ -354,7 +557,13 @@ CommitTransactionHandler::_ReadPackagesToActivate(
 			.SetSystemError(error);
 	}
 
-	// read the packages
+	// Check the packages and create jobs for reading the new ones. Reading a
+	// package file means reading and parsing its TOC and attributes, so we do
+	// that concurrently. The jobs are created in order, with NULL entries for
+	// packages that don't need to be read.
+	std::vector<Package*> packages(packagesToActivateCount);
+	std::vector<BReference<ReadPackageJob> > readJobs(packagesToActivateCount);
+	int32 readJobCount = 0;
 	for (int32 i = 0; i < packagesToActivateCount; i++) {
 		BString packageName = packagesToActivate.StringAt(i);
 		// make sure it doesn't clash with an already existing package,
@@ -365,15 +574,13 @@ CommitTransactionHandler::_ReadPackagesToActivate(
 				throw Exception(B_TRANSACTION_NO_SUCH_PACKAGE)
 					.SetPackageName(packageName);
 			}
-			if (!fPackagesToActivate.AddItem(package))
-				throw Exception(B_TRANSACTION_NO_MEMORY);
+			packages[i] = package;
 			continue;
 		} else {
 			if (package != NULL) {
 				if (fPackagesAlreadyAdded.find(package)
 						!= fPackagesAlreadyAdded.end()) {
-					if (!fPackagesToActivate.AddItem(package))
-						throw Exception(B_TRANSACTION_NO_MEMORY);
+					packages[i] = package;
 					continue;
 				}
 
@@ -385,55 +592,151 @@ CommitTransactionHandler::_ReadPackagesToActivate(
 			}
 		}
 
-		// read the package
-		error = fPackageFileManager->CreatePackage(
-			NotOwningEntryRef(fTransactionDirectoryRef, packageName),
-			package);
-		if (error != B_OK) {
-			if (error == B_NO_MEMORY)
+		// the client may have supplied a delta instead of the package file
+		_ReconstructPackageFromDelta(packageName);
+
+		ReadPackageJob* job = new ReadPackageJob(fPackageFileManager,
+			fTransactionDirectoryRef, packageName);
+		readJobs[i].SetTo(job, true);
+		readJobCount++;
+	}
+
+	// read the packages -- a single one is simply read synchronously
+	{
+		ParallelJobRunner jobRunner("read packages");
+		if (readJobCount > 1)
+			jobRunner.Init();
+		for (int32 i = 0; i < packagesToActivateCount; i++) {
+			if (readJobs[i].IsSet())
+				jobRunner.AddJob(readJobs[i].Get());
+		}
+		jobRunner.WaitForJobs();
+	}
+
+	// add the packages in the requested order
+	for (int32 i = 0; i < packagesToActivateCount; i++) {
+		Package* package = packages[i];
+		if (ReadPackageJob* job = readJobs[i].Get()) {
+			error = job->Error();
+			if (error != B_OK) {
+				const BString& packageName = job->PackageName();
+				if (error == B_NO_MEMORY)
+					throw Exception(B_TRANSACTION_NO_MEMORY);
+				throw Exception(B_TRANSACTION_FAILED_TO_READ_PACKAGE_FILE)
+					.SetPackageName(packageName)
+					.SetPath1(_GetPath(
+						FSUtils::Entry(
+							NotOwningEntryRef(fTransactionDirectoryRef,
+								packageName)),
+						packageName))
+					.SetSystemError(error);
+			}
+
+			package = job->DetachPackage();
+			if (!fPackagesToActivate.AddItem(package)) {
+				delete package;
 				throw Exception(B_TRANSACTION_NO_MEMORY);
-			throw Exception(B_TRANSACTION_FAILED_TO_READ_PACKAGE_FILE)
-				.SetPackageName(packageName)
-				.SetPath1(_GetPath(
-					FSUtils::Entry(
-						NotOwningEntryRef(fTransactionDirectoryRef,
-							packageName)),
-					packageName))
-				.SetSystemError(error);
+			}
+			continue;
 		}
 
-		if (!fPackagesToActivate.AddItem(package)) {
-			delete package;
+		if (!fPackagesToActivate.AddItem(package))
 			throw Exception(B_TRANSACTION_NO_MEMORY);
+	}
+}
+
+
+/*!	Rebuilds the package file \a packageName in the transaction directory
+	from a delta against one of the packages to deactivate, if the package file
+	itself is missing and a delta file was supplied instead.
+*/
+void
+CommitTransactionHandler::_ReconstructPackageFromDelta(
+	const BString& packageName)
+{
+	NotOwningEntryRef packageRef(fTransactionDirectoryRef, packageName);
+	BEntry packageEntry(&packageRef);
+	if (packageEntry.Exists())
+		return;
+
+	BString deltaName = PackageDelta::DeltaFileName(packageName);
+	NotOwningEntryRef deltaRef(fTransactionDirectoryRef, deltaName);
+	BEntry deltaEntry(&deltaRef);
+	if (!deltaEntry.Exists())
+		return;
+
+	PackageDelta delta;
+	status_t error = delta.SetTo(deltaEntry);
+	if (error == B_OK) {
+		// The base is the package file the delta was computed against. Check
+		// the size first to avoid computing needless checksums.
+		error = B_ENTRY_NOT_FOUND;
+		for (PackageSet::const_iterator it = fPackagesToDeactivate.begin();
+				it != fPackagesToDeactivate.end(); ++it) {
+			NotOwningEntryRef baseRef((*it)->EntryRef());
+			BEntry baseEntry(&baseRef);
+			off_t baseSize;
+			if (baseEntry.GetSize(&baseSize) != B_OK
+				|| baseSize != delta.BaseSize()) {
+				continue;
+			}
+
+			error = delta.Apply(baseEntry, packageEntry);
+			if (error != B_MISMATCHED_VALUES)
+				break;
 		}
 	}
+
+	if (error != B_OK) {
+		ERROR("Failed to reconstruct package \"%s\" from delta: %s\n",
+			packageName.String(), strerror(error));
+		packageEntry.Remove();
+		throw Exception(B_TRANSACTION_FAILED_TO_READ_PACKAGE_FILE)
+			.SetPackageName(packageName)
+			.SetPath1(_GetPath(FSUtils::Entry(deltaRef), deltaName))
+			.SetSystemError(error);
+	}
+
+	INFORM("Reconstructed package \"%s\" from delta\n", packageName.String());
+	deltaEntry.Remove();
 }
 
 
 void
 CommitTransactionHandler::_ApplyChanges()
 {
+	PhaseTimer timer("extracting writable files");
+	_PrepareGlobalWritableFiles();
+
 	if (!fFirstBootProcessing)
 	{
 		// create an old state directory
+		timer.Next("creating old state directory");
 		_CreateOldStateDirectory();
 
 		// move packages to deactivate to old state directory
+		timer.Next("removing packages to deactivate");
 		_RemovePackagesToDeactivate();
 
 		// move packages to activate to packages directory
+		timer.Next("adding packages to activate");
 		_AddPackagesToActivate();
 
 		// run pre-uninstall scripts, before their packages vanish.
+		timer.Next("running pre-uninstall scripts");
 		_RunPreUninstallScripts();
 
 		// activate/deactivate packages and create users, groups, settings files.
+		timer.Next("changing package activation");
 		_ChangePackageActivation(fAddedPackages, fRemovedPackages);
-	} else // FirstBootProcessing, skip several steps and just do package setup.
+	} else { // FirstBootProcessing, skip several steps and just do package setup.
+		timer.Next("preparing first boot packages");
 		_PrepareFirstBootPackages();
+	}
 
 	// run post-install scripts now that the new packages are visible in the
 	// package file system.
+	timer.Next("running post-install scripts");
 	if (fVolumeStateIsActive || fFirstBootProcessing) {
 		_RunPostInstallScripts();
 	} else {
@@ -830,12 +1133,7 @@ CommitTransactionHandler::_AddGlobalWritableFiles(Package* package)
 	const BObjectList<BGlobalWritableFileInfo, true>& files
 		= package->Info().GlobalWritableFileInfos();
 	BStringList contentPaths;
-	for (int32 i = 0; const BGlobalWritableFileInfo* file = files.ItemAt(i);
-		i++) {
-		if (file->IsIncluded() && !contentPaths.Add(file->Path()))
-			throw std::bad_alloc();
-	}
-
+	_GetIncludedGlobalWritableFiles(package, contentPaths);
 	if (contentPaths.IsEmpty())
 		return;
 
@@ -884,6 +1182,88 @@ CommitTransactionHandler::_AddGlobalWritableFiles(Package* package)
 }
 
 
+/*!	Extracts the global writable files of the packages to activate in advance,
+	several packages concurrently. The content of each package is extracted
+	into the temporary directory _ExtractPackageContent() would use and is
+	picked up from there later. Errors are ignored -- the respective packages
+	are then simply extracted (and the errors reported) by
+	_ExtractPackageContent().
+*/
+void
+CommitTransactionHandler::_PrepareGlobalWritableFiles()
+{
+	std::vector<BReference<ExtractWritableFilesJob> > jobs;
+
+	int32 count = fPackagesToActivate.CountItems();
+	for (int32 i = 0; i < count; i++) {
+		Package* package = fPackagesToActivate.ItemAt(i);
+
+		BStringList contentPaths;
+		_GetIncludedGlobalWritableFiles(package, contentPaths);
+		if (contentPaths.IsEmpty())
+			continue;
+
+		if (fWritableFilesDirectory.InitCheck() != B_OK
+			&& _OpenPackagesSubDirectory(
+				RelativePath(kAdminDirectoryName, kWritableFilesDirectoryName),
+				true, fWritableFilesDirectory) != B_OK) {
+			return;
+		}
+
+		// skip the package, if the same version has already been extracted
+		BString targetName(package->RevisionedNameThrows());
+		BEntry targetEntry(&fWritableFilesDirectory, targetName);
+		if (targetEntry.InitCheck() != B_OK || targetEntry.Exists())
+			continue;
+
+		BString temporaryTargetName = BString().SetToFormat("%s.tmp",
+			targetName.String());
+		if (temporaryTargetName.IsEmpty())
+			throw std::bad_alloc();
+
+		node_ref directoryRef;
+		if (fWritableFilesDirectory.GetNodeRef(&directoryRef) != B_OK)
+			return;
+
+		ExtractWritableFilesJob* job = new ExtractWritableFilesJob(
+			directoryRef, temporaryTargetName, package->EntryRef(),
+			contentPaths);
+		jobs.push_back(BReference<ExtractWritableFilesJob>(job, true));
+	}
+
+	// For a single package there's nothing to gain.
+	if (jobs.size() < 2)
+		return;
+
+	ParallelJobRunner jobRunner("extract writable files");
+	if (jobRunner.Init() != B_OK || jobRunner.CountThreads() == 0)
+		return;
+
+	for (size_t i = 0; i < jobs.size(); i++)
+		jobRunner.AddJob(jobs[i].Get());
+	jobRunner.WaitForJobs();
+
+	for (size_t i = 0; i < jobs.size(); i++) {
+		if (jobs[i]->Error() == B_OK)
+			fPreparedWritableFiles.insert(jobs[i]->TemporaryName().String());
+	}
+}
+
+
+void
+CommitTransactionHandler::_GetIncludedGlobalWritableFiles(Package* package,
+	BStringList& _contentPaths)
+{
+	const BObjectList<BGlobalWritableFileInfo, true>& files
+		= package->Info().GlobalWritableFileInfos();
+	for (int32 i = 0; const BGlobalWritableFileInfo* file = files.ItemAt(i);
+		i++) {
+		if (file->IsIncluded() && !_contentPaths.Add(file->Path()))
+			throw std::bad_alloc();
+	}
+}
+
+
 void
 CommitTransactionHandler::_AddGlobalWritableFile(Package* package,
 	const BGlobalWritableFileInfo& file, const BDirectory& rootDirectory,
@@ -1560,7 +1940,14 @@ CommitTransactionHandler::_ExtractPackageContent(Package* package,
 			.SetSystemError(error);
 	}
 
-	if (targetEntry.Exists()) {
+	// The content may already have been extracted by
+	// _PrepareGlobalWritableFiles().
+	BDirectory& subDirectory = _extractedFilesDirectory;
+	bool extracted
+		= fPreparedWritableFiles.erase(temporaryTargetName.String()) > 0
+		&& subDirectory.SetTo(&targetDirectory, temporaryTargetName) == B_OK;
+
+	if (!extracted && targetEntry.Exists()) {
 		// remove pre-existing
 		error = BRemoveEngine().RemoveEntry(FSUtils::Entry(targetEntry));
 		if (error != B_OK) {
@@ -1573,19 +1960,20 @@ CommitTransactionHandler::_ExtractPackageContent(Package* package,
 		}
 	}
 
-	BDirectory& subDirectory = _extractedFilesDirectory;
 	FSTransaction::CreateOperation createSubDirectoryOperation(
 		&fFSTransaction,
 		FSUtils::Entry(targetDirectory, temporaryTargetName));
-	error = targetDirectory.CreateDirectory(temporaryTargetName,
-		&subDirectory);
-	if (error != B_OK) {
-		throw Exception(B_TRANSACTION_FAILED_TO_CREATE_DIRECTORY)
-			.SetPath1(_GetPath(
-				FSUtils::Entry(targetDirectory, temporaryTargetName),
-				temporaryTargetName))
-			.SetPackageName(package->FileName())
-			.SetSystemError(error);
+	if (!extracted) {
+		error = targetDirectory.CreateDirectory(temporaryTargetName,
+			&subDirectory);
+		if (error != B_OK) {
+			throw Exception(B_TRANSACTION_FAILED_TO_CREATE_DIRECTORY)
+				.SetPath1(_GetPath(
+					FSUtils::Entry(targetDirectory, temporaryTargetName),
+					temporaryTargetName))
+				.SetPackageName(package->FileName())
+				.SetSystemError(error);
+		}
 	}
 
 	createSubDirectoryOperation.Finished();
@@ -1593,7 +1981,7 @@ CommitTransactionHandler::_ExtractPackageContent(Package* package,
 	// extract
 	NotOwningEntryRef packageRef(package->EntryRef());
 
-	int32 contentPathCount = contentPaths.CountStrings();
+	int32 contentPathCount = extracted ? 0 : contentPaths.CountStrings();
 	for (int32 i = 0; i < contentPathCount; i++) {
 		const char* contentPath = contentPaths.StringAt(i);
 
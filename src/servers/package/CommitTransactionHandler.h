@@ -65,12 +65,17 @@ private:
 			typedef FSUtils::RelativePath RelativePath;
 
 			struct TransactionIssueBuilder;
+			struct PhaseTimer;
+			struct ReadPackageJob;
+			struct ExtractWritableFilesJob;
 
 private:
 			void				_GetPackagesToDeactivate(
 									const BActivationTransaction& transaction);
 			void				_ReadPackagesToActivate(
 									const BActivationTransaction& transaction);
+			void				_ReconstructPackageFromDelta(
+									const BString& packageName);
 			void				_ApplyChanges();
 			void				_CreateOldStateDirectory();
 			void				_RemovePackagesToDeactivate();
@@ -80,6 +85,10 @@ private:
 			void				_AddGroup(Package* package,
 									const BString& groupName);
 			void				_AddUser(Package* package, const BUser& user);
+			void				_PrepareGlobalWritableFiles();
+			void				_GetIncludedGlobalWritableFiles(
+									Package* package,
+									BStringList& _contentPaths);
 			void				_AddGlobalWritableFiles(Package* package);
 			void				_AddGlobalWritableFile(Package* package,
 									const BGlobalWritableFileInfo& file,
@@ -180,6 +189,9 @@ private:
 			StringSet			fAddedGroups;
 			StringSet			fAddedUsers;
 			FSTransaction		fFSTransaction;
+			StringSet			fPreparedWritableFiles;
+									// temporary directories extracted by
+									// _PrepareGlobalWritableFiles()
 			BCommitTransactionResult& fResult;
 			Package*			fCurrentPackage;
 };
@@ -40,18 +40,14 @@ PackageFileManager::GetPackageFile(const entry_ref& entryRef,
 {
 	AutoLocker<BLocker> locker(fLock);
 
-	PackageFile* file = fFilesByEntryRef.Lookup(entryRef);
-	if (file != NULL) {
-		if (file->AcquireReference() > 0) {
-			_file = file;
-			return B_OK;
-		}
-
-		// File already full dereferenced. It is about to be deleted.
-		fFilesByEntryRef.Remove(file);
-	}
+	if (_LookupPackageFile(entryRef, _file))
+		return B_OK;
+
+	// Reading the package file may take a while. Don't hold the lock meanwhile,
+	// so that several packages can be read concurrently.
+	locker.Unlock();
 
-	file = new(std::nothrow) PackageFile;
+	PackageFile* file = new(std::nothrow) PackageFile;
 	if (file == NULL)
 		RETURN_ERROR(B_NO_MEMORY);
 
@@ -61,6 +57,17 @@ PackageFileManager::GetPackageFile(const entry_ref& entryRef,
 		return error;
 	}
 
+	locker.Lock();
+
+	// someone else may have been faster
+	PackageFile* otherFile;
+	if (_LookupPackageFile(entryRef, otherFile)) {
+		locker.Unlock();
+		file->ReleaseReference();
+		_file = otherFile;
+		return B_OK;
+	}
+
 	fFilesByEntryRef.Insert(file);
 
 	_file = file;
@@ -68,6 +75,28 @@ PackageFileManager::GetPackageFile(const entry_ref& entryRef,
 }
 
 
+/*!	Looks up the package file for \a entryRef and returns a reference to it.
+	The caller must hold the lock.
+*/
+bool
+PackageFileManager::_LookupPackageFile(const entry_ref& entryRef,
+	PackageFile*& _file)
+{
+	PackageFile* file = fFilesByEntryRef.Lookup(entryRef);
+	if (file == NULL)
+		return false;
+
+	if (file->AcquireReference() > 0) {
+		_file = file;
+		return true;
+	}
+
+	// File already full dereferenced. It is about to be deleted.
+	fFilesByEntryRef.Remove(file);
+	return false;
+}
+
+
 status_t
 PackageFileManager::CreatePackage(const entry_ref& entryRef, Package*& _package)
 {
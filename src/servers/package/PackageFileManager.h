@@ -36,6 +36,10 @@ public:
 private:
 			typedef PackageFileEntryRefHashTable EntryRefTable;
 
+private:
+			bool				_LookupPackageFile(const entry_ref& entryRef,
+									PackageFile*& _file);
+
 private:
 			BLocker&			fLock;
 			EntryRefTable		fFilesByEntryRef;
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "ParallelJobRunner.h"
+
+#include <new>
+
+#include "DebugSupport.h"
+
+
+static const int32 kMaxThreadCount = 8;
+
+
+ParallelJobRunner::ParallelJobRunner(const char* name)
+	:
+	fName(name),
+	fJobQueue(),
+	fDoneSemaphore(-1),
+	fThreads(NULL),
+	fThreadCount(0),
+	fPendingJobCount(0)
+{
+}
+
+
+ParallelJobRunner::~ParallelJobRunner()
+{
+	fJobQueue.Close();
+
+	for (int32 i = 0; i < fThreadCount; i++) {
+		status_t result;
+		wait_for_thread(fThreads[i], &result);
+	}
+	delete[] fThreads;
+
+	if (fDoneSemaphore >= 0)
+		delete_sem(fDoneSemaphore);
+}
+
+
+status_t
+ParallelJobRunner::Init(int32 threadCount)
+{
+	if (threadCount <= 0) {
+		system_info info;
+		threadCount = get_system_info(&info) == B_OK ? info.cpu_count : 1;
+	}
+	if (threadCount > kMaxThreadCount)
+		threadCount = kMaxThreadCount;
+
+	status_t error = fJobQueue.Init();
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	fDoneSemaphore = create_sem(0, fName);
+	if (fDoneSemaphore < 0)
+		RETURN_ERROR(fDoneSemaphore);
+
+	fThreads = new(std::nothrow) thread_id[threadCount];
+	if (fThreads == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+
+	for (int32 i = 0; i < threadCount; i++) {
+		thread_id thread = spawn_thread(&_WorkerEntry, fName,
+			B_NORMAL_PRIORITY, this);
+		if (thread < 0)
+			break;
+
+		fThreads[fThreadCount++] = thread;
+		resume_thread(thread);
+	}
+
+	return B_OK;
+}
+
+
+void
+ParallelJobRunner::AddJob(Job* job)
+{
+	if (fThreadCount > 0 && fJobQueue.QueueJob(job)) {
+		fPendingJobCount++;
+		return;
+	}
+
+	job->Do();
+}
+
+
+void
+ParallelJobRunner::WaitForJobs()
+{
+	while (fPendingJobCount > 0) {
+		status_t error = acquire_sem_etc(fDoneSemaphore, fPendingJobCount, 0,
+			0);
+		if (error == B_OK)
+			fPendingJobCount = 0;
+		else if (error != B_INTERRUPTED)
+			break;
+	}
+}
+
+
+/*static*/ status_t
+ParallelJobRunner::_WorkerEntry(void* data)
+{
+	return ((ParallelJobRunner*)data)->_Worker();
+}
+
+
+status_t
+ParallelJobRunner::_Worker()
+{
+	while (Job* job = fJobQueue.DequeueJob()) {
+		job->Do();
+		job->ReleaseReference();
+		release_sem(fDoneSemaphore);
+	}
+
+	return B_OK;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef PARALLEL_JOB_RUNNER_H
+#define PARALLEL_JOB_RUNNER_H
+
+
+#include <OS.h>
+
+#include "JobQueue.h"
+
+
+/*!	Runs jobs on a set of worker threads and allows waiting for their
+	completion. If no worker thread can be spawned, jobs are run synchronously
+	by AddJob().
+*/
+class ParallelJobRunner {
+public:
+								ParallelJobRunner(const char* name);
+								~ParallelJobRunner();
+
+			status_t			Init(int32 threadCount = 0);
+									// 0 means one thread per CPU
+
+			int32				CountThreads() const
+									{ return fThreadCount; }
+
+			void				AddJob(Job* job);
+									// acquires a reference
+			void				WaitForJobs();
+									// waits for all jobs added so far
+
+private:
+	static	status_t			_WorkerEntry(void* data);
+			status_t			_Worker();
+
+private:
+			const char*			fName;
+			JobQueue			fJobQueue;
+			sem_id				fDoneSemaphore;
+			thread_id*			fThreads;
+			int32				fThreadCount;
+			int32				fPendingJobCount;
+};
+
+
+#endif	// PARALLEL_JOB_RUNNER_H
@@ -309,6 +309,9 @@ Stream::ReadAt(off_t pos, uint8* buffer, size_t* _length)
 	if (pos + (off_t)length > data.Size())
 		length = data.Size() - pos;
 
+	if ((Flags() & INODE_INLINE_DATA) != 0)
+		return _ReadInlineData(pos, buffer, length, _length);
+
 	block_run run;
 	off_t offset;
 	if (FindBlockRun(pos, run, offset) < B_OK) {
@@ -415,6 +418,39 @@ Stream::ReadAt(off_t pos, uint8* buffer, size_t* _length)
 }
 
 
+/*!	Reads from the data of a small file that is stored in the small_data
+	section of its inode.
+*/
+status_t
+Stream::_ReadInlineData(off_t pos, uint8* buffer, size_t length,
+	size_t* _length)
+{
+	*_length = 0;
+
+	CachedBlock cached(fVolume);
+	bfs_inode* node = (bfs_inode*)cached.SetTo(inode_num);
+	if (node == NULL)
+		return B_IO_ERROR;
+
+	const small_data* item = node->SmallDataStart();
+	for (; !item->IsLast(node); item = item->Next()) {
+		if (*item->Name() == FILE_DATA_NAME
+			&& item->NameSize() == FILE_DATA_NAME_LENGTH)
+			break;
+	}
+
+	size_t bytes = 0;
+	if (!item->IsLast(node) && pos < item->DataSize()) {
+		bytes = min_c((off_t)length, item->DataSize() - pos);
+		memcpy(buffer, item->Data() + pos, bytes);
+	}
+	memset(buffer + bytes, 0, length - bytes);
+
+	*_length = length;
+	return B_OK;
+}
+
+
 Node*
 Stream::NodeFactory(Volume& volume, off_t id)
 {
@@ -90,7 +90,8 @@ Volume::IsValidSuperBlock()
 {
 	if (fSuperBlock.Magic1() != (int32)SUPER_BLOCK_MAGIC1
 		|| fSuperBlock.Magic2() != (int32)SUPER_BLOCK_MAGIC2
-		|| fSuperBlock.Magic3() != (int32)SUPER_BLOCK_MAGIC3
+		|| (fSuperBlock.Magic3() != (int32)SUPER_BLOCK_MAGIC3
+			&& fSuperBlock.Magic3() != (int32)SUPER_BLOCK_MAGIC3_FEATURES)
 		|| (int32)fSuperBlock.block_size != fSuperBlock.inode_size
 		|| fSuperBlock.ByteOrder() != SUPER_BLOCK_FS_LENDIAN
 		|| (1UL << fSuperBlock.BlockShift()) != fSuperBlock.BlockSize()
@@ -98,7 +99,8 @@ Volume::IsValidSuperBlock()
 		|| fSuperBlock.AllocationGroupShift() < 1
 		|| fSuperBlock.BlocksPerAllocationGroup() < 1
 		|| fSuperBlock.NumBlocks() < 10
-		|| fSuperBlock.AllocationGroups() != divide_roundup(fSuperBlock.NumBlocks(), 1L << fSuperBlock.AllocationGroupShift()))
+		|| fSuperBlock.AllocationGroups() != divide_roundup(fSuperBlock.NumBlocks(), 1L << fSuperBlock.AllocationGroupShift())
+		|| (fSuperBlock.Features() & ~SUPER_BLOCK_KNOWN_FEATURES) != 0)
 		return false;
 
 	return true;
@@ -13,6 +13,7 @@
 #include <slab/Slab.h>
 #include <vfs.h>
 #include <vm/vm.h>
+#include <vm/vm_page.h>
 
 #include "IORequest.h"
 
@@ -20,6 +21,8 @@
 status_t
 VMVnodeCache::Init(struct vnode* vnode, uint32 allocationFlags)
 {
+	fWritebackDevice = NULL;
+
 	status_t error = VMCache::Init("VMVnodeCache", CACHE_TYPE_VNODE, allocationFlags);
 	if (error != B_OK)
 		return error;
@@ -29,6 +32,8 @@ VMVnodeCache::Init(struct vnode* vnode, uint32 allocationFlags)
 	fVnodeDeleted = false;
 
 	vfs_vnode_to_node_ref(fVnode, &fDevice, &fInode);
+
+	fWritebackDevice = vm_page_get_writeback_device(fDevice);
 	return B_OK;
 }
 
@@ -181,5 +186,6 @@ VMVnodeCache::Dump(bool showPages) const
 void
 VMVnodeCache::DeleteObject()
 {
+	vm_page_put_writeback_device(fWritebackDevice);
 	object_cache_delete(gVnodeCacheObjectCache, this);
 }
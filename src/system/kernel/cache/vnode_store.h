@@ -11,6 +11,7 @@
 
 
 struct file_cache_ref;
+struct vm_writeback_device;
 
 
 class VMVnodeCache final : public VMCache {
@@ -54,12 +55,16 @@ public:
 			ino_t				InodeId() const
 									{ return fInode; }
 
+			vm_writeback_device* WritebackDevice() const
+									{ return fWritebackDevice; }
+
 protected:
 	virtual	void				DeleteObject();
 
 private:
 			struct vnode*		fVnode;
 			file_cache_ref*		fFileCacheRef;
+			vm_writeback_device* fWritebackDevice;
 			ino_t				fInode;
 			dev_t				fDevice;
 	volatile bool				fVnodeDeleted;
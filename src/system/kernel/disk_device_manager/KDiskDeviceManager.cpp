@@ -118,6 +118,19 @@ struct KDiskDeviceManager::PartitionSet : VectorSet<KPartition*> {
 };
 
 
+/*!	Returns whether the module \a name has been built against the current
+	version of the file system interface, as it would be misused otherwise.
+*/
+static bool
+is_current_file_system_module(const char* name)
+{
+	size_t length = strlen(name);
+	size_t suffixLength = strlen(B_CURRENT_FS_API_VERSION);
+	return length >= suffixLength
+		&& strcmp(name + length - suffixLength, B_CURRENT_FS_API_VERSION) == 0;
+}
+
+
 class KDiskDeviceManager::DiskSystemWatcher : public NotificationListener {
 public:
 	DiskSystemWatcher(KDiskDeviceManager* manager)
@@ -1070,6 +1083,14 @@ KDiskDeviceManager::_RescanDiskSystems(DiskSystemMap& addedSystems,
 		if (FindDiskSystem(name.Path()))
 			continue;
 
+		if (fileSystems && !is_current_file_system_module(name.Path())) {
+			// built against another version of the file system interface
+			dprintf("KDiskDeviceManager: ignoring file system module \"%s\", "
+				"expected version \"%s\"\n", name.Path(),
+				B_CURRENT_FS_API_VERSION);
+			continue;
+		}
+
 		if (fileSystems) {
 			TRACE("file system: %s\n", name.Path());
 			_AddFileSystem(name.Path());
@@ -109,8 +109,13 @@ EntryCache::Init()
 }
 
 
+/*!	Adds or updates the entry \a name in \a dirID. If \a _replaced is given,
+	it is set to whether the entry previously referred to another node, or
+	was known to be missing and now exists, or vice versa.
+*/
 status_t
-EntryCache::Add(ino_t dirID, const char* name, ino_t nodeID, bool missing)
+EntryCache::Add(ino_t dirID, const char* name, ino_t nodeID, bool missing,
+	bool* _replaced)
 {
 	EntryCacheKey key(dirID, name);
 
@@ -135,14 +140,18 @@ EntryCache::Add(ino_t dirID, const char* name, ino_t nodeID, bool missing)
 		return B_NO_MEMORY;
 	}
 
+	bool replaced = false;
 	EntryCacheEntry* existingEntry = fEntries.InsertAtomic(entry);
 	if (existingEntry != NULL) {
 		free(entry);
 		entry = existingEntry;
 
+		replaced = entry->missing != missing || entry->node_id != nodeID;
 		entry->node_id = nodeID;
 		entry->missing = missing;
 	}
+	if (_replaced != NULL)
+		*_replaced = replaced;
 
 	readLocker.Detach();
 	_AddEntryToCurrentGeneration(entry, entry == existingEntry);
@@ -150,15 +159,19 @@ EntryCache::Add(ino_t dirID, const char* name, ino_t nodeID, bool missing)
 }
 
 
+/*!	Removes the entry \a name in \a dirID. If \a missingOnly is \c true,
+	only a negative entry is removed, ie. one that caches that there is no
+	such entry.
+*/
 status_t
-EntryCache::Remove(ino_t dirID, const char* name)
+EntryCache::Remove(ino_t dirID, const char* name, bool missingOnly)
 {
 	EntryCacheKey key(dirID, name);
 
 	WriteLocker writeLocker(fLock);
 
 	EntryCacheEntry* entry = fEntries.Lookup(key);
-	if (entry == NULL)
+	if (entry == NULL || (missingOnly && !entry->missing))
 		return B_ENTRY_NOT_FOUND;
 
 	fEntries.Remove(entry);
@@ -105,9 +105,11 @@ public:
 			status_t			Init();
 
 			status_t			Add(ino_t dirID, const char* name,
-									ino_t nodeID, bool missing);
+									ino_t nodeID, bool missing,
+									bool* _replaced = NULL);
 
-			status_t			Remove(ino_t dirID, const char* name);
+			status_t			Remove(ino_t dirID, const char* name,
+									bool missingOnly = false);
 
 			bool				Lookup(ino_t dirID, const char* name,
 									ino_t& nodeID, bool& missing);
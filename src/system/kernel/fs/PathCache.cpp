@@ -0,0 +1,331 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "PathCache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <debug.h>
+#include <util/atomic.h>
+#include <util/StringHash.h>
+
+
+static const uint32 kSlotCount = 1024;
+
+
+struct PathCacheSlot {
+	int32	sequence;
+		// odd while the slot is being written
+	uint32	hash;
+	int64	generation;
+	dev_t	root_device;
+	dev_t	start_device;
+	ino_t	root_id;
+	ino_t	start_id;
+	dev_t	device;
+	ino_t	id;
+	ino_t	parent_id;
+	uint16	length;
+	bool	traverse_leaf_link;
+	bool	missing;
+	uint8	directory_count;
+	uint16	buckets[PathCacheDependencies::kMaxDirectories];
+	int64	directory_generations[PathCacheDependencies::kMaxDirectories];
+	char	path[PathCache::kMaxPathLength];
+};
+
+
+void
+PathCacheKey::ComputeHash()
+{
+	hash = hash_hash_string_part(path, length) ^ (uint32)start_id
+		^ (uint32)(start_id >> 32) ^ (uint32)start_device
+		^ (traverse_leaf_link ? 0x80000000 : 0);
+}
+
+
+//	#pragma mark -
+
+
+PathCacheDependencies::PathCacheDependencies(PathCache& cache)
+	:
+	cache(cache),
+	cacheable(true),
+	missing(false),
+	count(0)
+{
+}
+
+
+/*!	Must be called before \a directory is searched, so that any change made
+	to it afterwards will be noticed.
+*/
+void
+PathCacheDependencies::AddDirectory(dev_t device, ino_t directory)
+{
+	if (!cacheable)
+		return;
+
+	uint32 bucket = PathCache::DirectoryBucket(device, directory);
+	for (uint32 i = 0; i < count; i++) {
+		if (buckets[i] == bucket)
+			return;
+	}
+
+	if (count == kMaxDirectories) {
+		cacheable = false;
+		return;
+	}
+
+	buckets[count] = bucket;
+	generations[count] = cache.DirectoryGeneration(bucket);
+	count++;
+}
+
+
+//	#pragma mark -
+
+
+PathCache::PathCache()
+	:
+	fSlots(NULL),
+	fDirectoryGenerations(NULL),
+	fGeneration(0),
+	fAdds(0),
+	fMissingAdds(0),
+	fDirectoryInvalidations(0)
+{
+}
+
+
+PathCache::~PathCache()
+{
+	free(fSlots);
+	free(fDirectoryGenerations);
+}
+
+
+status_t
+PathCache::Init()
+{
+	fSlots = (PathCacheSlot*)calloc(kSlotCount, sizeof(PathCacheSlot));
+	if (fSlots == NULL)
+		return B_NO_MEMORY;
+
+	fDirectoryGenerations = (int64*)calloc(kDirectoryGenerationCount,
+		sizeof(int64));
+	if (fDirectoryGenerations == NULL) {
+		free(fSlots);
+		fSlots = NULL;
+		return B_NO_MEMORY;
+	}
+
+	// Make sure that no empty slot is valid
+	for (uint32 i = 0; i < kSlotCount; i++)
+		fSlots[i].generation = -1;
+
+	return B_OK;
+}
+
+
+/*!	Renders all cached paths stale. Must be called whenever a volume is
+	mounted or unmounted.
+*/
+void
+PathCache::Invalidate()
+{
+	atomic_add64(&fGeneration, 1);
+}
+
+
+/*!	Renders all cached paths stale that went through \a directory. Must be
+	called after an entry in it has been created, removed, renamed, or
+	replaced.
+*/
+void
+PathCache::InvalidateDirectory(dev_t device, ino_t directory)
+{
+	if (fDirectoryGenerations == NULL)
+		return;
+
+	atomic_add64(&fDirectoryGenerations[DirectoryBucket(device, directory)],
+		1);
+	atomic_add(&fDirectoryInvalidations, 1);
+}
+
+
+/*static*/ uint32
+PathCache::DirectoryBucket(dev_t device, ino_t directory)
+{
+	uint32 hash = (uint32)directory ^ (uint32)(directory >> 32);
+	hash = hash * 31 + (uint32)device;
+	return (hash ^ (hash >> 10) ^ (hash >> 20)) % kDirectoryGenerationCount;
+}
+
+
+/*!	If \a key is known, \c true is returned. \a _missing is then set to
+	whether the path does not exist; otherwise the node it refers to is
+	returned.
+*/
+bool
+PathCache::Lookup(const PathCacheKey& key, dev_t& _device, ino_t& _id,
+	ino_t& _parentID, bool& _missing)
+{
+	if (fSlots == NULL || key.length >= kMaxPathLength)
+		return false;
+
+	PathCacheSlot& slot = fSlots[key.hash % kSlotCount];
+
+	int32 sequence = atomic_get(&slot.sequence);
+	if ((sequence & 1) != 0)
+		return false;
+
+	memory_read_barrier();
+
+	bool found = slot.generation == Generation() && slot.hash == key.hash
+		&& slot.length == key.length && slot.start_id == key.start_id
+		&& slot.start_device == key.start_device
+		&& slot.root_id == key.root_id && slot.root_device == key.root_device
+		&& slot.traverse_leaf_link == key.traverse_leaf_link
+		&& memcmp(slot.path, key.path, key.length) == 0;
+	dev_t device = slot.device;
+	ino_t id = slot.id;
+	ino_t parentID = slot.parent_id;
+	bool missing = slot.missing;
+
+	uint32 directoryCount = 0;
+	uint16 buckets[PathCacheDependencies::kMaxDirectories];
+	int64 generations[PathCacheDependencies::kMaxDirectories];
+	if (found) {
+		directoryCount = std::min((uint32)slot.directory_count,
+			PathCacheDependencies::kMaxDirectories);
+		memcpy(buckets, slot.buckets, sizeof(uint16) * directoryCount);
+		memcpy(generations, slot.directory_generations,
+			sizeof(int64) * directoryCount);
+	}
+
+	memory_read_barrier();
+
+	// If the slot has been changed while we were reading it, what we read
+	// might not belong together
+	if (!found || atomic_get(&slot.sequence) != sequence)
+		return false;
+
+	for (uint32 i = 0; i < directoryCount; i++) {
+		if (DirectoryGeneration(buckets[i]) != generations[i])
+			return false;
+	}
+
+	_device = device;
+	_id = id;
+	_parentID = parentID;
+	_missing = missing;
+	return true;
+}
+
+
+/*!	Adds the result of a path resolution that started when the generation was
+	\a generation, and that searched the directories in \a dependencies; if
+	any of them was invalidated since, the result is dropped.
+	If another thread is currently writing the slot, the result is not cached
+	either, as waiting would defeat the purpose.
+*/
+void
+PathCache::Add(const PathCacheKey& key, int64 generation,
+	const PathCacheDependencies& dependencies, dev_t device, ino_t id,
+	ino_t parentID)
+{
+	_Add(key, generation, dependencies, device, id, parentID, false);
+}
+
+
+/*!	Like Add(), but remembers that the path does not exist. This is only
+	valid if \a dependencies found a negative entry cache entry.
+*/
+void
+PathCache::AddMissing(const PathCacheKey& key, int64 generation,
+	const PathCacheDependencies& dependencies)
+{
+	if (!dependencies.missing)
+		return;
+
+	_Add(key, generation, dependencies, -1, -1, -1, true);
+}
+
+
+void
+PathCache::_Add(const PathCacheKey& key, int64 generation,
+	const PathCacheDependencies& dependencies, dev_t device, ino_t id,
+	ino_t parentID, bool missing)
+{
+	if (fSlots == NULL || key.length >= kMaxPathLength
+		|| !dependencies.cacheable || generation != Generation()) {
+		return;
+	}
+
+	for (uint32 i = 0; i < dependencies.count; i++) {
+		if (DirectoryGeneration(dependencies.buckets[i])
+				!= dependencies.generations[i]) {
+			return;
+		}
+	}
+
+	PathCacheSlot& slot = fSlots[key.hash % kSlotCount];
+
+	int32 sequence = atomic_get(&slot.sequence);
+	if ((sequence & 1) != 0
+		|| atomic_test_and_set(&slot.sequence, sequence + 1, sequence)
+			!= sequence) {
+		return;
+	}
+
+	slot.hash = key.hash;
+	slot.generation = generation;
+	slot.root_device = key.root_device;
+	slot.root_id = key.root_id;
+	slot.start_device = key.start_device;
+	slot.start_id = key.start_id;
+	slot.device = device;
+	slot.id = id;
+	slot.parent_id = parentID;
+	slot.length = key.length;
+	slot.traverse_leaf_link = key.traverse_leaf_link;
+	slot.missing = missing;
+	slot.directory_count = dependencies.count;
+	memcpy(slot.buckets, dependencies.buckets,
+		sizeof(uint16) * dependencies.count);
+	memcpy(slot.directory_generations, dependencies.generations,
+		sizeof(int64) * dependencies.count);
+	memcpy(slot.path, key.path, key.length);
+
+	memory_write_barrier();
+	atomic_set(&slot.sequence, sequence + 2);
+
+	atomic_add(missing ? &fMissingAdds : &fAdds, 1);
+}
+
+
+void
+PathCache::Dump()
+{
+	int64 generation = Generation();
+	uint32 valid = 0;
+	for (uint32 i = 0; i < kSlotCount; i++) {
+		if (fSlots != NULL && fSlots[i].generation == generation)
+			valid++;
+	}
+
+	kprintf("generation:   %" B_PRId64 "\n", generation);
+	kprintf("added:        %" B_PRId32 "\n", fAdds);
+	kprintf("added missing: %" B_PRId32 "\n", fMissingAdds);
+	kprintf("invalidated directories: %" B_PRId32 "\n",
+		fDirectoryInvalidations);
+	kprintf("valid slots:  %" B_PRIu32 " of %" B_PRIu32 "\n", valid,
+		kSlotCount);
+}
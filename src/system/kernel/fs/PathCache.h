@@ -0,0 +1,119 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef PATH_CACHE_H
+#define PATH_CACHE_H
+
+
+#include <SupportDefs.h>
+
+
+struct PathCacheKey {
+	dev_t		root_device;
+	ino_t		root_id;
+	dev_t		start_device;
+	ino_t		start_id;
+	const char*	path;
+	size_t		length;
+	bool		traverse_leaf_link;
+	uint32		hash;
+
+	void		ComputeHash();
+};
+
+
+struct PathCacheSlot;
+class PathCache;
+
+
+/*!	Collects the directories a path resolution searched, together with their
+	generations at the time they were searched. \c missing is set when the
+	resolution failed because the entry cache knew that an entry does not
+	exist.
+*/
+struct PathCacheDependencies {
+	static	const uint32		kMaxDirectories = 8;
+
+								PathCacheDependencies(PathCache& cache);
+
+			void				AddDirectory(dev_t device, ino_t directory);
+
+			PathCache&			cache;
+			bool				cacheable;
+			bool				missing;
+			uint32				count;
+			uint16				buckets[kMaxDirectories];
+			int64				generations[kMaxDirectories];
+};
+
+
+/*!	Caches the results of resolving whole relative paths, so that paths that
+	are looked up over and over again do not have to be walked component by
+	component.
+	Lookups do not take any lock, they only read a slot's sequence number
+	before and after copying it. Every directory hashes to one of a fixed
+	number of generation counters, and a slot remembers the generations of
+	all directories its path went through. Paths that do not exist are
+	cached as well, as long as the entry cache knew about the missing entry;
+	creating an entry therefore invalidates its directory, too.
+	Changing an entry only increases
+	the generation of its directory, and thus only renders the paths stale
+	that searched that directory (or one that shares its counter).
+	Mounting and unmounting volumes increases a global generation instead,
+	which renders all slots stale.
+*/
+class PathCache {
+public:
+								PathCache();
+								~PathCache();
+
+			status_t			Init();
+
+			int64				Generation() const
+									{ return atomic_get64(
+										(int64*)&fGeneration); }
+			void				Invalidate();
+
+			int64				DirectoryGeneration(uint32 bucket) const
+									{ return atomic_get64(
+										&fDirectoryGenerations[bucket]); }
+			void				InvalidateDirectory(dev_t device,
+									ino_t directory);
+
+			bool				Lookup(const PathCacheKey& key,
+									dev_t& _device, ino_t& _id,
+									ino_t& _parentID, bool& _missing);
+			void				Add(const PathCacheKey& key, int64 generation,
+									const PathCacheDependencies& dependencies,
+									dev_t device, ino_t id, ino_t parentID);
+			void				AddMissing(const PathCacheKey& key,
+									int64 generation,
+									const PathCacheDependencies& dependencies);
+
+			void				Dump();
+
+	static	uint32				DirectoryBucket(dev_t device,
+									ino_t directory);
+
+	static	const size_t		kMaxPathLength = 128;
+	static	const uint32		kDirectoryGenerationCount = 1024;
+
+private:
+			void				_Add(const PathCacheKey& key,
+									int64 generation,
+									const PathCacheDependencies& dependencies,
+									dev_t device, ino_t id, ino_t parentID,
+									bool missing);
+
+private:
+			PathCacheSlot*		fSlots;
+			int64*				fDirectoryGenerations;
+			int64				fGeneration;
+			int32				fAdds;
+			int32				fMissingAdds;
+			int32				fDirectoryInvalidations;
+};
+
+
+#endif	// PATH_CACHE_H
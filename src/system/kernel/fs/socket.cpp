@@ -1028,8 +1028,11 @@ _user_recvfrom(int socket, void *data, size_t length, int flags,
 }
 
 
-ssize_t
-_user_recvmsg(int socket, struct msghdr *userMessage, int flags)
+/*!	Receives a message into the userland \a userMessage, and copies the
+	updated message header back. Used by recvmsg() and recvmmsg().
+*/
+static ssize_t
+recvmsg_userland(int socket, struct msghdr *userMessage, int flags)
 {
 	// copy message from userland
 	msghdr message;
@@ -1064,8 +1067,7 @@ _user_recvmsg(int socket, struct msghdr *userMessage, int flags)
 		message.msg_control = NULL;
 
 	// recvmsg()
-	SyscallRestartWrapper<ssize_t> result;
-	result = common_recvmsg(socket, &message, flags, false);
+	ssize_t result = common_recvmsg(socket, &message, flags, false);
 	if (result < 0)
 		return result;
 
@@ -1086,6 +1088,70 @@ _user_recvmsg(int socket, struct msghdr *userMessage, int flags)
 }
 
 
+ssize_t
+_user_recvmsg(int socket, struct msghdr *userMessage, int flags)
+{
+	SyscallRestartWrapper<ssize_t> result;
+	return result = recvmsg_userland(socket, userMessage, flags);
+}
+
+
+/*!	Receives up to \a count messages with a single syscall. Only waiting for
+	the first one is restartable; once a message has been received, errors
+	only end the batch, and the number of messages received is returned.
+	The \a timeout is only checked after each message, like on other
+	platforms.
+*/
+ssize_t
+_user_recvmmsg(int socket, struct mmsghdr *userMessages, unsigned int count,
+	int flags, bigtime_t timeout)
+{
+	if (userMessages == NULL || !IS_USER_ADDRESS(userMessages))
+		return B_BAD_ADDRESS;
+	if (count > IOV_MAX)
+		count = IOV_MAX;
+
+	if (timeout < 0)
+		return B_BAD_VALUE;
+
+	bigtime_t deadline = B_INFINITE_TIMEOUT;
+	if (timeout != B_INFINITE_TIMEOUT)
+		deadline = system_time() + timeout;
+
+	const bool waitForOne = (flags & MSG_WAITFORONE) != 0;
+	flags &= ~MSG_WAITFORONE;
+
+	SyscallRestartWrapper<ssize_t> result;
+	unsigned int received = 0;
+	while (received < count) {
+		ssize_t bytesReceived = recvmsg_userland(socket,
+			&userMessages[received].msg_hdr, flags);
+		if (bytesReceived < 0) {
+			if (received == 0)
+				return result = bytesReceived;
+			break;
+		}
+
+		unsigned int length = bytesReceived;
+		if (user_memcpy(&userMessages[received].msg_len, &length,
+				sizeof(length)) != B_OK) {
+			if (received == 0)
+				return B_BAD_ADDRESS;
+			break;
+		}
+
+		received++;
+
+		if (waitForOne)
+			flags |= MSG_DONTWAIT;
+		if (deadline != B_INFINITE_TIMEOUT && system_time() >= deadline)
+			break;
+	}
+
+	return received;
+}
+
+
 ssize_t
 _user_send(int socket, const void *data, size_t length, int flags)
 {
@@ -1121,8 +1187,10 @@ _user_sendto(int socket, const void *data, size_t length, int flags,
 }
 
 
-ssize_t
-_user_sendmsg(int socket, const struct msghdr *userMessage, int flags)
+/*!	Sends the userland \a userMessage. Used by sendmsg() and sendmmsg().
+*/
+static ssize_t
+sendmsg_userland(int socket, const struct msghdr *userMessage, int flags)
 {
 	// copy message from userland
 	msghdr message;
@@ -1166,8 +1234,54 @@ _user_sendmsg(int socket, const struct msghdr *userMessage, int flags)
 		message.msg_control = NULL;
 
 	// sendmsg()
+	return common_sendmsg(socket, &message, flags, false);
+}
+
+
+ssize_t
+_user_sendmsg(int socket, const struct msghdr *userMessage, int flags)
+{
 	SyscallRestartWrapper<ssize_t> result;
-	return result = common_sendmsg(socket, &message, flags, false);
+	return result = sendmsg_userland(socket, userMessage, flags);
+}
+
+
+/*!	Sends up to \a count messages with a single syscall. Like recvmmsg(), it
+	only fails if not even the first message could be sent; otherwise it
+	returns the number of messages sent.
+*/
+ssize_t
+_user_sendmmsg(int socket, struct mmsghdr *userMessages, unsigned int count,
+	int flags)
+{
+	if (userMessages == NULL || !IS_USER_ADDRESS(userMessages))
+		return B_BAD_ADDRESS;
+	if (count > IOV_MAX)
+		count = IOV_MAX;
+
+	SyscallRestartWrapper<ssize_t> result;
+	unsigned int sent = 0;
+	while (sent < count) {
+		ssize_t bytesSent = sendmsg_userland(socket,
+			&userMessages[sent].msg_hdr, flags);
+		if (bytesSent < 0) {
+			if (sent == 0)
+				return result = bytesSent;
+			break;
+		}
+
+		unsigned int length = bytesSent;
+		if (user_memcpy(&userMessages[sent].msg_len, &length,
+				sizeof(length)) != B_OK) {
+			if (sent == 0)
+				return B_BAD_ADDRESS;
+			break;
+		}
+
+		sent++;
+	}
+
+	return sent;
 }
 
 
@@ -35,6 +35,7 @@
 #include <AutoDeleterDrivers.h>
 #include <block_cache.h>
 #include <boot/kernel_args.h>
+#include <BytePointer.h>
 #include <debug_heap.h>
 #include <disk_device_manager/KDiskDevice.h>
 #include <disk_device_manager/KDiskDeviceManager.h>
@@ -42,6 +43,7 @@
 #include <disk_device_manager/KDiskSystem.h>
 #include <fd.h>
 #include <file_cache.h>
+#include <fs/dir_stat.h>
 #include <fs/node_monitor.h>
 #include <KPath.h>
 #include <lock.h>
@@ -60,12 +62,14 @@
 #include <condition_variable.h>
 #include <vfs.h>
 #include <vm/vm.h>
+#include <vm/vm_page.h>
 #include <vm/VMCache.h>
 #include <wait_for_objects.h>
 
 #include "EntryCache.h"
 #include "fifo.h"
 #include "IORequest.h"
+#include "PathCache.h"
 #include "unused_vnodes.h"
 #include "vfs_tracing.h"
 #include "Vnode.h"
@@ -119,6 +123,9 @@
 const static size_t kMaxPathLength = 65536;
 	// The absolute maximum path length (for getcwd() - this is not depending
 	// on PATH_MAX
+const static size_t kMaxReadDirStatBufferSize = 128 * 1024;
+	// Large enough for at least one entry with the maximum number of
+	// attributes of the maximum size
 
 
 typedef DoublyLinkedList<vnode> VnodeList;
@@ -438,6 +445,7 @@ object_cache* sFileDescriptorCache;
 #define VNODE_HASH_TABLE_SIZE 1024
 static VnodeTable* sVnodeTable;
 static struct vnode* sRoot;
+static PathCache sPathCache;
 
 #define MOUNTS_HASH_TABLE_SIZE 16
 static MountTable* sMountsTable;
@@ -879,9 +887,10 @@ put_mount(struct fs_mount* mount)
 
 
 /*!	Tries to open the specified file system module.
-	Accepts a file system name of the form "bfs" or "file_systems/bfs/v1".
+	Accepts a file system name of the form "bfs" or "file_systems/bfs/v2".
 	Returns a pointer to file system module interface, or NULL if it
-	could not open the module.
+	could not open the module, or if it was built for another version of
+	the file system API.
 */
 static file_system_module_info*
 get_file_system(const char* fsName)
@@ -890,8 +899,16 @@ get_file_system(const char* fsName)
 	if (strncmp(fsName, "file_systems/", strlen("file_systems/"))) {
 		// construct module name if we didn't get one
 		// (we currently support only one API)
-		snprintf(name, sizeof(name), "file_systems/%s/v1", fsName);
+		snprintf(name, sizeof(name), "file_systems/%s" B_CURRENT_FS_API_VERSION,
+			fsName);
 		fsName = NULL;
+	} else {
+		size_t length = strlen(fsName);
+		size_t suffixLength = strlen(B_CURRENT_FS_API_VERSION);
+		if (length < suffixLength || strcmp(fsName + length - suffixLength,
+				B_CURRENT_FS_API_VERSION) != 0) {
+			return NULL;
+		}
 	}
 
 	file_system_module_info* info;
@@ -902,7 +919,7 @@ get_file_system(const char* fsName)
 }
 
 
-/*!	Accepts a file system name of the form "bfs" or "file_systems/bfs/v1"
+/*!	Accepts a file system name of the form "bfs" or "file_systems/bfs/v2"
 	and returns a compatible fs_info.fsh_name name ("bfs" in both cases).
 	The name is allocated for you, and you have to free() it when you're
 	done with it.
@@ -925,7 +942,7 @@ get_file_system_name(const char* fsName)
 		return strdup(fsName);
 	}
 
-	// cut off the trailing /v1
+	// cut off the trailing API version
 
 	char* name = (char*)malloc(end + 1 - fsName);
 	if (name == NULL)
@@ -2340,18 +2357,34 @@ entry_ref_to_vnode(dev_t mountID, ino_t directoryID, const char* name,
 /*!	Looks up the entry with name \a name in the directory represented by \a dir
 	and returns the respective vnode.
 	On success a reference to the vnode is acquired for the caller.
+	If \a dependencies is given, \a dir is added to it, and the result is
+	marked as not cacheable unless the entry was found in the entry cache,
+	or the entry cache knew that it does not exist.
 */
 static status_t
-lookup_dir_entry(struct vnode* dir, const char* name, struct vnode** _vnode)
+lookup_dir_entry(struct vnode* dir, const char* name, struct vnode** _vnode,
+	PathCacheDependencies* dependencies = NULL)
 {
 	ino_t id;
 	bool missing;
 
+	if (dependencies != NULL)
+		dependencies->AddDirectory(dir->device, dir->id);
+
 	if (dir->mount->entry_cache.Lookup(dir->id, name, id, missing)) {
-		return missing ? B_ENTRY_NOT_FOUND
-			: get_vnode(dir->device, id, _vnode, true, false);
+		if (missing) {
+			if (dependencies != NULL)
+				dependencies->missing = true;
+			return B_ENTRY_NOT_FOUND;
+		}
+		return get_vnode(dir->device, id, _vnode, true, false);
 	}
 
+	// Only paths made of entries the entry cache knows about may be put into
+	// the path cache
+	if (dependencies != NULL)
+		dependencies->cacheable = false;
+
 	status_t status = FS_CALL(dir, lookup, name, &id);
 	if (status != B_OK)
 		return status;
@@ -2401,7 +2434,7 @@ lookup_dir_entry(struct vnode* dir, const char* name, struct vnode** _vnode)
 static status_t
 vnode_path_to_vnode(struct vnode* start, char* path, bool traverseLeafLink,
 	int count, struct io_context* ioContext, VnodePutter& _vnode,
-	ino_t* _parentID, char* leafName)
+	ino_t* _parentID, char* leafName, PathCacheDependencies* dependencies)
 {
 	FUNCTION(("vnode_path_to_vnode(vnode = %p, path = %s)\n", start, path));
 	ASSERT(!_vnode.IsSet());
@@ -2467,7 +2500,8 @@ vnode_path_to_vnode(struct vnode* start, char* path, bool traverseLeafLink,
 		VnodePutter nextVnode;
 		if (status == B_OK) {
 			struct vnode* temp = NULL;
-			status = lookup_dir_entry(vnode.Get(), path, &temp);
+			status = lookup_dir_entry(vnode.Get(), path, &temp,
+				dependencies);
 			nextVnode.SetTo(temp);
 		}
 
@@ -2535,7 +2569,7 @@ vnode_path_to_vnode(struct vnode* start, char* path, bool traverseLeafLink,
 				nextVnode.SetTo(vnode.Get());
 			} else {
 				status = vnode_path_to_vnode(vnode.Get(), path, true, count + 1,
-					ioContext, nextVnode, &lastParentID, leafName);
+					ioContext, nextVnode, &lastParentID, leafName, dependencies);
 			}
 
 			object_cache_free(sPathNameCache, buffer, 0);
@@ -2572,12 +2606,102 @@ vnode_path_to_vnode(struct vnode* start, char* path, bool traverseLeafLink,
 }
 
 
+/*!	Marks the end of every path component in \a path, the same way
+	vnode_path_to_vnode() does while walking it.
+*/
+static void
+terminate_path_components(char* path, size_t length)
+{
+	for (size_t i = length; i-- > 1;) {
+		if (path[i] == '/' && path[i - 1] != '/')
+			path[i] = '\0';
+	}
+}
+
+
+/*!	Like the above, but resolves paths the path cache knows about without
+	walking them.
+	Only the superuser may use the path cache: since it is allowed to search
+	any directory, there are no permissions that would have to be checked
+	for each path component.
+*/
 static status_t
 vnode_path_to_vnode(struct vnode* vnode, char* path, bool traverseLeafLink,
 	bool kernel, VnodePutter& _vnode, ino_t* _parentID, char* leafName)
 {
-	return vnode_path_to_vnode(vnode, path, traverseLeafLink, 0,
-		get_current_io_context(kernel), _vnode, _parentID, leafName);
+	struct io_context* ioContext = get_current_io_context(kernel);
+
+	size_t length = path != NULL ? strlen(path) : PathCache::kMaxPathLength;
+	if (length == 0 || length >= PathCache::kMaxPathLength || geteuid() != 0) {
+		return vnode_path_to_vnode(vnode, path, traverseLeafLink, 0, ioContext,
+			_vnode, _parentID, leafName, NULL);
+	}
+
+	// the walk clobbers the path, so we have to remember it first
+	char pathCopy[PathCache::kMaxPathLength];
+	memcpy(pathCopy, path, length);
+
+	PathCacheKey key;
+	rw_lock_read_lock(&sIOContextRootLock);
+	struct vnode* root = ioContext->root;
+	if (root != NULL) {
+		key.root_device = root->device;
+		key.root_id = root->id;
+	}
+	rw_lock_read_unlock(&sIOContextRootLock);
+
+	if (root == NULL) {
+		// we're too early to cache anything
+		return vnode_path_to_vnode(vnode, path, traverseLeafLink, 0, ioContext,
+			_vnode, _parentID, leafName, NULL);
+	}
+	key.start_device = vnode->device;
+	key.start_id = vnode->id;
+	key.path = pathCopy;
+	key.length = length;
+	key.traverse_leaf_link = traverseLeafLink;
+	key.ComputeHash();
+
+	dev_t device;
+	ino_t id;
+	ino_t parentID;
+	bool missing;
+	if (sPathCache.Lookup(key, device, id, parentID, missing)) {
+		// A caller that wants the leaf name also needs the last directory
+		// on failure, which is not cached
+		if (missing && leafName == NULL) {
+			put_vnode(vnode);
+			return B_ENTRY_NOT_FOUND;
+		}
+
+		struct vnode* node;
+		if (!missing && get_vnode(device, id, &node, true, false) == B_OK) {
+			put_vnode(vnode);
+			terminate_path_components(path, length);
+
+			_vnode.SetTo(node);
+			if (_parentID != NULL)
+				*_parentID = parentID;
+			return B_OK;
+		}
+	}
+
+	int64 generation = sPathCache.Generation();
+	PathCacheDependencies dependencies(sPathCache);
+
+	status_t status = vnode_path_to_vnode(vnode, path, traverseLeafLink, 0,
+		ioContext, _vnode, &parentID, leafName, &dependencies);
+	if (status == B_ENTRY_NOT_FOUND && leafName == NULL)
+		sPathCache.AddMissing(key, generation, dependencies);
+	if (status != B_OK)
+		return status;
+
+	sPathCache.Add(key, generation, dependencies, _vnode->device, _vnode->id,
+		parentID);
+
+	if (_parentID != NULL)
+		*_parentID = parentID;
+	return B_OK;
 }
 
 
@@ -3700,6 +3824,19 @@ dump_vnode_usage(int argc, char** argv)
 	return 0;
 }
 
+
+static int
+dump_path_cache(int argc, char** argv)
+{
+	if (argc != 1) {
+		kprintf("usage: %s\n", argv[0]);
+		return 0;
+	}
+
+	sPathCache.Dump();
+	return 0;
+}
+
 #endif	// ADD_DEBUGGER_COMMANDS
 
 
@@ -4422,7 +4559,13 @@ entry_cache_add(dev_t mountID, ino_t dirID, const char* name, ino_t nodeID)
 		return B_BAD_VALUE;
 	locker.Unlock();
 
-	return mount->entry_cache.Add(dirID, name, nodeID, false);
+	bool replaced = false;
+	status_t status = mount->entry_cache.Add(dirID, name, nodeID, false,
+		&replaced);
+	if (replaced)
+		sPathCache.InvalidateDirectory(mountID, dirID);
+
+	return status;
 }
 
 
@@ -4437,7 +4580,13 @@ entry_cache_add_missing(dev_t mountID, ino_t dirID, const char* name)
 		return B_BAD_VALUE;
 	locker.Unlock();
 
-	return mount->entry_cache.Add(dirID, name, -1, true);
+	bool replaced = false;
+	status_t status = mount->entry_cache.Add(dirID, name, -1, true,
+		&replaced);
+	if (replaced)
+		sPathCache.InvalidateDirectory(mountID, dirID);
+
+	return status;
 }
 
 
@@ -4452,7 +4601,10 @@ entry_cache_remove(dev_t mountID, ino_t dirID, const char* name)
 		return B_BAD_VALUE;
 	locker.Unlock();
 
-	return mount->entry_cache.Remove(dirID, name);
+	status_t status = mount->entry_cache.Remove(dirID, name);
+	sPathCache.InvalidateDirectory(mountID, dirID);
+
+	return status;
 }
 
 
@@ -4951,6 +5103,36 @@ vfs_free_unused_vnodes(int32 level)
 }
 
 
+/*!	Called by the node monitor whenever an entry has been created. Since file
+	systems are not required to remove negative entries they put into the
+	entry cache on their own, we make sure there is none left for \a name.
+	Also drops the cached paths that went through \a directory, as they
+	might have found \a name missing.
+*/
+void
+vfs_entry_created(dev_t device, ino_t directory, const char* name)
+{
+	ReadLocker locker(sMountLock);
+	struct fs_mount* mount = find_mount(device);
+	if (mount == NULL)
+		return;
+	locker.Unlock();
+
+	mount->entry_cache.Remove(directory, name, true);
+	sPathCache.InvalidateDirectory(device, directory);
+}
+
+
+/*!	Called by the node monitor whenever an entry has been removed, or moved
+	away from \a directory.
+*/
+void
+vfs_entry_removed(dev_t device, ino_t directory, const char* name)
+{
+	sPathCache.InvalidateDirectory(device, directory);
+}
+
+
 extern "C" bool
 vfs_can_page(struct vnode* vnode, void* cookie)
 {
@@ -5542,6 +5724,8 @@ vfs_bind_mount_directory(dev_t mountID, ino_t nodeID, dev_t coveredMountID,
 	inc_vnode_ref_count(vnode);
 	inc_vnode_ref_count(coveredVnode);
 
+	sPathCache.Invalidate();
+
 	return B_OK;
 }
 
@@ -5648,6 +5832,9 @@ vfs_init(kernel_args* args)
 
 	recursive_lock_init(&sMountOpLock, "vfs_mount_op_lock");
 
+	if (sPathCache.Init() != B_OK)
+		panic("vfs_init: error creating path cache\n");
+
 	if (block_cache_init() != B_OK)
 		return B_ERROR;
 
@@ -5672,6 +5859,8 @@ vfs_init(kernel_args* args)
 		"info about the I/O context");
 	add_debugger_command("vnode_usage", &dump_vnode_usage,
 		"info about vnode usage");
+	add_debugger_command("path_cache", &dump_path_cache,
+		"info about the path cache");
 #endif
 
 	register_low_resource_handler(&vnode_low_resource_handler, NULL,
@@ -6087,7 +6276,15 @@ file_write(struct file_descriptor* descriptor, off_t pos, const void* buffer,
 
 	BlockingFDSetter blockingFD(descriptor);
 
-	return FS_CALL(vnode, write, descriptor->cookie, pos, buffer, length);
+	status_t status = FS_CALL(vnode, write, descriptor->cookie, pos, buffer,
+		length);
+
+	// Don't let the writer fill the memory with modified pages faster than
+	// they can be written back
+	if (status == B_OK && vnode->cache != NULL)
+		vm_page_throttle_writer(vnode->device);
+
+	return status;
 }
 
 
@@ -6513,6 +6710,171 @@ dir_read(struct io_context* ioContext, struct vnode* vnode, void* cookie,
 }
 
 
+static void
+read_dir_stat_attribute(struct vnode* vnode, const char* name,
+	dir_stat_attr& attribute, void* buffer, size_t bufferSize)
+{
+	if (!HAS_FS_CALL(vnode, open_attr) || !HAS_FS_CALL(vnode, read_attr)
+		|| !HAS_FS_CALL(vnode, read_attr_stat)) {
+		attribute.size = B_UNSUPPORTED;
+		return;
+	}
+
+	void* cookie;
+	status_t status = FS_CALL(vnode, open_attr, name, O_RDONLY, &cookie);
+	if (status != B_OK) {
+		attribute.size = status;
+		return;
+	}
+
+	struct stat stat;
+	status = FS_CALL(vnode, read_attr_stat, cookie, &stat);
+	if (status == B_OK) {
+		size_t length = min_c((off_t)bufferSize, stat.st_size);
+		status = FS_CALL(vnode, read_attr, cookie, 0, buffer, &length);
+	}
+	if (status == B_OK) {
+		attribute.type = stat.st_type;
+		attribute.size = stat.st_size;
+	} else
+		attribute.size = status;
+
+	if (HAS_FS_CALL(vnode, close_attr))
+		FS_CALL(vnode, close_attr, cookie);
+	if (HAS_FS_CALL(vnode, free_attr_cookie))
+		FS_CALL(vnode, free_attr_cookie, cookie);
+}
+
+
+/*!	Fills in the stat and the attributes of an entry laid out by
+	init_dir_stat_entry() from the node its dirent refers to.
+*/
+static void
+fill_dir_stat_entry(dir_stat_entry* entry, const char* const* attributes,
+	size_t maxAttributeSize)
+{
+	struct dirent* dirent = dir_stat_entry_dirent(entry);
+
+	struct vnode* vnode;
+	status_t status = get_vnode(dirent->d_dev, dirent->d_ino, &vnode, true,
+		false);
+	if (status != B_OK) {
+		entry->stat_status = status;
+		for (uint32 i = 0; i < entry->attribute_count; i++)
+			entry->attributes[i].size = status;
+		return;
+	}
+	VnodePutter vnodePutter(vnode);
+
+	entry->stat_status = HAS_FS_CALL(vnode, read_stat)
+		? vfs_stat_vnode(vnode, &entry->stat) : B_UNSUPPORTED;
+
+	for (uint32 i = 0; i < entry->attribute_count; i++) {
+		read_dir_stat_attribute(vnode, attributes[i], entry->attributes[i],
+			dir_stat_entry_attribute_data(entry, i), maxAttributeSize);
+	}
+}
+
+
+/*!	Reads as many directory entries as fit into \a buffer, together with
+	their stat data and the contents of the given attributes. The file system
+	may implement this natively; otherwise, every entry is read with a
+	separate read_dir() call, so that none gets lost when the buffer is full.
+*/
+static status_t
+dir_read_stat(struct io_context* ioContext, struct file_descriptor* descriptor,
+	const char* const* attributes, uint32 attributeCount,
+	size_t maxAttributeSize, dir_stat_entry* buffer, size_t bufferSize,
+	uint32* _count)
+{
+	struct vnode* vnode = descriptor->u.vnode;
+	uint32 maxCount = *_count;
+
+	if (HAS_FS_CALL(vnode, read_dir_stat)) {
+		status_t status = FS_CALL(vnode, read_dir_stat, descriptor->cookie,
+			attributes, attributeCount, maxAttributeSize, buffer, bufferSize,
+			_count);
+		if (status != B_OK)
+			return status;
+
+		// Entries that refer to mount points, or to the parent of the root
+		// of a mounted volume have to be read from the other volume
+		BytePointer<dir_stat_entry> entry(buffer);
+		for (uint32 i = 0; i < *_count; i++) {
+			struct dirent* dirent = dir_stat_entry_dirent(&entry);
+			dev_t device = dirent->d_dev;
+			ino_t id = dirent->d_ino;
+
+			status = fix_dirent(vnode, dirent, ioContext);
+			if (status != B_OK)
+				return status;
+
+			if (dirent->d_dev != device || dirent->d_ino != id) {
+				// don't let anything of the covered node leak through
+				memset(&entry->stat, 0, sizeof(entry->stat));
+				for (uint32 j = 0; j < entry->attribute_count; j++) {
+					memset(dir_stat_entry_attribute_data(&entry, j), 0,
+						maxAttributeSize);
+				}
+				fill_dir_stat_entry(&entry, attributes, maxAttributeSize);
+			} else if (entry->stat_status == B_OK) {
+				entry->stat.st_dev = device;
+				entry->stat.st_ino = id;
+				if (!S_ISBLK(entry->stat.st_mode)
+					&& !S_ISCHR(entry->stat.st_mode)) {
+					entry->stat.st_rdev = -1;
+				}
+			}
+
+			entry += entry->length;
+		}
+		return B_OK;
+	}
+
+	if (!HAS_FS_CALL(vnode, read_dir))
+		return B_UNSUPPORTED;
+
+	size_t maxEntrySize = dir_stat_entry_size(attributeCount, maxAttributeSize,
+		B_FILE_NAME_LENGTH - 1);
+	if (bufferSize < maxEntrySize)
+		return B_BUFFER_OVERFLOW;
+
+	char direntBuffer[offsetof(struct dirent, d_name) + B_FILE_NAME_LENGTH];
+	struct dirent* dirent = (struct dirent*)direntBuffer;
+
+	BytePointer<dir_stat_entry> entry(buffer);
+	size_t bytesLeft = bufferSize;
+	uint32 count = 0;
+
+	while (count < maxCount && bytesLeft >= maxEntrySize) {
+		uint32 num = 1;
+		status_t status = FS_CALL(vnode, read_dir, descriptor->cookie, dirent,
+			sizeof(direntBuffer), &num);
+		if (status == B_OK && num == 1)
+			status = fix_dirent(vnode, dirent, ioContext);
+		if (status != B_OK) {
+			// report the error with the next call, if we have entries
+			if (count > 0)
+				break;
+			return status;
+		}
+		if (num == 0)
+			break;
+
+		init_dir_stat_entry(&entry, attributeCount, maxAttributeSize,
+			dirent);
+		fill_dir_stat_entry(&entry, attributes, maxAttributeSize);
+
+		bytesLeft -= entry->length;
+		entry += entry->length;
+		count++;
+	}
+
+	*_count = count;
+	return B_OK;
+}
+
+
 static status_t
 dir_rewind(struct file_descriptor* descriptor)
 {
@@ -8099,6 +8461,8 @@ fs_mount(char* path, const char* device, const char* fsName, uint32 flags,
 		coveredNode->covered_by = mount->root_vnode;
 		coveredNode->SetCovered(true);
 		inc_vnode_ref_count(mount->root_vnode);
+
+		sPathCache.Invalidate();
 	}
 	rw_lock_write_unlock(&sVnodeLock);
 
@@ -8365,6 +8729,8 @@ fs_unmount(char* path, dev_t mountID, uint32 flags, bool kernel)
 		vnode_to_be_freed(vnode);
 	}
 
+	sPathCache.Invalidate();
+
 	vnodesWriteLocker.Unlock();
 
 	// Free all vnodes associated with this mount.
@@ -9715,6 +10081,92 @@ _user_open_parent_dir(int fd, char* userName, size_t nameLength)
 }
 
 
+ssize_t
+_user_read_dir_stat(int fd, const char* const* userAttributes,
+	uint32 attributeCount, size_t maxAttributeSize,
+	dir_stat_entry* userBuffer, size_t bufferSize, uint32 maxCount)
+{
+	if (maxCount == 0)
+		return 0;
+
+	if (attributeCount > DIR_STAT_MAX_ATTRIBUTES
+		|| maxAttributeSize > DIR_STAT_MAX_ATTRIBUTE_SIZE
+		|| (attributeCount > 0 && userAttributes == NULL)) {
+		return B_BAD_VALUE;
+	}
+	if (userBuffer == NULL || !IS_USER_ADDRESS(userBuffer)
+		|| (userAttributes != NULL && !IS_USER_ADDRESS(userAttributes))) {
+		return B_BAD_ADDRESS;
+	}
+
+	// copy the attribute names
+	char* names = NULL;
+	const char* attributes[DIR_STAT_MAX_ATTRIBUTES];
+	if (attributeCount > 0) {
+		names = (char*)malloc(attributeCount * B_ATTR_NAME_LENGTH);
+		if (names == NULL)
+			return B_NO_MEMORY;
+	}
+	MemoryDeleter namesDeleter(names);
+
+	for (uint32 i = 0; i < attributeCount; i++) {
+		const char* userName;
+		if (user_memcpy(&userName, &userAttributes[i], sizeof(userName))
+				!= B_OK) {
+			return B_BAD_ADDRESS;
+		}
+		if (userName == NULL || !IS_USER_ADDRESS(userName))
+			return B_BAD_ADDRESS;
+
+		char* name = names + i * B_ATTR_NAME_LENGTH;
+		status_t status = user_copy_name(name, userName, B_ATTR_NAME_LENGTH);
+		if (status != B_OK)
+			return status;
+
+		attributes[i] = name;
+	}
+
+	io_context* ioContext = get_current_io_context(false);
+	FileDescriptorPutter descriptor(get_fd(ioContext, fd));
+	if (!descriptor.IsSet())
+		return B_FILE_ERROR;
+	if (descriptor->ops != &sDirectoryOps)
+		return B_NOT_A_DIRECTORY;
+
+	// restrict buffer size and allocate a heap buffer
+	if (bufferSize > kMaxReadDirStatBufferSize)
+		bufferSize = kMaxReadDirStatBufferSize;
+	dir_stat_entry* buffer = (dir_stat_entry*)malloc(bufferSize);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter bufferDeleter(buffer);
+
+	uint32 count = maxCount;
+	status_t status = dir_read_stat(ioContext, descriptor.Get(), attributes,
+		attributeCount, maxAttributeSize, buffer, bufferSize, &count);
+	if (status != B_OK)
+		return status;
+
+	ASSERT(count <= maxCount);
+
+	// copy the buffer back -- determine the total buffer size first
+	size_t sizeToCopy = 0;
+	BytePointer<dir_stat_entry> entry(buffer);
+	for (uint32 i = 0; i < count; i++) {
+		size_t length = entry->length;
+		sizeToCopy += length;
+		entry += length;
+	}
+
+	ASSERT(sizeToCopy <= bufferSize);
+
+	if (user_memcpy(userBuffer, buffer, sizeToCopy) != B_OK)
+		return B_BAD_ADDRESS;
+
+	return count;
+}
+
+
 status_t
 _user_fcntl(int fd, int op, size_t argument)
 {
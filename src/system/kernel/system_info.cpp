@@ -645,6 +645,43 @@ _user_get_cpu_topology_info(cpu_topology_node_info* topologyInfos,
 }
 
 
+status_t
+_user_get_writeback_info(writeback_device_info* userInfos, uint32* _userCount)
+{
+	if (_userCount == NULL || !IS_USER_ADDRESS(_userCount))
+		return B_BAD_ADDRESS;
+
+	uint32 count = vm_page_get_writeback_info(NULL, 0);
+
+	if (userInfos == NULL)
+		return user_memcpy(_userCount, &count, sizeof(uint32));
+	else if (!IS_USER_ADDRESS(userInfos))
+		return B_BAD_ADDRESS;
+
+	uint32 userCount;
+	status_t error = user_memcpy(&userCount, _userCount, sizeof(uint32));
+	if (error != B_OK)
+		return error;
+	if (userCount == 0)
+		return B_OK;
+	count = std::min(count, userCount);
+
+	writeback_device_info* infos = new(std::nothrow) writeback_device_info[count];
+	if (infos == NULL)
+		return B_NO_MEMORY;
+	ArrayDeleter<writeback_device_info> _(infos);
+
+	// devices might have gone away in the mean time
+	count = std::min(count, vm_page_get_writeback_info(infos, count));
+
+	error = user_memcpy(userInfos, infos,
+		sizeof(writeback_device_info) * count);
+	if (error != B_OK)
+		return error;
+	return user_memcpy(_userCount, &count, sizeof(uint32));
+}
+
+
 status_t
 _user_start_watching_system(int32 object, uint32 flags, port_id port,
 	int32 token)
@@ -379,6 +379,8 @@ VMCache::Delete()
 
 		// remove it
 		pages.Remove(page);
+		if (page->State() == PAGE_STATE_MODIFIED)
+			vm_page_account_modified_pages(this, -1);
 		page->SetCacheRef(NULL);
 		page_count--;
 
@@ -503,6 +505,8 @@ VMCache::InsertPage(vm_page* page, off_t offset)
 
 	if (page->WiredCount() > 0)
 		IncrementWiredPagesCount();
+	if (page->State() == PAGE_STATE_MODIFIED)
+		vm_page_account_modified_pages(this, 1);
 }
 
 
@@ -523,6 +527,9 @@ VMCache::RemovePage(vm_page* page)
 
 	T2(RemovePage(this, page));
 
+	if (page->State() == PAGE_STATE_MODIFIED)
+		vm_page_account_modified_pages(this, -1);
+
 	pages.Remove(page);
 	page_count--;
 	page->SetCacheRef(NULL);
@@ -562,6 +569,10 @@ VMCache::MovePage(vm_page* page, off_t offset)
 		IncrementWiredPagesCount();
 		oldCache->DecrementWiredPagesCount();
 	}
+	if (page->State() == PAGE_STATE_MODIFIED) {
+		vm_page_account_modified_pages(oldCache, -1);
+		vm_page_account_modified_pages(this, 1);
+	}
 
 	T2(InsertPage(this, page, page->cache_offset << PAGE_SHIFT));
 }
@@ -27,6 +27,7 @@
 #include <heap.h>
 #include <kernel.h>
 #include <low_resource_manager.h>
+#include <system_info.h>
 #include <thread.h>
 #include <tracing.h>
 #include <util/AutoLock.h>
@@ -42,6 +43,7 @@
 #include "PageCacheLocker.h"
 #include "VMAnonymousCache.h"
 #include "VMPageQueue.h"
+#include "../cache/vnode_store.h"
 
 
 //#define TRACE_VM_PAGE
@@ -123,6 +125,39 @@ static int32 sUnreservedFreePages;
 static int32 sUnsatisfiedPageReservations;
 static int32 sModifiedTemporaryPages;
 
+// Modified pages of file caches are accounted per device, so that the page
+// writer can share its runs among the devices, and that writers can be
+// throttled when their device accumulates more than its share of them.
+struct vm_writeback_device {
+	dev_t		device;
+	int32		ref_count;
+	int32		dirty_pages;
+	uint32		bandwidth;
+		// estimated write back speed in pages per second
+	uint32		run_quota;
+	uint32		run_pages;
+	uint32		run_written_pages;
+	bigtime_t	run_time;
+		// the above are only used by the page writer
+	int64		written_pages;
+	int64		throttled_writes;
+	int64		throttle_time;
+};
+
+static const uint32 kMaxWritebackDevices = 32;
+static const uint32 kMinRunPagesPerDevice = 32;
+static const uint32 kDefaultWritebackBandwidth = 2560;
+	// pages per second assumed for devices we didn't write to yet
+static const bigtime_t kThrottleInterval = 20000;
+static const bigtime_t kMaxThrottleTime = 500000;
+
+static vm_writeback_device sWritebackDevices[kMaxWritebackDevices];
+static mutex sWritebackDevicesLock = MUTEX_INITIALIZER("writeback devices");
+static ConditionVariable sWritebackCondition;
+static int32 sModifiedWritebackPages;
+static page_num_t sDirtyPagesLimit;
+	// the modified file cache pages the devices have to share
+
 static ConditionVariable sFreePageCondition;
 static mutex sPageDeficitLock = MUTEX_INITIALIZER("page deficit");
 
@@ -1220,6 +1255,30 @@ dump_page_stats(int argc, char **argv)
 }
 
 
+static int
+dump_writeback_devices(int argc, char** argv)
+{
+	kprintf("dirty limit: %" B_PRIuPHYSADDR " pages, accounted dirty pages: %"
+		B_PRId32 "\n\n", sDirtyPagesLimit, sModifiedWritebackPages);
+	kprintf("device refs   dirty  pages/s   quota          written  throttled"
+		"  throttle time\n");
+
+	for (uint32 i = 0; i < kMaxWritebackDevices; i++) {
+		vm_writeback_device& device = sWritebackDevices[i];
+		if (device.ref_count == 0)
+			continue;
+
+		kprintf("%6" B_PRIdDEV " %4" B_PRId32 " %7" B_PRId32 " %8" B_PRIu32
+			" %7" B_PRIu32 " %16" B_PRId64 " %10" B_PRId64 " %11" B_PRId64
+			" ms\n", device.device, device.ref_count, device.dirty_pages,
+			device.bandwidth, device.run_quota, device.written_pages,
+			device.throttled_writes, device.throttle_time / 1000);
+	}
+
+	return 0;
+}
+
+
 #if VM_PAGE_ALLOCATION_TRACKING_AVAILABLE
 
 static caller_info*
@@ -1695,6 +1754,11 @@ set_page_state(vm_page *page, int pageState)
 			atomic_add(&sModifiedTemporaryPages, 1);
 		else if (page->State() == PAGE_STATE_MODIFIED)
 			atomic_add(&sModifiedTemporaryPages, -1);
+	} else if (cache != NULL) {
+		if (pageState == PAGE_STATE_MODIFIED)
+			vm_page_account_modified_pages(cache, 1);
+		else if (page->State() == PAGE_STATE_MODIFIED)
+			vm_page_account_modified_pages(cache, -1);
 	}
 
 	// move the page
@@ -1954,6 +2018,111 @@ next_modified_page(page_num_t& maxPagesToSee)
 }
 
 
+// #pragma mark - writeback accounting
+
+
+static inline vm_writeback_device*
+writeback_device_for_cache(VMCache* cache)
+{
+	if (cache == NULL || cache->type != CACHE_TYPE_VNODE)
+		return NULL;
+
+	return static_cast<VMVnodeCache*>(cache)->WritebackDevice();
+}
+
+
+static inline uint32
+writeback_bandwidth(const vm_writeback_device& device)
+{
+	return device.bandwidth != 0 ? device.bandwidth : kDefaultWritebackBandwidth;
+}
+
+
+/*!	Returns the number of modified pages \a device may have before writers are
+	throttled. The dirty pages limit is split among all devices that currently
+	have modified pages in proportion to their write back bandwidth.
+	Since no lock is held, the result is only an approximation.
+*/
+static uint32
+writeback_device_dirty_limit(const vm_writeback_device& device)
+{
+	uint64 totalBandwidth = 0;
+	for (uint32 i = 0; i < kMaxWritebackDevices; i++) {
+		const vm_writeback_device& other = sWritebackDevices[i];
+		if (&other != &device
+			&& (other.ref_count <= 0 || other.dirty_pages <= 0)) {
+			continue;
+		}
+
+		totalBandwidth += writeback_bandwidth(other);
+	}
+
+	uint64 limit = (uint64)sDirtyPagesLimit * writeback_bandwidth(device)
+		/ totalBandwidth;
+	return std::max(limit, (uint64)sDirtyPagesLimit / 16);
+}
+
+
+/*!	Splits the pages of the next page writer run among the devices with
+	modified pages in proportion to their bandwidth, so that writing back to a
+	slow device cannot hold up the faster ones for long.
+*/
+static void
+prepare_writeback_run(uint32 runPages)
+{
+	uint64 totalBandwidth = 0;
+	uint32 activeDevices = 0;
+
+	for (uint32 i = 0; i < kMaxWritebackDevices; i++) {
+		vm_writeback_device& device = sWritebackDevices[i];
+		device.run_pages = 0;
+		device.run_written_pages = 0;
+		device.run_time = 0;
+
+		if (device.ref_count > 0 && device.dirty_pages > 0) {
+			totalBandwidth += writeback_bandwidth(device);
+			activeDevices++;
+		}
+	}
+
+	for (uint32 i = 0; i < kMaxWritebackDevices; i++) {
+		vm_writeback_device& device = sWritebackDevices[i];
+		if (activeDevices <= 1) {
+			device.run_quota = runPages;
+			continue;
+		}
+
+		device.run_quota = std::max((uint32)((uint64)runPages
+				* writeback_bandwidth(device) / totalBandwidth),
+			kMinRunPagesPerDevice);
+	}
+}
+
+
+/*!	Updates the bandwidth estimations of all devices that were written to in
+	the last page writer run, and wakes up the throttled writers.
+*/
+static void
+finish_writeback_run()
+{
+	for (uint32 i = 0; i < kMaxWritebackDevices; i++) {
+		vm_writeback_device& device = sWritebackDevices[i];
+		if (device.run_written_pages == 0)
+			continue;
+
+		uint32 bandwidth = (uint64)device.run_written_pages * 1000000
+			/ std::max(device.run_time, (bigtime_t)1);
+		if (device.bandwidth != 0)
+			bandwidth = ((uint64)device.bandwidth * 3 + bandwidth) / 4;
+
+		device.bandwidth = std::max(bandwidth, (uint32)1);
+		atomic_add64(&device.written_pages, device.run_written_pages);
+	}
+
+	sWritebackCondition.NotifyAll();
+}
+
+
 // #pragma mark -
 
 
@@ -1995,6 +2164,7 @@ public:
 	status_t Status() const	{ return fStatus; }
 	struct VMCache* Cache() const { return fCache; }
 	uint32 PageCount() const { return fPageCount; }
+	bigtime_t FinishTime() const { return fFinishTime; }
 
 	virtual void IOFinished(status_t status, bool partialTransfer,
 		generic_size_t bytesTransferred);
@@ -2006,6 +2176,7 @@ private:
 	uint32				fPageCount;
 	int32				fMaxPages;
 	status_t			fStatus;
+	bigtime_t			fFinishTime;
 	uint32				fVecCount;
 	generic_io_vec		fVecs[64]; // TODO: make dynamic/configurable
 };
@@ -2247,6 +2418,7 @@ PageWriteTransfer::SetStatus(status_t status, size_t transferred)
 		status = B_ERROR;
 
 	fStatus = status;
+	fFinishTime = system_time();
 }
 
 
@@ -2314,6 +2486,8 @@ PageWriterRun::Go()
 	ConditionVariableEntry waitEntry;
 	fAllFinishedCondition.Add(&waitEntry);
 
+	bigtime_t startTime = system_time();
+
 	// schedule writes
 	for (uint32 i = 0; i < fTransferCount; i++)
 		fTransfers[i].Schedule(B_VIP_IO_REQUEST);
@@ -2327,6 +2501,15 @@ PageWriterRun::Go()
 	uint32 wrapperIndex = 0;
 	for (uint32 i = 0; i < fTransferCount; i++) {
 		PageWriteTransfer& transfer = fTransfers[i];
+
+		vm_writeback_device* device
+			= writeback_device_for_cache(transfer.Cache());
+		if (device != NULL && transfer.Status() == B_OK) {
+			device->run_written_pages += transfer.PageCount();
+			device->run_time = std::max(device->run_time,
+				transfer.FinishTime() - startTime);
+		}
+
 		transfer.Cache()->Lock();
 
 		for (uint32 j = 0; j < transfer.PageCount(); j++) {
@@ -2430,6 +2613,7 @@ page_writer(void* /*unused*/)
 
 		uint32 numPages = 0;
 		run.PrepareNextRun();
+		prepare_writeback_run(kNumPages);
 
 		// TODO: make this laptop friendly, too (ie. only start doing
 		// something if someone else did something or there is really
@@ -2486,6 +2670,16 @@ page_writer(void* /*unused*/)
 				continue;
 			}
 
+			// Leave the pages of devices that already got their share of this
+			// run to the next one.
+			vm_writeback_device* writebackDevice
+				= writeback_device_for_cache(cache);
+			if (writebackDevice != NULL
+				&& writebackDevice->run_pages >= writebackDevice->run_quota) {
+				DEBUG_PAGE_ACCESS_END(page);
+				continue;
+			}
+
 			// We need our own reference to the store, as it might currently be
 			// destroyed.
 			if (cache->AcquireUnreferencedStoreRef() != B_OK) {
@@ -2509,11 +2703,16 @@ page_writer(void* /*unused*/)
 
 			cache->AcquireRefLocked();
 			numPages++;
+			if (writebackDevice != NULL)
+				writebackDevice->run_pages++;
 
 			// Write adjacent pages at the same time, if they're also modified.
 			if (cache->temporary)
 				continue;
-			while (page->cache_next != NULL && numPages < kNumPages) {
+			while (page->cache_next != NULL && numPages < kNumPages
+				&& (writebackDevice == NULL
+					|| writebackDevice->run_pages
+						< writebackDevice->run_quota)) {
 				page = page->cache_next;
 				if (page->busy || page->State() != PAGE_STATE_MODIFIED)
 					break;
@@ -2528,6 +2727,8 @@ page_writer(void* /*unused*/)
 				cache->AcquireStoreRef();
 				cache->AcquireRefLocked();
 				numPages++;
+				if (writebackDevice != NULL)
+					writebackDevice->run_pages++;
 				if (maxPagesToSee > 0)
 					maxPagesToSee--;
 			}
@@ -2544,6 +2745,7 @@ page_writer(void* /*unused*/)
 		pageWritingTime -= system_time();
 #endif
 		uint32 failedPages = run.Go();
+		finish_writeback_run();
 #ifdef TRACE_VM_PAGE
 		pageWritingTime += system_time();
 
@@ -3361,6 +3563,148 @@ vm_page_schedule_write_page_range(struct VMCache *cache, uint32 firstPage,
 }
 
 
+/*!	Returns the write back accounting object for \a device, or \c NULL if
+	there are already too many devices, in which case the pages of that device
+	are not accounted for.
+*/
+vm_writeback_device*
+vm_page_get_writeback_device(dev_t device)
+{
+	MutexLocker locker(sWritebackDevicesLock);
+
+	vm_writeback_device* unused = NULL;
+	for (uint32 i = 0; i < kMaxWritebackDevices; i++) {
+		vm_writeback_device& writebackDevice = sWritebackDevices[i];
+		if (writebackDevice.ref_count > 0) {
+			if (writebackDevice.device == device) {
+				atomic_add(&writebackDevice.ref_count, 1);
+				return &writebackDevice;
+			}
+		} else if (unused == NULL)
+			unused = &writebackDevice;
+	}
+
+	if (unused == NULL)
+		return NULL;
+
+	unused->device = device;
+	unused->dirty_pages = 0;
+	unused->bandwidth = 0;
+	unused->run_quota = 0;
+	unused->run_pages = 0;
+	unused->run_written_pages = 0;
+	unused->run_time = 0;
+	unused->written_pages = 0;
+	unused->throttled_writes = 0;
+	unused->throttle_time = 0;
+	atomic_set(&unused->ref_count, 1);
+
+	return unused;
+}
+
+
+void
+vm_page_put_writeback_device(vm_writeback_device* device)
+{
+	if (device == NULL)
+		return;
+
+	atomic_add(&device->ref_count, -1);
+}
+
+
+/*!	Adds \a count to the modified pages of the device \a cache belongs to.
+	Must be called whenever a modified page is added to or removed from a
+	cache, or changes its state from or to PAGE_STATE_MODIFIED.
+*/
+void
+vm_page_account_modified_pages(VMCache* cache, int32 count)
+{
+	vm_writeback_device* device = writeback_device_for_cache(cache);
+	if (device == NULL)
+		return;
+
+	atomic_add(&device->dirty_pages, count);
+	atomic_add(&sModifiedWritebackPages, count);
+}
+
+
+/*!	Lets the calling thread wait if \a device has more modified pages than its
+	share of the dirty pages limit, until the page writer caught up, or until
+	kMaxThrottleTime has passed.
+	Must be called after writing to the file cache without holding any locks
+	the page writer might need.
+*/
+void
+vm_page_throttle_writer(dev_t device)
+{
+	if (atomic_get(&sModifiedWritebackPages) < (int32)(sDirtyPagesLimit / 2))
+		return;
+
+	vm_writeback_device* writebackDevice = NULL;
+	for (uint32 i = 0; i < kMaxWritebackDevices; i++) {
+		if (sWritebackDevices[i].ref_count > 0
+			&& sWritebackDevices[i].device == device) {
+			writebackDevice = &sWritebackDevices[i];
+			break;
+		}
+	}
+	if (writebackDevice == NULL)
+		return;
+
+	bigtime_t startTime = 0;
+	while (atomic_get(&writebackDevice->dirty_pages)
+			> (int32)writeback_device_dirty_limit(*writebackDevice)) {
+		bigtime_t now = system_time();
+		if (startTime == 0) {
+			startTime = now;
+			atomic_add64(&writebackDevice->throttled_writes, 1);
+		} else if (now - startTime >= kMaxThrottleTime)
+			break;
+
+		sPageWriterCondition.WakeUp();
+
+		ConditionVariableEntry entry;
+		sWritebackCondition.Add(&entry);
+		entry.Wait(B_RELATIVE_TIMEOUT, kThrottleInterval);
+	}
+
+	if (startTime != 0) {
+		atomic_add64(&writebackDevice->throttle_time,
+			system_time() - startTime);
+	}
+}
+
+
+/*!	Fills in \a infos with the write back statistics of up to \a maxCount
+	devices, and returns the number of devices there are.
+*/
+uint32
+vm_page_get_writeback_info(writeback_device_info* infos, uint32 maxCount)
+{
+	uint32 count = 0;
+	for (uint32 i = 0; i < kMaxWritebackDevices; i++) {
+		const vm_writeback_device& device = sWritebackDevices[i];
+		if (device.ref_count <= 0)
+			continue;
+
+		if (count < maxCount) {
+			writeback_device_info& info = infos[count];
+			info.device = device.device;
+			info.dirty_pages = std::max(device.dirty_pages, (int32)0);
+			info.dirty_limit = writeback_device_dirty_limit(device);
+			info.bandwidth = device.bandwidth;
+			info.written_pages = device.written_pages;
+			info.throttled_writes = device.throttled_writes;
+			info.throttle_time = device.throttle_time;
+		}
+		count++;
+	}
+
+	return count;
+}
+
+
 void
 vm_page_init_num_pages(kernel_args *args)
 {
@@ -3512,6 +3856,8 @@ vm_page_init_post_area(kernel_args *args)
 	add_debugger_command("page_queue", &dump_page_queue, "Dump page queue");
 	add_debugger_command("find_page", &find_page,
 		"Find out which queue a page is actually in");
+	add_debugger_command("writeback", &dump_writeback_devices,
+		"Dump the modified pages and write back statistics per device");
 
 #ifdef TRACK_PAGE_USAGE_STATS
 	add_debugger_command_etc("page_usage", &dump_page_usage_stats,
@@ -3556,6 +3902,10 @@ vm_page_init_post_thread(kernel_args *args)
 {
 	new (&sFreePageCondition) ConditionVariable;
 
+	new (&sWritebackCondition) ConditionVariable;
+	sWritebackCondition.Init(sWritebackDevices, "page writeback");
+	sDirtyPagesLimit = vm_page_num_pages() / 5;
+
 	// create a kernel thread to clear out pages
 
 	thread_id thread = spawn_kernel_thread(&page_scrubber, "page scrubber",
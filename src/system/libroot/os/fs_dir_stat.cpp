@@ -0,0 +1,27 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <fs_dir_stat.h>
+
+#include <errno_private.h>
+#include <syscalls.h>
+#include <syscall_utils.h>
+
+
+/*!	Reads the next entries of the directory \a fd refers to, together with
+	their stat data, and the first \a maxAttributeSize bytes of each of the
+	given attributes, with a single syscall.
+	Returns the number of entries read, 0 at the end of the directory.
+*/
+extern "C" ssize_t
+fs_read_dir_stat(int fd, const char* const* attributes, uint32 attributeCount,
+	size_t maxAttributeSize, dir_stat_entry* buffer, size_t bufferSize,
+	uint32 maxCount)
+{
+	ssize_t count = _kern_read_dir_stat(fd, attributes, attributeCount,
+		maxAttributeSize, buffer, bufferSize, maxCount);
+	RETURN_AND_SET_ERRNO(count);
+}
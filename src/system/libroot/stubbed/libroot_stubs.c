@@ -1095,6 +1095,7 @@ void _kern_get_thread_affinity() {}
 void _kern_get_thread_info() {}
 void _kern_get_timer() {}
 void _kern_get_timezone() {}
+void _kern_get_writeback_info() {}
 void _kern_getcwd() {}
 void _kern_getgid() {}
 void _kern_getgroups() {}
@@ -1148,6 +1149,7 @@ void _kern_process_info() {}
 void _kern_read() {}
 void _kern_read_attr() {}
 void _kern_read_dir() {}
+void _kern_read_dir_stat() {}
 void _kern_read_fs_info() {}
 void _kern_read_index_stat() {}
 void _kern_read_kernel_image_symbols() {}
@@ -1164,6 +1166,7 @@ void _kern_realtime_sem_wait() {}
 void _kern_receive_data() {}
 void _kern_recv() {}
 void _kern_recvfrom() {}
+void _kern_recvmmsg() {}
 void _kern_recvmsg() {}
 void _kern_register_file_device() {}
 void _kern_register_image() {}
@@ -1190,6 +1193,7 @@ void _kern_select() {}
 void _kern_send() {}
 void _kern_send_data() {}
 void _kern_send_signal() {}
+void _kern_sendmmsg() {}
 void _kern_sendmsg() {}
 void _kern_sendto() {}
 void _kern_set_area_protection() {}
@@ -1677,6 +1681,7 @@ void fs_open_live_query() {}
 void fs_open_query() {}
 void fs_read_attr() {}
 void fs_read_attr_dir() {}
+void fs_read_dir_stat() {}
 void fs_read_index_dir() {}
 void fs_read_query() {}
 void fs_remove_attr() {}
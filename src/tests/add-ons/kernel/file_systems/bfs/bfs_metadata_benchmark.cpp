@@ -0,0 +1,280 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures metadata throughput with several threads working at the same
+	time: every thread creates files, writes an attribute to each of them,
+	and removes them again. Unlike the "benchmark" command of bfs_shell, this
+	runs on a mounted volume, and therefore shows how well concurrent
+	metadata operations scale.
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <OS.h>
+#include <fs_attr.h>
+#include <TypeConstants.h>
+
+
+static const int32 kMaxThreads = 64;
+
+enum benchmark_phase {
+	PHASE_CREATE,
+	PHASE_WRITE_ATTRIBUTE,
+	PHASE_REMOVE
+};
+
+struct benchmark_options {
+	const char*	base;
+	int32		threads;
+	int32		files;
+	int32		syncInterval;
+	bool		sharedDirectory;
+};
+
+struct thread_data {
+	const benchmark_options* options;
+	int32			index;
+	benchmark_phase	phase;
+	status_t		status;
+};
+
+
+static void
+file_path(const benchmark_options& options, int32 thread, int32 file,
+	char* path, size_t length)
+{
+	if (options.sharedDirectory) {
+		snprintf(path, length, "%s/shared/t%" B_PRId32 "-%" B_PRId32,
+			options.base, thread, file);
+	} else {
+		snprintf(path, length, "%s/%" B_PRId32 "/%" B_PRId32, options.base,
+			thread, file);
+	}
+}
+
+
+static status_t
+create_file(const benchmark_options& options, const char* path, int32 file)
+{
+	int fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0)
+		return errno;
+
+	status_t status = B_OK;
+	if (options.syncInterval > 0 && (file + 1) % options.syncInterval == 0
+		&& fsync(fd) != 0)
+		status = errno;
+
+	close(fd);
+	return status;
+}
+
+
+static status_t
+write_attribute(const benchmark_options& options, const char* path,
+	int32 file)
+{
+	int fd = open(path, O_RDWR);
+	if (fd < 0)
+		return errno;
+
+	char value[32];
+	snprintf(value, sizeof(value), "file %" B_PRId32, file);
+
+	status_t status = B_OK;
+	if (fs_write_attr(fd, "BENCH:value", B_STRING_TYPE, 0, value,
+			strlen(value) + 1) < 0)
+		status = errno;
+	else if (options.syncInterval > 0
+		&& (file + 1) % options.syncInterval == 0 && fsync(fd) != 0)
+		status = errno;
+
+	close(fd);
+	return status;
+}
+
+
+static void*
+benchmark_thread(void* _data)
+{
+	thread_data& data = *(thread_data*)_data;
+	const benchmark_options& options = *data.options;
+	char path[B_PATH_NAME_LENGTH];
+
+	for (int32 i = 0; i < options.files; i++) {
+		file_path(options, data.index, i, path, sizeof(path));
+
+		switch (data.phase) {
+			case PHASE_CREATE:
+				data.status = create_file(options, path, i);
+				break;
+			case PHASE_WRITE_ATTRIBUTE:
+				data.status = write_attribute(options, path, i);
+				break;
+			case PHASE_REMOVE:
+				data.status = unlink(path) == 0 ? B_OK : errno;
+				break;
+		}
+		if (data.status != B_OK)
+			break;
+	}
+
+	return NULL;
+}
+
+
+/*!	Runs \a phase in all threads at the same time, and returns how long it
+	took until all of them were done.
+*/
+static status_t
+run_phase(const benchmark_options& options, benchmark_phase phase,
+	bigtime_t& _time)
+{
+	pthread_t threads[kMaxThreads];
+	thread_data data[kMaxThreads];
+
+	bigtime_t start = system_time();
+
+	int32 started = 0;
+	status_t status = B_OK;
+	for (; started < options.threads; started++) {
+		data[started].options = &options;
+		data[started].index = started;
+		data[started].phase = phase;
+		data[started].status = B_OK;
+
+		status = pthread_create(&threads[started], NULL, &benchmark_thread,
+			&data[started]);
+		if (status != 0)
+			break;
+	}
+
+	for (int32 i = 0; i < started; i++) {
+		pthread_join(threads[i], NULL);
+		if (status == B_OK)
+			status = data[i].status;
+	}
+
+	_time = system_time() - start;
+	return status;
+}
+
+
+static void
+print_rate(const char* what, int64 count, bigtime_t time)
+{
+	printf("  %-16s %8" B_PRId64 " in %6" B_PRId64 " ms, %8.0f/s\n", what,
+		count, time / 1000, time > 0 ? count * 1000000.0 / time : 0.0);
+}
+
+
+static status_t
+create_directory(const char* path)
+{
+	if (mkdir(path, 0755) != 0 && errno != EEXIST)
+		return errno;
+
+	return B_OK;
+}
+
+
+static void
+usage(const char* name)
+{
+	fprintf(stderr, "Usage: %s [-t <threads>] [-n <files>] "
+		"[-s <sync interval>] [-d] <directory>\n"
+		"Every thread creates <files> files in <directory>, writes an "
+		"attribute to each\nof them, and removes them again.\n"
+		"  -s  fsync() every <sync interval> files\n"
+		"  -d  put the files of all threads into a single directory\n",
+		name);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	benchmark_options options;
+	options.base = NULL;
+	options.threads = 4;
+	options.files = 2000;
+	options.syncInterval = 0;
+	options.sharedDirectory = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-t") && i + 1 < argc)
+			options.threads = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			options.files = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+			options.syncInterval = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-d"))
+			options.sharedDirectory = true;
+		else if (argv[i][0] != '-' && options.base == NULL)
+			options.base = argv[i];
+		else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (options.base == NULL) {
+		usage(argv[0]);
+		return 1;
+	}
+	if (options.threads < 1 || options.threads > kMaxThreads
+		|| options.files < 1) {
+		fprintf(stderr, "Invalid number of threads or files\n");
+		return 1;
+	}
+
+	char path[B_PATH_NAME_LENGTH];
+	status_t status = create_directory(options.base);
+	if (status == B_OK && options.sharedDirectory) {
+		snprintf(path, sizeof(path), "%s/shared", options.base);
+		status = create_directory(path);
+	}
+	for (int32 i = 0; status == B_OK && !options.sharedDirectory
+			&& i < options.threads; i++) {
+		snprintf(path, sizeof(path), "%s/%" B_PRId32, options.base, i);
+		status = create_directory(path);
+	}
+
+	bigtime_t createTime = 0;
+	bigtime_t attributeTime = 0;
+	bigtime_t removeTime = 0;
+	if (status == B_OK)
+		status = run_phase(options, PHASE_CREATE, createTime);
+	if (status == B_OK)
+		status = run_phase(options, PHASE_WRITE_ATTRIBUTE, attributeTime);
+	if (status == B_OK)
+		status = run_phase(options, PHASE_REMOVE, removeTime);
+
+	if (status != B_OK) {
+		fprintf(stderr, "Benchmark failed: %s\n", strerror(status));
+		return 1;
+	}
+
+	int64 files = (int64)options.threads * options.files;
+	printf("%" B_PRId32 " threads, %" B_PRId64 " files in %s%s:\n",
+		options.threads, files,
+		options.sharedDirectory ? "one directory" : "a directory per thread",
+		options.syncInterval > 0 ? ", with fsync()" : "");
+	print_rate("created", files, createTime);
+	print_rate("attributes", files, attributeTime);
+	print_rate("removed", files, removeTime);
+	print_rate("total", 3 * files, createTime + attributeTime + removeTime);
+
+	return 0;
+}
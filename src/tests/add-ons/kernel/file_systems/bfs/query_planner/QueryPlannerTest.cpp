@@ -0,0 +1,400 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Tests which index the query planner chooses for a query, and which
+	other indices it intersects with it, using the estimates of a fake
+	volume. It checks the plan as described by Query::Explain().
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define QUERY_INFORM(message...) printf(message)
+#define QUERY_FATAL(message...) { fprintf(stderr, message); abort(); }
+#include <file_systems/QueryParser.h>
+
+
+class Entry;
+class Volume {};
+
+
+/*!	Describes one index of the fake volume. An equation on it is estimated
+	to match \c matches entries, while all \c entries have to be read when
+	the index needs to be scanned completely. If \c matches is negative,
+	the index cannot give any estimates.
+*/
+struct IndexInfo {
+	const char*	name;
+	type_code	type;
+	int64		entries;
+	int64		matches;
+};
+
+
+static Volume sVolume;
+static const IndexInfo* sIndices;
+
+
+struct QueryPolicy {
+	typedef ::Volume Context;
+	typedef ::Entry Entry;
+	typedef ::Entry Node;
+	typedef void* NodeHolder;
+
+	struct Index {
+		const IndexInfo* info;
+
+		Index(Context* context)
+			:
+			info(NULL)
+		{
+		}
+	};
+
+	struct IndexIterator {
+		Entry* entry;
+	};
+
+	static const int32 kMaxFileNameLength = B_FILE_NAME_LENGTH;
+
+	// Entry interface
+
+	static ino_t EntryGetParentID(Entry* entry)
+	{
+		return -1;
+	}
+
+	static Node* EntryGetNode(Entry* entry)
+	{
+		return entry;
+	}
+
+	static ino_t EntryGetNodeID(Entry* entry)
+	{
+		return -1;
+	}
+
+	static ssize_t EntryGetName(Entry* entry, void* buffer, size_t bufferSize)
+	{
+		return B_ERROR;
+	}
+
+	static const char* EntryGetNameNoCopy(NodeHolder& holder, Entry* entry)
+	{
+		return NULL;
+	}
+
+	// Index interface
+
+	static status_t IndexSetTo(Index& index, const char* attribute)
+	{
+		for (const IndexInfo* info = sIndices; info->name != NULL; info++) {
+			if (strcmp(info->name, attribute) == 0) {
+				index.info = info;
+				return B_OK;
+			}
+		}
+
+		index.info = NULL;
+		return B_ENTRY_NOT_FOUND;
+	}
+
+	static void IndexUnset(Index& index)
+	{
+		index.info = NULL;
+	}
+
+	static int32 IndexGetSize(Index& index)
+	{
+		return index.info->entries;
+	}
+
+	static type_code IndexGetType(Index& index)
+	{
+		return index.info->type;
+	}
+
+	static int32 IndexGetKeySize(Index& index)
+	{
+		return index.info->type == B_STRING_TYPE ? 0 : sizeof(int32);
+	}
+
+	static status_t IndexEstimateCount(Index& index, int32 op,
+		const void* value, size_t size, bool prefix, int64* _count)
+	{
+		if (index.info->matches < 0)
+			return B_NOT_SUPPORTED;
+
+		*_count = value != NULL ? index.info->matches : index.info->entries;
+		return B_OK;
+	}
+
+	static IndexIterator* IndexCreateIterator(Index& index)
+	{
+		return NULL;
+	}
+
+	// IndexIterator interface
+
+	static void IndexIteratorDelete(IndexIterator* indexIterator)
+	{
+		delete indexIterator;
+	}
+
+	static status_t IndexIteratorFind(IndexIterator* indexIterator,
+		const void* value, size_t size)
+	{
+		return B_ERROR;
+	}
+
+	static status_t IndexIteratorFindPattern(IndexIterator* indexIterator,
+		const char* pattern)
+	{
+		return B_ERROR;
+	}
+
+	static status_t IndexIteratorFetchNextEntry(IndexIterator* indexIterator,
+		void* value, size_t* _valueLength, size_t bufferSize, size_t* duplicate)
+	{
+		return B_ERROR;
+	}
+
+	static status_t IndexIteratorGetEntry(Context* context,
+		IndexIterator* indexIterator, NodeHolder& holder, Entry** _entry)
+	{
+		*_entry = indexIterator->entry;
+		return B_OK;
+	}
+
+	static ino_t IndexIteratorGetNodeID(IndexIterator* indexIterator)
+	{
+		return -1;
+	}
+
+	static void IndexIteratorSkipDuplicates(IndexIterator* indexIterator)
+	{
+	}
+
+	static void IndexIteratorSuspend(IndexIterator* indexIterator)
+	{
+	}
+
+	static void IndexIteratorResume(IndexIterator* indexIterator)
+	{
+	}
+
+	// Node interface
+
+	static const off_t NodeGetSize(Node* node)
+	{
+		return 0;
+	}
+
+	static time_t NodeGetLastModifiedTime(Node* node)
+	{
+		return 0;
+	}
+
+	static status_t NodeGetAttribute(NodeHolder& nodeHolder, Node* node,
+		const char* attribute, void* buffer, size_t* _size, int32* _type)
+	{
+		return B_ERROR;
+	}
+
+	static Entry* NodeGetFirstReferrer(Node* node)
+	{
+		return node;
+	}
+
+	static Entry* NodeGetNextReferrer(Node* node, Entry* entry)
+	{
+		return NULL;
+	}
+
+	// Volume interface
+
+	static dev_t ContextGetVolumeID(Context* context)
+	{
+		return 0;
+	}
+
+	static status_t ContextGetEntry(Context* context, ino_t id,
+		NodeHolder& holder, Entry** _entry)
+	{
+		return B_ERROR;
+	}
+};
+
+typedef QueryParser::Query<QueryPolicy> Query;
+
+
+struct PlanTest {
+	const char*			name;
+	const IndexInfo*	indices;
+	const char*			query;
+	const char*			expected[6];
+		// must appear in the plan in this order
+	const char*			unexpected;
+		// must not appear in the plan
+};
+
+
+// Reading an index entry costs 1, loading an entry to check it costs 16
+
+static const IndexInfo kSelectionIndices[] = {
+	{"name", B_STRING_TYPE, 10000, 1},
+	{"a", B_INT32_TYPE, 10000, 5000},
+	{"b", B_INT32_TYPE, 10000, 10},
+	{"s", B_INT32_TYPE, 1000, -1},
+	{NULL}
+};
+
+// "a" drives the query with a cost of 1700. Intersecting "b" first leaves
+// ~3 candidates for a cost of 448, after which "c" would cost more than it
+// saves. Trying "c" first would have ended with a worse plan.
+static const IndexInfo kIntersectionIndices[] = {
+	{"name", B_STRING_TYPE, 10000, 1},
+	{"a", B_INT32_TYPE, 10000, 100},
+	{"b", B_INT32_TYPE, 10000, 300},
+	{"c", B_INT32_TYPE, 10000, 1000},
+	{"large", B_INT32_TYPE, 1000000, 300000},
+	{NULL}
+};
+
+static const PlanTest kPlanTests[] = {
+	{
+		"cheapest index drives the query",
+		kSelectionIndices,
+		"(a==1)&&(b==1)",
+		{"1. b == 1: index, ~10 reads, ~10 matches", "filter: a == 1"},
+		"intersect"
+	},
+	{
+		"order of equations does not matter",
+		kSelectionIndices,
+		"(b==1)&&(a==1)",
+		{"1. b == 1: index, ~10 reads, ~10 matches", "filter: a == 1"},
+		"intersect"
+	},
+	{
+		"index without estimates is scored by its size",
+		kSelectionIndices,
+		"(s==1)&&(a==1)",
+		{"1. s == 1: index (read", "filter: a == 1"},
+		"intersect"
+	},
+	{
+		"estimate beats size score",
+		kSelectionIndices,
+		"(s==1)&&(b==1)",
+		{"1. b == 1: index, ~10 reads", "filter: s == 1"},
+		"intersect"
+	},
+	{
+		"attribute without index only filters",
+		kSelectionIndices,
+		"(x==1)&&(a==1)",
+		{"1. a == 1: index, ~5000 reads", "filter: x == \"1\""},
+		"intersect"
+	},
+	{
+		"disjunction runs both sides",
+		kSelectionIndices,
+		"(a==1)||(b==1)",
+		{"1. a == 1: index, ~5000 reads", "2. b == 1: index, ~10 reads"},
+		"intersect"
+	},
+	{
+		"intersect in order of matches",
+		kIntersectionIndices,
+		"(c==1)&&(b==1)&&(a==1)",
+		{"estimated entries: 10000", "1. intersect indices, ~3 candidates",
+			"a == 1: index, ~100 reads", "b == 1: index, ~300 reads"},
+		"c == 1: index"
+	},
+	{
+		"unequal is not intersected",
+		kIntersectionIndices,
+		"(a==1)&&(b!=1)",
+		{"1. a == 1: index, ~100 reads", "filter: b != 1"},
+		"intersect"
+	},
+	{
+		"too many matches are not intersected",
+		kIntersectionIndices,
+		"(a==1)&&(large==1)",
+		{"1. a == 1: index, ~100 reads", "filter: large == 1"},
+		"intersect"
+	},
+};
+
+
+static bool
+test_plan(const PlanTest& test)
+{
+	sIndices = test.indices;
+
+	Query* query;
+	status_t status = Query::Create(&sVolume, test.query, 0, -1, 0, query);
+	if (status != B_OK) {
+		fprintf(stderr, "%s: could not create query \"%s\": %s\n", test.name,
+			test.query, strerror(status));
+		return false;
+	}
+
+	char plan[4096];
+	status = query->Explain(plan, sizeof(plan));
+	delete query;
+
+	if (status != B_OK) {
+		fprintf(stderr, "%s: could not explain query: %s\n", test.name,
+			strerror(status));
+		return false;
+	}
+
+	const char* position = plan;
+	for (int32 i = 0; i < 6 && test.expected[i] != NULL; i++) {
+		const char* found = strstr(position, test.expected[i]);
+		if (found == NULL) {
+			fprintf(stderr, "%s: \"%s\" missing from plan:\n%s", test.name,
+				test.expected[i], plan);
+			return false;
+		}
+		position = found + strlen(test.expected[i]);
+	}
+
+	if (test.unexpected != NULL && strstr(plan, test.unexpected) != NULL) {
+		fprintf(stderr, "%s: \"%s\" should not be part of plan:\n%s",
+			test.name, test.unexpected, plan);
+		return false;
+	}
+
+	return true;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int32 count = sizeof(kPlanTests) / sizeof(kPlanTests[0]);
+	int32 failed = 0;
+
+	for (int32 i = 0; i < count; i++) {
+		if (!test_plan(kPlanTests[i]))
+			failed++;
+	}
+
+	if (failed > 0) {
+		fprintf(stderr, "%" B_PRId32 " of %" B_PRId32 " tests failed.\n",
+			failed, count);
+		return 1;
+	}
+
+	printf("All %" B_PRId32 " tests passed.\n", count);
+	return 0;
+}
@@ -114,6 +114,12 @@ struct Query::QueryPolicy {
 		return 0;
 	}
 
+	static status_t IndexEstimateCount(Index& index, int32 op,
+		const void* value, size_t size, bool prefix, int64* _count)
+	{
+		return B_ERROR;
+	}
+
 	static IndexIterator* IndexCreateIterator(Index& index)
 	{
 		return NULL;
@@ -132,6 +138,12 @@ struct Query::QueryPolicy {
 		return B_ERROR;
 	}
 
+	static status_t IndexIteratorFindPattern(IndexIterator* indexIterator,
+		const char* pattern)
+	{
+		return B_ERROR;
+	}
+
 	static status_t IndexIteratorFetchNextEntry(IndexIterator* indexIterator,
 		void* value, size_t* _valueLength, size_t bufferSize, size_t* duplicate)
 	{
@@ -145,6 +157,11 @@ struct Query::QueryPolicy {
 		return B_OK;
 	}
 
+	static ino_t IndexIteratorGetNodeID(IndexIterator* indexIterator)
+	{
+		return -1;
+	}
+
 	static void IndexIteratorSkipDuplicates(IndexIterator* indexIterator)
 	{
 	}
@@ -191,6 +208,12 @@ struct Query::QueryPolicy {
 	{
 		return 0;
 	}
+
+	static status_t ContextGetEntry(Context* context, ino_t id,
+		NodeHolder& holder, Entry** _entry)
+	{
+		return B_ERROR;
+	}
 };
 
 
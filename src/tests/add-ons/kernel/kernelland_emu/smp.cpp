@@ -30,3 +30,10 @@ smp_get_current_cpu()
 {
 	return 0;
 }
+
+
+extern "C" int32
+smp_get_num_cpus()
+{
+	return 1;
+}
@@ -0,0 +1,306 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Writes the contents of all files of a directory tree into a package file
+	heap with an increasing number of compression threads, and prints how long
+	that took. Also verifies that all runs produce the very same heap.
+*/
+
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <new>
+
+#include <File.h>
+#include <OS.h>
+#include <Referenceable.h>
+#include <String.h>
+
+#include <package/hpkg/DataReader.h>
+#include <package/hpkg/HPKGDefs.h>
+#include <package/hpkg/PackageFileHeapWriter.h>
+#include <package/hpkg/StandardErrorOutput.h>
+
+#include <ZlibCompressionAlgorithm.h>
+#include <ZstdCompressionAlgorithm.h>
+
+
+using namespace BPackageKit::BHPKG;
+using BPackageKit::BHPKG::BPrivate::CompressionAlgorithmOwner;
+using BPackageKit::BHPKG::BPrivate::DecompressionAlgorithmOwner;
+using BPackageKit::BHPKG::BPrivate::PackageFileHeapWriter;
+
+
+static const char* kUsage =
+	"Usage: %s [ <options> ] <directory> <heap file>\n"
+	"Writes the contents of all files below <directory> to the package heap\n"
+	"file <heap file>, once per thread count, and prints the times needed.\n"
+	"\n"
+	"Options:\n"
+	"  -0 ... -9  - Use compression level 0 ... 9. Defaults to 9.\n"
+	"  -j <count> - Use up to <count> threads. Defaults to the number of\n"
+	"               CPUs.\n"
+	"  -z <type>  - Use compression method <type>, \"zlib\" or \"zstd\".\n"
+	"               Defaults to \"zlib\".\n"
+	"  -h         - Print this usage info.\n";
+
+
+static const char* sProgramName;
+
+
+static void
+print_usage_and_exit(bool error)
+{
+	fprintf(error ? stderr : stdout, kUsage, sProgramName);
+	exit(error ? 1 : 0);
+}
+
+
+struct BenchmarkResult {
+	bigtime_t	time;
+	uint64		uncompressedSize;
+	uint64		compressedSize;
+	uint64		checksum;
+};
+
+
+static status_t
+add_directory(PackageFileHeapWriter& heapWriter, const BString& path)
+{
+	DIR* dir = opendir(path.String());
+	if (dir == NULL) {
+		fprintf(stderr, "Error: Failed to open directory \"%s\": %s\n",
+			path.String(), strerror(errno));
+		return errno;
+	}
+
+	status_t error = B_OK;
+	while (dirent* entry = readdir(dir)) {
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+			continue;
+
+		BString entryPath = path;
+		entryPath << '/' << entry->d_name;
+
+		struct stat st;
+		if (lstat(entryPath.String(), &st) != 0)
+			continue;
+
+		if (S_ISDIR(st.st_mode)) {
+			error = add_directory(heapWriter, entryPath);
+		} else if (S_ISREG(st.st_mode)) {
+			int fd = open(entryPath.String(), O_RDONLY);
+			if (fd < 0) {
+				fprintf(stderr, "Error: Failed to open \"%s\": %s\n",
+					entryPath.String(), strerror(errno));
+				error = errno;
+				break;
+			}
+
+			BFDDataReader dataReader(fd);
+			uint64 offset;
+			error = heapWriter.AddData(dataReader, st.st_size, offset);
+			close(fd);
+		}
+
+		if (error != B_OK)
+			break;
+	}
+
+	closedir(dir);
+	return error;
+}
+
+
+static uint64
+checksum_file(BFile& file, uint64 size)
+{
+	// FNV-1a
+	uint64 checksum = 0xcbf29ce484222325ULL;
+	uint8 buffer[64 * 1024];
+	off_t offset = 0;
+	while ((uint64)offset < size) {
+		ssize_t bytesRead = file.ReadAt(offset, buffer, sizeof(buffer));
+		if (bytesRead <= 0)
+			break;
+
+		for (ssize_t i = 0; i < bytesRead; i++) {
+			checksum ^= buffer[i];
+			checksum *= 0x100000001b3ULL;
+		}
+		offset += bytesRead;
+	}
+
+	return checksum;
+}
+
+
+static status_t
+run_benchmark(const char* directory, const char* heapFileName,
+	CompressionAlgorithmOwner* compressionAlgorithm,
+	DecompressionAlgorithmOwner* decompressionAlgorithm, int32 threadCount,
+	BenchmarkResult& _result)
+{
+	BFile file;
+	status_t error = file.SetTo(heapFileName,
+		B_READ_WRITE | B_CREATE_FILE | B_ERASE_FILE);
+	if (error != B_OK) {
+		fprintf(stderr, "Error: Failed to create heap file \"%s\": %s\n",
+			heapFileName, strerror(error));
+		return error;
+	}
+
+	BStandardErrorOutput errorOutput;
+	bigtime_t startTime = system_time();
+
+	try {
+		PackageFileHeapWriter heapWriter(&errorOutput, &file, 0,
+			compressionAlgorithm, decompressionAlgorithm);
+		heapWriter.SetThreadCount(threadCount);
+		heapWriter.Init();
+
+		error = add_directory(heapWriter, directory);
+		if (error == B_OK)
+			error = heapWriter.Finish();
+		if (error != B_OK)
+			return error;
+
+		_result.time = system_time() - startTime;
+		_result.uncompressedSize = heapWriter.UncompressedHeapSize();
+		_result.compressedSize = heapWriter.CompressedHeapSize();
+	} catch (std::bad_alloc&) {
+		fprintf(stderr, "Error: Out of memory\n");
+		return B_NO_MEMORY;
+	} catch (status_t error) {
+		return error;
+	}
+
+	off_t fileSize;
+	error = file.GetSize(&fileSize);
+	if (error != B_OK)
+		return error;
+
+	_result.checksum = checksum_file(file, fileSize);
+	return B_OK;
+}
+
+
+int
+main(int argc, const char* const* argv)
+{
+	sProgramName = argv[0];
+
+	int32 compressionLevel = B_HPKG_COMPRESSION_LEVEL_BEST;
+	int32 maxThreadCount = sysconf(_SC_NPROCESSORS_ONLN);
+	bool useZstd = false;
+
+	int argi = 1;
+	for (; argi < argc; argi++) {
+		const char* arg = argv[argi];
+		if (arg[0] != '-')
+			break;
+
+		if (arg[1] >= '0' && arg[1] <= '9' && arg[2] == '\0') {
+			compressionLevel = arg[1] - '0';
+		} else if (strcmp(arg, "-j") == 0 && argi + 1 < argc) {
+			maxThreadCount = atoi(argv[++argi]);
+		} else if (strcmp(arg, "-z") == 0 && argi + 1 < argc) {
+			const char* type = argv[++argi];
+			if (strcmp(type, "zstd") == 0)
+				useZstd = true;
+			else if (strcmp(type, "zlib") != 0)
+				print_usage_and_exit(true);
+		} else if (strcmp(arg, "-h") == 0) {
+			print_usage_and_exit(false);
+		} else
+			print_usage_and_exit(true);
+	}
+
+	if (argc - argi != 2)
+		print_usage_and_exit(true);
+
+	const char* directory = argv[argi];
+	const char* heapFileName = argv[argi + 1];
+	if (maxThreadCount < 1)
+		maxThreadCount = 1;
+
+	CompressionAlgorithmOwner* compressionAlgorithm = NULL;
+	DecompressionAlgorithmOwner* decompressionAlgorithm = NULL;
+	if (compressionLevel != 0) {
+		float level = compressionLevel
+			/ float(B_HPKG_COMPRESSION_LEVEL_BEST);
+		if (useZstd) {
+			compressionAlgorithm = CompressionAlgorithmOwner::Create(
+				new(std::nothrow) BZstdCompressionAlgorithm,
+				new(std::nothrow) BZstdCompressionParameters(
+					level * B_ZSTD_COMPRESSION_BEST));
+			decompressionAlgorithm = DecompressionAlgorithmOwner::Create(
+				new(std::nothrow) BZstdCompressionAlgorithm,
+				new(std::nothrow) BZstdDecompressionParameters);
+		} else {
+			compressionAlgorithm = CompressionAlgorithmOwner::Create(
+				new(std::nothrow) BZlibCompressionAlgorithm,
+				new(std::nothrow) BZlibCompressionParameters(
+					level * B_ZLIB_COMPRESSION_BEST));
+			decompressionAlgorithm = DecompressionAlgorithmOwner::Create(
+				new(std::nothrow) BZlibCompressionAlgorithm,
+				new(std::nothrow) BZlibDecompressionParameters);
+		}
+
+		if (compressionAlgorithm == NULL
+			|| compressionAlgorithm->algorithm == NULL
+			|| compressionAlgorithm->parameters == NULL
+			|| decompressionAlgorithm == NULL
+			|| decompressionAlgorithm->algorithm == NULL
+			|| decompressionAlgorithm->parameters == NULL) {
+			fprintf(stderr, "Error: Out of memory\n");
+			return 1;
+		}
+	}
+
+	BReference<CompressionAlgorithmOwner> compressionAlgorithmReference(
+		compressionAlgorithm, true);
+	BReference<DecompressionAlgorithmOwner> decompressionAlgorithmReference(
+		decompressionAlgorithm, true);
+
+	printf("threads      time    MB/s   uncompressed     compressed\n");
+
+	BenchmarkResult firstResult;
+	bool mismatch = false;
+	for (int32 threadCount = 1; threadCount <= maxThreadCount;
+			threadCount = threadCount == maxThreadCount
+				? maxThreadCount + 1
+				: std::min(threadCount * 2, maxThreadCount)) {
+		BenchmarkResult result;
+		if (run_benchmark(directory, heapFileName, compressionAlgorithm,
+				decompressionAlgorithm, threadCount, result) != B_OK) {
+			return 1;
+		}
+
+		double seconds = result.time / 1000000.0;
+		printf("%7" B_PRId32 " %8.2fs %7.1f %14" B_PRIu64 " %14" B_PRIu64 "%s\n",
+			threadCount, seconds,
+			seconds > 0 ? result.uncompressedSize / seconds / 1024 / 1024 : 0,
+			result.uncompressedSize, result.compressedSize,
+			threadCount > 1 && result.checksum != firstResult.checksum
+				? "  (heap differs!)" : "");
+
+		if (threadCount == 1)
+			firstResult = result;
+		else if (result.checksum != firstResult.checksum)
+			mismatch = true;
+	}
+
+	return mismatch ? 1 : 0;
+}
@@ -0,0 +1,441 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Reads the package attributes and TOC of a set of package files
+	repeatedly, once through a BPackageContentHandler and once through a
+	BLowLevelPackageContentHandler, and prints how long that took. Optionally
+	also parses randomly corrupted copies of the packages, to check that the
+	reader rejects them gracefully.
+*/
+
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <new>
+
+#include <DataIO.h>
+#include <File.h>
+#include <OS.h>
+#include <String.h>
+#include <StringList.h>
+
+#include <package/hpkg/NoErrorOutput.h>
+#include <package/hpkg/PackageContentHandler.h>
+#include <package/hpkg/PackageEntry.h>
+#include <package/hpkg/PackageReader.h>
+#include <package/hpkg/StandardErrorOutput.h>
+
+
+using namespace BPackageKit::BHPKG;
+
+
+static const char* kUsage =
+	"Usage: %s [ <options> ] <package or directory> ...\n"
+	"Reads the package attributes and the TOC of the given package files and\n"
+	"of the package files in the given directories, through both the high\n"
+	"and the low level content handler interface, and prints the time needed.\n"
+	"\n"
+	"Options:\n"
+	"  -n <count> - Read each package <count> times. Defaults to 10.\n"
+	"  -f <count> - Additionally parse <count> randomly corrupted copies of\n"
+	"               each package. Most effective with uncompressed packages\n"
+	"               (\"package create -0\").\n"
+	"  -m         - Read the package files into memory first, so that the\n"
+	"               times don't include reading from the file system.\n"
+	"               Combined with uncompressed packages, this mostly leaves\n"
+	"               the time needed for parsing the attributes.\n"
+	"  -h         - Print this usage info.\n";
+
+
+static const char* sProgramName;
+
+
+static void
+print_usage_and_exit(bool error)
+{
+	fprintf(error ? stderr : stdout, kUsage, sProgramName);
+	exit(error ? 1 : 0);
+}
+
+
+struct ContentHandler : BPackageContentHandler {
+	ContentHandler()
+		:
+		fEntryCount(0),
+		fAttributeCount(0),
+		fPackageAttributeCount(0)
+	{
+	}
+
+	virtual status_t HandleEntry(BPackageEntry* entry)
+	{
+		fEntryCount++;
+		return B_OK;
+	}
+
+	virtual status_t HandleEntryAttribute(BPackageEntry* entry,
+		BPackageEntryAttribute* attribute)
+	{
+		fAttributeCount++;
+		return B_OK;
+	}
+
+	virtual status_t HandleEntryDone(BPackageEntry* entry)
+	{
+		return B_OK;
+	}
+
+	virtual status_t HandlePackageAttribute(
+		const BPackageInfoAttributeValue& value)
+	{
+		fPackageAttributeCount++;
+		return B_OK;
+	}
+
+	virtual void HandleErrorOccurred()
+	{
+	}
+
+	uint64	fEntryCount;
+	uint64	fAttributeCount;
+	uint64	fPackageAttributeCount;
+};
+
+
+/*!	Counts the attributes and checks that the attribute and done hooks are
+	called in a properly nested fashion with consistent tokens.
+*/
+struct LowLevelContentHandler : BLowLevelPackageContentHandler {
+	LowLevelContentHandler()
+		:
+		fAttributeCount(0),
+		fNextToken(0),
+		fDepth(0),
+		fConsistent(true)
+	{
+	}
+
+	virtual status_t HandleSectionStart(BHPKGPackageSectionID sectionID,
+		bool& _handleSection)
+	{
+		_handleSection = true;
+		return B_OK;
+	}
+
+	virtual status_t HandleSectionEnd(BHPKGPackageSectionID sectionID)
+	{
+		if (fDepth != 0)
+			fConsistent = false;
+		return B_OK;
+	}
+
+	virtual status_t HandleAttribute(BHPKGAttributeID attributeID,
+		const BPackageAttributeValue& value, void* parentToken, void*& _token)
+	{
+		if (parentToken != _CurrentToken())
+			fConsistent = false;
+
+		fAttributeCount++;
+		_token = (void*)(addr_t)++fNextToken;
+		if (fDepth < kMaxDepth)
+			fTokens[fDepth] = _token;
+		fDepth++;
+		return B_OK;
+	}
+
+	virtual status_t HandleAttributeDone(BHPKGAttributeID attributeID,
+		const BPackageAttributeValue& value, void* parentToken, void* token)
+	{
+		if (fDepth == 0) {
+			fConsistent = false;
+			return B_OK;
+		}
+
+		if (token != _CurrentToken())
+			fConsistent = false;
+		fDepth--;
+		if (parentToken != _CurrentToken())
+			fConsistent = false;
+		return B_OK;
+	}
+
+	virtual void HandleErrorOccurred()
+	{
+	}
+
+	bool Consistent() const
+	{
+		return fConsistent;
+	}
+
+	uint64	fAttributeCount;
+
+private:
+	static const int32	kMaxDepth = 1024;
+
+	void* _CurrentToken() const
+	{
+		if (fDepth == 0 || fDepth > kMaxDepth)
+			return NULL;
+		return fTokens[fDepth - 1];
+	}
+
+private:
+	uint64	fNextToken;
+	int32	fDepth;
+	bool	fConsistent;
+	void*	fTokens[kMaxDepth];
+};
+
+
+static void
+collect_packages(const char* path, BStringList& _packages)
+{
+	struct stat st;
+	if (stat(path, &st) != 0) {
+		fprintf(stderr, "Error: Failed to stat \"%s\": %s\n", path,
+			strerror(errno));
+		exit(1);
+	}
+
+	if (!S_ISDIR(st.st_mode)) {
+		_packages.Add(path);
+		return;
+	}
+
+	DIR* dir = opendir(path);
+	if (dir == NULL) {
+		fprintf(stderr, "Error: Failed to open directory \"%s\": %s\n", path,
+			strerror(errno));
+		exit(1);
+	}
+
+	while (dirent* entry = readdir(dir)) {
+		size_t length = strlen(entry->d_name);
+		if (length > 5 && strcmp(entry->d_name + length - 5, ".hpkg") == 0) {
+			BString entryPath(path);
+			entryPath << '/' << entry->d_name;
+			_packages.Add(entryPath);
+		}
+	}
+
+	closedir(dir);
+}
+
+
+/*!	Reads the whole file \a path into a newly allocated buffer, which the
+	caller needs to free().
+*/
+static uint8*
+load_package(const char* path, off_t& _size)
+{
+	BFile file;
+	if (file.SetTo(path, B_READ_ONLY) != B_OK || file.GetSize(&_size) != B_OK
+		|| _size <= 0) {
+		return NULL;
+	}
+
+	uint8* data = (uint8*)malloc(_size);
+	if (data != NULL && file.ReadAtExactly(0, data, _size) != B_OK) {
+		free(data);
+		return NULL;
+	}
+
+	return data;
+}
+
+
+static status_t
+read_package(const char* path, const uint8* data, off_t size, bool lowLevel,
+	uint64& _attributeCount, uint64& _entryCount)
+{
+	BStandardErrorOutput errorOutput;
+	BPackageReader reader(&errorOutput);
+	BMemoryIO io(data, size);
+	status_t error = data != NULL ? reader.Init(&io, false) : reader.Init(path);
+	if (error != B_OK)
+		return error;
+
+	if (lowLevel) {
+		LowLevelContentHandler handler;
+		error = reader.ParseContent(&handler);
+		if (error == B_OK && !handler.Consistent()) {
+			fprintf(stderr, "Error: Inconsistent low level attribute "
+				"notifications for \"%s\"\n", path);
+			error = B_ERROR;
+		}
+		_attributeCount += handler.fAttributeCount;
+	} else {
+		ContentHandler handler;
+		error = reader.ParseContent(&handler);
+		_attributeCount += handler.fAttributeCount
+			+ handler.fPackageAttributeCount;
+		_entryCount += handler.fEntryCount;
+	}
+
+	return error;
+}
+
+
+static bool
+fuzz_package(const char* path, int32 count)
+{
+	off_t size;
+	uint8* original = load_package(path, size);
+	uint8* data = original != NULL ? (uint8*)malloc(size) : NULL;
+	if (data == NULL) {
+		fprintf(stderr, "Error: Failed to read \"%s\"\n", path);
+		free(original);
+		free(data);
+		return false;
+	}
+
+	int32 accepted = 0;
+	for (int32 i = 0; i < count; i++) {
+		memcpy(data, original, size);
+
+		// flip a few random bytes
+		int32 byteCount = 1 + rand() % 8;
+		for (int32 k = 0; k < byteCount; k++)
+			data[(((off_t)rand() << 31) ^ rand()) % size] ^= 1 + rand() % 255;
+
+		BNoErrorOutput errorOutput;
+		BPackageReader reader(&errorOutput);
+		BMemoryIO io(data, size);
+		if (reader.Init(&io, false) != B_OK)
+			continue;
+
+		ContentHandler handler;
+		LowLevelContentHandler lowLevelHandler;
+		if (reader.ParseContent(&handler) == B_OK
+			&& reader.ParseContent(&lowLevelHandler) == B_OK) {
+			accepted++;
+		}
+	}
+
+	printf("%s: %" B_PRId32 " of %" B_PRId32 " corrupted copies accepted\n",
+		path, accepted, count);
+
+	free(original);
+	free(data);
+	return true;
+}
+
+
+int
+main(int argc, const char* const* argv)
+{
+	sProgramName = argv[0];
+
+	int32 iterations = 10;
+	int32 fuzzCount = 0;
+	bool inMemory = false;
+
+	int argi = 1;
+	for (; argi < argc; argi++) {
+		const char* arg = argv[argi];
+		if (arg[0] != '-')
+			break;
+
+		if (strcmp(arg, "-n") == 0 && argi + 1 < argc) {
+			iterations = atoi(argv[++argi]);
+		} else if (strcmp(arg, "-f") == 0 && argi + 1 < argc) {
+			fuzzCount = atoi(argv[++argi]);
+		} else if (strcmp(arg, "-m") == 0) {
+			inMemory = true;
+		} else if (strcmp(arg, "-h") == 0) {
+			print_usage_and_exit(false);
+		} else
+			print_usage_and_exit(true);
+	}
+
+	if (argi == argc || iterations < 1 || fuzzCount < 0)
+		print_usage_and_exit(true);
+
+	BStringList packages;
+	for (; argi < argc; argi++)
+		collect_packages(argv[argi], packages);
+
+	int32 packageCount = packages.CountStrings();
+	if (packageCount == 0) {
+		fprintf(stderr, "Error: No package files found\n");
+		return 1;
+	}
+
+	uint8** packageData = new(std::nothrow) uint8*[packageCount];
+	off_t* packageSizes = new(std::nothrow) off_t[packageCount];
+	if (packageData == NULL || packageSizes == NULL) {
+		fprintf(stderr, "Error: Out of memory\n");
+		return 1;
+	}
+
+	for (int32 k = 0; k < packageCount; k++) {
+		packageData[k] = NULL;
+		packageSizes[k] = 0;
+		if (!inMemory)
+			continue;
+
+		packageData[k] = load_package(packages.StringAt(k), packageSizes[k]);
+		if (packageData[k] == NULL) {
+			fprintf(stderr, "Error: Failed to read \"%s\"\n",
+				packages.StringAt(k).String());
+			return 1;
+		}
+	}
+
+	printf("%" B_PRId32 " package(s), %" B_PRId32 " iteration(s)%s\n\n",
+		packageCount, iterations, inMemory ? ", from memory" : "");
+	printf("handler      entries  attributes      total   per package"
+		"  per attribute\n");
+
+	for (int32 lowLevel = 0; lowLevel < 2; lowLevel++) {
+		uint64 attributeCount = 0;
+		uint64 entryCount = 0;
+		bigtime_t startTime = system_time();
+
+		for (int32 i = 0; i < iterations; i++) {
+			for (int32 k = 0; k < packageCount; k++) {
+				const char* path = packages.StringAt(k);
+				status_t error = read_package(path, packageData[k],
+					packageSizes[k], lowLevel != 0, attributeCount, entryCount);
+				if (error != B_OK) {
+					fprintf(stderr, "Error: Failed to read \"%s\": %s\n", path,
+						strerror(error));
+					return 1;
+				}
+			}
+		}
+
+		bigtime_t time = system_time() - startTime;
+		printf("%-9s %10" B_PRIu64 " %11" B_PRIu64 " %9.3fs %11.1fus"
+			" %12.1fns\n",
+			lowLevel != 0 ? "low level" : "high level", entryCount / iterations,
+			attributeCount / iterations, time / 1000000.0,
+			(double)time / iterations / packageCount,
+			attributeCount > 0 ? time * 1000.0 / attributeCount : 0.0);
+	}
+
+	for (int32 k = 0; k < packageCount; k++)
+		free(packageData[k]);
+	delete[] packageData;
+	delete[] packageSizes;
+
+	if (fuzzCount > 0) {
+		printf("\n");
+		srand(42);
+		for (int32 k = 0; k < packageCount; k++) {
+			if (!fuzz_package(packages.StringAt(k), fuzzCount))
+				return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,293 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Creates deltas between pairs of files in a scratch directory and checks
+	that applying them reproduces the target files byte for byte, that they
+	refuse to apply to anything but their base, and that corrupt deltas are
+	rejected.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Directory.h>
+#include <Entry.h>
+#include <File.h>
+#include <String.h>
+
+#include <package/ChecksumAccessors.h>
+#include <package/PackageDelta.h>
+
+
+using BPackageKit::BPrivate::GeneralFileChecksumAccessor;
+using BPackageKit::BPrivate::PackageDelta;
+
+
+static const size_t kBaseSize = 512 * 1024;
+static const size_t kTailSize = 100;
+	// literal data the target ends with, so that the delta does as well
+
+
+static int32 sFailed = 0;
+
+
+static void
+check(status_t error, const char* what)
+{
+	if (error != B_OK) {
+		fprintf(stderr, "Error: %s: %s\n", what, strerror(error));
+		exit(1);
+	}
+}
+
+
+static void
+expect(status_t error, status_t expected, const char* what)
+{
+	if (error != expected) {
+		fprintf(stderr, "%s: got \"%s\", expected \"%s\"\n", what,
+			strerror(error), strerror(expected));
+		sFailed++;
+	}
+}
+
+
+static void
+random_fill(uint8* data, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+		data[i] = rand();
+}
+
+
+static void
+write_file(const BEntry& entry, const uint8* data, size_t size)
+{
+	BFile file(&entry, B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	check(file.InitCheck(), "create file");
+	if (file.Write(data, size) != (ssize_t)size)
+		check(B_IO_ERROR, "write file");
+}
+
+
+static BString
+checksum_of(const BEntry& entry)
+{
+	BString checksum;
+	check(GeneralFileChecksumAccessor(entry).GetChecksum(checksum),
+		"compute checksum");
+	return checksum;
+}
+
+
+/*!	Creates the delta from \a base to \a target, and checks that it can be
+	read back and turns \a base into \a target.
+*/
+static void
+test_round_trip(const char* name, const BEntry& base, const BEntry& target,
+	const BEntry& delta, const BEntry& result, bool expectCopies)
+{
+	PackageDelta created;
+	check(created.Create(base, target, delta), "create delta");
+
+	if (expectCopies && created.CopiedSize() == 0) {
+		fprintf(stderr, "%s: nothing has been copied from the base\n", name);
+		sFailed++;
+	}
+
+	PackageDelta read;
+	check(read.SetTo(delta), "read delta");
+	if (read.BaseChecksum() != checksum_of(base)
+		|| read.TargetChecksum() != checksum_of(target)
+		|| read.BaseSize() != created.BaseSize()
+		|| read.TargetSize() != created.TargetSize()) {
+		fprintf(stderr, "%s: delta header doesn't match the files\n", name);
+		sFailed++;
+	}
+
+	expect(read.Apply(base, result), B_OK, name);
+	if (checksum_of(result) != checksum_of(target)) {
+		fprintf(stderr, "%s: file rebuilt from delta differs\n", name);
+		sFailed++;
+	}
+
+	off_t deltaSize;
+	delta.GetSize(&deltaSize);
+	printf("%s: delta %" B_PRIdOFF " bytes, %" B_PRIdOFF " of %" B_PRIdOFF
+		" bytes copied\n", name, deltaSize, created.CopiedSize(),
+		created.TargetSize());
+}
+
+
+/*!	Inverts the bits \a mask of the byte at \a offset of \a entry, and
+	changes its size to \a size, if that is not zero. Negative values count
+	from the end of the file.
+*/
+static void
+damage_file(const BEntry& entry, off_t offset, uint8 mask, off_t size)
+{
+	BFile file(&entry, B_READ_WRITE);
+	check(file.InitCheck(), "open file");
+
+	off_t fileSize;
+	check(file.GetSize(&fileSize), "get file size");
+
+	if (mask != 0) {
+		if (offset < 0)
+			offset += fileSize;
+
+		uint8 value;
+		if (file.ReadAt(offset, &value, 1) != 1)
+			check(B_IO_ERROR, "read file");
+		value ^= mask;
+		if (file.WriteAt(offset, &value, 1) != 1)
+			check(B_IO_ERROR, "write file");
+	}
+
+	if (size != 0)
+		check(file.SetSize(size < 0 ? fileSize + size : size), "resize file");
+}
+
+
+static void
+copy_file(const BEntry& from, const BEntry& to)
+{
+	BFile source(&from, B_READ_ONLY);
+	check(source.InitCheck(), "open file");
+
+	off_t size;
+	check(source.GetSize(&size), "get file size");
+
+	uint8* data = (uint8*)malloc(size);
+	if (data == NULL)
+		check(B_NO_MEMORY, "copy file");
+	if (source.ReadAt(0, data, size) != size)
+		check(B_IO_ERROR, "read file");
+
+	write_file(to, data, size);
+	free(data);
+}
+
+
+/*!	Damages copies of the valid delta \a delta in several ways, and checks
+	that they are rejected.
+*/
+static void
+test_corrupt_deltas(const BEntry& base, const BEntry& delta,
+	const BEntry& corrupt, const BEntry& result)
+{
+	static const struct {
+		const char*	name;
+		off_t		offset;
+		uint8		mask;
+		off_t		size;
+		status_t	setToError;
+		status_t	applyError;
+	} kTests[] = {
+		// the header starts with the magic
+		{"bad magic", 0, 0xff, 0, B_BAD_DATA, B_NO_INIT},
+		{"truncated header", 0, 0, 100, B_BAD_DATA, B_NO_INIT},
+		// the first operation follows the 152 bytes of the header
+		{"unknown operation", 152, 0x7c, 0, B_OK, B_BAD_DATA},
+		// the last byte of the literal tail, before the end operation
+		{"damaged data", -2, 0xff, 0, B_OK, B_BAD_DATA},
+		{"missing end", 0, 0, -1, B_OK, B_BAD_DATA},
+	};
+
+	for (size_t i = 0; i < sizeof(kTests) / sizeof(kTests[0]); i++) {
+		copy_file(delta, corrupt);
+		damage_file(corrupt, kTests[i].offset, kTests[i].mask,
+			kTests[i].size);
+
+		PackageDelta damaged;
+		expect(damaged.SetTo(corrupt), kTests[i].setToError, kTests[i].name);
+		expect(damaged.Apply(base, result), kTests[i].applyError,
+			kTests[i].name);
+	}
+}
+
+
+int
+main(int argc, const char* const* argv)
+{
+	const char* directoryPath = argc > 1 ? argv[1] : "/tmp";
+	BDirectory directory(directoryPath);
+	check(directory.InitCheck(), "open scratch directory");
+
+	BEntry baseEntry(&directory, "package-delta-test.base");
+	BEntry targetEntry(&directory, "package-delta-test.target");
+	BEntry deltaEntry(&directory, "package-delta-test.delta");
+	BEntry resultEntry(&directory, "package-delta-test.result");
+	BEntry corruptEntry(&directory, "package-delta-test.corrupt");
+
+	srand(47);
+
+	// The target changes a few bytes of the base, inserts and removes some
+	// data, and gets a new tail
+	uint8* base = (uint8*)malloc(kBaseSize);
+	uint8* target = (uint8*)malloc(kBaseSize + 4096 + kTailSize);
+	if (base == NULL || target == NULL)
+		check(B_NO_MEMORY, "allocate files");
+
+	random_fill(base, kBaseSize);
+
+	size_t targetSize = 0;
+	memcpy(target, base, 100000);
+	targetSize += 100000;
+	target[5000] ^= 0xff;
+	random_fill(target + targetSize, 4096);
+	targetSize += 4096;
+	memcpy(target + targetSize, base + 100000, 300000);
+	targetSize += 300000;
+	memcpy(target + targetSize, base + 420000, kBaseSize - 420000);
+	targetSize += kBaseSize - 420000;
+	random_fill(target + targetSize, kTailSize);
+	targetSize += kTailSize;
+
+	write_file(baseEntry, base, kBaseSize);
+	write_file(targetEntry, target, targetSize);
+
+	test_round_trip("changed file", baseEntry, targetEntry, deltaEntry,
+		resultEntry, true);
+
+	// the delta must refuse to apply to anything but its base
+	PackageDelta delta;
+	check(delta.SetTo(deltaEntry), "read delta");
+	expect(delta.Apply(targetEntry, resultEntry), B_MISMATCHED_VALUES,
+		"wrong base");
+
+	test_corrupt_deltas(baseEntry, deltaEntry, corruptEntry, resultEntry);
+
+	// files smaller than a block can only be transferred literally
+	write_file(baseEntry, base, 100);
+	write_file(targetEntry, target + 50, 200);
+	test_round_trip("small file", baseEntry, targetEntry, deltaEntry,
+		resultEntry, false);
+
+	// an empty target
+	write_file(targetEntry, target, 0);
+	test_round_trip("empty file", baseEntry, targetEntry, deltaEntry,
+		resultEntry, false);
+
+	free(base);
+	free(target);
+
+	baseEntry.Remove();
+	targetEntry.Remove();
+	deltaEntry.Remove();
+	resultEntry.Remove();
+	corruptEntry.Remove();
+
+	if (sFailed > 0) {
+		fprintf(stderr, "%" B_PRId32 " checks failed.\n", sFailed);
+		return 1;
+	}
+
+	printf("All tests passed.\n");
+	return 0;
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Writes two versions of a synthetic repository into a scratch directory,
+	creates the delta between them and checks that applying the delta to the
+	older version reproduces the newer one byte for byte. The scratch
+	directory stands in for a repository server.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Directory.h>
+#include <Entry.h>
+#include <Path.h>
+#include <String.h>
+
+#include <package/ChecksumAccessors.h>
+#include <package/hpkg/RepositoryWriter.h>
+#include <package/hpkg/StandardErrorOutput.h>
+#include <package/PackageInfo.h>
+#include <package/RepositoryDelta.h>
+#include <package/RepositoryInfo.h>
+
+
+using namespace BPackageKit;
+using namespace BPackageKit::BHPKG;
+using BPackageKit::BPrivate::GeneralFileChecksumAccessor;
+using BPackageKit::BPrivate::RepositoryDelta;
+
+
+static const int32 kPackageCount = 200;
+
+
+struct RepositoryWriterListener : BRepositoryWriterListener {
+	virtual void PrintErrorVarArgs(const char* format, va_list args)
+	{
+		vfprintf(stderr, format, args);
+	}
+
+	virtual void OnPackageAdded(const BPackageInfo& packageInfo)
+	{
+	}
+
+	virtual void OnRepositoryInfoSectionDone(uint32 uncompressedSize)
+	{
+	}
+
+	virtual void OnPackageAttributesSectionDone(uint32 stringCount,
+		uint32 uncompressedSize)
+	{
+	}
+
+	virtual void OnRepositoryDone(uint32 headerSize, uint32 repositoryInfoSize,
+		uint32 licenseCount, uint32 packageCount, uint32 packageAttributesSize,
+		uint64 totalSize)
+	{
+	}
+};
+
+
+static void
+check(status_t error, const char* what)
+{
+	if (error != B_OK) {
+		fprintf(stderr, "Error: %s: %s\n", what, strerror(error));
+		exit(1);
+	}
+}
+
+
+static void
+make_package_info(BPackageInfo& info, int32 index, int32 revision)
+{
+	BString name = BString("pkg") << index;
+	info.SetName(name);
+	info.SetSummary(BString("Summary of ") << name);
+	info.SetDescription(BString("Description of ") << name);
+	info.SetVendor("Haiku Project");
+	info.SetPackager("repository_delta_test");
+	info.SetArchitecture(B_PACKAGE_ARCHITECTURE_X86_64);
+	info.SetVersion(BPackageVersion(BString() << 1 + index % 7,
+		BString() << index % 10, "", "", revision));
+	info.SetChecksum(BString().SetToFormat("%064" B_PRIx32, index * 31
+		+ revision));
+	info.AddCopyright("2026 Haiku, Inc.");
+	info.AddLicense("MIT");
+}
+
+
+static void
+write_repository(const BEntry& entry, int32 firstPackage, int32 lastPackage,
+	int32 updateModulo)
+{
+	BRepositoryInfo repositoryInfo;
+	repositoryInfo.SetName("delta-test");
+	repositoryInfo.SetIdentifier("tag:haiku-os.org,2026:delta-test");
+	repositoryInfo.SetBaseURL("file:///boot/system/cache/delta-test");
+	repositoryInfo.SetVendor("Haiku Project");
+	repositoryInfo.SetSummary("Repository delta test");
+	repositoryInfo.SetPriority(1);
+	repositoryInfo.SetArchitecture(B_PACKAGE_ARCHITECTURE_X86_64);
+	check(repositoryInfo.AddLicense("MIT", "MIT license text"), "add license");
+
+	BPath path;
+	check(entry.GetPath(&path), "get repository path");
+
+	RepositoryWriterListener listener;
+	BRepositoryWriter writer(&listener, &repositoryInfo);
+	check(writer.Init(path.Path()), "init repository writer");
+
+	for (int32 i = firstPackage; i <= lastPackage; i++) {
+		BPackageInfo info;
+		make_package_info(info, i,
+			updateModulo > 0 && i % updateModulo == 0 ? 2 : 1);
+		check(writer.AddPackageInfo(info), "add package info");
+	}
+
+	check(writer.Finish(), "finish repository");
+}
+
+
+static BString
+checksum_of(const BEntry& entry)
+{
+	BString checksum;
+	check(GeneralFileChecksumAccessor(entry).GetChecksum(checksum),
+		"compute checksum");
+	return checksum;
+}
+
+
+int
+main(int argc, const char* const* argv)
+{
+	const char* directoryPath = argc > 1 ? argv[1] : "/tmp";
+	BDirectory directory(directoryPath);
+	check(directory.InitCheck(), "open scratch directory");
+
+	BEntry baseEntry(&directory, "delta-test-repo.base");
+	BEntry targetEntry(&directory, "delta-test-repo.target");
+	BEntry deltaEntry(&directory, "delta-test-repo.delta");
+	BEntry resultEntry(&directory, "delta-test-repo.result");
+
+	// the new version drops the first ten packages, updates every twentieth
+	// one and adds another ten
+	write_repository(baseEntry, 0, kPackageCount - 1, 0);
+	write_repository(targetEntry, 10, kPackageCount + 9, 20);
+
+	RepositoryDelta delta;
+	check(delta.Create(baseEntry, targetEntry), "create delta");
+	check(delta.WriteToFile(deltaEntry), "write delta");
+
+	int32 expectedAddedCount = 0;
+	for (int32 i = 10; i < kPackageCount + 10; i++) {
+		if (i >= kPackageCount || i % 20 == 0)
+			expectedAddedCount++;
+	}
+
+	RepositoryDelta readDelta;
+	check(readDelta.ReadFromFile(deltaEntry), "read delta");
+	if (readDelta.CountPackages() != kPackageCount
+		|| readDelta.CountAddedPackages() != expectedAddedCount) {
+		fprintf(stderr, "Error: unexpected delta: %" B_PRId32 " packages, %"
+			B_PRId32 " added\n", readDelta.CountPackages(),
+			readDelta.CountAddedPackages());
+		return 1;
+	}
+
+	BStandardErrorOutput errorOutput;
+	check(readDelta.Apply(baseEntry, resultEntry, &errorOutput),
+		"apply delta");
+	if (checksum_of(resultEntry) != checksum_of(targetEntry)) {
+		fprintf(stderr, "Error: repository rebuilt from delta differs\n");
+		return 1;
+	}
+
+	// the delta must refuse to apply to anything but its base
+	if (readDelta.Apply(targetEntry, resultEntry, &errorOutput)
+			!= B_MISMATCHED_VALUES) {
+		fprintf(stderr, "Error: delta applied to the wrong base\n");
+		return 1;
+	}
+
+	off_t repositorySize;
+	off_t deltaSize;
+	targetEntry.GetSize(&repositorySize);
+	deltaEntry.GetSize(&deltaSize);
+	printf("delta: %" B_PRIdOFF " bytes, repository: %" B_PRIdOFF " bytes\n",
+		deltaSize, repositorySize);
+
+	baseEntry.Remove();
+	targetEntry.Remove();
+	deltaEntry.Remove();
+	resultEntry.Remove();
+
+	return 0;
+}
@@ -1,12 +1,25 @@
 /*
  * Copyright 2008, Ingo Weinhold, ingo_weinhold@gmx.de.
+ * Copyright 2026, Haiku, Inc. All rights reserved.
  * Distributed under the terms of the MIT License.
  */
 
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include <OS.h>
+#include <fs_volume.h>
+
+
+static const char* const kTestDirectory = "/tmp/path_resolution_test";
+
+static int32 sFailed = 0;
+static volatile bool sStopChurn = false;
 
 
 static void
@@ -27,9 +40,158 @@ time_lstat(const char* path)
 }
 
 
+/*!	Looks up \a path a few times, so that the path cache gets to know it, and
+	checks that it exists or not, as given by \a exists.
+*/
+static void
+check_path(const char* what, const char* path, bool exists)
+{
+	for (int32 i = 0; i < 3; i++) {
+		struct stat st;
+		bool found = lstat(path, &st) == 0;
+		if (found != exists) {
+			fprintf(stderr, "%s: \"%s\" should %sexist\n", what, path,
+				exists ? "" : "not ");
+			sFailed++;
+			return;
+		}
+	}
+}
+
+
+static void
+create_file(const char* path)
+{
+	int fd = open(path, O_CREAT | O_WRONLY, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "Could not create \"%s\": %s\n", path,
+			strerror(errno));
+		sFailed++;
+		return;
+	}
+	close(fd);
+}
+
+
+static void
+make_path(char* buffer, size_t size, const char* path)
+{
+	snprintf(buffer, size, "%s/%s", kTestDirectory, path);
+}
+
+
+/*!	Changes the name space under paths that have just been looked up, and
+	verifies that the results of the path cache follow.
+*/
+static void
+test_invalidation()
+{
+	char path[B_PATH_NAME_LENGTH];
+	char otherPath[B_PATH_NAME_LENGTH];
+
+	mkdir(kTestDirectory, 0755);
+	make_path(path, sizeof(path), "a");
+	mkdir(path, 0755);
+	make_path(path, sizeof(path), "a/b");
+	mkdir(path, 0755);
+	make_path(path, sizeof(path), "a/b/file");
+	create_file(path);
+
+	// rename a directory on the path
+	check_path("rename", path, true);
+	make_path(otherPath, sizeof(otherPath), "a/b");
+	make_path(path, sizeof(path), "a/c");
+	rename(otherPath, path);
+	make_path(path, sizeof(path), "a/b/file");
+	check_path("rename", path, false);
+	make_path(path, sizeof(path), "a/c/file");
+	check_path("rename", path, true);
+
+	// unlink the leaf
+	unlink(path);
+	check_path("unlink", path, false);
+
+	// create an entry that has been looked up before
+	make_path(path, sizeof(path), "a/c/new");
+	check_path("create", path, false);
+	create_file(path);
+	check_path("create", path, true);
+	unlink(path);
+
+	// move the directory a relative path starts in, so that its ".." changes
+	make_path(path, sizeof(path), "a/marker");
+	create_file(path);
+	make_path(path, sizeof(path), "d");
+	mkdir(path, 0755);
+	make_path(path, sizeof(path), "a/c");
+	char cwd[B_PATH_NAME_LENGTH];
+	if (getcwd(cwd, sizeof(cwd)) != NULL && chdir(path) == 0) {
+		check_path("move", "../marker", true);
+		make_path(otherPath, sizeof(otherPath), "d/c");
+		rename(path, otherPath);
+		check_path("move", "../marker", false);
+		chdir(cwd);
+		rmdir(otherPath);
+	}
+	make_path(path, sizeof(path), "a/marker");
+	unlink(path);
+
+	// mount a volume over a directory on the path
+	make_path(path, sizeof(path), "a/mount");
+	mkdir(path, 0755);
+	make_path(otherPath, sizeof(otherPath), "a/mount/file");
+	create_file(otherPath);
+	check_path("mount", otherPath, true);
+
+	dev_t volume = fs_mount_volume(path, NULL, "ramfs", 0, NULL);
+	if (volume < 0) {
+		printf("Could not mount ramfs, skipping the mount test: %s\n",
+			strerror(volume));
+	} else {
+		check_path("mount", otherPath, false);
+		fs_unmount_volume(path, 0);
+		check_path("unmount", otherPath, true);
+	}
+	unlink(otherPath);
+	rmdir(path);
+
+	make_path(path, sizeof(path), "a");
+	rmdir(path);
+	make_path(path, sizeof(path), "d");
+	rmdir(path);
+}
+
+
+/*!	Keeps creating and removing a file in a directory that none of the timed
+	paths goes through.
+*/
+static void*
+churn_thread(void*)
+{
+	char path[B_PATH_NAME_LENGTH];
+	make_path(path, sizeof(path), "churn");
+
+	while (!sStopChurn) {
+		int fd = open(path, O_CREAT | O_WRONLY, 0644);
+		if (fd >= 0)
+			close(fd);
+		unlink(path);
+	}
+
+	return NULL;
+}
+
+
 int
 main()
 {
+	if (geteuid() != 0) {
+		printf("Not running as root: the path cache is only used for the "
+			"superuser.\n");
+	}
+
+	test_invalidation();
+
 	const char* const paths[] = {
 		"/",
 		"/boot",
@@ -44,5 +206,37 @@ main()
 	for (int32 i = 0; paths[i] != NULL; i++)
 		time_lstat(paths[i]);
 
+	// entries that don't exist, as looked up when searching paths
+	const char* const missingPaths[] = {
+		"/boot/missing",
+		"/boot/develop/missing",
+		"/boot/develop/headers/missing.h",
+		"/boot/develop/headers/posix/missing.h",
+		"/boot/develop/headers/posix/sys/missing.h",
+		NULL
+	};
+
+	for (int32 i = 0; missingPaths[i] != NULL; i++)
+		time_lstat(missingPaths[i]);
+
+	// the same, while entries are removed in an unrelated directory
+	printf("\nwhile %s/churn is created and removed:\n", kTestDirectory);
+
+	pthread_t churnThread;
+	if (pthread_create(&churnThread, NULL, &churn_thread, NULL) == 0) {
+		time_lstat(paths[6]);
+		time_lstat(missingPaths[4]);
+
+		sStopChurn = true;
+		pthread_join(churnThread, NULL);
+	}
+
+	rmdir(kTestDirectory);
+
+	if (sFailed > 0) {
+		fprintf(stderr, "%" B_PRId32 " path checks failed.\n", sFailed);
+		return 1;
+	}
+
 	return 0;
 }
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Lists a directory with readdir(), lstat() and fs_read_attr() for every
+	entry, and with fs_read_dir_stat(), compares the results, and prints the
+	time both needed.
+*/
+
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+
+#include <fs_attr.h>
+#include <fs_dir_stat.h>
+#include <OS.h>
+
+
+static const char* const kAttributes[] = {
+	"BEOS:TYPE",
+	"_trk/pinfo_le"
+};
+static const uint32 kAttributeCount = 2;
+static const size_t kMaxAttributeSize = 256;
+static const size_t kBufferSize = 64 * 1024;
+
+
+struct entry_info {
+	struct stat	stat;
+	ssize_t		attributeSize[kAttributeCount];
+	char		attributeData[kAttributeCount][kMaxAttributeSize];
+};
+
+typedef std::map<std::string, entry_info> EntryMap;
+
+
+static bigtime_t
+read_single(const char* path, EntryMap& entries)
+{
+	bigtime_t start = system_time();
+
+	DIR* dir = opendir(path);
+	if (dir == NULL) {
+		fprintf(stderr, "Could not open \"%s\": %s\n", path, strerror(errno));
+		exit(1);
+	}
+
+	while (dirent* dirent = readdir(dir)) {
+		entry_info& info = entries[dirent->d_name];
+
+		char entryPath[B_PATH_NAME_LENGTH];
+		snprintf(entryPath, sizeof(entryPath), "%s/%s", path, dirent->d_name);
+		if (lstat(entryPath, &info.stat) != 0)
+			continue;
+
+		int fd = open(entryPath, O_RDONLY | O_NOTRAVERSE);
+		for (uint32 i = 0; i < kAttributeCount; i++) {
+			info.attributeSize[i] = fs_read_attr(fd, kAttributes[i], 0, 0,
+				info.attributeData[i], kMaxAttributeSize);
+			if (info.attributeSize[i] < 0)
+				info.attributeSize[i] = -1;
+		}
+		close(fd);
+	}
+
+	closedir(dir);
+	return system_time() - start;
+}
+
+
+static bigtime_t
+read_batched(const char* path, EntryMap& entries)
+{
+	bigtime_t start = system_time();
+
+	int fd = open(path, O_RDONLY | O_DIRECTORY);
+	if (fd < 0) {
+		fprintf(stderr, "Could not open \"%s\": %s\n", path, strerror(errno));
+		exit(1);
+	}
+
+	dir_stat_entry* buffer = (dir_stat_entry*)malloc(kBufferSize);
+
+	while (true) {
+		ssize_t count = fs_read_dir_stat(fd, kAttributes, kAttributeCount,
+			kMaxAttributeSize, buffer, kBufferSize, INT_MAX);
+		if (count < 0) {
+			fprintf(stderr, "fs_read_dir_stat() failed: %s\n",
+				strerror(errno));
+			exit(1);
+		}
+		if (count == 0)
+			break;
+
+		dir_stat_entry* entry = buffer;
+		for (ssize_t i = 0; i < count; i++) {
+			entry_info& info = entries[dir_stat_entry_dirent(entry)->d_name];
+			info.stat = entry->stat;
+
+			for (uint32 j = 0; j < kAttributeCount; j++) {
+				off_t size = entry->attributes[j].size;
+				if (size < 0) {
+					info.attributeSize[j] = -1;
+					continue;
+				}
+				if (size > (off_t)kMaxAttributeSize)
+					size = kMaxAttributeSize;
+				info.attributeSize[j] = size;
+				memcpy(info.attributeData[j],
+					dir_stat_entry_attribute_data(entry, j), size);
+			}
+
+			entry = (dir_stat_entry*)((uint8*)entry + entry->length);
+		}
+	}
+
+	free(buffer);
+	close(fd);
+	return system_time() - start;
+}
+
+
+static bool
+compare(const EntryMap& single, const EntryMap& batched)
+{
+	bool success = true;
+
+	if (single.size() != batched.size()) {
+		fprintf(stderr, "readdir() found %zu entries, fs_read_dir_stat() "
+			"%zu\n", single.size(), batched.size());
+		success = false;
+	}
+
+	EntryMap::const_iterator iterator = single.begin();
+	for (; iterator != single.end(); iterator++) {
+		EntryMap::const_iterator found = batched.find(iterator->first);
+		if (found == batched.end()) {
+			fprintf(stderr, "\"%s\" is missing\n", iterator->first.c_str());
+			success = false;
+			continue;
+		}
+
+		const entry_info& a = iterator->second;
+		const entry_info& b = found->second;
+		if (a.stat.st_ino != b.stat.st_ino || a.stat.st_dev != b.stat.st_dev
+			|| a.stat.st_size != b.stat.st_size
+			|| a.stat.st_mode != b.stat.st_mode) {
+			fprintf(stderr, "\"%s\": stat differs\n", iterator->first.c_str());
+			success = false;
+		}
+
+		for (uint32 i = 0; i < kAttributeCount; i++) {
+			if (a.attributeSize[i] != b.attributeSize[i]
+				|| (a.attributeSize[i] > 0 && memcmp(a.attributeData[i],
+					b.attributeData[i], a.attributeSize[i]) != 0)) {
+				fprintf(stderr, "\"%s\": attribute \"%s\" differs\n",
+					iterator->first.c_str(), kAttributes[i]);
+				success = false;
+			}
+		}
+	}
+
+	return success;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	const char* path = argc > 1 ? argv[1] : "/boot/system/lib";
+
+	EntryMap single;
+	EntryMap batched;
+	bigtime_t singleTime = read_single(path, single);
+	bigtime_t batchedTime = read_batched(path, batched);
+
+	printf("%zu entries: readdir/lstat/fs_read_attr %" B_PRIdBIGTIME " us, "
+		"fs_read_dir_stat %" B_PRIdBIGTIME " us\n", single.size(), singleTime,
+		batchedTime);
+
+	if (!compare(single, batched))
+		return 1;
+
+	printf("All tests passed.\n");
+	return 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Verifies that all checksum routines of the network stack the CPU supports
+	compute the same results as the generic one, and measures their speed.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include "checksum.h"
+
+
+static const size_t kMaxSize = 65536;
+static const size_t kTestSizes[] = {
+	0, 1, 2, 3, 7, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 255, 1023, 1460,
+	1500, 4096, 9000, 65535
+};
+static const size_t kBenchmarkSizes[] = { 64, 576, 1500, 9000, 65536 };
+
+
+static bool
+verify(const checksum_kernel& kernel, const uint8* data, uint8* copy)
+{
+	const checksum_kernel& generic = gChecksumKernels[0];
+
+	for (size_t i = 0; i < B_COUNT_OF(kTestSizes); i++) {
+		size_t size = kTestSizes[i];
+
+		for (size_t alignment = 0; alignment < 16; alignment++) {
+			uint16 expected = generic.checksum(data + alignment, size);
+
+			uint16 sum = kernel.checksum(data + alignment, size);
+			if (sum != expected) {
+				fprintf(stderr, "%s: checksum of %zu bytes at offset %zu is "
+					"%#x, expected %#x\n", kernel.name, size, alignment, sum,
+					expected);
+				return false;
+			}
+
+			memset(copy, 0, kMaxSize + 32);
+			sum = kernel.copy_and_checksum(copy + 15 - alignment,
+				data + alignment, size);
+			if (sum != expected
+				|| memcmp(copy + 15 - alignment, data + alignment, size) != 0) {
+				fprintf(stderr, "%s: copy and checksum of %zu bytes at offset "
+					"%zu failed\n", kernel.name, size, alignment);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+static void
+benchmark(const checksum_kernel& kernel, const uint8* data, uint8* copy)
+{
+	for (size_t i = 0; i < B_COUNT_OF(kBenchmarkSizes); i++) {
+		size_t size = kBenchmarkSizes[i];
+		uint32 rounds = 256 * 1024 * 1024 / size;
+
+		volatile uint16 sink = 0;
+		bigtime_t start = system_time();
+		for (uint32 round = 0; round < rounds; round++)
+			sink += kernel.checksum(data, size);
+		bigtime_t checksumTime = system_time() - start;
+
+		start = system_time();
+		for (uint32 round = 0; round < rounds; round++)
+			sink += kernel.copy_and_checksum(copy, data, size);
+		bigtime_t copyTime = system_time() - start;
+
+		printf("%-8s %6zu bytes: checksum %8.1f MB/s, copy+checksum "
+			"%8.1f MB/s\n", kernel.name, size,
+			1.0 * size * rounds / checksumTime,
+			1.0 * size * rounds / copyTime);
+	}
+}
+
+
+int
+main(int argc, char** argv)
+{
+	uint8* data = (uint8*)malloc(kMaxSize + 32);
+	uint8* copy = (uint8*)malloc(kMaxSize + 32);
+	if (data == NULL || copy == NULL) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	srand(42);
+	for (size_t i = 0; i < kMaxSize + 32; i++)
+		data[i] = rand();
+
+	// make sure carries are handled correctly as well
+	memset(data + kMaxSize / 2, 0xff, kMaxSize / 2);
+
+	bool success = true;
+	for (uint32 i = 0; i < gChecksumKernelCount; i++) {
+		const checksum_kernel& kernel = gChecksumKernels[i];
+		if (!kernel.is_supported()) {
+			printf("%s: not supported\n", kernel.name);
+			continue;
+		}
+
+		if (!verify(kernel, data, copy)) {
+			success = false;
+			continue;
+		}
+
+		benchmark(kernel, data, copy);
+	}
+
+	select_checksum_kernel();
+	printf("selected: %s\n", current_checksum_kernel()->name);
+
+	free(data);
+	free(copy);
+
+	if (!success)
+		return 1;
+
+	printf("All tests passed.\n");
+	return 0;
+}
@@ -0,0 +1,336 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Verifies the network stack's ForwardingTable against a brute force
+	longest prefix match, and measures its load and lookup speed with an
+	IPv4 table of the size of the full internet routing table, and an IPv6
+	table of random prefixes.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include "fib.h"
+
+
+static const uint32 kFullTableSize = 950000;
+static const uint32 kIPv6TableSize = 200000;
+static const uint32 kVerifyTableSize = 4000;
+static const uint32 kVerifyLookups = 20000;
+static const uint32 kBenchmarkLookups = 20000000;
+
+
+struct test_route {
+	uint8	length;
+	uint8	prefix[16];
+	bool	removed;
+} _ALIGNED(8);
+
+
+static uint8
+route_prefix_length(const void* value)
+{
+	return ((const test_route*)value)->length;
+}
+
+
+static void
+mask_prefix(uint8* prefix, uint8 length, uint32 bytes)
+{
+	for (uint32 i = 0; i < bytes; i++) {
+		if (length >= (i + 1) * 8)
+			continue;
+		if (length <= i * 8)
+			prefix[i] = 0;
+		else
+			prefix[i] &= 0xff << (8 - (length - i * 8));
+	}
+}
+
+
+static bool
+prefix_matches(const test_route& route, const uint8* address)
+{
+	uint8 masked[16];
+	memcpy(masked, address, sizeof(masked));
+	mask_prefix(masked, route.length, sizeof(masked));
+	return memcmp(masked, route.prefix, (route.length + 7) / 8) == 0;
+}
+
+
+/*!	Picks prefix lengths roughly like they are distributed in the global
+	IPv4 routing table: most of them are /24, followed by /22, /23, /20.
+*/
+static uint8
+random_ipv4_length()
+{
+	uint32 value = rand() % 100;
+	if (value < 58)
+		return 24;
+	if (value < 70)
+		return 22;
+	if (value < 80)
+		return 23;
+	if (value < 86)
+		return 20;
+	if (value < 90)
+		return 21;
+	if (value < 93)
+		return 16;
+	if (value < 96)
+		return 19;
+	return 8 + rand() % 25;
+}
+
+
+static test_route*
+create_routes(uint32 count, uint32 addressBytes)
+{
+	test_route* routes = (test_route*)calloc(count, sizeof(test_route));
+	if (routes == NULL)
+		return NULL;
+
+	for (uint32 i = 0; i < count; i++) {
+		test_route& route = routes[i];
+		route.length = addressBytes == 4
+			? random_ipv4_length() : 16 + rand() % 113;
+		for (uint32 j = 0; j < addressBytes; j++)
+			route.prefix[j] = rand();
+		mask_prefix(route.prefix, route.length, addressBytes);
+	}
+
+	// a default route
+	memset(routes[0].prefix, 0, sizeof(routes[0].prefix));
+	routes[0].length = 0;
+
+	return routes;
+}
+
+
+static void
+random_address(const test_route* routes, uint32 count, uint32 addressBytes,
+	uint8* address)
+{
+	const test_route& route = routes[rand() % count];
+	for (uint32 i = 0; i < addressBytes; i++)
+		address[i] = rand();
+
+	// keep the prefix of a random route most of the time
+	if (rand() % 4 != 0) {
+		for (uint32 bit = 0; bit < route.length; bit++) {
+			uint8 mask = 0x80 >> (bit % 8);
+			address[bit / 8] = (address[bit / 8] & ~mask)
+				| (route.prefix[bit / 8] & mask);
+		}
+	}
+}
+
+
+/*!	Returns the route that should win for \a address: the longest matching
+	prefix, and the first one added among equal prefixes.
+*/
+static const test_route*
+brute_force_lookup(const test_route* routes, uint32 count,
+	const uint8* address)
+{
+	const test_route* best = NULL;
+	for (uint32 i = 0; i < count; i++) {
+		const test_route& route = routes[i];
+		if (route.removed || !prefix_matches(route, address))
+			continue;
+		if (best == NULL || route.length > best->length)
+			best = &route;
+	}
+	return best;
+}
+
+
+static const test_route*
+covering_route(const test_route* routes, uint32 count,
+	const test_route& removed)
+{
+	const test_route* best = NULL;
+	for (uint32 i = 0; i < count; i++) {
+		const test_route& route = routes[i];
+		if (route.removed || route.length > removed.length
+			|| !prefix_matches(route, removed.prefix))
+			continue;
+		if (best == NULL || route.length > best->length)
+			best = &route;
+	}
+	return best;
+}
+
+
+static bool
+is_duplicate(const test_route* routes, uint32 index)
+{
+	for (uint32 i = 0; i < index; i++) {
+		if (routes[i].length == routes[index].length
+			&& memcmp(routes[i].prefix, routes[index].prefix, 16) == 0)
+			return true;
+	}
+	return false;
+}
+
+
+static bool
+verify(const char* name, uint32 addressBytes)
+{
+	test_route* routes = create_routes(kVerifyTableSize, addressBytes);
+	if (routes == NULL)
+		return false;
+
+	// The table only keeps the first of equal prefixes, like the stack does
+	for (uint32 i = 0; i < kVerifyTableSize; i++)
+		routes[i].removed = is_duplicate(routes, i);
+
+	ForwardingTable table;
+	if (table.Init(addressBytes * 8, &route_prefix_length) != B_OK)
+		return false;
+
+	for (uint32 i = 0; i < kVerifyTableSize; i++) {
+		if (!routes[i].removed
+			&& table.Insert(routes[i].prefix, routes[i].length, &routes[i])
+				!= B_OK) {
+			fprintf(stderr, "%s: inserting failed\n", name);
+			return false;
+		}
+	}
+
+	for (int pass = 0; pass < 2; pass++) {
+		for (uint32 i = 0; i < kVerifyLookups; i++) {
+			uint8 address[16];
+			random_address(routes, kVerifyTableSize, addressBytes, address);
+
+			int32 cookie = table.EnterRead();
+			void* found = table.Lookup(address);
+			table.ExitRead(cookie);
+
+			if (found != brute_force_lookup(routes, kVerifyTableSize,
+					address)) {
+				fprintf(stderr, "%s: lookup mismatch in pass %d\n", name,
+					pass);
+				return false;
+			}
+		}
+
+		if (pass == 1)
+			break;
+
+		// remove every other route, and check again
+		for (uint32 i = 0; i < kVerifyTableSize; i += 2) {
+			test_route& route = routes[i];
+			if (route.removed)
+				continue;
+
+			route.removed = true;
+			table.Replace(route.prefix, route.length, &route,
+				(void*)covering_route(routes, kVerifyTableSize, route));
+		}
+		table.Synchronize();
+	}
+
+	printf("%s: verified, %zu tables\n", name, table.TableCount());
+
+	// removing everything must leave no tables behind
+	for (uint32 i = 0; i < kVerifyTableSize; i++) {
+		test_route& route = routes[i];
+		if (route.removed)
+			continue;
+
+		route.removed = true;
+		table.Replace(route.prefix, route.length, &route,
+			(void*)covering_route(routes, kVerifyTableSize, route));
+	}
+	table.Synchronize();
+
+	if (table.TableCount() != 0) {
+		fprintf(stderr, "%s: %zu tables left after removing all routes\n",
+			name, table.TableCount());
+		return false;
+	}
+
+	free(routes);
+	return true;
+}
+
+
+static bool
+benchmark(const char* name, uint32 routeCount, uint32 addressBytes)
+{
+	test_route* routes = create_routes(routeCount, addressBytes);
+	if (routes == NULL)
+		return false;
+
+	ForwardingTable table;
+	if (table.Init(addressBytes * 8, &route_prefix_length) != B_OK)
+		return false;
+
+	bigtime_t start = system_time();
+	for (uint32 i = 0; i < routeCount; i++) {
+		if (table.Insert(routes[i].prefix, routes[i].length, &routes[i])
+				!= B_OK) {
+			fprintf(stderr, "out of memory loading the table\n");
+			return false;
+		}
+	}
+	bigtime_t loadTime = system_time() - start;
+
+	printf("loaded %" B_PRIu32 " %s routes in %" B_PRId64 " ms, %zu tables "
+		"(%zu KB)\n", routeCount, name, loadTime / 1000, table.TableCount(),
+		table.MemoryUsage() / 1024);
+
+	const uint32 kAddressCount = 1 << 20;
+	uint8* addresses = (uint8*)malloc(kAddressCount * addressBytes);
+	if (addresses == NULL)
+		return false;
+
+	for (uint32 i = 0; i < kAddressCount; i++) {
+		random_address(routes, routeCount, addressBytes,
+			addresses + i * addressBytes);
+	}
+
+	uint32 found = 0;
+	start = system_time();
+	for (uint32 i = 0; i < kBenchmarkLookups; i++) {
+		int32 cookie = table.EnterRead();
+		if (table.Lookup(addresses + (i % kAddressCount) * addressBytes)
+				!= NULL)
+			found++;
+		table.ExitRead(cookie);
+	}
+	bigtime_t lookupTime = system_time() - start;
+
+	printf("%" B_PRIu32 " lookups in %" B_PRId64 " ms: %.1f million/s (%"
+		B_PRIu32 " found)\n", kBenchmarkLookups, lookupTime / 1000,
+		1.0 * kBenchmarkLookups / lookupTime, found);
+
+	free(addresses);
+	free(routes);
+	return true;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	srand(42);
+
+	if (!verify("IPv4", 4) || !verify("IPv6", 16))
+		return 1;
+
+	if (!benchmark("IPv4", kFullTableSize, 4)
+		|| !benchmark("IPv6", kIPv6TableSize, 16))
+		return 1;
+
+	printf("All tests passed.\n");
+	return 0;
+}
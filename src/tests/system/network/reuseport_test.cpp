@@ -0,0 +1,319 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Opens several TCP and UDP sockets sharing one port via SO_REUSEPORT, and
+	checks that incoming connections and datagrams are distributed among all
+	of them, and that each flow always ends up at the same socket. It also
+	checks that a non-root user can still join a group after one of its
+	members accepted a connection.
+*/
+
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+static const int kMemberCount = 4;
+static const int kFlowCount = 64;
+
+
+/*!	Creates a socket with SO_REUSEPORT set, and binds it to \a port. Returns
+	-1 if binding or listening fails.
+*/
+static int
+try_open_member(int type, uint16_t port)
+{
+	int fd = socket(AF_INET, type, 0);
+	if (fd < 0) {
+		fprintf(stderr, "failed to create socket: %s\n", strerror(errno));
+		exit(1);
+	}
+
+	int enable = 1;
+	if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable))
+			!= 0) {
+		fprintf(stderr, "failed to set SO_REUSEPORT: %s\n", strerror(errno));
+		exit(1);
+	}
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_len = sizeof(address);
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = port;
+	if (bind(fd, (sockaddr*)&address, sizeof(address)) != 0
+		|| (type == SOCK_STREAM && listen(fd, kFlowCount) != 0)) {
+		int error = errno;
+		close(fd);
+		errno = error;
+		return -1;
+	}
+
+	return fd;
+}
+
+
+static int
+open_member(int type, uint16_t port)
+{
+	int fd = try_open_member(type, port);
+	if (fd < 0) {
+		fprintf(stderr, "failed to bind member socket: %s\n",
+			strerror(errno));
+		exit(1);
+	}
+
+	return fd;
+}
+
+
+static uint16_t
+port_of(int fd)
+{
+	sockaddr_in address;
+	socklen_t length = sizeof(address);
+	if (getsockname(fd, (sockaddr*)&address, &length) != 0) {
+		fprintf(stderr, "failed to get socket name: %s\n", strerror(errno));
+		exit(1);
+	}
+	return address.sin_port;
+}
+
+
+/*!	Waits for the next member socket that has something pending, and returns
+	its index, or -1 on timeout.
+*/
+static int
+wait_for_member(const int* members)
+{
+	pollfd fds[kMemberCount];
+	for (int i = 0; i < kMemberCount; i++) {
+		fds[i].fd = members[i];
+		fds[i].events = POLLIN;
+		fds[i].revents = 0;
+	}
+
+	if (poll(fds, kMemberCount, 1000) <= 0)
+		return -1;
+
+	for (int i = 0; i < kMemberCount; i++) {
+		if ((fds[i].revents & POLLIN) != 0)
+			return i;
+	}
+	return -1;
+}
+
+
+static bool
+check_distribution(const char* name, const int* counts)
+{
+	int used = 0;
+	printf("%s:", name);
+	for (int i = 0; i < kMemberCount; i++) {
+		printf(" %d", counts[i]);
+		if (counts[i] > 0)
+			used++;
+	}
+	printf("\n");
+
+	if (used < 2) {
+		fprintf(stderr, "%s: flows were not distributed among the members\n",
+			name);
+		return false;
+	}
+	return true;
+}
+
+
+static bool
+test_tcp()
+{
+	int members[kMemberCount];
+	members[0] = open_member(SOCK_STREAM, 0);
+	uint16_t port = port_of(members[0]);
+	for (int i = 1; i < kMemberCount; i++)
+		members[i] = open_member(SOCK_STREAM, port);
+
+	int counts[kMemberCount] = {};
+
+	for (int flow = 0; flow < kFlowCount; flow++) {
+		int client = socket(AF_INET, SOCK_STREAM, 0);
+
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_len = sizeof(address);
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = port;
+		if (connect(client, (sockaddr*)&address, sizeof(address)) != 0) {
+			fprintf(stderr, "failed to connect: %s\n", strerror(errno));
+			return false;
+		}
+
+		int member = wait_for_member(members);
+		if (member < 0) {
+			fprintf(stderr, "connection was not accepted by any member\n");
+			return false;
+		}
+
+		int connection = accept(members[member], NULL, NULL);
+		if (connection < 0) {
+			fprintf(stderr, "failed to accept: %s\n", strerror(errno));
+			return false;
+		}
+		counts[member]++;
+
+		close(connection);
+		close(client);
+	}
+
+	for (int i = 0; i < kMemberCount; i++)
+		close(members[i]);
+
+	return check_distribution("tcp", counts);
+}
+
+
+/*!	Connections accepted by a listener are bound to its port in the kernel's
+	context. They must still belong to the listener's owner, or else no other
+	socket of a non-root user could join the group afterwards.
+*/
+static bool
+test_tcp_join_after_accept()
+{
+	uid_t previousUser = geteuid();
+	if (previousUser == 0 && seteuid(1000) != 0) {
+		fprintf(stderr, "failed to switch to a non-root user: %s\n",
+			strerror(errno));
+		return false;
+	}
+
+	int listener = open_member(SOCK_STREAM, 0);
+	uint16_t port = port_of(listener);
+
+	int client = socket(AF_INET, SOCK_STREAM, 0);
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_len = sizeof(address);
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = port;
+
+	bool success = true;
+	int connection = -1;
+	if (connect(client, (sockaddr*)&address, sizeof(address)) != 0) {
+		fprintf(stderr, "failed to connect: %s\n", strerror(errno));
+		success = false;
+	} else if ((connection = accept(listener, NULL, NULL)) < 0) {
+		fprintf(stderr, "failed to accept: %s\n", strerror(errno));
+		success = false;
+	}
+
+	if (success) {
+		// the accepted connection is still open while the next member joins
+		int member = try_open_member(SOCK_STREAM, port);
+		if (member < 0) {
+			fprintf(stderr, "joining after accept failed: %s\n",
+				strerror(errno));
+			success = false;
+		} else
+			close(member);
+	}
+
+	if (connection >= 0)
+		close(connection);
+	close(client);
+	close(listener);
+
+	if (previousUser == 0)
+		seteuid(previousUser);
+
+	if (success)
+		printf("tcp join after accept: ok\n");
+	return success;
+}
+
+
+static bool
+test_udp()
+{
+	int members[kMemberCount];
+	members[0] = open_member(SOCK_DGRAM, 0);
+	uint16_t port = port_of(members[0]);
+	for (int i = 1; i < kMemberCount; i++)
+		members[i] = open_member(SOCK_DGRAM, port);
+
+	int counts[kMemberCount] = {};
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_len = sizeof(address);
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = port;
+
+	for (int flow = 0; flow < kFlowCount; flow++) {
+		int client = socket(AF_INET, SOCK_DGRAM, 0);
+
+		// every datagram of a flow must reach the same member
+		int flowMember = -1;
+		for (int i = 0; i < 3; i++) {
+			char data = (char)flow;
+			if (sendto(client, &data, 1, 0, (sockaddr*)&address,
+					sizeof(address)) != 1) {
+				fprintf(stderr, "failed to send: %s\n", strerror(errno));
+				return false;
+			}
+
+			int member = wait_for_member(members);
+			if (member < 0) {
+				fprintf(stderr, "datagram was not received by any member\n");
+				return false;
+			}
+			recv(members[member], &data, 1, 0);
+
+			if (flowMember >= 0 && member != flowMember) {
+				fprintf(stderr, "flow %d moved from member %d to %d\n", flow,
+					flowMember, member);
+				return false;
+			}
+			flowMember = member;
+		}
+		counts[flowMember]++;
+
+		close(client);
+	}
+
+	for (int i = 0; i < kMemberCount; i++)
+		close(members[i]);
+
+	return check_distribution("udp", counts);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	bool success = test_tcp();
+	if (!test_tcp_join_after_accept())
+		success = false;
+	if (!test_udp())
+		success = false;
+
+	if (!success)
+		return 1;
+
+	printf("All tests passed.\n");
+	return 0;
+}
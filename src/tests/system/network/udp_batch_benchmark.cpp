@@ -0,0 +1,258 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures how many datagrams per second can be sent and received over the
+	loopback interface with one syscall per datagram, with sendmmsg() and
+	recvmmsg(), and with UDP_SEGMENT.
+*/
+
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+static const uint32 kDatagramCount = 200000;
+static const uint32 kDatagramSize = 512;
+static const uint32 kBatchSize = 32;
+static const int kIdleTimeout = 500;
+	// in ms
+
+
+enum mode {
+	MODE_SINGLE,
+	MODE_BATCH,
+	MODE_SEGMENT
+};
+
+static const char* kModeNames[] = {
+	"sendto/recvfrom",
+	"sendmmsg/recvmmsg",
+	"UDP_SEGMENT/recvmmsg"
+};
+
+
+struct receiver {
+	int			fd;
+	mode		receiveMode;
+	uint32		received;
+	uint32		badSize;
+	bigtime_t	lastReceived;
+};
+
+
+static int
+open_socket(sockaddr_in& address)
+{
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd < 0) {
+		fprintf(stderr, "failed to create socket: %s\n", strerror(errno));
+		exit(1);
+	}
+
+	memset(&address, 0, sizeof(address));
+	address.sin_len = sizeof(address);
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+		fprintf(stderr, "failed to bind socket: %s\n", strerror(errno));
+		exit(1);
+	}
+
+	socklen_t length = sizeof(address);
+	getsockname(fd, (sockaddr*)&address, &length);
+	return fd;
+}
+
+
+static void*
+receive_thread(void* _data)
+{
+	receiver& data = *(receiver*)_data;
+
+	char buffers[kBatchSize][kDatagramSize + 1];
+	iovec vecs[kBatchSize];
+	mmsghdr messages[kBatchSize];
+	memset(messages, 0, sizeof(messages));
+	for (uint32 i = 0; i < kBatchSize; i++) {
+		vecs[i].iov_base = buffers[i];
+		vecs[i].iov_len = sizeof(buffers[i]);
+		messages[i].msg_hdr.msg_iov = &vecs[i];
+		messages[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	while (data.received < kDatagramCount) {
+		pollfd pollFD = { data.fd, POLLIN, 0 };
+		if (poll(&pollFD, 1, kIdleTimeout) <= 0)
+			break;
+
+		if (data.receiveMode == MODE_SINGLE) {
+			ssize_t bytes = recvfrom(data.fd, buffers[0], sizeof(buffers[0]),
+				MSG_DONTWAIT, NULL, NULL);
+			if (bytes < 0)
+				continue;
+			if ((uint32)bytes != kDatagramSize)
+				data.badSize++;
+			data.received++;
+		} else {
+			int count = recvmmsg(data.fd, messages, kBatchSize, MSG_DONTWAIT,
+				NULL);
+			if (count < 0)
+				continue;
+			for (int i = 0; i < count; i++) {
+				if (messages[i].msg_len != kDatagramSize)
+					data.badSize++;
+			}
+			data.received += count;
+		}
+		data.lastReceived = system_time();
+	}
+
+	return NULL;
+}
+
+
+static uint32
+send_datagrams(int fd, const sockaddr_in& target, mode sendMode)
+{
+	static char data[kBatchSize * kDatagramSize];
+	memset(data, 'x', sizeof(data));
+
+	iovec vecs[kBatchSize];
+	mmsghdr messages[kBatchSize];
+	memset(messages, 0, sizeof(messages));
+	for (uint32 i = 0; i < kBatchSize; i++) {
+		vecs[i].iov_base = data + i * kDatagramSize;
+		vecs[i].iov_len = kDatagramSize;
+		messages[i].msg_hdr.msg_name = (void*)&target;
+		messages[i].msg_hdr.msg_namelen = sizeof(target);
+		messages[i].msg_hdr.msg_iov = &vecs[i];
+		messages[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	if (sendMode == MODE_SEGMENT) {
+		int segmentSize = kDatagramSize;
+		if (setsockopt(fd, IPPROTO_UDP, UDP_SEGMENT, &segmentSize,
+				sizeof(segmentSize)) != 0) {
+			fprintf(stderr, "failed to set UDP_SEGMENT: %s\n",
+				strerror(errno));
+			exit(1);
+		}
+	}
+
+	uint32 sent = 0;
+	while (sent < kDatagramCount) {
+		uint32 count = kBatchSize;
+		if (count > kDatagramCount - sent)
+			count = kDatagramCount - sent;
+
+		switch (sendMode) {
+			case MODE_SINGLE:
+				if (sendto(fd, data, kDatagramSize, 0, (sockaddr*)&target,
+						sizeof(target)) == (ssize_t)kDatagramSize) {
+					count = 1;
+				} else
+					count = 0;
+				break;
+
+			case MODE_BATCH:
+			{
+				int result = sendmmsg(fd, messages, count, 0);
+				count = result > 0 ? result : 0;
+				break;
+			}
+
+			case MODE_SEGMENT:
+				if (sendto(fd, data, count * kDatagramSize, 0,
+						(sockaddr*)&target, sizeof(target)) < 0) {
+					count = 0;
+				}
+				break;
+		}
+
+		if (count == 0) {
+			if (errno != ENOBUFS && errno != EAGAIN) {
+				fprintf(stderr, "%s: sending failed: %s\n",
+					kModeNames[sendMode], strerror(errno));
+				exit(1);
+			}
+			snooze(100);
+		}
+		sent += count;
+	}
+
+	return sent;
+}
+
+
+static bool
+run(mode testMode)
+{
+	sockaddr_in receiverAddress;
+	sockaddr_in senderAddress;
+	int receiveFD = open_socket(receiverAddress);
+	int sendFD = open_socket(senderAddress);
+
+	int bufferSize = 1024 * 1024;
+	setsockopt(receiveFD, SOL_SOCKET, SO_RCVBUF, &bufferSize,
+		sizeof(bufferSize));
+
+	receiver data = { receiveFD, testMode == MODE_SINGLE
+		? MODE_SINGLE : MODE_BATCH, 0, 0, 0 };
+	pthread_t thread;
+	pthread_create(&thread, NULL, &receive_thread, &data);
+
+	bigtime_t start = system_time();
+	uint32 sent = send_datagrams(sendFD, receiverAddress, testMode);
+	bigtime_t sendTime = system_time() - start;
+
+	pthread_join(thread, NULL);
+	bigtime_t receiveTime = data.lastReceived - start;
+
+	printf("%-22s sent %8.0f/s, received %8.0f/s (%" B_PRIu32 " of %" B_PRIu32
+		" datagrams)\n", kModeNames[testMode], 1000000.0 * sent / sendTime,
+		receiveTime > 0 ? 1000000.0 * data.received / receiveTime : 0.0,
+		data.received, sent);
+
+	close(receiveFD);
+	close(sendFD);
+
+	if (data.badSize != 0) {
+		fprintf(stderr, "%s: %" B_PRIu32 " datagrams had the wrong size\n",
+			kModeNames[testMode], data.badSize);
+		return false;
+	}
+	if (data.received == 0) {
+		fprintf(stderr, "%s: nothing received\n", kModeNames[testMode]);
+		return false;
+	}
+
+	return true;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	bool success = run(MODE_SINGLE);
+	success &= run(MODE_BATCH);
+	success &= run(MODE_SEGMENT);
+
+	if (!success)
+		return 1;
+
+	printf("All tests passed.\n");
+	return 0;
+}
@@ -6,7 +6,10 @@
 
 #include "fssh.h"
 
+#include "command_benchmark.h"
 #include "command_checkfs.h"
+#include "command_compact.h"
+#include "command_explain.h"
 #include "command_resizefs.h"
 
 
@@ -16,10 +19,23 @@ namespace FSShell {
 void
 register_additional_commands()
 {
+	CommandManager::Default()->AddCommand(command_benchmark, "benchmark",
+		"benchmark metadata operations");
 	CommandManager::Default()->AddCommand(command_checkfs, "checkfs",
 		"check file system");
+	CommandManager::Default()->AddCommand(command_compact, "compact",
+		"compact the B+tree of a directory or index");
+	CommandManager::Default()->AddCommand(command_compact_benchmark,
+		"compactbench", "benchmark directory lookups before and after "
+		"compacting");
+	CommandManager::Default()->AddCommand(command_explain, "explain",
+		"show how a query is evaluated");
+	CommandManager::Default()->AddCommand(command_query_benchmark,
+		"querybench", "benchmark combined and substring queries");
 	CommandManager::Default()->AddCommand(command_resizefs, "resizefs",
 		"resize file system");
+	CommandManager::Default()->AddCommand(command_small_file_benchmark,
+		"smallfilebench", "benchmark creating and reading small files");
 }
 
 
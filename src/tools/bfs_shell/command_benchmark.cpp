@@ -0,0 +1,1197 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "command_benchmark.h"
+
+#include "fssh_dirent.h"
+#include "fssh_fs_info.h"
+#include "fssh_stat.h"
+#include "fssh_stdio.h"
+#include "syscalls.h"
+
+#include "bfs.h"
+#include "bfs_control.h"
+
+
+namespace FSShell {
+
+
+static const int32 kMaxDirectories = 64;
+static const int32 kMaxOpenFiles = 64;
+static const size_t kAppendSize = 4096;
+
+static const char* kQueryWords[] = {
+	"alpha", "Beta", "gamma", "DELTA", "epsilon", "zeta", "Theta", "iota",
+	"kappa", "lambda", "Sigma", "omega", "report", "photo", "invoice", "notes"
+};
+static const int32 kQueryWordCount
+	= sizeof(kQueryWords) / sizeof(kQueryWords[0]);
+static const char* kQueryExtensions[] = {
+	"txt", "jpg", "pdf", "cpp", "mp3", "html"
+};
+static const int32 kQueryExtensionCount
+	= sizeof(kQueryExtensions) / sizeof(kQueryExtensions[0]);
+
+static const char* kBenchmarkQueries[] = {
+	"name==\"*lambda*\"",
+	"name==\"*[sS][iI][gG][mM][aA]*\"",
+	"name==\"*photo_notes*\"",
+	"name==\"*-0004*\"",
+	"name==\"*.html\"",
+	"name==\"*missing*\""
+};
+static const int32 kBenchmarkQueryCount
+	= sizeof(kBenchmarkQueries) / sizeof(kBenchmarkQueries[0]);
+
+static const char* kQueryKindIndex = "QUERY:kind";
+static const char* kQueryKinds[] = {
+	"text", "image", "audio", "video", "mail"
+};
+static const int32 kQueryKindCount
+	= sizeof(kQueryKinds) / sizeof(kQueryKinds[0]);
+static const time_t kQueryBaseTime = 1700000000;
+
+
+// Every file gets one of the kinds, a size below 1000 bytes, and a
+// modification time that is at most 996 seconds after kQueryBaseTime.
+
+static bool
+match_combined_kind_size_time(int32 file)
+{
+	return file % kQueryKindCount == 0 && file % 1000 >= 900
+		&& file % 997 >= 900;
+}
+
+
+static bool
+match_combined_size_time(int32 file)
+{
+	return file % 1000 >= 990 && file % 997 >= 10;
+}
+
+
+static bool
+match_combined_kind_size(int32 file)
+{
+	return file % kQueryKindCount == 1 && file % 1000 < 50;
+}
+
+
+static bool
+match_combined_kind_or_size(int32 file)
+{
+	// there are no files that match both
+	return file % kQueryKindCount == 2 || file % 1000 == 123;
+}
+
+
+static bool
+match_combined_name_size(int32 file)
+{
+	return (file % kQueryWordCount == 9
+			|| (file / kQueryWordCount) % kQueryWordCount == 9)
+		&& file % 1000 >= 500;
+}
+
+
+static bool
+match_combined_time_kind(int32 file)
+{
+	return file % 997 == 500 && file % kQueryKindCount == 4;
+}
+
+
+struct combined_query {
+	const char*	query;
+	bool		(*matches)(int32 file);
+};
+
+static const combined_query kCombinedQueries[] = {
+	{"(QUERY:kind==\"text\")&&(size>=900)&&(last_modified>=1700000900)",
+		&match_combined_kind_size_time},
+	{"(size>=990)&&(last_modified>=1700000010)", &match_combined_size_time},
+	{"(QUERY:kind==\"image\")&&(size<50)", &match_combined_kind_size},
+	{"(QUERY:kind==\"audio\")||(size==123)", &match_combined_kind_or_size},
+	{"(name==\"*lambda*\")&&(size>=500)", &match_combined_name_size},
+	{"(last_modified==1700000500)&&(QUERY:kind==\"mail\")",
+		&match_combined_time_kind}
+};
+static const int32 kCombinedQueryCount
+	= sizeof(kCombinedQueries) / sizeof(kCombinedQueries[0]);
+
+
+struct benchmark_options {
+	int32		directories;
+	int32		files;
+	int32		syncInterval;
+	off_t		appendBytes;
+	bool		sharedDirectory;
+};
+
+
+static void
+file_path(const benchmark_options& options, int32 file, char* path,
+	size_t length)
+{
+	int32 directory = file % options.directories;
+	if (options.sharedDirectory) {
+		snprintf(path, length, "/myfs/benchmark/d%" B_PRId32 "-%" B_PRId32,
+			directory, file);
+	} else {
+		snprintf(path, length, "/myfs/benchmark/%" B_PRId32 "/%" B_PRId32,
+			directory, file);
+	}
+}
+
+
+/*!	Creates the files, and writes an attribute to each of them. The files
+	are spread over the directories in turn, like concurrent clients would.
+	The fs_shell is single threaded, though, so this only measures the cost
+	of each operation; bfs_metadata_benchmark runs them in parallel on a
+	mounted volume.
+*/
+static status_t
+create_files(const benchmark_options& options)
+{
+	char path[B_PATH_NAME_LENGTH];
+
+	for (int32 i = 0; i < options.files; i++) {
+		file_path(options, i, path, sizeof(path));
+
+		int fd = _kern_open(-1, path, O_RDWR | O_CREAT | O_EXCL, 0644);
+		if (fd < 0)
+			return fd;
+
+		char value[32];
+		snprintf(value, sizeof(value), "file %" B_PRId32, i);
+
+		status_t status = B_OK;
+		int attr = _kern_create_attr(fd, "BENCH:value", B_STRING_TYPE,
+			O_WRONLY | O_TRUNC);
+		if (attr >= 0) {
+			ssize_t bytesWritten = _kern_write(attr, 0, value,
+				strlen(value) + 1);
+			if (bytesWritten < 0)
+				status = bytesWritten;
+			_kern_close(attr);
+		} else
+			status = attr;
+
+		if (status == B_OK && options.syncInterval > 0
+			&& (i + 1) % options.syncInterval == 0)
+			status = _kern_fsync(fd, false);
+
+		_kern_close(fd);
+
+		if (status != B_OK)
+			return status;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Appends data to the files in small pieces. Up to kMaxOpenFiles files are
+	open at the same time, and are written to in turn, like log files would.
+*/
+static status_t
+append_files(const benchmark_options& options)
+{
+	static char buffer[kAppendSize];
+	memset(buffer, 'x', sizeof(buffer));
+
+	char path[B_PATH_NAME_LENGTH];
+	int fds[kMaxOpenFiles];
+
+	for (int32 first = 0; first < options.files; first += kMaxOpenFiles) {
+		int32 count = min_c(options.files - first, kMaxOpenFiles);
+		status_t status = B_OK;
+
+		int32 opened = 0;
+		for (; opened < count; opened++) {
+			file_path(options, first + opened, path, sizeof(path));
+
+			fds[opened] = _kern_open(-1, path, O_WRONLY | O_APPEND, 0);
+			if (fds[opened] < 0) {
+				status = fds[opened];
+				break;
+			}
+		}
+
+		for (off_t written = 0; status == B_OK
+				&& written < options.appendBytes; written += kAppendSize) {
+			size_t length = min_c(options.appendBytes - written,
+				(off_t)kAppendSize);
+
+			for (int32 i = 0; i < opened; i++) {
+				ssize_t bytesWritten = _kern_write(fds[i], -1, buffer, length);
+				if (bytesWritten < 0) {
+					status = bytesWritten;
+					break;
+				}
+			}
+		}
+
+		for (int32 i = 0; i < opened; i++)
+			_kern_close(fds[i]);
+
+		if (status != B_OK)
+			return status;
+	}
+
+	return B_OK;
+}
+
+
+static status_t
+remove_files(const benchmark_options& options)
+{
+	char path[B_PATH_NAME_LENGTH];
+
+	for (int32 i = 0; i < options.files; i++) {
+		file_path(options, i, path, sizeof(path));
+
+		status_t status = _kern_unlink(-1, path);
+		if (status != B_OK)
+			return status;
+	}
+
+	return B_OK;
+}
+
+
+static void
+print_rate(const char* action, int64 operations, bigtime_t time)
+{
+	if (time <= 0)
+		time = 1;
+
+	fssh_dprintf("  %-8s %8" B_PRId64 " in %6" B_PRId64 " ms, %10.1f/s\n",
+		action, operations, time / 1000, operations * 1000000.0 / time);
+}
+
+
+static void
+query_file_path(const benchmark_options& options, int32 file, char* path,
+	size_t length)
+{
+	snprintf(path, length, "/myfs/querybench/%" B_PRId32 "/%s_%s-%07" B_PRId32
+		".%s", file % options.directories, kQueryWords[file % kQueryWordCount],
+		kQueryWords[(file / kQueryWordCount) % kQueryWordCount], file,
+		kQueryExtensions[(file / 3) % kQueryExtensionCount]);
+}
+
+
+/*!	Runs \a query, and returns the number of entries it found, or an error
+	code.
+*/
+static int32
+run_query(dev_t device, const char* query)
+{
+	int fd = _kern_open_query(device, query, strlen(query), 0, -1, -1);
+	if (fd < 0)
+		return fd;
+
+	char buffer[sizeof(struct dirent) + B_FILE_NAME_LENGTH];
+	struct dirent* entry = (struct dirent*)buffer;
+	int32 count = 0;
+	ssize_t entriesRead;
+	while ((entriesRead = _kern_read_dir(fd, entry, sizeof(buffer), 1)) == 1)
+		count++;
+
+	_kern_close(fd);
+
+	if (entriesRead < 0)
+		return entriesRead;
+	return count;
+}
+
+
+static status_t
+set_index_cache(int rootDir, uint64 size)
+{
+	return _kern_ioctl(rootDir, BFS_IOCTL_SET_INDEX_CACHE, &size,
+		sizeof(size));
+}
+
+
+/*!	Runs all benchmark queries, and stores the number of entries they found
+	in \a counts, and the time they took in \a times.
+*/
+static status_t
+run_queries(dev_t device, int32* counts, bigtime_t* times)
+{
+	for (int32 i = 0; i < kBenchmarkQueryCount; i++) {
+		bigtime_t start = system_time();
+		counts[i] = run_query(device, kBenchmarkQueries[i]);
+		times[i] = system_time() - start;
+
+		if (counts[i] < 0)
+			return counts[i];
+	}
+
+	return B_OK;
+}
+
+
+static bool
+compare_counts(const int32* counts, const int32* expected)
+{
+	bool equal = true;
+	for (int32 i = 0; i < kBenchmarkQueryCount; i++) {
+		if (counts[i] != expected[i]) {
+			fssh_dprintf("Query %s found %" B_PRId32 " entries with the index "
+				"cache, %" B_PRId32 " without!\n", kBenchmarkQueries[i],
+				counts[i], expected[i]);
+			equal = false;
+		}
+	}
+	return equal;
+}
+
+
+/*!	Renames every seventh file, so that it gets another extension, and
+	removes every 31st file, to see if the index cache keeps up with the
+	changes.
+*/
+static status_t
+change_query_files(const benchmark_options& options)
+{
+	char path[B_PATH_NAME_LENGTH];
+	char newPath[B_PATH_NAME_LENGTH];
+
+	for (int32 i = 0; i < options.files; i++) {
+		query_file_path(options, i, path, sizeof(path));
+
+		status_t status = B_OK;
+		if (i % 7 == 1) {
+			snprintf(newPath, sizeof(newPath), "%s.moved", path);
+			status = _kern_rename(-1, path, -1, newPath);
+		} else if (i % 31 == 0)
+			status = _kern_unlink(-1, path);
+
+		if (status != B_OK)
+			return status;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Gives the file its kind, size, and modification time for the combined
+	queries.
+*/
+static status_t
+set_query_file_attributes(int fd, int32 file)
+{
+	const char* kind = kQueryKinds[file % kQueryKindCount];
+	int attr = _kern_create_attr(fd, kQueryKindIndex, B_STRING_TYPE,
+		O_WRONLY | O_TRUNC);
+	if (attr < 0)
+		return attr;
+
+	ssize_t bytesWritten = _kern_write(attr, 0, kind, strlen(kind) + 1);
+	_kern_close(attr);
+	if (bytesWritten < 0)
+		return bytesWritten;
+
+	struct stat fileStat;
+	fileStat.st_size = file % 1000;
+	fileStat.st_mtim.tv_sec = kQueryBaseTime + file % 997;
+	fileStat.st_mtim.tv_nsec = 0;
+	return _kern_write_stat(fd, NULL, false, &fileStat, sizeof(fileStat),
+		B_STAT_SIZE | B_STAT_MODIFICATION_TIME);
+}
+
+
+/*!	Runs queries that combine several indices, and checks that they find
+	exactly the files they should. With \a verbose, the query plans are
+	printed as well.
+*/
+static status_t
+benchmark_combined_queries(int rootDir, const benchmark_options& options,
+	bool verbose)
+{
+	char buffer[8192];
+
+	for (int32 i = 0; i < kCombinedQueryCount; i++) {
+		const combined_query& query = kCombinedQueries[i];
+
+		int32 expected = 0;
+		for (int32 file = 0; file < options.files; file++) {
+			if (query.matches(file))
+				expected++;
+		}
+
+		explain_query_control control;
+		control.query = query.query;
+		control.buffer = buffer;
+		control.buffer_size = sizeof(buffer);
+		control.flags = BFS_EXPLAIN_RUN;
+
+		bigtime_t start = system_time();
+		status_t status = _kern_ioctl(rootDir, BFS_IOCTL_EXPLAIN_QUERY,
+			&control, sizeof(control));
+		bigtime_t time = system_time() - start;
+		if (status != B_OK && status != B_BUFFER_OVERFLOW)
+			return status;
+
+		fssh_dprintf("  %-60s %7" B_PRIu32 " found, %6" B_PRId64 " ms\n",
+			query.query, control.entries_found, time / 1000);
+		if (verbose)
+			fssh_dprintf("%s\n", buffer);
+
+		if ((int32)control.entries_found != expected) {
+			fssh_dprintf("Query %s should have found %" B_PRId32 " entries!\n",
+				query.query, expected);
+			return B_ERROR;
+		}
+	}
+
+	return B_OK;
+}
+
+
+/*!	Runs the benchmark queries without the index cache, and with it, and
+	makes sure both find the same entries. Then the files are changed while
+	the cache is in use, and the queries are compared again.
+*/
+static status_t
+benchmark_queries(int rootDir, dev_t device,
+	const benchmark_options& options, uint64 cacheSize)
+{
+	int32 scanCounts[kBenchmarkQueryCount];
+	int32 counts[kBenchmarkQueryCount];
+	bigtime_t scanTimes[kBenchmarkQueryCount];
+	bigtime_t times[kBenchmarkQueryCount];
+
+	status_t status = set_index_cache(rootDir, 0);
+	if (status == B_OK)
+		status = run_queries(device, scanCounts, scanTimes);
+	if (status == B_OK)
+		status = set_index_cache(rootDir, cacheSize);
+
+	// the first query builds the trigram index
+	bigtime_t start = system_time();
+	if (status == B_OK)
+		status = run_query(device, kBenchmarkQueries[0]);
+	bigtime_t buildTime = system_time() - start;
+
+	if (status >= B_OK)
+		status = run_queries(device, counts, times);
+	if (status != B_OK)
+		return status;
+
+	for (int32 i = 0; i < kBenchmarkQueryCount; i++) {
+		fssh_dprintf("  %-36s %7" B_PRId32 " found, scan %6" B_PRId64 " ms, "
+			"cached %6" B_PRId64 " ms\n", kBenchmarkQueries[i], scanCounts[i],
+			scanTimes[i] / 1000, times[i] / 1000);
+	}
+
+	index_cache_info info;
+	if (_kern_ioctl(rootDir, BFS_IOCTL_GET_INDEX_CACHE_INFO, &info,
+			sizeof(info)) == B_OK) {
+		fssh_dprintf("Index cache: %" B_PRIu64 " KB, built in %" B_PRId64
+			" ms\n", info.size / 1024, buildTime / 1000);
+	}
+
+	if (!compare_counts(counts, scanCounts))
+		return B_ERROR;
+
+	status = change_query_files(options);
+	if (status == B_OK)
+		status = run_queries(device, counts, times);
+	if (status == B_OK) {
+		status = _kern_ioctl(rootDir, BFS_IOCTL_GET_INDEX_CACHE_INFO, &info,
+			sizeof(info));
+	}
+	if (status == B_OK)
+		status = set_index_cache(rootDir, 0);
+	if (status == B_OK)
+		status = run_queries(device, scanCounts, scanTimes);
+	if (status != B_OK)
+		return status;
+
+	if (!compare_counts(counts, scanCounts))
+		return B_ERROR;
+
+	fssh_dprintf("Results still match after renaming and removing files "
+		"(index built %" B_PRIu32 " times)\n", info.builds);
+	return B_OK;
+}
+
+
+fssh_status_t
+command_query_benchmark(int argc, const char* const* argv)
+{
+	benchmark_options options;
+	options.directories = 16;
+	options.files = 100000;
+	uint64 cacheSize = 256;
+	bool verbose = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-D") && i + 1 < argc)
+			options.directories = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			options.files = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-c") && i + 1 < argc)
+			cacheSize = strtoull(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-v"))
+			verbose = true;
+		else {
+			fssh_dprintf("Usage: %s [-D <directories>] [-n <files>] "
+				"[-c <MB>] [-v]\n"
+				"Creates <files> small files with varying names and "
+				"attributes, runs queries\nthat combine several indices, and "
+				"substring queries with and without the\nindex cache.\n"
+				"  -c  maximum size of the index cache, default is 256 MB\n"
+				"  -v  print the plans of the combined queries\n",
+				argv[0]);
+			return B_BAD_VALUE;
+		}
+	}
+
+	if (options.directories < 1 || options.directories > kMaxDirectories
+		|| options.files < 1 || cacheSize == 0) {
+		fssh_dprintf("Invalid number of directories, files, or cache size\n");
+		return B_BAD_VALUE;
+	}
+
+	int rootDir = _kern_open_dir(-1, "/myfs");
+	if (rootDir < 0)
+		return rootDir;
+
+	struct stat rootStat;
+	status_t status = _kern_read_stat(rootDir, NULL, false, &rootStat,
+		sizeof(rootStat));
+	if (status == B_OK) {
+		status = _kern_create_index(rootStat.st_dev, kQueryKindIndex,
+			B_STRING_TYPE, 0);
+	}
+	if (status == B_OK)
+		status = _kern_create_dir(-1, "/myfs/querybench", 0755);
+
+	char path[B_PATH_NAME_LENGTH];
+	for (int32 i = 0; status == B_OK && i < options.directories; i++) {
+		snprintf(path, sizeof(path), "/myfs/querybench/%" B_PRId32, i);
+		status = _kern_create_dir(-1, path, 0755);
+	}
+
+	bigtime_t start = system_time();
+	for (int32 i = 0; status == B_OK && i < options.files; i++) {
+		query_file_path(options, i, path, sizeof(path));
+
+		int fd = _kern_open(-1, path, O_RDWR | O_CREAT | O_EXCL, 0644);
+		if (fd < 0)
+			status = fd;
+		else {
+			status = set_query_file_attributes(fd, i);
+			_kern_close(fd);
+		}
+	}
+
+	if (status == B_OK) {
+		print_rate("created", options.files, system_time() - start);
+		status = benchmark_combined_queries(rootDir, options, verbose);
+	}
+	if (status == B_OK) {
+		status = benchmark_queries(rootDir, rootStat.st_dev, options,
+			cacheSize * 1024 * 1024);
+	}
+
+	set_index_cache(rootDir, 0);
+
+	if (status == B_OK) {
+		// remove what change_query_files() left over
+		for (int32 i = 0; status == B_OK && i < options.files; i++) {
+			if (i % 7 != 1 && i % 31 == 0)
+				continue;
+
+			query_file_path(options, i, path, sizeof(path));
+			if (i % 7 == 1)
+				strlcat(path, ".moved", sizeof(path));
+			status = _kern_unlink(-1, path);
+		}
+		for (int32 i = 0; status == B_OK && i < options.directories; i++) {
+			snprintf(path, sizeof(path), "/myfs/querybench/%" B_PRId32, i);
+			status = _kern_remove_dir(-1, path);
+		}
+		if (status == B_OK)
+			status = _kern_remove_dir(-1, "/myfs/querybench");
+		if (status == B_OK)
+			status = _kern_remove_index(rootStat.st_dev, kQueryKindIndex);
+	}
+
+	_kern_close(rootDir);
+
+	if (status != B_OK) {
+		fssh_dprintf("Benchmark failed: %s\n", strerror(status));
+		return status;
+	}
+
+	return B_OK;
+}
+
+
+fssh_status_t
+command_benchmark(int argc, const char* const* argv)
+{
+	benchmark_options options;
+	options.directories = 4;
+	options.files = 4000;
+	options.syncInterval = 0;
+	options.appendBytes = 0;
+	options.sharedDirectory = false;
+	bool keepFiles = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-D") && i + 1 < argc)
+			options.directories = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			options.files = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+			options.syncInterval = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-a") && i + 1 < argc)
+			options.appendBytes = strtoll(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-d"))
+			options.sharedDirectory = true;
+		else if (!strcmp(argv[i], "-k"))
+			keepFiles = true;
+		else {
+			fssh_dprintf("Usage: %s [-D <directories>] [-n <files>] "
+				"[-s <sync interval>] [-a <bytes>] [-d] [-k]\n"
+				"Creates <files> files with an attribute each, spread over "
+				"<directories>\ndirectories, and removes them again, all "
+				"from a single thread.\n"
+				"  -s  fsync() every <sync interval> files\n"
+				"  -a  append <bytes> to each file in 4 KB pieces, with "
+				"several files\n      being written at the same time\n"
+				"  -d  put all files into a single directory\n"
+				"  -k  keep the files, ie. to check their fragmentation with "
+				"checkfs\n", argv[0]);
+			return B_BAD_VALUE;
+		}
+	}
+
+	if (options.directories < 1 || options.directories > kMaxDirectories
+		|| options.files < 1) {
+		fssh_dprintf("Invalid number of directories or files\n");
+		return B_BAD_VALUE;
+	}
+
+	status_t status = _kern_create_dir(-1, "/myfs/benchmark", 0755);
+	if (status != B_OK && status != B_FILE_EXISTS)
+		return status;
+
+	if (!options.sharedDirectory) {
+		for (int32 i = 0; i < options.directories; i++) {
+			char path[B_PATH_NAME_LENGTH];
+			snprintf(path, sizeof(path), "/myfs/benchmark/%" B_PRId32, i);
+			status = _kern_create_dir(-1, path, 0755);
+			if (status != B_OK && status != B_FILE_EXISTS)
+				return status;
+		}
+	}
+
+	bigtime_t start = system_time();
+	status = create_files(options);
+	bigtime_t createTime = system_time() - start;
+
+	bigtime_t appendTime = 0;
+	if (status == B_OK && options.appendBytes > 0) {
+		start = system_time();
+		status = append_files(options);
+		appendTime = system_time() - start;
+	}
+
+	bigtime_t removeTime = 0;
+	if (status == B_OK && !keepFiles) {
+		start = system_time();
+		status = remove_files(options);
+		removeTime = system_time() - start;
+	}
+
+	if (status != B_OK) {
+		fssh_dprintf("Benchmark failed: %s\n", strerror(status));
+		return status;
+	}
+
+	fssh_dprintf("%" B_PRId32 " files in %" B_PRId32 " director%s%s:\n",
+		options.files, options.sharedDirectory ? 1 : options.directories,
+		options.sharedDirectory || options.directories == 1 ? "y" : "ies",
+		options.syncInterval > 0 ? ", with fsync()" : "");
+	print_rate("created", options.files, createTime);
+	if (options.appendBytes > 0) {
+		print_rate("appended", options.files
+			* ((options.appendBytes + kAppendSize - 1) / kAppendSize),
+			appendTime);
+	}
+	if (!keepFiles) {
+		print_rate("removed", options.files, removeTime);
+		print_rate("total", 2 * options.files, createTime + removeTime);
+	}
+
+	return B_OK;
+}
+
+
+//	#pragma mark - compaction
+
+
+static const char* kCompactDirectory = "/myfs/compactbench";
+static const int32 kCompactLookupRounds = 5;
+
+
+/*!	The names are scattered, so that the files that are removed leave holes
+	all over the B+tree of the directory.
+*/
+static void
+compact_file_name(int32 file, char* name, size_t length)
+{
+	snprintf(name, length, "entry-%08" B_PRIx32 "-%" B_PRId32,
+		(uint32)file * 2654435761UL, file);
+}
+
+
+static inline bool
+compact_file_kept(int32 file)
+{
+	return file % 4 == 0;
+}
+
+
+/*!	Looks up every file that is left several times, and makes sure the
+	removed ones are really gone.
+*/
+static status_t
+lookup_compact_files(int dir, int32 files, bigtime_t& _time)
+{
+	char name[B_FILE_NAME_LENGTH];
+	struct stat stat;
+
+	bigtime_t start = system_time();
+	for (int32 round = 0; round < kCompactLookupRounds; round++) {
+		for (int32 i = 0; i < files; i += 4) {
+			compact_file_name(i, name, sizeof(name));
+			status_t status = _kern_read_stat(dir, name, false, &stat,
+				sizeof(stat));
+			if (status != B_OK)
+				return status;
+		}
+	}
+	_time = system_time() - start;
+
+	for (int32 i = 0; i < files; i++) {
+		if (compact_file_kept(i))
+			continue;
+
+		compact_file_name(i, name, sizeof(name));
+		if (_kern_read_stat(dir, name, false, &stat, sizeof(stat))
+				!= B_ENTRY_NOT_FOUND) {
+			fssh_dprintf("Removed file \"%s\" was found\n", name);
+			return B_ERROR;
+		}
+	}
+
+	return B_OK;
+}
+
+
+/*!	Reads up to \a count entries from \a dir, and counts how often every
+	file has been seen in \a seen.
+*/
+static status_t
+read_compact_directory(int dir, int32 files, int32 count, uint8* seen,
+	int32& _read)
+{
+	union {
+		struct fssh_dirent dirent;
+		char buffer[sizeof(struct fssh_dirent) + B_FILE_NAME_LENGTH];
+	} entry;
+
+	_read = 0;
+	while (_read < count) {
+		ssize_t result = _kern_read_dir(dir, &entry.dirent, sizeof(entry), 1);
+		if (result < 0)
+			return result;
+		if (result == 0)
+			break;
+
+		const char* name = entry.dirent.d_name;
+		if (strncmp(name, "entry-", 6) == 0) {
+			int32 file = strtol(strrchr(name, '-') + 1, NULL, 10);
+			if (file < 0 || file >= files || seen[file] == 255)
+				return B_BAD_DATA;
+			seen[file]++;
+		}
+		_read++;
+	}
+
+	return B_OK;
+}
+
+
+static status_t
+compact_tree(int fd, const char* index, compact_tree_control& control)
+{
+	memset(&control, 0, sizeof(control));
+	if (index != NULL)
+		strlcpy(control.index, index, sizeof(control.index));
+
+	return _kern_ioctl(fd, BFS_IOCTL_COMPACT_TREE, &control, sizeof(control));
+}
+
+
+static void
+print_compaction(const char* tree, const compact_tree_control& control)
+{
+	fssh_dprintf("  %-10s %" B_PRIu32 " -> %" B_PRIu32 " levels, %7" B_PRIu64
+		" -> %7" B_PRIu64 " nodes, %7" B_PRIu64 " -> %" B_PRIu64 " free\n",
+		tree, control.levels_before, control.levels_after,
+		control.nodes_before, control.nodes_after, control.free_nodes_before,
+		control.free_nodes_after);
+}
+
+
+fssh_status_t
+command_compact_benchmark(int argc, const char* const* argv)
+{
+	int32 files = 50000;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			files = strtol(argv[++i], NULL, 0);
+		else {
+			fssh_dprintf("Usage: %s [-n <files>]\n"
+				"Creates <files> files in a directory, and removes three "
+				"quarters of them.\nThen the lookup of the remaining files "
+				"is timed before and after\ncompacting the directory. The "
+				"directory is read while it is compacted.\n", argv[0]);
+			return B_BAD_VALUE;
+		}
+	}
+
+	if (files < 4) {
+		fssh_dprintf("Invalid number of files\n");
+		return B_BAD_VALUE;
+	}
+
+	uint8* seen = (uint8*)calloc(files, 1);
+	if (seen == NULL)
+		return B_NO_MEMORY;
+
+	status_t status = _kern_create_dir(-1, kCompactDirectory, 0755);
+	int dir = status == B_OK ? _kern_open_dir(-1, kCompactDirectory) : status;
+	if (dir < 0) {
+		free(seen);
+		fssh_dprintf("Benchmark failed: %s\n", strerror(dir));
+		return dir;
+	}
+
+	char name[B_FILE_NAME_LENGTH];
+	for (int32 i = 0; status == B_OK && i < files; i++) {
+		compact_file_name(i, name, sizeof(name));
+		int fd = _kern_open(dir, name, O_RDWR | O_CREAT | O_EXCL, 0644);
+		if (fd < 0)
+			status = fd;
+		else
+			_kern_close(fd);
+	}
+	for (int32 i = 0; status == B_OK && i < files; i++) {
+		if (compact_file_kept(i))
+			continue;
+
+		compact_file_name(i, name, sizeof(name));
+		status = _kern_unlink(dir, name);
+	}
+
+	bigtime_t before = 0;
+	bigtime_t after = 0;
+	compact_tree_control directoryControl;
+	compact_tree_control nameControl;
+	int32 kept = (files + 3) / 4;
+
+	if (status == B_OK)
+		status = lookup_compact_files(dir, files, before);
+
+	// Compact the directory while it is being read, and then make sure that
+	// every entry was returned exactly once
+	int reader = status == B_OK ? _kern_open_dir(dir, ".") : status;
+	if (reader < 0)
+		status = reader;
+
+	int32 read = 0;
+	int32 readAfter = 0;
+	if (status == B_OK)
+		status = read_compact_directory(reader, files, kept / 2, seen, read);
+	if (status == B_OK)
+		status = compact_tree(dir, NULL, directoryControl);
+	if (status == B_OK) {
+		status = read_compact_directory(reader, files, files, seen,
+			readAfter);
+	}
+	if (reader >= 0)
+		_kern_close(reader);
+
+	for (int32 i = 0; status == B_OK && i < files; i++) {
+		if (seen[i] != (compact_file_kept(i) ? 1 : 0)) {
+			fssh_dprintf("File %" B_PRId32 " was read %d times\n", i,
+				seen[i]);
+			status = B_ERROR;
+		}
+	}
+
+	if (status == B_OK)
+		status = compact_tree(dir, "name", nameControl);
+	if (status == B_OK)
+		status = lookup_compact_files(dir, files, after);
+
+	if (status == B_OK) {
+		fssh_dprintf("%" B_PRId32 " of %" B_PRId32 " files left, %" B_PRId32
+			" read before and %" B_PRId32 " after compacting:\n", kept, files,
+			read, readAfter);
+		print_compaction("directory", directoryControl);
+		print_compaction("name index", nameControl);
+		print_rate("before", kept * kCompactLookupRounds, before);
+		print_rate("after", kept * kCompactLookupRounds, after);
+	}
+
+	for (int32 i = 0; status == B_OK && i < files; i += 4) {
+		compact_file_name(i, name, sizeof(name));
+		status = _kern_unlink(dir, name);
+	}
+
+	_kern_close(dir);
+	free(seen);
+
+	if (status == B_OK)
+		status = _kern_remove_dir(-1, kCompactDirectory);
+	if (status != B_OK) {
+		fssh_dprintf("Benchmark failed: %s\n", strerror(status));
+		return status;
+	}
+
+	return B_OK;
+}
+
+
+
+//	#pragma mark - small files
+
+
+static const char* kSmallFileDirectory = "/myfs/smallfilebench";
+static const int32 kSmallFileReadRounds = 5;
+
+
+static size_t
+small_file_size(int32 file, size_t maxSize)
+{
+	return (file * 7919) % maxSize + 1;
+}
+
+
+static void
+fill_small_file(int32 file, uint8* buffer, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+		buffer[i] = (uint8)(file + i * 13);
+}
+
+
+static status_t
+create_small_files(int dir, int32 files, size_t maxSize, uint8* buffer)
+{
+	char name[B_FILE_NAME_LENGTH];
+
+	for (int32 i = 0; i < files; i++) {
+		snprintf(name, sizeof(name), "small-%" B_PRId32, i);
+
+		int fd = _kern_open(dir, name, O_WRONLY | O_CREAT | O_EXCL, 0644);
+		if (fd < 0)
+			return fd;
+
+		size_t size = small_file_size(i, maxSize);
+		fill_small_file(i, buffer, size);
+
+		// write the file in two pieces, so that files also have to grow
+		// out of their inode
+		size_t first = size / 2;
+		ssize_t bytesWritten = _kern_write(fd, 0, buffer, first);
+		if (bytesWritten == (ssize_t)first) {
+			bytesWritten = _kern_write(fd, first, buffer + first,
+				size - first);
+		}
+		_kern_close(fd);
+
+		if (bytesWritten < 0)
+			return bytesWritten;
+		if ((size_t)bytesWritten != size - first)
+			return B_IO_ERROR;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Reads all files back, and verifies their contents. */
+static status_t
+read_small_files(int dir, int32 files, size_t maxSize, uint8* buffer,
+	uint8* expected)
+{
+	char name[B_FILE_NAME_LENGTH];
+
+	for (int32 i = 0; i < files; i++) {
+		snprintf(name, sizeof(name), "small-%" B_PRId32, i);
+
+		int fd = _kern_open(dir, name, O_RDONLY, 0);
+		if (fd < 0)
+			return fd;
+
+		ssize_t bytesRead = _kern_read(fd, 0, buffer, maxSize + 1);
+		_kern_close(fd);
+
+		if (bytesRead < 0)
+			return bytesRead;
+
+		size_t size = small_file_size(i, maxSize);
+		fill_small_file(i, expected, size);
+
+		if ((size_t)bytesRead != size || memcmp(buffer, expected, size) != 0) {
+			fssh_dprintf("File \"%s\" has the wrong contents\n", name);
+			return B_BAD_DATA;
+		}
+	}
+
+	return B_OK;
+}
+
+
+static status_t
+remove_small_files(int dir, int32 files)
+{
+	char name[B_FILE_NAME_LENGTH];
+
+	for (int32 i = 0; i < files; i++) {
+		snprintf(name, sizeof(name), "small-%" B_PRId32, i);
+
+		status_t status = _kern_unlink(dir, name);
+		if (status != B_OK)
+			return status;
+	}
+
+	return B_OK;
+}
+
+
+static status_t
+used_blocks(int dir, off_t& _blocks)
+{
+	struct stat stat;
+	status_t status = _kern_read_stat(dir, NULL, false, &stat, sizeof(stat));
+	if (status != B_OK)
+		return status;
+
+	fs_info info;
+	status = _kern_read_fs_info(stat.st_dev, &info);
+	if (status != B_OK)
+		return status;
+
+	_blocks = info.total_blocks - info.free_blocks;
+	return B_OK;
+}
+
+
+fssh_status_t
+command_small_file_benchmark(int argc, const char* const* argv)
+{
+	int32 files = 10000;
+	size_t maxSize = 1024;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			files = strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+			maxSize = strtoul(argv[++i], NULL, 0);
+		else {
+			fssh_dprintf("Usage: %s [-n <files>] [-s <max size>]\n"
+				"Creates <files> files of up to <max size> bytes, reads them "
+				"back, and\nremoves them again. Compare volumes that were "
+				"initialized with and\nwithout the \"inline_data\" "
+				"parameter.\n", argv[0]);
+			return B_BAD_VALUE;
+		}
+	}
+
+	if (files < 1 || maxSize < 1 || maxSize > 65536) {
+		fssh_dprintf("Invalid number of files, or file size\n");
+		return B_BAD_VALUE;
+	}
+
+	uint8* buffer = (uint8*)malloc(2 * (maxSize + 1));
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+
+	status_t status = _kern_create_dir(-1, kSmallFileDirectory, 0755);
+	int dir = status == B_OK ? _kern_open_dir(-1, kSmallFileDirectory)
+		: status;
+	if (dir < 0) {
+		free(buffer);
+		fssh_dprintf("Benchmark failed: %s\n", strerror(dir));
+		return dir;
+	}
+
+	off_t blocksBefore = 0;
+	off_t blocksAfter = 0;
+	bigtime_t createTime = 0;
+	bigtime_t readTime = 0;
+	bigtime_t removeTime = 0;
+
+	status = used_blocks(dir, blocksBefore);
+	if (status == B_OK) {
+		bigtime_t start = system_time();
+		status = create_small_files(dir, files, maxSize, buffer);
+		createTime = system_time() - start;
+	}
+	if (status == B_OK)
+		status = used_blocks(dir, blocksAfter);
+
+	for (int32 round = 0; status == B_OK && round < kSmallFileReadRounds;
+			round++) {
+		bigtime_t start = system_time();
+		status = read_small_files(dir, files, maxSize, buffer,
+			buffer + maxSize + 1);
+		readTime += system_time() - start;
+	}
+
+	if (status == B_OK) {
+		bigtime_t start = system_time();
+		status = remove_small_files(dir, files);
+		removeTime = system_time() - start;
+	}
+
+	_kern_close(dir);
+	free(buffer);
+
+	if (status == B_OK)
+		status = _kern_remove_dir(-1, kSmallFileDirectory);
+	if (status != B_OK) {
+		fssh_dprintf("Benchmark failed: %s\n", strerror(status));
+		return status;
+	}
+
+	off_t blocks = blocksAfter - blocksBefore;
+	fssh_dprintf("%" B_PRId32 " files of up to %" B_PRIuSIZE " bytes use %"
+		B_PRIdOFF " blocks, %.2f per file:\n", files, maxSize, blocks,
+		(double)blocks / files);
+	print_rate("create", files, createTime);
+	print_rate("read", (int64)files * kSmallFileReadRounds, readTime);
+	print_rate("remove", files, removeTime);
+
+	return B_OK;
+}
+
+}	// namespace FSShell
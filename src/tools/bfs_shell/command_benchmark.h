@@ -0,0 +1,26 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+
+#include "fssh_types.h"
+
+
+namespace FSShell {
+
+
+fssh_status_t command_benchmark(int argc, const char* const* argv);
+fssh_status_t command_query_benchmark(int argc, const char* const* argv);
+fssh_status_t command_compact_benchmark(int argc,
+	const char* const* argv);
+fssh_status_t command_small_file_benchmark(int argc,
+	const char* const* argv);
+
+
+}	// namespace FSShell
+
+
+#endif	// BENCHMARK_H
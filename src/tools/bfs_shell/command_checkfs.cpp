@@ -137,6 +137,9 @@ command_checkfs(int argc, const char* const* argv)
 		result.stats.double_indirect_block_runs,
 		result.stats.double_indirect_array_blocks,
 		result.stats.blocks_in_double_indirect * result.stats.block_size);
+	fssh_dprintf("\tfile extents\t\t\t%" FSSH_B_PRIu64 " (%" FSSH_B_PRIu64
+		" files fragmented)\n", result.file_extents,
+		result.fragmented_files);
 
 	if (result.status == B_ENTRY_NOT_FOUND)
 		result.status = B_OK;
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "command_compact.h"
+
+#include "fssh_stdio.h"
+#include "syscalls.h"
+
+#include "bfs.h"
+#include "bfs_control.h"
+
+
+namespace FSShell {
+
+
+fssh_status_t
+command_compact(int argc, const char* const* argv)
+{
+	const char* index = NULL;
+	const char* path = "/myfs";
+	int i = 1;
+	if (i + 1 < argc && !strcmp(argv[i], "-i")) {
+		index = argv[i + 1];
+		i += 2;
+	}
+	if (i < argc)
+		path = argv[i++];
+
+	if (i != argc || (index != NULL && strlen(index) >= B_FILE_NAME_LENGTH)) {
+		fssh_dprintf("Usage: %s [-i <index>] [<directory>]\n"
+			"Merges underfull nodes of the B+tree of a directory, or of an "
+			"index, and\nfrees the nodes that are no longer needed.\n",
+			argv[0]);
+		return B_ERROR;
+	}
+
+	int fd = _kern_open_dir(-1, path);
+	if (fd < 0) {
+		fssh_dprintf("Error: Couldn't open \"%s\": %s\n", path,
+			fssh_strerror(fd));
+		return fd;
+	}
+
+	compact_tree_control control;
+	memset(&control, 0, sizeof(control));
+	if (index != NULL)
+		strlcpy(control.index, index, sizeof(control.index));
+
+	status_t status = _kern_ioctl(fd, BFS_IOCTL_COMPACT_TREE, &control,
+		sizeof(control));
+
+	_kern_close(fd);
+
+	if (status != B_OK) {
+		fssh_dprintf("Compacting failed: %s\n", fssh_strerror(status));
+		return status;
+	}
+
+	fssh_dprintf("before: %" B_PRIu32 " levels, %" B_PRIu64 " nodes, %"
+		B_PRIu64 " free\n", control.levels_before, control.nodes_before,
+		control.free_nodes_before);
+	fssh_dprintf("after:  %" B_PRIu32 " levels, %" B_PRIu64 " nodes, %"
+		B_PRIu64 " free\n", control.levels_after, control.nodes_after,
+		control.free_nodes_after);
+	return B_OK;
+}
+
+
+}	// namespace FSShell
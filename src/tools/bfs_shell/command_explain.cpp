@@ -0,0 +1,70 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "command_explain.h"
+
+#include "fssh_stdio.h"
+#include "syscalls.h"
+
+#include "bfs.h"
+#include "bfs_control.h"
+
+
+namespace FSShell {
+
+
+fssh_status_t
+command_explain(int argc, const char* const* argv)
+{
+	bool run = false;
+	int i = 1;
+	if (i < argc && !strcmp(argv[i], "-r")) {
+		run = true;
+		i++;
+	}
+
+	if (i + 1 != argc) {
+		fssh_dprintf("Usage: %s [-r] <query>\n"
+			"Shows how the query would be evaluated.\n"
+			"  -r  also runs the query, and shows what each step did\n",
+			argv[0]);
+		return B_ERROR;
+	}
+
+	int rootDir = _kern_open_dir(-1, "/myfs");
+	if (rootDir < 0) {
+		fssh_dprintf("Error: Couldn't open root directory\n");
+		return rootDir;
+	}
+
+	char buffer[8192];
+	explain_query_control control;
+	control.query = argv[i];
+	control.buffer = buffer;
+	control.buffer_size = sizeof(buffer);
+	control.flags = run ? BFS_EXPLAIN_RUN : 0;
+
+	status_t status = _kern_ioctl(rootDir, BFS_IOCTL_EXPLAIN_QUERY,
+		&control, sizeof(control));
+
+	_kern_close(rootDir);
+
+	if (status != B_OK && status != B_BUFFER_OVERFLOW) {
+		fssh_dprintf("Explaining the query failed: %s\n",
+			fssh_strerror(status));
+		return status;
+	}
+
+	fssh_dprintf("%s", buffer);
+	if (run) {
+		fssh_dprintf("found %" B_PRIu32 " entries\n",
+			control.entries_found);
+	}
+	return B_OK;
+}
+
+
+}	// namespace FSShell
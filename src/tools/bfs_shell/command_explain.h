@@ -0,0 +1,21 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef EXPLAIN_H
+#define EXPLAIN_H
+
+
+#include "fssh_types.h"
+
+
+namespace FSShell {
+
+
+fssh_status_t command_explain(int argc, const char* const* argv);
+
+
+}	// namespace FSShell
+
+
+#endif	// EXPLAIN_H
@@ -154,31 +154,30 @@ void
 hash_remove_current(struct hash_table *table, struct hash_iterator *iterator)
 {
 	uint32_t index = iterator->bucket;
-	void *element;
+	void *element, *lastElement = NULL;
 
 	if (iterator->current == NULL)
 		fssh_panic("hash_remove_current() called too early.");
 
-	for (element = table->table[index]; index < table->table_size; index++) {
-		void *lastElement = NULL;
-
-		while (element != NULL) {
-			if (element == iterator->current) {
+	// the current element is always part of the iterator's bucket
+	for (element = table->table[index]; element != NULL;
+			lastElement = element, element = NEXT(table, element)) {
+		if (element == iterator->current) {
+			if (lastElement != NULL) {
+				// connect the previous entry with the next one
+				PUT_IN_NEXT(table, lastElement, NEXT(table, element));
 				iterator->current = lastElement;
+			} else {
+				table->table[index] = (struct hash_element *)NEXT(table,
+					element);
 
-				if (lastElement != NULL) {
-					// connect the previous entry with the next one
-					PUT_IN_NEXT(table, lastElement, NEXT(table, element));
-				} else {
-					table->table[index] = (struct hash_element *)NEXT(table,
-						element);
-				}
-
-				table->num_elements--;
-				return;
+				// let hash_next() continue with the new head of this bucket
+				iterator->bucket = index - 1;
+				iterator->current = NULL;
 			}
 
-			element = NEXT(table, element);
+			table->num_elements--;
+			return;
 		}
 	}
 }
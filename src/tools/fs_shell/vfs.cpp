@@ -5306,9 +5306,9 @@ _kern_fcntl(int fd, int op, uint32_t argument)
 
 
 fssh_status_t
-_kern_fsync(int fd)
+_kern_fsync(int fd, bool dataOnly)
 {
-	return common_sync(fd, false, true);
+	return common_sync(fd, dataOnly, true);
 }
 
 